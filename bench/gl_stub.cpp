@@ -0,0 +1,119 @@
+// Copyright 2024 Chengfu Zou.
+
+#include "gl_stub.hpp"
+
+// clang-format off
+// OpenGL
+#include <GL/glew.h>
+// clang-format on
+
+namespace {
+uint64_t g_calls = 0;
+GLuint g_next_id = 0;
+
+auto genIds(GLsizei n, GLuint* ids) -> void {
+  g_calls++;
+  for (GLsizei i = 0; i < n; ++i) {
+    ids[i] = ++g_next_id;
+  }
+}
+}  // namespace
+
+// GL 1.1的函数由libGL直接导出，在可执行文件中定义同名符号覆盖
+extern "C" {
+void glGenTextures(GLsizei n, GLuint* textures) { genIds(n, textures); }
+void glDeleteTextures(GLsizei, const GLuint*) { g_calls++; }
+void glBindTexture(GLenum, GLuint) { g_calls++; }
+void glTexParameteri(GLenum, GLenum, GLint) { g_calls++; }
+void glTexImage2D(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*) { g_calls++; }
+void glTexSubImage2D(GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, const void*) { g_calls++; }
+void glDrawArrays(GLenum, GLint, GLsizei) { g_calls++; }
+void glDrawElements(GLenum, GLsizei, GLenum, const void*) { g_calls++; }
+void glEnable(GLenum) { g_calls++; }
+void glDisable(GLenum) { g_calls++; }
+void glDepthFunc(GLenum) { g_calls++; }
+void glDepthMask(GLboolean) { g_calls++; }
+void glBlendFunc(GLenum, GLenum) { g_calls++; }
+void glClear(GLbitfield) { g_calls++; }
+void glClearColor(GLfloat, GLfloat, GLfloat, GLfloat) { g_calls++; }
+void glViewport(GLint, GLint, GLsizei, GLsizei) { g_calls++; }
+void glPixelStorei(GLenum, GLint) { g_calls++; }
+void glFlush() { g_calls++; }
+void glFinish() { g_calls++; }
+void glGetIntegerv(GLenum, GLint* data) {
+  g_calls++;
+  *data = 0;
+}
+GLenum glGetError() { return GL_NO_ERROR; }
+}
+
+namespace gl_stub {
+
+auto install() -> void {
+  // 缓冲区和顶点数组
+  __glewGenVertexArrays = [](GLsizei n, GLuint* ids) { genIds(n, ids); };
+  __glewDeleteVertexArrays = [](GLsizei, const GLuint*) { g_calls++; };
+  __glewBindVertexArray = [](GLuint) { g_calls++; };
+  __glewGenBuffers = [](GLsizei n, GLuint* ids) { genIds(n, ids); };
+  __glewDeleteBuffers = [](GLsizei, const GLuint*) { g_calls++; };
+  __glewBindBuffer = [](GLenum, GLuint) { g_calls++; };
+  __glewBufferData = [](GLenum, GLsizeiptr, const void*, GLenum) { g_calls++; };
+  __glewBufferSubData = [](GLenum, GLintptr, GLsizeiptr, const void*) { g_calls++; };
+  __glewVertexAttribPointer = [](GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) { g_calls++; };
+  __glewEnableVertexAttribArray = [](GLuint) { g_calls++; };
+  __glewVertexAttribDivisor = [](GLuint, GLuint) { g_calls++; };
+  // 纹理
+  __glewActiveTexture = [](GLenum) { g_calls++; };
+  __glewGenerateMipmap = [](GLenum) { g_calls++; };
+  // 着色器
+  __glewCreateShader = [](GLenum) -> GLuint {
+    g_calls++;
+    return ++g_next_id;
+  };
+  __glewShaderSource = [](GLuint, GLsizei, const GLchar* const*, const GLint*) { g_calls++; };
+  __glewCompileShader = [](GLuint) { g_calls++; };
+  __glewGetShaderiv = [](GLuint, GLenum, GLint* params) {
+    g_calls++;
+    *params = GL_TRUE;
+  };
+  __glewGetShaderInfoLog = [](GLuint, GLsizei, GLsizei*, GLchar* log) {
+    g_calls++;
+    log[0] = '\0';
+  };
+  __glewCreateProgram = []() -> GLuint {
+    g_calls++;
+    return ++g_next_id;
+  };
+  __glewAttachShader = [](GLuint, GLuint) { g_calls++; };
+  __glewLinkProgram = [](GLuint) { g_calls++; };
+  __glewGetProgramiv = [](GLuint, GLenum, GLint* params) {
+    g_calls++;
+    *params = GL_TRUE;
+  };
+  __glewGetProgramInfoLog = [](GLuint, GLsizei, GLsizei*, GLchar* log) {
+    g_calls++;
+    log[0] = '\0';
+  };
+  __glewDeleteShader = [](GLuint) { g_calls++; };
+  __glewDeleteProgram = [](GLuint) { g_calls++; };
+  __glewUseProgram = [](GLuint) { g_calls++; };
+  __glewGetUniformLocation = [](GLuint, const GLchar*) -> GLint {
+    g_calls++;
+    return 0;
+  };
+  __glewUniform1i = [](GLint, GLint) { g_calls++; };
+  __glewUniform1f = [](GLint, GLfloat) { g_calls++; };
+  __glewUniform2f = [](GLint, GLfloat, GLfloat) { g_calls++; };
+  __glewUniform3f = [](GLint, GLfloat, GLfloat, GLfloat) { g_calls++; };
+  __glewUniform4f = [](GLint, GLfloat, GLfloat, GLfloat, GLfloat) { g_calls++; };
+  __glewUniform2fv = [](GLint, GLsizei, const GLfloat*) { g_calls++; };
+  __glewUniform3fv = [](GLint, GLsizei, const GLfloat*) { g_calls++; };
+  __glewUniform4fv = [](GLint, GLsizei, const GLfloat*) { g_calls++; };
+  __glewUniformMatrix2fv = [](GLint, GLsizei, GLboolean, const GLfloat*) { g_calls++; };
+  __glewUniformMatrix3fv = [](GLint, GLsizei, GLboolean, const GLfloat*) { g_calls++; };
+  __glewUniformMatrix4fv = [](GLint, GLsizei, GLboolean, const GLfloat*) { g_calls++; };
+}
+
+auto callCount() -> uint64_t { return g_calls; }
+
+}  // namespace gl_stub
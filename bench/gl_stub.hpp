@@ -0,0 +1,26 @@
+// Copyright 2024 Chengfu Zou.
+
+#ifndef GL_HOMEWORK_BENCH_GL_STUB_HPP_
+#define GL_HOMEWORK_BENCH_GL_STUB_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+// clang-format on
+
+namespace gl_stub {
+
+/**
+ * @brief 将GLEW的函数指针替换为空实现，不需要OpenGL上下文
+ * GL 1.1的函数(glTexImage2D、glDrawElements等)由gl_stub.cpp中的同名符号覆盖，仅适用于Linux动态链接
+ */
+auto install() -> void;
+
+/**
+ * @brief 空实现被调用的总次数
+ */
+auto callCount() -> uint64_t;
+
+}  // namespace gl_stub
+
+#endif
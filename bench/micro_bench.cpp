@@ -0,0 +1,387 @@
+// Copyright 2024 Chengfu Zou.
+
+// 库自身CPU热点的microbenchmark，GL函数替换为空实现，不需要OpenGL上下文
+// 用法: micro_bench [--filter substr] [--json result.json]
+
+// clang-format off
+// std
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+// OpenGL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+// third party
+#include <fmt/core.h>
+// project
+#include "gl_homework/camera.hpp"
+#include "gl_homework/frame_arena.hpp"
+#include "gl_homework/image_codec.hpp"
+#include "gl_homework/instance_buffer.hpp"
+#include "gl_homework/job_system.hpp"
+#include "gl_homework/occlusion_culler.hpp"
+#include "gl_homework/parametric_mesh_builder.hpp"
+#include "gl_homework/primitive_builder.hpp"
+#include "gl_homework/shader.hpp"
+#include "gl_homework/simple_polytope_builder.hpp"
+#include "gl_homework/texture_loader.hpp"
+#include "gl_homework/transform_store.hpp"
+#include "gl_stub.hpp"
+// clang-format on
+
+// 统计堆分配次数，动态库内的分配同样经过这里
+namespace {
+std::atomic<uint64_t> g_alloc_count{0};
+std::atomic<uint64_t> g_alloc_bytes{0};
+}  // namespace
+
+auto operator new(std::size_t size) -> void* {
+  g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+  g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+auto operator new[](std::size_t size) -> void* { return operator new(size); }
+auto operator delete(void* p) noexcept -> void { std::free(p); }
+auto operator delete[](void* p) noexcept -> void { std::free(p); }
+auto operator delete(void* p, std::size_t) noexcept -> void { std::free(p); }
+auto operator delete[](void* p, std::size_t) noexcept -> void { std::free(p); }
+
+namespace {
+
+struct MicroResult {
+  std::string name;
+  std::string variant;
+  double ns_per_op;
+  double allocs_per_op;
+  double bytes_per_op;
+  double gl_calls_per_op;
+};
+
+auto nowNs() -> uint64_t {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// 写一块远大于LLC的内存，把之前的数据挤出缓存
+auto evictCaches() -> void {
+  static std::vector<char> buffer(32 << 20);
+  static char value = 0;
+  value++;
+  for (size_t i = 0; i < buffer.size(); i += 64) {
+    buffer[i] = value;
+  }
+}
+
+class MicroBench {
+ public:
+  static constexpr uint32_t kMaxColdIterations = 100;
+
+  explicit MicroBench(std::string filter) : filter_(std::move(filter)) {}
+
+  /**
+   * @brief warm: 预热后连续执行；cold: 每次执行前清空缓存，只计时被测函数
+   * 预热、warm和cold传给func的编号互不重叠，按编号缓存的用例在计时范围内不会命中预热的结果
+   */
+  auto run(const std::string& name, uint32_t iterations, const std::function<void(uint32_t)>& func) -> void {
+    if (!filter_.empty() && name.find(filter_) == std::string::npos) {
+      return;
+    }
+    uint32_t warmup = iterations / 10;
+    for (uint32_t i = 0; i < warmup; ++i) {
+      func(i);
+    }
+    auto allocs = g_alloc_count.load();
+    auto bytes = g_alloc_bytes.load();
+    auto calls = gl_stub::callCount();
+    auto begin = nowNs();
+    for (uint32_t i = 0; i < iterations; ++i) {
+      func(warmup + i);
+    }
+    auto elapsed = nowNs() - begin;
+    record(name, "warm", elapsed, iterations, allocs, bytes, calls);
+
+    // 清缓存本身很慢，cold最多执行kMaxColdIterations次
+    uint32_t cold_iterations = std::min(kMaxColdIterations, std::max(1u, iterations / 100));
+    // 首次调用会分配清缓存用的内存，不计入统计
+    evictCaches();
+    elapsed = 0;
+    allocs = g_alloc_count.load();
+    bytes = g_alloc_bytes.load();
+    calls = gl_stub::callCount();
+    for (uint32_t i = 0; i < cold_iterations; ++i) {
+      evictCaches();
+      auto t0 = nowNs();
+      func(warmup + iterations + i);
+      elapsed += nowNs() - t0;
+    }
+    record(name, "cold", elapsed, cold_iterations, allocs, bytes, calls);
+  }
+
+  auto record(const std::string& name, const std::string& variant, uint64_t elapsed, uint32_t iterations,
+              uint64_t allocs_before, uint64_t bytes_before, uint64_t calls_before) -> void {
+    MicroResult r;
+    r.name = name;
+    r.variant = variant;
+    r.ns_per_op = static_cast<double>(elapsed) / iterations;
+    r.allocs_per_op = static_cast<double>(g_alloc_count.load() - allocs_before) / iterations;
+    r.bytes_per_op = static_cast<double>(g_alloc_bytes.load() - bytes_before) / iterations;
+    r.gl_calls_per_op = static_cast<double>(gl_stub::callCount() - calls_before) / iterations;
+    fmt::print("{:<36} {:<5} {:>12.1f} ns/op {:>8.2f} allocs/op {:>10.1f} B/op {:>6.1f} gl/op\n", r.name, r.variant,
+               r.ns_per_op, r.allocs_per_op, r.bytes_per_op, r.gl_calls_per_op);
+    results_.push_back(r);
+  }
+
+  auto writeJson(const std::string& path) -> bool {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+      fmt::print("micro_bench: Failed to open file: {}\n", path);
+      return false;
+    }
+    file << "{\n  \"results\": [";
+    for (size_t i = 0; i < results_.size(); ++i) {
+      const auto& r = results_[i];
+      file << fmt::format(
+          "{}\n    {{\"name\": \"{}\", \"variant\": \"{}\", \"ns_per_op\": {:.2f}, \"allocs_per_op\": {:.3f}, "
+          "\"bytes_per_op\": {:.1f}, \"gl_calls_per_op\": {:.2f}}}",
+          i == 0 ? "" : ",", r.name, r.variant, r.ns_per_op, r.allocs_per_op, r.bytes_per_op, r.gl_calls_per_op);
+    }
+    file << "\n  ]\n}\n";
+    return true;
+  }
+
+ private:
+  std::string filter_;
+  std::vector<MicroResult> results_;
+};
+
+// n*n的网格，每个顶点附带两组vec3数据
+auto gridMesh(uint32_t n, std::vector<glm::vec3>& positions, std::vector<std::vector<float>>& other_data) -> void {
+  for (uint32_t y = 0; y < n; ++y) {
+    for (uint32_t x = 0; x < n; ++x) {
+      positions.emplace_back(static_cast<float>(x), static_cast<float>(y), 0.0f);
+      other_data.push_back({x / static_cast<float>(n), y / static_cast<float>(n), 0.0f, 0.0f, 0.0f, 1.0f});
+    }
+  }
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int {
+  std::string filter;
+  std::string json;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    if (arg == "--filter") {
+      filter = argv[i + 1];
+    } else if (arg == "--json") {
+      json = argv[i + 1];
+    }
+  }
+
+  gl_stub::install();
+  MicroBench bench(filter);
+
+  // PrimitiveBuilderImpl::buildPrimitvie: 首次构建时的顶点重排与上传
+  for (uint32_t n : {6u, 100u}) {
+    std::vector<glm::vec3> positions;
+    std::vector<std::vector<float>> other_data;
+    gridMesh(n, positions, other_data);
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    bench.run(fmt::format("primitive_build_{}verts", n * n), n == 6 ? 20000 : 2000, [&](uint32_t i) {
+      builder->buildTriangles(fmt::format("mesh_{}", i), positions, {}, other_data);
+      // 每次构建视为一帧，顶点重排的临时数组来自FrameArena
+      gl_hwk::FrameArena::instance().reset();
+    });
+  }
+
+  // 已缓存图元的绘制：按名字查找并重新设置顶点属性
+  {
+    std::vector<glm::vec3> positions;
+    std::vector<std::vector<float>> other_data;
+    gridMesh(6, positions, other_data);
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    bench.run("primitive_draw_cached", 200000,
+              [&](uint32_t) { builder->buildTriangles("cube", positions, {}, other_data); });
+  }
+
+  // 示例每帧调用的多面体和单个图元：参数不变时命中缓存，不再生成顶点
+  {
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    gl_hwk::SimplePolytopeBuilder polytopes(builder);
+    const auto cube_data = std::vector<std::vector<float>>(8, {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f});
+    bench.run("polytope_cube_cached", 200000,
+              [&](uint32_t) { polytopes.buildCube("cube", {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}, cube_data); });
+    const auto rect_data = std::vector<std::vector<float>>(4, {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f});
+    bench.run("polytope_rect_cached", 200000, [&](uint32_t) {
+      polytopes.buildRect("rect", {0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, rect_data);
+    });
+    const auto triangle_data = std::vector<float>{0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+    bench.run("primitive_triangle_cached", 200000, [&](uint32_t) {
+      builder->buildTriangle("triangle", {0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, triangle_data);
+    });
+  }
+
+  // 参数化网格的生成，顶点较多时按行并行；以及命中缓存后的绘制
+  {
+    gl_hwk::ParametricParams sphere;
+    gl_hwk::ParametricParams torus;
+    torus.shape = gl_hwk::ParametricShape::kTorus;
+    bench.run("parametric_uv_sphere_32", 20000, [&](uint32_t) { gl_hwk::ParametricMeshBuilder::generate(sphere, 32); });
+    bench.run("parametric_uv_sphere_256", 200, [&](uint32_t) { gl_hwk::ParametricMeshBuilder::generate(sphere, 256); });
+    bench.run("parametric_torus_256", 200, [&](uint32_t) { gl_hwk::ParametricMeshBuilder::generate(torus, 256); });
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    gl_hwk::ParametricMeshBuilder meshes(builder);
+    gl_hwk::Camera camera(glm::vec3(0.0f, 0.0f, -10.0f), 600.f, 1024, 1024);
+    const glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 5.0f));
+    bench.run("parametric_draw_lod_cached", 200000, [&](uint32_t) { meshes.draw(sphere, camera, model); });
+  }
+
+  // 遮挡剔除：光栅化一个细分的平面遮挡物，以及测试墙后的包围盒
+  {
+    gl_hwk::ParametricParams plane;
+    plane.shape = gl_hwk::ParametricShape::kPlane;
+    plane.size = glm::vec2(8.0f);
+    auto mesh = gl_hwk::ParametricMeshBuilder::generate(plane, 16);
+    gl_hwk::OcclusionCuller culler;
+    const glm::mat4 wall = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 5.0f)),
+                                       glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    culler.addOccluder(mesh.positions, mesh.indices, wall);
+    gl_hwk::Camera camera(glm::vec3(0.0f, 0.0f, 0.0f), 600.f, 1024, 512);
+    const glm::mat4 view_projection = camera.getProjectionMatrix() * camera.getViewMatrix();
+    bench.run("occlusion_raster_512_tris", 2000, [&](uint32_t) { culler.render(view_projection); });
+    gl_hwk::Aabb box;
+    box.min = glm::vec3(-0.5f, -0.5f, 9.5f);
+    box.max = glm::vec3(0.5f, 0.5f, 10.5f);
+    bench.run("occlusion_test_box", 200000, [&](uint32_t) { culler.isVisible(box); });
+  }
+
+  // TextureLoader::setTextureAlpha的逐像素循环
+  {
+    GLuint texture = gl_hwk::TextureLoader::instance().loadTexture("texture/wall.jpg");
+    if (texture != 0) {
+      bench.run("texture_set_alpha_512x512", 200,
+                [&](uint32_t i) { gl_hwk::TextureLoader::instance().setTextureAlpha(texture, (i % 255) / 255.0f); });
+    } else {
+      fmt::print("micro_bench: texture/wall.jpg not found, skip texture_set_alpha\n");
+    }
+  }
+
+  // 纹理的冷启动解码：内存中的文件直接解码到复用的缓冲区，比较各指令集
+  {
+    gl_hwk::ImageCodec codec;
+    gl_hwk::Image image;
+    const std::pair<const char*, const char*> files[] = {{"texture/wall.jpg", "jpeg_512x512"},
+                                                         {"texture/m_gq.png", "png_1000x667"}};
+    for (const auto& [path, label] : files) {
+      std::ifstream file(path, std::ios::binary);
+      std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+      if (data.empty()) {
+        fmt::print("micro_bench: {} not found, skip image_decode\n", path);
+        continue;
+      }
+      const std::pair<gl_hwk::SimdLevel, const char*> levels[] = {{gl_hwk::SimdLevel::kScalar, "scalar"},
+                                                                  {gl_hwk::SimdLevel::kAvx2, "avx2"}};
+      for (const auto& [level, name] : levels) {
+        codec.setSimdLevel(level);
+        if (codec.getSimdLevel() != level) {
+          continue;
+        }
+        bench.run(fmt::format("image_decode_{}_{}", label, name), 50, [&](uint32_t i) {
+          gl_hwk::DecodeOptions options;
+          options.flip = (i & 1) != 0;
+          codec.decode(data.data(), data.size(), options, image);
+        });
+      }
+    }
+  }
+
+  // CameraImpl::updateCameraVectors
+  {
+    gl_hwk::Camera camera(glm::vec3(0.0f, 0.0f, -3.0f), 600.f, 1024, 1024);
+    bench.run("camera_turn_yaw", 1000000, [&](uint32_t) { camera.turnYaw(0.1f); });
+    bench.run("camera_view_projection", 1000000, [&](uint32_t) {
+      volatile float sink = (camera.getProjectionMatrix() * camera.getViewMatrix())[0][0];
+      (void)sink;
+    });
+  }
+
+  // 示例中每个立方体的model矩阵
+  {
+    bench.run("model_matrix_translate_rotate", 1000000, [&](uint32_t i) {
+      glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(i * 0.001f, 0.0f, 0.0f));
+      model = glm::rotate(model, glm::radians(i * 0.1f), glm::vec3(1.0f, 0.3f, 0.5f));
+      volatile float sink = model[0][0];
+      (void)sink;
+    });
+  }
+
+  // 大量实例的model和法线矩阵：逐个用glm构建 vs InstanceBuffer并行计算
+  {
+    constexpr size_t kInstances = 100000;
+    std::vector<gl_hwk::Transform> transforms(kInstances);
+    for (size_t i = 0; i < kInstances; ++i) {
+      transforms[i].position = glm::vec3(i % 100, (i / 100) % 100, i / 10000);
+      transforms[i].axis = glm::vec3(1.0f, 0.3f, 0.5f);
+      transforms[i].angle = static_cast<float>(i);
+      transforms[i].scale = glm::vec3(0.5f);
+    }
+    std::vector<gl_hwk::InstanceData> serial(kInstances);
+    bench.run("transform_serial_100k", 20, [&](uint32_t) {
+      for (size_t i = 0; i < kInstances; ++i) {
+        const auto& t = transforms[i];
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), t.position);
+        model = glm::rotate(model, glm::radians(t.angle), t.axis);
+        model = glm::scale(model, t.scale);
+        serial[i].model = model;
+        serial[i].normal = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+      }
+    });
+    gl_hwk::InstanceBuffer instances;
+    bench.run(fmt::format("transform_parallel_100k_{}workers", gl_hwk::JobSystem::instance().getWorkerCount()), 20,
+              [&](uint32_t) { instances.updateTransforms(transforms); });
+
+    // SoA存储 + SIMD，单线程比较各指令集
+    gl_hwk::TransformStore store;
+    for (const auto& t : transforms) {
+      store.add(t.position, glm::angleAxis(glm::radians(t.angle), glm::normalize(t.axis)), t.scale);
+    }
+    const std::pair<gl_hwk::SimdLevel, const char*> levels[] = {
+        {gl_hwk::SimdLevel::kScalar, "scalar"}, {gl_hwk::SimdLevel::kSse, "sse"}, {gl_hwk::SimdLevel::kAvx2, "avx2"}};
+    for (const auto& [level, name] : levels) {
+      store.setSimdLevel(level);
+      if (store.getSimdLevel() != level) {
+        continue;
+      }
+      bench.run(fmt::format("transform_store_100k_{}", name), 20,
+                [&](uint32_t) { store.compose(serial.data(), 0, kInstances); });
+    }
+  }
+
+  // 以字符串为key的查找：uniform位置和图元名字
+  {
+    gl_hwk::Shader shader("shader/phong.vert.GLSL", "shader/phong.frag.GLSL");
+    glm::mat4 model(1.0f);
+    bench.run("shader_set_mat4_by_name", 1000000, [&](uint32_t) { shader.setMat4("model", model); });
+    bench.run("shader_set_vec3_by_name", 1000000, [&](uint32_t) { shader.setVec3("lightColor", 1.0f, 1.0f, 1.0f); });
+    bench.run("example_cube_name_format", 1000000, [&](uint32_t i) {
+      volatile size_t sink = fmt::format("cube_{}", i % 10).size();
+      (void)sink;
+    });
+  }
+
+  if (!json.empty()) {
+    bench.writeJson(json);
+  }
+  return 0;
+}
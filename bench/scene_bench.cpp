@@ -0,0 +1,1151 @@
+// Copyright 2024 Chengfu Zou.
+
+// 场景级benchmark：无窗口渲染一组参数化的压力场景，输出JSON并与baseline比较
+// 用法: bench [--frames N] [--filter substr] [--out result.json] [--baseline baseline.json]
+//             [--tolerance 0.15] [--update-baseline]
+
+// clang-format off
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+// POSIX
+#include <unistd.h>
+// OpenGL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+// third party
+#include <fmt/core.h>
+// project
+#include "gl_homework/camera.hpp"
+#include "gl_homework/clustered_lighting.hpp"
+#include "gl_homework/dynamic_resolution.hpp"
+#include "gl_homework/geometry_pool.hpp"
+#include "gl_homework/gpu_profiler.hpp"
+#include "gl_homework/instance_buffer.hpp"
+#include "gl_homework/multi_view.hpp"
+#include "gl_homework/occlusion_culler.hpp"
+#include "gl_homework/opengl_application.hpp"
+#include "gl_homework/parametric_mesh_builder.hpp"
+#include "gl_homework/primitive_builder.hpp"
+#include "gl_homework/render_graph.hpp"
+#include "gl_homework/scene_graph.hpp"
+#include "gl_homework/shadow_map.hpp"
+#include "gl_homework/shader.hpp"
+#include "gl_homework/skybox.hpp"
+#include "gl_homework/software_renderer.hpp"
+#include "gl_homework/texture_loader.hpp"
+#include "gl_homework/texture_streamer.hpp"
+#include "gl_homework/transform_store.hpp"
+#include "gl_homework/transparency_renderer.hpp"
+// clang-format on
+
+namespace {
+
+struct BenchOptions {
+  uint32_t frames = 60;
+  // 前几帧包含着色器编译、缓冲区创建等一次性开销，不参与统计
+  uint32_t warmup = 5;
+  uint32_t width = 512;
+  uint32_t height = 512;
+  std::string filter;
+  std::string out = "bench_result.json";
+  std::string baseline = "bench/baseline.json";
+  double tolerance = 0.15;
+  bool update_baseline = false;
+};
+
+struct Scene {
+  std::string name;
+  std::function<void()> setup;
+  // 返回本帧的draw call数
+  std::function<uint32_t()> render;
+};
+
+struct SceneResult {
+  std::string name;
+  double cpu_ms = 0.0;
+  double cpu_p99_ms = 0.0;
+  double frame_ms = 0.0;
+  double gpu_ms = 0.0;
+  uint32_t draw_calls = 0;
+  // 从setup之前到场景结束的常驻内存变化
+  int64_t rss_delta_kb = 0;
+};
+
+auto residentMemoryKb() -> uint64_t {
+  std::ifstream statm("/proc/self/statm");
+  uint64_t size = 0, resident = 0;
+  statm >> size >> resident;
+  return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) / 1024;
+}
+
+auto nowMs() -> double {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 立方体的36个顶点，附带纹理坐标和法向量
+auto cubeVertices(std::vector<glm::vec3>& positions, std::vector<std::vector<float>>& other_data) -> void {
+  const glm::vec3 normals[6] = {{0, 0, -1}, {0, 0, 1}, {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}};
+  const float uv[6][2] = {{0, 0}, {1, 0}, {1, 1}, {1, 1}, {0, 1}, {0, 0}};
+  for (const auto& n : normals) {
+    glm::vec3 u = std::abs(n.y) > 0.5f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+    glm::vec3 v = glm::cross(n, u);
+    for (const auto& c : uv) {
+      positions.push_back(n * 0.5f + (u * (c[0] - 0.5f) + v * (c[1] - 0.5f)));
+      other_data.push_back({c[0], c[1], 0.0f, n.x, n.y, n.z});
+    }
+  }
+}
+
+class SceneFactory {
+ public:
+  SceneFactory(const BenchOptions& options) : options_(options) {
+    camera_ = std::make_shared<gl_hwk::Camera>(glm::vec3(0.0f, 0.0f, -40.0f), 600.f, options.width, options.height);
+    cubeVertices(cube_positions_, cube_data_);
+  }
+
+  auto shader(const std::string& name) -> std::shared_ptr<gl_hwk::Shader> {
+    auto it = shaders_.find(name);
+    if (it == shaders_.end()) {
+      auto shader = std::make_shared<gl_hwk::Shader>(fmt::format("shader/{}.vert.GLSL", name),
+                                                     fmt::format("shader/{}.frag.GLSL", name));
+      it = shaders_.emplace(name, shader).first;
+    }
+    return it->second;
+  }
+
+  auto setCommonUniforms(gl_hwk::Shader& shader) -> void {
+    shader.start();
+    shader.setMat4("projection", camera_->getProjectionMatrix());
+    shader.setMat4("view", camera_->getViewMatrix());
+    shader.setVec3("lightColor", 1.0f, 1.0f, 1.0f);
+    shader.setVec3("lightPos", glm::vec3(0.0f, 20.0f, -20.0f));
+    shader.setVec3("viewPos", camera_->getPosition());
+    shader.setInt("texture1", 0);
+  }
+
+  // phong和gouraud需要CPU计算好的法线矩阵
+  auto setModel(gl_hwk::Shader& shader, const glm::mat4& model) -> void {
+    shader.setMat4("model", model);
+    shader.setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
+  }
+
+  // 将N个物体排布在摄像机前方的网格中
+  auto gridModel(uint32_t i, uint32_t n, float angle) -> glm::mat4 {
+    auto side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(n))));
+    float spacing = 40.0f / side;
+    glm::vec3 pos = glm::vec3(i % side, (i / side) % side, i / (side * side)) * spacing - glm::vec3(20.0f, 20.0f, 0.0f);
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), pos);
+    model = glm::rotate(model, glm::radians(angle + i), glm::vec3(1.0f, 0.3f, 0.5f));
+    return glm::scale(model, glm::vec3(spacing * 0.5f));
+  }
+
+  auto cubes(uint32_t n, bool skybox) -> Scene {
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    auto sky = std::make_shared<std::shared_ptr<gl_hwk::SkyBox>>();
+    Scene scene;
+    scene.name = fmt::format("cubes_{}{}", n, skybox ? "_skybox" : "");
+    scene.setup = [this, sky, skybox]() {
+      if (skybox) {
+        auto paths = std::vector<std::string>{"texture/skybox/right.jpg",  "texture/skybox/left.jpg",
+                                              "texture/skybox/top.jpg",    "texture/skybox/bottom.jpg",
+                                              "texture/skybox/front.jpg",  "texture/skybox/back.jpg"};
+        *sky = std::make_shared<gl_hwk::SkyBox>(paths, shader("skybox"), camera_);
+      }
+    };
+    scene.render = [this, builder, sky, n]() -> uint32_t {
+      uint32_t draws = 0;
+      if (*sky) {
+        (*sky)->draw();
+        draws++;
+      }
+      auto s = shader("light_source");
+      setCommonUniforms(*s);
+      for (uint32_t i = 0; i < n; ++i) {
+        s->setMat4("model", gridModel(i, n, frame_ * 2.0f));
+        builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+      }
+      return draws + n;
+    };
+    return scene;
+  }
+
+  auto textures(uint32_t n) -> Scene {
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    auto ids = std::make_shared<std::vector<GLuint>>();
+    Scene scene;
+    scene.name = fmt::format("textures_{}", n);
+    scene.setup = [ids, n]() {
+      for (uint32_t i = 0; i < n; ++i) {
+        ids->push_back(gl_hwk::TextureLoader::instance().loadTexture("texture/wall.jpg"));
+      }
+    };
+    scene.render = [this, builder, ids, n]() -> uint32_t {
+      auto s = shader("phong");
+      setCommonUniforms(*s);
+      for (uint32_t i = 0; i < n; ++i) {
+        gl_hwk::TextureLoader::instance().activeTexture((*ids)[i], 0);
+        setModel(*s, gridModel(i, n, frame_ * 2.0f));
+        builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+      }
+      return n;
+    };
+    return scene;
+  }
+
+  // 与textures相同，纹理按立方体在屏幕上的大小流式加载mip，显存预算小于全部纹理的总大小
+  auto streamedTextures(uint32_t n) -> Scene {
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    auto ids = std::make_shared<std::vector<GLuint>>();
+    auto streamer = std::make_shared<std::unique_ptr<gl_hwk::TextureStreamer>>();
+    auto bounds = gl_hwk::Aabb::fromPoints(cube_positions_);
+    Scene scene;
+    scene.name = fmt::format("streamed_textures_{}", n);
+    scene.setup = [ids, streamer, n]() {
+      gl_hwk::TextureStreamingOptions streaming_options;
+      streaming_options.budget_bytes = 16ull << 20;
+      *streamer = std::make_unique<gl_hwk::TextureStreamer>(streaming_options);
+      for (uint32_t i = 0; i < n; ++i) {
+        ids->push_back((*streamer)->load("texture/wall.jpg"));
+      }
+      // 只测量流式上传，不包括后台解码
+      while ((*streamer)->getStats().loading > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        (*streamer)->update();
+      }
+    };
+    scene.render = [this, builder, ids, streamer, bounds, n]() -> uint32_t {
+      auto s = shader("phong");
+      setCommonUniforms(*s);
+      for (uint32_t i = 0; i < n; ++i) {
+        (*streamer)->request((*ids)[i], *camera_, bounds.transform(gridModel(i, n, frame_ * 2.0f)));
+      }
+      (*streamer)->update();
+      for (uint32_t i = 0; i < n; ++i) {
+        gl_hwk::TextureLoader::instance().activeTexture((*ids)[i], 0);
+        setModel(*s, gridModel(i, n, frame_ * 2.0f));
+        builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+      }
+      return n;
+    };
+    return scene;
+  }
+
+  // 与cubes相同的网格，变换存于TransformStore，每帧批量计算矩阵后一次实例化绘制
+  auto cubesInstanced(uint32_t n) -> Scene {
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    auto transforms = std::make_shared<gl_hwk::TransformStore>();
+    auto instances = std::make_shared<gl_hwk::InstanceBuffer>();
+    auto instanced_shader = std::make_shared<std::shared_ptr<gl_hwk::Shader>>();
+    Scene scene;
+    scene.name = fmt::format("cubes_instanced_{}", n);
+    scene.setup = [this, builder, transforms, instanced_shader, n]() {
+      *instanced_shader =
+          std::make_shared<gl_hwk::Shader>("shader/phong_instanced.vert.GLSL", "shader/phong.frag.GLSL");
+      auto side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(n))));
+      float spacing = 40.0f / side;
+      for (uint32_t i = 0; i < n; ++i) {
+        glm::vec3 pos =
+            glm::vec3(i % side, (i / side) % side, i / (side * side)) * spacing - glm::vec3(20.0f, 20.0f, 0.0f);
+        transforms->add(pos, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(spacing * 0.5f));
+      }
+      // 先创建图元，drawInstanced只绘制已缓存的图元
+      auto s = shader("light_source");
+      setCommonUniforms(*s);
+      s->setMat4("model", glm::mat4(0.0f));
+      builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+    };
+    scene.render = [this, builder, transforms, instances, instanced_shader, n]() -> uint32_t {
+      const glm::vec3 axis = glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f));
+      for (uint32_t i = 0; i < n; ++i) {
+        transforms->setRotation(i, glm::angleAxis(glm::radians(frame_ * 2.0f + i), axis));
+      }
+      transforms->compose(*instances);
+      instances->upload();
+      setCommonUniforms(**instanced_shader);
+      builder->drawInstanced("cube", *instances);
+      return 1;
+    };
+    return scene;
+  }
+
+  // N个物体使用4种网格，全部放在GeometryPool中，每个物体一条间接绘制命令，整帧只有一次draw call
+  auto geometryPool(uint32_t n) -> Scene {
+    auto pool = std::make_shared<gl_hwk::GeometryPool>();
+    auto transforms = std::make_shared<gl_hwk::TransformStore>();
+    auto instances = std::make_shared<gl_hwk::InstanceBuffer>();
+    auto instanced_shader = std::make_shared<std::shared_ptr<gl_hwk::Shader>>();
+    Scene scene;
+    scene.name = fmt::format("geometry_pool_{}", n);
+    scene.setup = [this, pool, transforms, instanced_shader, n]() {
+      *instanced_shader =
+          std::make_shared<gl_hwk::Shader>("shader/phong_instanced.vert.GLSL", "shader/phong.frag.GLSL");
+      std::vector<gl_hwk::MeshId> meshes;
+      for (float size : {0.6f, 0.8f, 1.0f, 1.2f}) {
+        auto positions = cube_positions_;
+        for (auto& p : positions) {
+          p *= size;
+        }
+        meshes.push_back(pool->addMesh(positions, {}, cube_data_));
+      }
+      auto side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(n))));
+      float spacing = 40.0f / side;
+      for (uint32_t i = 0; i < n; ++i) {
+        glm::vec3 pos =
+            glm::vec3(i % side, (i / side) % side, i / (side * side)) * spacing - glm::vec3(20.0f, 20.0f, 0.0f);
+        transforms->add(pos, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(spacing * 0.5f));
+        pool->addDraw(meshes[i % meshes.size()], i);
+      }
+    };
+    scene.render = [this, pool, transforms, instances, instanced_shader, n]() -> uint32_t {
+      const glm::vec3 axis = glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f));
+      for (uint32_t i = 0; i < n; ++i) {
+        transforms->setRotation(i, glm::angleAxis(glm::radians(frame_ * 2.0f + i), axis));
+      }
+      transforms->compose(*instances);
+      instances->upload();
+      setCommonUniforms(**instanced_shader);
+      pool->draw(*instances);
+      return 1;
+    };
+    return scene;
+  }
+
+  // 场景图：每层一个父节点，每帧只旋转其中一层，其余节点的矩阵和包围盒保持缓存；绘制前做视锥体剔除
+  auto sceneGraph(uint32_t n) -> Scene {
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    auto graph = std::make_shared<gl_hwk::SceneGraph>();
+    auto layers = std::make_shared<std::vector<gl_hwk::NodeId>>();
+    auto visible = std::make_shared<std::vector<gl_hwk::NodeId>>();
+    Scene scene;
+    scene.name = fmt::format("scene_graph_{}", n);
+    scene.setup = [this, builder, graph, layers, n]() {
+      auto s = shader("phong");
+      setCommonUniforms(*s);
+      s->setMat4("model", glm::mat4(0.0f));
+      s->setMat3("normalMatrix", glm::mat3(0.0f));
+      builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+      auto bounds = gl_hwk::Aabb::fromPoints(cube_positions_);
+      auto side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(n))));
+      float spacing = 40.0f / side;
+      const glm::vec3 axis = glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f));
+      for (uint32_t i = 0; i < n; ++i) {
+        uint32_t layer = i / (side * side);
+        if (layer >= layers->size()) {
+          auto id = graph->createNode();
+          graph->setPosition(id, glm::vec3(0.0f, 0.0f, layer * spacing));
+          layers->push_back(id);
+        }
+        auto id = graph->createNode((*layers)[layer]);
+        glm::vec3 pos = glm::vec3(i % side, (i / side) % side, 0.0f) * spacing - glm::vec3(20.0f, 20.0f, 0.0f);
+        graph->setTransform(id, pos, glm::angleAxis(glm::radians(static_cast<float>(i)), axis),
+                            glm::vec3(spacing * 0.5f));
+        graph->setMesh(id, "cube", bounds);
+        graph->setMaterial(id, s);
+      }
+    };
+    scene.render = [this, builder, graph, layers, visible]() -> uint32_t {
+      auto& layer = (*layers)[frame_ % layers->size()];
+      graph->setRotation(layer, glm::angleAxis(glm::radians(frame_ * 2.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+      graph->update();
+      graph->cull(gl_hwk::Frustum::fromMatrix(camera_->getProjectionMatrix() * camera_->getViewMatrix()), *visible);
+      setCommonUniforms(*shader("phong"));
+      graph->draw(*builder, *visible);
+      return static_cast<uint32_t>(visible->size());
+    };
+    return scene;
+  }
+
+  // 1000个立方体被N个运动的点光源照亮，光源按cluster分配
+  auto clusteredLights(uint32_t n) -> Scene {
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    auto lighting = std::make_shared<gl_hwk::ClusteredLighting>();
+    auto clustered_shader = std::make_shared<std::shared_ptr<gl_hwk::Shader>>();
+    Scene scene;
+    scene.name = fmt::format("clustered_lights_{}", n);
+    scene.setup = [clustered_shader]() {
+      *clustered_shader =
+          std::make_shared<gl_hwk::Shader>("shader/phong.vert.GLSL", "shader/phong_clustered.frag.GLSL");
+    };
+    scene.render = [this, builder, lighting, clustered_shader, n]() -> uint32_t {
+      auto& lights = lighting->getLights();
+      lights.resize(n);
+      for (uint32_t i = 0; i < n; ++i) {
+        float t = static_cast<float>(i);
+        float angle = frame_ * 0.05f + t * 0.37f;
+        lights[i].position =
+            glm::vec3(std::cos(angle) * 18.0f, std::sin(t * 0.9f) * 18.0f, 10.0f + std::sin(angle) * 18.0f);
+        lights[i].radius = 6.0f;
+        lights[i].color = glm::vec3(0.5f + 0.5f * std::sin(t), 0.5f + 0.5f * std::sin(t * 1.7f), 0.8f);
+      }
+      lighting->build(*camera_);
+      lighting->upload();
+      auto& s = **clustered_shader;
+      setCommonUniforms(s);
+      lighting->bind(s);
+      const uint32_t cubes = 1000;
+      for (uint32_t i = 0; i < cubes; ++i) {
+        setModel(s, gridModel(i, cubes, frame_ * 2.0f));
+        builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+      }
+      return cubes;
+    };
+    return scene;
+  }
+
+  // N个静态立方体和8个旋转的动态立方体投射平行光阴影；cached为false时每帧重新渲染静态阴影，用于对比缓存的收益
+  auto shadows(uint32_t n, bool cached) -> Scene {
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    auto shadow_map = std::make_shared<std::unique_ptr<gl_hwk::ShadowMap>>();
+    auto shadow_shader = std::make_shared<std::shared_ptr<gl_hwk::Shader>>();
+    const uint32_t dynamic = 8;
+    Scene scene;
+    scene.name = fmt::format("shadows_{}{}", n, cached ? "" : "_uncached");
+    scene.setup = [this, builder, shadow_map, shadow_shader, n]() {
+      *shadow_shader = std::make_shared<gl_hwk::Shader>("shader/phong.vert.GLSL", "shader/phong_shadow.frag.GLSL");
+      *shadow_map = std::make_unique<gl_hwk::ShadowMap>();
+      (*shadow_map)->setDirectionalLight(glm::vec3(-0.3f, -1.0f, 0.5f), glm::vec3(0.0f, 0.0f, 20.0f), 40.0f);
+      (*shadow_map)->setStaticCasters([this, builder, n](gl_hwk::Shader& s) {
+        for (uint32_t i = 0; i < n; ++i) {
+          s.setMat4("model", gridModel(i, n, 0.0f));
+          builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+        }
+      });
+      (*shadow_map)->setDynamicCasters([this, builder](gl_hwk::Shader& s) {
+        for (uint32_t i = 0; i < dynamic; ++i) {
+          s.setMat4("model", gridModel(i, dynamic, frame_ * 2.0f));
+          builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+        }
+      });
+    };
+    scene.render = [this, builder, shadow_map, shadow_shader, n, cached]() -> uint32_t {
+      auto& sm = **shadow_map;
+      if (!cached) {
+        sm.markStaticDirty();
+      }
+      sm.update();
+      auto& s = **shadow_shader;
+      setCommonUniforms(s);
+      sm.bind(s);
+      for (uint32_t i = 0; i < n; ++i) {
+        setModel(s, gridModel(i, n, 0.0f));
+        builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+      }
+      for (uint32_t i = 0; i < dynamic; ++i) {
+        setModel(s, gridModel(i, dynamic, frame_ * 2.0f));
+        builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+      }
+      return n + dynamic;
+    };
+    return scene;
+  }
+
+  // 摄像机和N个立方体之间有一面墙，enabled为true时用OcclusionCuller剔除被墙挡住的立方体
+  auto occlusion(uint32_t n, bool enabled) -> Scene {
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    auto culler = std::make_shared<gl_hwk::OcclusionCuller>();
+    const glm::mat4 wall = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(4.0f, 0.0f, -10.0f)),
+                                      glm::vec3(24.0f, 24.0f, 1.0f));
+    Scene scene;
+    scene.name = fmt::format("occlusion_{}{}", n, enabled ? "" : "_off");
+    scene.setup = [this, culler, wall]() {
+      std::vector<GLsizei> indices(cube_positions_.size());
+      for (size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = static_cast<GLsizei>(i);
+      }
+      culler->addOccluder(cube_positions_, indices, wall);
+    };
+    scene.render = [this, builder, culler, wall, n, enabled]() -> uint32_t {
+      auto s = shader("light_source");
+      setCommonUniforms(*s);
+      if (enabled) {
+        culler->render(camera_->getProjectionMatrix() * camera_->getViewMatrix());
+      }
+      s->setMat4("model", wall);
+      builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+      auto unit = gl_hwk::Aabb::fromPoints(cube_positions_);
+      uint32_t draws = 1;
+      for (uint32_t i = 0; i < n; ++i) {
+        glm::mat4 model = gridModel(i, n, frame_ * 2.0f);
+        if (enabled && !culler->isVisible(unit.transform(model))) {
+          continue;
+        }
+        s->setMat4("model", model);
+        builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+        draws++;
+      }
+      return draws;
+    };
+    return scene;
+  }
+
+  // N个球体和圆环，lod为true时按屏幕大小选择段数，否则都使用最大段数
+  auto parametric(uint32_t n, bool lod) -> Scene {
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    auto meshes = std::make_shared<gl_hwk::ParametricMeshBuilder>(builder);
+    Scene scene;
+    scene.name = fmt::format("parametric_{}_{}", n, lod ? "lod" : "max");
+    scene.setup = [this]() { shader("phong"); };
+    scene.render = [this, meshes, n, lod]() -> uint32_t {
+      gl_hwk::ParametricParams params[2];
+      params[1].shape = gl_hwk::ParametricShape::kTorus;
+      params[1].radius = 0.35f;
+      params[1].minor_radius = 0.12f;
+      auto s = shader("phong");
+      setCommonUniforms(*s);
+      for (uint32_t i = 0; i < n; ++i) {
+        glm::mat4 model = gridModel(i, n, frame_ * 2.0f);
+        setModel(*s, model);
+        if (lod) {
+          meshes->draw(params[i % 2], *camera_, model);
+        } else {
+          meshes->draw(params[i % 2], gl_hwk::ParametricLodOptions().max_segments);
+        }
+      }
+      return n;
+    };
+    return scene;
+  }
+
+  // N个phong立方体由SoftwareRenderer在CPU上绘制，包含清屏和分块光栅化，不占用GPU
+  auto software(uint32_t n) -> Scene {
+    gl_hwk::SoftwareRendererOptions software_options;
+    software_options.width = options_.width;
+    software_options.height = options_.height;
+    auto renderer = std::make_shared<gl_hwk::SoftwareRenderer>(software_options);
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>(renderer);
+    Scene scene;
+    scene.name = fmt::format("software_{}", n);
+    scene.setup = []() {};
+    scene.render = [this, renderer, builder, n]() -> uint32_t {
+      renderer->clear(glm::vec4(0.1f, 0.1f, 0.1f, 1.0f));
+      renderer->setShader(gl_hwk::SoftwareShader::kPhong);
+      auto& uniforms = renderer->uniforms();
+      uniforms.projection = camera_->getProjectionMatrix();
+      uniforms.view = camera_->getViewMatrix();
+      uniforms.light_pos = glm::vec3(0.0f, 20.0f, -20.0f);
+      uniforms.view_pos = camera_->getPosition();
+      for (uint32_t i = 0; i < n; ++i) {
+        uniforms.model = gridModel(i, n, frame_ * 2.0f);
+        uniforms.normal_matrix = glm::transpose(glm::inverse(glm::mat3(uniforms.model)));
+        builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+      }
+      renderer->flush();
+      return n;
+    };
+    return scene;
+  }
+
+  // N个半透明立方体，weighted为true时用加权混合OIT，否则每帧按深度排序后绘制
+  auto transparent(uint32_t n, bool weighted) -> Scene {
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    auto texture = std::make_shared<GLuint>(0);
+    auto transparency = std::make_shared<std::unique_ptr<gl_hwk::TransparencyRenderer>>();
+    Scene scene;
+    scene.name = fmt::format("transparent_{}_{}", n, weighted ? "weighted" : "sorted");
+    scene.setup = [this, texture, transparency, weighted]() {
+      shader("phong");
+      *texture = gl_hwk::TextureLoader::instance().loadTexture("texture/wall.jpg");
+      gl_hwk::TextureLoader::instance().setTextureAlpha(*texture, 0.5f);
+      gl_hwk::TransparencyOptions transparency_options;
+      transparency_options.mode =
+          weighted ? gl_hwk::TransparencyMode::kWeightedBlended : gl_hwk::TransparencyMode::kSorted;
+      *transparency = std::make_unique<gl_hwk::TransparencyRenderer>(transparency_options);
+    };
+    scene.render = [this, builder, texture, transparency, n]() -> uint32_t {
+      auto s = shader("phong");
+      setCommonUniforms(*s);
+      gl_hwk::TextureLoader::instance().activeTexture(*texture, 0);
+      auto& renderer = **transparency;
+      renderer.begin(camera_->getViewMatrix());
+      for (uint32_t i = 0; i < n; ++i) {
+        renderer.add(glm::vec3(gridModel(i, n, 0.0f)[3]), *s, i);
+      }
+      renderer.render([&](gl_hwk::Shader& shader, uint32_t i) {
+        setModel(shader, gridModel(i, n, frame_ * 2.0f));
+        builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+      });
+      return n + (renderer.getMode() == gl_hwk::TransparencyMode::kWeightedBlended ? 1 : 0);
+    };
+    return scene;
+  }
+
+  // 每帧构建渲染图：场景、两次降采样、一次升采样和合成，半分辨率的两个目标共用纹理，调试pass没有读者被剔除
+  auto renderGraph(uint32_t n) -> Scene {
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    auto graph = std::make_shared<std::unique_ptr<gl_hwk::RenderGraph>>();
+    auto vao = std::make_shared<GLuint>(0);
+    Scene scene;
+    scene.name = fmt::format("render_graph_{}", n);
+    scene.setup = [this, graph, vao]() {
+      shader("phong");
+      shader("fullscreen");
+      *graph = std::make_unique<gl_hwk::RenderGraph>();
+      glGenVertexArrays(1, vao.get());
+    };
+    scene.render = [this, builder, graph, vao, n]() -> uint32_t {
+      auto& g = **graph;
+      uint32_t width = options_.width, height = options_.height;
+      auto blit = [this, vao](const gl_hwk::RenderPassResources& resources, gl_hwk::RenderResource source) {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        auto s = shader("fullscreen");
+        s->start();
+        s->setInt("sourceTexture", 0);
+        s->setVec4("viewportRect", glm::vec4(viewport[0], viewport[1], viewport[2], viewport[3]));
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, resources.getTexture(source));
+        glBindVertexArray(*vao);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+      };
+      auto downsample = [&](const std::string& name, gl_hwk::RenderResource source, uint32_t divisor) {
+        gl_hwk::RenderResource target;
+        g.addPass(
+            name,
+            [&](gl_hwk::RenderGraphBuilder& b) {
+              b.read(source);
+              target = b.write(b.create(name, {width / divisor, height / divisor, GL_RGBA8}));
+            },
+            [blit, source](const gl_hwk::RenderPassResources& resources) { blit(resources, source); });
+        return target;
+      };
+
+      g.reset();
+      gl_hwk::RenderResource color, depth;
+      g.addPass(
+          "scene",
+          [&](gl_hwk::RenderGraphBuilder& b) {
+            color = b.write(b.create("scene_color", {width, height, GL_RGBA8}));
+            depth = b.write(b.create("scene_depth", {width, height, GL_DEPTH_COMPONENT24}));
+          },
+          [this, builder, n](const gl_hwk::RenderPassResources&) {
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glEnable(GL_DEPTH_TEST);
+            auto s = shader("phong");
+            setCommonUniforms(*s);
+            for (uint32_t i = 0; i < n; ++i) {
+              setModel(*s, gridModel(i, n, frame_ * 2.0f));
+              builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+            }
+          });
+      auto half = downsample("downsample_half", color, 2);
+      auto quarter = downsample("downsample_quarter", half, 4);
+      // 与downsample_half生命周期不重叠，复用同一个纹理
+      auto bloom = downsample("upsample_half", quarter, 2);
+      downsample("debug_depth", depth, 4);
+      g.addPass(
+          "composite",
+          [&](gl_hwk::RenderGraphBuilder& b) {
+            b.read(color);
+            b.read(bloom);
+            b.sideEffect();
+          },
+          [blit, color, bloom](const gl_hwk::RenderPassResources& resources) {
+            glDisable(GL_DEPTH_TEST);
+            blit(resources, color);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+            blit(resources, bloom);
+            glDisable(GL_BLEND);
+            glEnable(GL_DEPTH_TEST);
+          });
+      g.execute();
+      glBindVertexArray(0);
+      // 场景、三次缩放、两次合成
+      return n + 5;
+    };
+    return scene;
+  }
+
+  // N个phong立方体渲染到动态分辨率的离屏目标，GPU预算为target_ms，比例稳定后与固定分辨率比较gpu时间
+  auto dynamicResolution(uint32_t n, double target_ms) -> Scene {
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    auto resolution = std::make_shared<std::unique_ptr<gl_hwk::DynamicResolution>>();
+    Scene scene;
+    scene.name = fmt::format("dynamic_resolution_{}_{}ms", n, target_ms);
+    scene.setup = [this, resolution, target_ms]() {
+      shader("phong");
+      gl_hwk::DynamicResolutionOptions resolution_options;
+      resolution_options.target_ms = target_ms;
+      *resolution = std::make_unique<gl_hwk::DynamicResolution>(options_.width, options_.height, resolution_options);
+    };
+    scene.render = [this, builder, resolution, n]() -> uint32_t {
+      (*resolution)->begin();
+      auto s = shader("phong");
+      setCommonUniforms(*s);
+      for (uint32_t i = 0; i < n; ++i) {
+        setModel(*s, gridModel(i, n, frame_ * 2.0f));
+        builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+      }
+      (*resolution)->end();
+      return n + 1;
+    };
+    return scene;
+  }
+
+  // N个实例化立方体绘制到多个视图：cubemap为立方体贴图的六个面，否则为绕场景中心旋转的2x2分屏
+  // 变换、包围盒、剔除和实例数据每帧只计算一次，每个视图只设置矩阵并绘制自己的实例区间
+  auto multiView(uint32_t n, bool cubemap) -> Scene {
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    auto transforms = std::make_shared<gl_hwk::TransformStore>();
+    auto instances = std::make_shared<gl_hwk::InstanceBuffer>();
+    auto view_instances = std::make_shared<gl_hwk::InstanceBuffer>();
+    auto bounds = std::make_shared<std::vector<gl_hwk::Aabb>>(n);
+    auto renderer = std::make_shared<gl_hwk::MultiViewRenderer>();
+    auto instanced_shader = std::make_shared<std::shared_ptr<gl_hwk::Shader>>();
+    auto cube_texture = std::make_shared<GLuint>(0);
+    Scene scene;
+    scene.name = fmt::format("multi_view_{}_{}", cubemap ? "cubemap" : "split4", n);
+    scene.setup = [this, builder, transforms, renderer, instanced_shader, cube_texture, cubemap, n]() {
+      *instanced_shader =
+          std::make_shared<gl_hwk::Shader>("shader/phong_instanced.vert.GLSL", "shader/phong.frag.GLSL");
+      auto side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(n))));
+      float spacing = 40.0f / side;
+      for (uint32_t i = 0; i < n; ++i) {
+        glm::vec3 pos =
+            glm::vec3(i % side, (i / side) % side, i / (side * side)) * spacing - glm::vec3(20.0f, 20.0f, 0.0f);
+        transforms->add(pos, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(spacing * 0.5f));
+      }
+      auto s = shader("light_source");
+      setCommonUniforms(*s);
+      s->setMat4("model", glm::mat4(0.0f));
+      builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+
+      const glm::vec3 center(0.0f, 0.0f, 20.0f);
+      if (cubemap) {
+        constexpr uint32_t kSize = 256;
+        glGenTextures(1, cube_texture.get());
+        glBindTexture(GL_TEXTURE_CUBE_MAP, *cube_texture);
+        for (int face = 0; face < 6; ++face) {
+          glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGBA8, kSize, kSize, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                       nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        renderer->addCubemapViews(*cube_texture, kSize, center, 0.1f, 100.0f);
+      } else {
+        auto viewports = gl_hwk::MultiViewRenderer::splitViewports(4, options_.width, options_.height);
+        for (uint32_t v = 0; v < viewports.size(); ++v) {
+          auto view = gl_hwk::RenderView::fromCamera(*camera_, viewports[v]);
+          glm::mat4 orbit = glm::translate(glm::mat4(1.0f), center) *
+                            glm::rotate(glm::mat4(1.0f), glm::radians(90.0f * v), glm::vec3(0.0f, 1.0f, 0.0f)) *
+                            glm::translate(glm::mat4(1.0f), -center);
+          view.view = view.view * orbit;
+          view.clear_color = glm::vec4(0.1f * v, 0.1f, 0.1f, 1.0f);
+          renderer->addView(view);
+        }
+      }
+    };
+    scene.render = [this, builder, transforms, instances, view_instances, bounds, renderer, instanced_shader,
+                    n]() -> uint32_t {
+      const glm::vec3 axis = glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f));
+      for (uint32_t i = 0; i < n; ++i) {
+        transforms->setRotation(i, glm::angleAxis(glm::radians(frame_ * 2.0f + i), axis));
+      }
+      transforms->compose(*instances);
+      auto unit = gl_hwk::Aabb::fromPoints(cube_positions_);
+      for (uint32_t i = 0; i < n; ++i) {
+        (*bounds)[i] = unit.transform(instances->data()[i].model);
+      }
+      renderer->cull(*bounds);
+      renderer->gatherInstances(*instances, *view_instances);
+      view_instances->upload();
+      auto& s = **instanced_shader;
+      setCommonUniforms(s);
+      renderer->render([builder, view_instances, renderer, &s](uint32_t view, const gl_hwk::RenderView& rv) {
+        s.setMat4("projection", rv.projection);
+        s.setMat4("view", rv.view);
+        s.setVec3("viewPos", glm::vec3(glm::inverse(rv.view)[3]));
+        auto range = renderer->getInstanceRange(view);
+        builder->drawInstanced("cube", *view_instances, range.first, range.second);
+      });
+      return renderer->getViewCount();
+    };
+    return scene;
+  }
+
+  // 每次draw都切换着色器
+  auto shaderSwitches(uint32_t n) -> Scene {
+    auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
+    Scene scene;
+    scene.name = fmt::format("shader_switch_{}", n);
+    scene.setup = [this]() {
+      shader("phong");
+      shader("gouraud");
+    };
+    scene.render = [this, builder, n]() -> uint32_t {
+      std::shared_ptr<gl_hwk::Shader> list[2] = {shader("phong"), shader("gouraud")};
+      for (uint32_t i = 0; i < n; ++i) {
+        auto& s = list[i % 2];
+        setCommonUniforms(*s);
+        setModel(*s, gridModel(i, n, frame_ * 2.0f));
+        builder->buildTriangles("cube", cube_positions_, {}, cube_data_);
+      }
+      return n;
+    };
+    return scene;
+  }
+
+  // 每帧重新生成并上传一个res*res的网格，PrimitiveBuilder只支持静态几何，这里直接使用GL缓冲区
+  auto dynamicGeometry(uint32_t res) -> Scene {
+    auto buffers = std::make_shared<std::pair<GLuint, GLuint>>(0, 0);
+    auto vertices = std::make_shared<std::vector<float>>();
+    Scene scene;
+    scene.name = fmt::format("dynamic_geometry_{}", res);
+    scene.setup = [buffers]() {
+      glGenVertexArrays(1, &buffers->first);
+      glGenBuffers(1, &buffers->second);
+    };
+    scene.render = [this, buffers, vertices, res]() -> uint32_t {
+      vertices->clear();
+      float t = frame_ * 0.1f;
+      for (uint32_t y = 0; y < res; ++y) {
+        for (uint32_t x = 0; x < res; ++x) {
+          // 每个格子两个三角形
+          const uint32_t quad[6][2] = {{0, 0}, {1, 0}, {1, 1}, {1, 1}, {0, 1}, {0, 0}};
+          for (const auto& q : quad) {
+            float px = (x + q[0]) * 40.0f / res - 20.0f;
+            float py = (y + q[1]) * 40.0f / res - 20.0f;
+            vertices->push_back(px);
+            vertices->push_back(py);
+            vertices->push_back(std::sin(px * 0.3f + t) * std::cos(py * 0.3f + t) * 2.0f);
+          }
+        }
+      }
+      auto s = shader("light_source");
+      setCommonUniforms(*s);
+      s->setMat4("model", glm::mat4(1.0f));
+      glBindVertexArray(buffers->first);
+      glBindBuffer(GL_ARRAY_BUFFER, buffers->second);
+      glBufferData(GL_ARRAY_BUFFER, vertices->size() * sizeof(float), vertices->data(), GL_STREAM_DRAW);
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+      glEnableVertexAttribArray(0);
+      glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices->size() / 3));
+      return 1;
+    };
+    return scene;
+  }
+
+  auto nextFrame() -> void { frame_++; }
+
+ private:
+  const BenchOptions& options_;
+  uint32_t frame_ = 0;
+  std::shared_ptr<gl_hwk::Camera> camera_;
+  std::map<std::string, std::shared_ptr<gl_hwk::Shader>> shaders_;
+  std::vector<glm::vec3> cube_positions_;
+  std::vector<std::vector<float>> cube_data_;
+};
+
+auto runScene(Scene& scene, SceneFactory& factory, const BenchOptions& options) -> SceneResult {
+  SceneResult result;
+  result.name = scene.name;
+  const uint64_t rss_before_kb = residentMemoryKb();
+  scene.setup();
+  // reset会等待上一个场景在途的查询，之后的结果只属于这个场景
+  gl_hwk::GpuProfiler::instance().reset();
+
+  std::vector<double> cpu_ms;
+  double start_ms = 0.0;
+  uint32_t frame = 0;
+  gl_hwk::OpenGLApplication::instance().onDisplay([&]() {
+    if (frame == options.warmup) {
+      glFinish();
+      start_ms = nowMs();
+    }
+    // 预热帧不计入GPU耗时
+    const bool timed = frame >= options.warmup;
+    double begin = nowMs();
+    if (timed) {
+      gl_hwk::GpuProfiler::instance().beginScope("scene");
+    }
+    result.draw_calls = scene.render();
+    if (timed) {
+      gl_hwk::GpuProfiler::instance().endScope();
+      cpu_ms.push_back(nowMs() - begin);
+    }
+    factory.nextFrame();
+    frame++;
+  });
+  gl_hwk::OpenGLApplication::instance().run();
+
+  // run结束时已经glFinish
+  result.frame_ms = (nowMs() - start_ms) / std::max<size_t>(cpu_ms.size(), 1);
+  if (!cpu_ms.empty()) {
+    double sum = 0.0;
+    for (double ms : cpu_ms) sum += ms;
+    result.cpu_ms = sum / cpu_ms.size();
+    std::sort(cpu_ms.begin(), cpu_ms.end());
+    result.cpu_p99_ms = cpu_ms[std::min(cpu_ms.size() - 1, static_cast<size_t>(cpu_ms.size() * 0.99))];
+  }
+  for (const auto& stats : gl_hwk::GpuProfiler::instance().getReport()) {
+    if (stats.name == "scene") {
+      result.gpu_ms = stats.avg_ms;
+    }
+  }
+  result.rss_delta_kb = static_cast<int64_t>(residentMemoryKb()) - static_cast<int64_t>(rss_before_kb);
+  return result;
+}
+
+auto writeResults(const std::string& path, const BenchOptions& options, const std::vector<SceneResult>& results)
+    -> bool {
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    fmt::print("bench: Failed to open file: {}\n", path);
+    return false;
+  }
+  file << fmt::format("{{\n  \"frames\": {},\n  \"width\": {},\n  \"height\": {},\n  \"scenes\": {{", options.frames,
+                      options.width, options.height);
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto& r = results[i];
+    // 每个场景占一行，便于readBaseline解析
+    file << fmt::format(
+        "{}\n    \"{}\": {{\"cpu_ms\": {:.4f}, \"cpu_p99_ms\": {:.4f}, \"frame_ms\": {:.4f}, \"gpu_ms\": {:.4f}, "
+        "\"draw_calls\": {}, \"rss_delta_kb\": {}}}",
+        i == 0 ? "" : ",", r.name, r.cpu_ms, r.cpu_p99_ms, r.frame_ms, r.gpu_ms, r.draw_calls, r.rss_delta_kb);
+  }
+  file << "\n  }\n}\n";
+  return true;
+}
+
+auto readNumber(const std::string& line, const std::string& key) -> double {
+  auto pos = line.find("\"" + key + "\":");
+  if (pos == std::string::npos) {
+    return 0.0;
+  }
+  return std::stod(line.substr(pos + key.size() + 3));
+}
+
+// 只解析writeResults写出的格式
+auto readBaseline(const std::string& path) -> std::map<std::string, SceneResult> {
+  std::map<std::string, SceneResult> baseline;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    auto name_begin = line.find('"');
+    auto name_end = line.find("\": {\"cpu_ms\"");
+    if (name_begin == std::string::npos || name_end == std::string::npos) {
+      continue;
+    }
+    SceneResult r;
+    r.name = line.substr(name_begin + 1, name_end - name_begin - 1);
+    r.cpu_ms = readNumber(line, "cpu_ms");
+    r.cpu_p99_ms = readNumber(line, "cpu_p99_ms");
+    r.frame_ms = readNumber(line, "frame_ms");
+    r.gpu_ms = readNumber(line, "gpu_ms");
+    r.draw_calls = static_cast<uint32_t>(readNumber(line, "draw_calls"));
+    r.rss_delta_kb = static_cast<int64_t>(readNumber(line, "rss_delta_kb"));
+    baseline[r.name] = r;
+  }
+  return baseline;
+}
+
+/**
+ * @brief 与baseline比较，超出容差的指标视为回归
+ * @return 回归的数量
+ */
+auto compare(const std::vector<SceneResult>& results, const std::map<std::string, SceneResult>& baseline,
+             double tolerance) -> int {
+  int regressions = 0;
+  auto check = [&](const std::string& scene, const char* metric, double current, double base) {
+    // baseline中为0表示该指标不可用(如不支持timer query)
+    if (base <= 0.0 || current <= 0.0) {
+      return;
+    }
+    double ratio = current / base;
+    bool regressed = ratio > 1.0 + tolerance;
+    fmt::print("  {:<28} {:<10} {:>10.4f} -> {:>10.4f} ({:+.1f}%){}\n", scene, metric, base, current,
+               (ratio - 1.0) * 100.0, regressed ? "  REGRESSION" : "");
+    regressions += regressed ? 1 : 0;
+  };
+  for (const auto& r : results) {
+    auto it = baseline.find(r.name);
+    if (it == baseline.end()) {
+      fmt::print("  {:<28} not in baseline\n", r.name);
+      continue;
+    }
+    const auto& b = it->second;
+    check(r.name, "cpu_ms", r.cpu_ms, b.cpu_ms);
+    check(r.name, "frame_ms", r.frame_ms, b.frame_ms);
+    check(r.name, "gpu_ms", r.gpu_ms, b.gpu_ms);
+    if (r.draw_calls != b.draw_calls) {
+      fmt::print("  {:<28} draw_calls {} -> {}  REGRESSION\n", r.name, b.draw_calls, r.draw_calls);
+      regressions++;
+    }
+  }
+  return regressions;
+}
+
+constexpr const char* kUsage =
+    "usage: bench [--frames N] [--filter substr] [--out result.json] [--baseline baseline.json]\n"
+    "             [--tolerance 0.15] [--update-baseline]\n";
+
+/**
+ * @brief 解析整个字符串为数字，缺少参数或含有多余字符时返回false
+ */
+template <typename T>
+auto parseNumber(const std::string& text, T& out) -> bool {
+  // 无符号类型读入负数时会回绕，直接拒绝
+  if (text.empty() || text[0] == '-') {
+    return false;
+  }
+  std::istringstream stream(text);
+  T value;
+  stream >> value;
+  if (stream.fail() || !stream.eof()) {
+    return false;
+  }
+  out = value;
+  return true;
+}
+
+/**
+ * @brief 参数错误时打印原因并返回false
+ */
+auto parseOptions(int argc, char** argv, BenchOptions& options) -> bool {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    auto value = [&]() -> std::string { return has_value ? argv[++i] : ""; };
+    if (arg == "--frames") {
+      if (!parseNumber(value(), options.frames) || options.frames == 0) {
+        fmt::print("bench: --frames requires a positive integer\n");
+        return false;
+      }
+    } else if (arg == "--tolerance") {
+      if (!parseNumber(value(), options.tolerance)) {
+        fmt::print("bench: --tolerance requires a non-negative number\n");
+        return false;
+      }
+    } else if (arg == "--filter" || arg == "--out" || arg == "--baseline") {
+      if (!has_value) {
+        fmt::print("bench: {} requires a value\n", arg);
+        return false;
+      }
+      if (arg == "--filter") {
+        options.filter = value();
+      } else if (arg == "--out") {
+        options.out = value();
+      } else {
+        options.baseline = value();
+      }
+    } else if (arg == "--update-baseline") {
+      options.update_baseline = true;
+    } else {
+      fmt::print("bench: unknown argument {}\n", arg);
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> int {
+  BenchOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    fmt::print("{}", kUsage);
+    return 2;
+  }
+
+  gl_hwk::WindowOptions window;
+  window.name = "bench";
+  window.width = options.width;
+  window.height = options.height;
+  window.headless = true;
+  window.frames = options.frames + options.warmup;
+  gl_hwk::OpenGLApplication::instance().init(argc, argv, window);
+  gl_hwk::GpuProfiler::instance().setEnabled(true);
+
+  SceneFactory factory(options);
+  std::vector<Scene> scenes;
+  for (uint32_t n : {10u, 100u, 1000u, 10000u, 100000u}) {
+    scenes.push_back(factory.cubes(n, false));
+  }
+  scenes.push_back(factory.cubes(1000, true));
+  for (uint32_t n : {1000u, 100000u}) {
+    scenes.push_back(factory.cubesInstanced(n));
+  }
+  for (uint32_t n : {1000u, 100000u}) {
+    scenes.push_back(factory.geometryPool(n));
+  }
+  for (uint32_t n : {1000u, 10000u}) {
+    scenes.push_back(factory.sceneGraph(n));
+  }
+  for (uint32_t n : {64u, 512u}) {
+    scenes.push_back(factory.clusteredLights(n));
+  }
+  scenes.push_back(factory.shadows(1000, true));
+  scenes.push_back(factory.shadows(1000, false));
+  scenes.push_back(factory.occlusion(10000, true));
+  scenes.push_back(factory.occlusion(10000, false));
+  scenes.push_back(factory.parametric(1000, true));
+  scenes.push_back(factory.parametric(1000, false));
+  for (uint32_t n : {100u, 1000u}) {
+    scenes.push_back(factory.software(n));
+  }
+  for (uint32_t n : {1000u, 10000u}) {
+    scenes.push_back(factory.transparent(n, true));
+    scenes.push_back(factory.transparent(n, false));
+  }
+  for (uint32_t n : {100u, 1000u}) {
+    scenes.push_back(factory.renderGraph(n));
+  }
+  scenes.push_back(factory.dynamicResolution(10000, 2.0));
+  scenes.push_back(factory.multiView(10000, false));
+  scenes.push_back(factory.multiView(10000, true));
+  for (uint32_t n : {1u, 16u, 64u}) {
+    scenes.push_back(factory.textures(n));
+    scenes.push_back(factory.streamedTextures(n));
+  }
+  for (uint32_t n : {100u, 1000u}) {
+    scenes.push_back(factory.shaderSwitches(n));
+  }
+  for (uint32_t res : {16u, 128u}) {
+    scenes.push_back(factory.dynamicGeometry(res));
+  }
+
+  std::vector<SceneResult> results;
+  for (auto& scene : scenes) {
+    if (!options.filter.empty() && scene.name.find(options.filter) == std::string::npos) {
+      continue;
+    }
+    auto r = runScene(scene, factory, options);
+    fmt::print("{:<28} cpu {:>8.3f}ms (p99 {:>8.3f}) frame {:>8.3f}ms gpu {:>8.3f}ms draws {:>7} rss {:+}KB\n",
+               r.name, r.cpu_ms, r.cpu_p99_ms, r.frame_ms, r.gpu_ms, r.draw_calls, r.rss_delta_kb);
+    results.push_back(r);
+    // 释放场景的图元、纹理和着色器，不计入下一个场景的内存变化
+    scene = Scene();
+  }
+
+  writeResults(options.out, options, results);
+  if (options.update_baseline) {
+    writeResults(options.baseline, options, results);
+    fmt::print("bench: baseline written to {}\n", options.baseline);
+    return 0;
+  }
+
+  auto baseline = readBaseline(options.baseline);
+  if (baseline.empty()) {
+    fmt::print("bench: no baseline at {}, run with --update-baseline to create one\n", options.baseline);
+    return 0;
+  }
+  fmt::print("bench: comparing against {} (tolerance {:.0f}%)\n", options.baseline, options.tolerance * 100.0);
+  int regressions = compare(results, baseline, options.tolerance);
+  if (regressions > 0) {
+    fmt::print("bench: {} regression(s)\n", regressions);
+    return 1;
+  }
+  return 0;
+}
@@ -2,8 +2,11 @@
 
 // clang-format off
 // std
+#include <cmath>
 #include <functional>
 #include <memory>
+#include <string>
+#include <utility>
 // OpenGL
 #include <GL/glew.h>
 #include <GL/freeglut.h>
@@ -16,10 +19,19 @@
 #include "gl_homework/opengl_application.hpp"
 #include "gl_homework/shader.hpp"
 #include "gl_homework/camera.hpp"
+#include "gl_homework/clustered_lighting.hpp"
+#include "gl_homework/command_list.hpp"
+#include "gl_homework/gpu_profiler.hpp"
+#include "gl_homework/instance_buffer.hpp"
 #include "gl_homework/primitive_builder.hpp"
+#include "gl_homework/render_stats.hpp"
 #include "gl_homework/simple_polytope_builder.hpp"
 #include "gl_homework/skybox.hpp"
 #include "gl_homework/texture_loader.hpp"
+#include "gl_homework/texture_streamer.hpp"
+#include "gl_homework/trace.hpp"
+#include "gl_homework/transform_store.hpp"
+#include "gl_homework/transparency_renderer.hpp"
 // clang-format on
 
 auto main(int argc, char** argv) -> int {
@@ -28,8 +40,23 @@ auto main(int argc, char** argv) -> int {
   options.name = argv[0];
   options.width = 1024;
   options.height = 1024;
+  // --headless: 无窗口渲染300帧后退出
+  if (argc > 1 && std::string(argv[1]) == "--headless") {
+    options.headless = true;
+    options.frames = 300;
+  }
+
+  // 记录CPU trace，按t输出
+  gl_hwk::Tracer::instance().setEnabled(true);
+  gl_hwk::Tracer::instance().setThreadName("main");
 
   gl_hwk::OpenGLApplication::instance().init(argc, argv, options);
+  // 统计GPU耗时，按p输出
+  gl_hwk::GpuProfiler::instance().setEnabled(true);
+  // 渲染统计，按r输出；无窗口模式下每100帧输出一次
+  if (options.headless) {
+    gl_hwk::RenderStats::instance().setLogInterval(100);
+  }
 
   // 着色器
   auto phong_shader = std::make_shared<gl_hwk::Shader>(
@@ -44,6 +71,13 @@ auto main(int argc, char** argv) -> int {
       "shader/"
       "gouraud.frag.GLSL");
 
+  // 多光源，按3切换
+  auto clustered_shader = std::make_shared<gl_hwk::Shader>(
+      "shader/"
+      "phong.vert.GLSL",
+      "shader/"
+      "phong_clustered.frag.GLSL");
+
   auto light_source_shader = std::make_shared<gl_hwk::Shader>(
       "shader/"
       "light_source.vert.GLSL",
@@ -63,14 +97,22 @@ auto main(int argc, char** argv) -> int {
   auto builder = std::make_shared<gl_hwk::PrimitiveBuilder>();
   // 多面体builder
   auto polytope_builder = std::make_shared<gl_hwk::SimplePolytopeBuilder>(builder);
+  // 国旗和四面体的顶点数据，避免每帧重新构造
+  const auto rect_data = std::vector<std::vector<float>>{{0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f},
+                                                         {0.0f, 1.0f, 0.0f, 0.0f, 0.0f, -1.0f},
+                                                         {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f},
+                                                         {1.0f, 1.0f, 0.0f, 0.0f, 0.0f, -1.0f}};
+  const auto terahedron_data = std::vector<std::vector<float>>{
+      {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f, 1.0f}};
 
   // 摄像机
   // Camera
   auto camera = std::make_shared<gl_hwk::Camera>(glm::vec3(0.0f, 0.0f, -3.0f), 600.f, 1024, 1024);
 
   // 纹理
-  // 砖块纹理
-  GLuint wall_texture = gl_hwk::TextureLoader::instance().loadTexture("texture/wall.jpg");
+  // 砖块纹理，按立方体在屏幕上的大小流式加载mip
+  gl_hwk::TextureStreamer texture_streamer;
+  GLuint wall_texture = texture_streamer.load("texture/wall.jpg");
   // 国旗纹理
   GLuint flag_texture = gl_hwk::TextureLoader::instance().loadTexture("texture/m_gq.png", true);
   // 激活纹理单元
@@ -78,6 +120,8 @@ auto main(int argc, char** argv) -> int {
   phong_shader->setInt("texture1", 0);
   gouraud_shader->start();
   gouraud_shader->setInt("texture1", 0);
+  clustered_shader->start();
+  clustered_shader->setInt("texture1", 0);
 
   // 天空盒
   auto skybox_paths =
@@ -242,8 +286,87 @@ auto main(int argc, char** argv) -> int {
     other_data.push_back(std::move(temp));
   }
 
+  // 128个绕立方体旋转的彩色点光源，分簇后每个片元只计算附近的光源
+  gl_hwk::ClusteredLighting clustered_lighting;
+  std::vector<gl_hwk::PointLight> orbit_lights(128);
+  for (size_t i = 0; i < orbit_lights.size(); i++) {
+    float t = static_cast<float>(i);
+    orbit_lights[i].radius = 3.0f;
+    orbit_lights[i].color = glm::vec3(0.5f + 0.5f * std::sin(t), 0.5f + 0.5f * std::sin(t * 1.7f + 2.0f),
+                                      0.5f + 0.5f * std::sin(t * 2.3f + 4.0f));
+  }
+
+  // 半透明物体在不透明物体之后绘制，默认使用加权混合OIT，不需要排序
+  gl_hwk::TransparencyRenderer transparency;
+
+  // 立方体的变换按SoA存储，每帧批量计算model和法线矩阵
+  gl_hwk::TransformStore cube_transforms;
+  for (const auto& position : cube_positions) {
+    cube_transforms.add(position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+  }
+  gl_hwk::InstanceBuffer cube_instances;
+  // 纹理流式加载按包围盒估计立方体在屏幕上的大小
+  const auto cube_bounds = gl_hwk::Aabb::fromPoints(vertices);
+
+  // 10个立方体的命令只录制一次，每帧只修改矩阵和摄像机位置
+  auto cubes_list = std::make_shared<gl_hwk::CommandList>();
+  gl_hwk::CommandParam cubes_view_pos, cubes_projection, cubes_view;
+  std::vector<gl_hwk::CommandParam> cubes_model(cube_positions.size());
+  std::vector<gl_hwk::CommandParam> cubes_normal(cube_positions.size());
+  auto record_cubes = [&]() -> void {
+    cubes_list->reset();
+    cubes_list->bindTexture(wall_texture, 0);
+    cubes_list->useShader(objects_shader);
+    cubes_list->setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
+    cubes_list->setVec3("lightPos", light_positions);
+    cubes_view_pos = cubes_list->setVec3("viewPos", camera->getPosition());
+    cubes_projection = cubes_list->setMat4("projection", glm::mat4(1.0f));
+    cubes_view = cubes_list->setMat4("view", glm::mat4(1.0f));
+    for (size_t i = 0; i < cube_positions.size(); i++) {
+      cubes_model[i] = cubes_list->setMat4("model", glm::mat4(1.0f));
+      cubes_normal[i] = cubes_list->setMat3("normalMatrix", glm::mat3(1.0f));
+      // 只有第一条命令携带几何数据，其余直接绘制同一个图元
+      if (i == 0) {
+        cubes_list->buildTriangles(builder, "cube_0", vertices, {}, other_data);
+      } else {
+        cubes_list->draw(builder, "cube_0");
+      }
+    }
+  };
+  record_cubes();
+
+  // 按住的按键，摄像机在固定步长的更新中按速度移动，与帧率无关
+  bool held_keys[256] = {};
+  const float camera_speed = 5.0f;
+  auto update_func = [&](float dt) -> void {
+    camera->saveState();
+    glm::vec3 direction(0.0f);
+    const std::pair<unsigned char, glm::vec3> moves[] = {{'w', camera->getFront()}, {'s', -camera->getFront()},
+                                                         {'a', camera->getLeft()},  {'d', camera->getRight()},
+                                                         {' ', camera->getUp()},    {'c', -camera->getUp()}};
+    for (const auto& [key, dir] : moves) {
+      if (held_keys[key]) {
+        direction += dir;
+      }
+    }
+    if (glm::length(direction) > 0.0f) {
+      camera->move(glm::normalize(direction) * camera_speed * dt);
+    }
+    // 立方体每秒转10度
+    cube_transforms.saveState();
+    auto time = static_cast<float>(gl_hwk::OpenGLApplication::instance().getSimulationTime() + dt);
+    for (uint32_t i = 0; i < cube_transforms.size(); i++) {
+      float angle = 20.0f * i + time * 10.0f;
+      cube_transforms.setRotation(i, glm::angleAxis(glm::radians(angle), glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f))));
+    }
+  };
+
   // 渲染主程序
   auto render_func = [&]() -> void {
+    // 在最近两次更新的状态之间插值
+    float alpha = gl_hwk::OpenGLApplication::instance().getInterpolationAlpha();
+    auto render_time = static_cast<float>(gl_hwk::OpenGLApplication::instance().getRenderTime());
+    camera->interpolate(alpha);
     glm::mat4 view = camera->getViewMatrix();
     glm::mat4 projection = camera->getProjectionMatrix();
     glm::mat4 model = glm::mat4(1.0f);
@@ -261,78 +384,124 @@ auto main(int argc, char** argv) -> int {
     builder->buildTriangles("light", vertices, {}, other_data);
 
     // 10个立方体，展示光照
-    gl_hwk::TextureLoader::instance().activeTexture(wall_texture, 0);
-    objects_shader->start();
-    objects_shader->setVec3("lightColor", 1.0f, 1.0f, 1.0f);
-    objects_shader->setVec3("lightPos", light_positions);
-    objects_shader->setVec3("viewPos", camera->getPosition());
-    objects_shader->setMat4("projection", projection);
-    objects_shader->setMat4("view", view);
-    for (int i = 0; i < 10; i++) {
-      glm::mat4 model = glm::mat4(1.0f);
-      model = glm::translate(model, cube_positions[i]);
-      float angle = 20.0f * i + std::abs(glutGet(GLUT_ELAPSED_TIME) / 100.0f);
-
-      model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-      objects_shader->setMat4("model", model);
-      ;
-      builder->buildTriangles(fmt::format("cube_{}", 0), vertices, {}, other_data);
+    gl_hwk::GpuProfiler::instance().beginScope("opaque");
+    cubes_list->patch(cubes_view_pos, camera->getPosition());
+    cubes_list->patch(cubes_projection, projection);
+    cubes_list->patch(cubes_view, view);
+    cube_transforms.compose(cube_instances, alpha);
+    if (objects_shader == clustered_shader) {
+      float time = render_time;
+      for (size_t i = 0; i < orbit_lights.size(); i++) {
+        float t = static_cast<float>(i);
+        float angle = time * 0.5f + t * 0.37f;
+        orbit_lights[i].position =
+            glm::vec3(std::cos(angle) * (2.0f + std::fmod(t, 5.0f)), std::sin(t * 0.9f) * 5.0f,
+                      -7.0f + std::sin(angle) * (2.0f + std::fmod(t, 5.0f)));
+      }
+      clustered_lighting.setLights(orbit_lights);
+      clustered_lighting.build(*camera);
+      clustered_lighting.upload();
+      clustered_lighting.bind(*clustered_shader);
     }
+    for (size_t i = 0; i < cube_instances.size(); i++) {
+      cubes_list->patch(cubes_model[i], cube_instances.data()[i].model);
+      cubes_list->patch(cubes_normal[i], glm::mat3(cube_instances.data()[i].normal));
+      texture_streamer.request(wall_texture, *camera, cube_bounds.transform(cube_instances.data()[i].model));
+    }
+    texture_streamer.update();
+    cubes_list->execute();
+    // 后面的国旗沿用objects_shader
+    objects_shader->start();
+    gl_hwk::GpuProfiler::instance().endScope();
 
-    // 国旗
-    gl_hwk::TextureLoader::instance().activeTexture(flag_texture, 0);
-    gl_hwk::TextureLoader::instance().setTextureAlpha(flag_texture, 0.5f);
-    model = glm::mat4(1.0f);
-    objects_shader->setMat4("model", model);
-    float flag_w = 10.0f * 2;
-    float flag_h = 6.667f * 2;
-    glm::vec3 flag_center = {-flag_w / 2, -flag_h / 2, 10.0f};
-    // 以从Z轴正方向看
-    // 左下， 左上， 右下， 右上
-    polytope_builder->buildRect("rect", glm::vec3{flag_w, 0.0f, 10.0f} + flag_center,
-                                glm::vec3{flag_w, flag_h, 10.0f} + flag_center,
-                                glm::vec3{0.0f, 0.0f, 10.0f} + flag_center,
-                                std::vector<std::vector<float>>{{0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f},
-                                                                {0.0f, 1.0f, 0.0f, 0.0f, 0.0f, -1.0f},
-                                                                {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f},
-                                                                {1.0f, 1.0f, 0.0f, 0.0f, 0.0f, -1.0f}});
     // 四面体
     pure_color_shader->start();
     // projection = glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, 0.1f, 100.0f);
     pure_color_shader->setMat4("projection", projection);
     pure_color_shader->setMat4("view", view);
-    float angle = std::abs(glutGet(GLUT_ELAPSED_TIME) / 100.0f);
-    model = glm::rotate(model, glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
+    float angle = render_time * 10.0f;
+    model = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
     pure_color_shader->setMat4("model", model);
-    polytope_builder->buildTeraHedron(
-        "terahedron", {0.0f, 0.0, 6.0f}, {1, 1, 1},
-        std::vector<std::vector<float>>{
-            {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f, 1.0f}});
+    polytope_builder->buildTeraHedron("terahedron", {0.0f, 0.0, 6.0f}, {1, 1, 1}, terahedron_data);
+
+    // 国旗，在所有不透明物体之后绘制
+    float flag_w = 10.0f * 2;
+    float flag_h = 6.667f * 2;
+    glm::vec3 flag_center = {-flag_w / 2, -flag_h / 2, 10.0f};
+    transparency.begin(view);
+    transparency.add(glm::vec3(0.0f, 0.0f, 20.0f), *objects_shader, 0);
+    transparency.render([&](gl_hwk::Shader& shader, uint32_t) {
+      gl_hwk::TextureLoader::instance().activeTexture(flag_texture, 0);
+      gl_hwk::TextureLoader::instance().setTextureAlpha(flag_texture, 0.5f);
+      shader.setMat4("model", glm::mat4(1.0f));
+      shader.setMat3("normalMatrix", glm::mat3(1.0f));
+      // 以从Z轴正方向看
+      // 左下， 左上， 右下， 右上
+      polytope_builder->buildRect("rect", glm::vec3{flag_w, 0.0f, 10.0f} + flag_center,
+                                  glm::vec3{flag_w, flag_h, 10.0f} + flag_center,
+                                  glm::vec3{0.0f, 0.0f, 10.0f} + flag_center, rect_data);
+    });
   };
 
   // 键盘回调
+  bool recording = false;
   auto keyboardCallback = [&](unsigned char key, int x, int y) {
     if (key == 27) {
       exit(0);
-    } else if (key == 'w') {
-      camera->move(camera->getFront() * 0.25f);
-    } else if (key == 's') {
-      camera->move(camera->getFront() * -0.25f);
-    } else if (key == 'a') {
-      camera->move(camera->getLeft() * 0.25f);
-    } else if (key == 'd') {
-      camera->move(camera->getRight() * 0.25f);
-    } else if (key == ' ') {
-      camera->move(camera->getUp() * 0.25f);
-    } else if (key == 'c') {
-      camera->move(camera->getUp() * -0.25f);
+    } else if (key == 'w' || key == 's' || key == 'a' || key == 'd' || key == ' ' || key == 'c') {
+      held_keys[key] = true;
     } else if (key == '1') {
       objects_shader = phong_shader;
+      record_cubes();
     } else if (key == '2') {
       objects_shader = gouraud_shader;
+      record_cubes();
+    } else if (key == '3') {
+      objects_shader = clustered_shader;
+      record_cubes();
+    } else if (key == 'o') {
+      // 切换加权混合OIT和排序
+      bool weighted = transparency.getMode() == gl_hwk::TransparencyMode::kWeightedBlended;
+      transparency.setMode(weighted ? gl_hwk::TransparencyMode::kSorted : gl_hwk::TransparencyMode::kWeightedBlended);
+    } else if (key == 'p') {
+      for (const auto& stats : gl_hwk::GpuProfiler::instance().getReport()) {
+        fmt::print("{:<24} min {:.3f}ms avg {:.3f}ms p99 {:.3f}ms\n", stats.name, stats.min_ms, stats.avg_ms,
+                   stats.p99_ms);
+      }
+      gl_hwk::GpuProfiler::instance().exportCsv("gpu_profile.csv");
+      gl_hwk::GpuProfiler::instance().exportJson("gpu_profile.json");
+    } else if (key == 't') {
+      gl_hwk::Tracer::instance().writeChromeTrace("trace.json");
+    } else if (key == 'r') {
+      fmt::print("{}", gl_hwk::RenderStats::instance().format());
+    } else if (key == 'l') {
+      auto stats = gl_hwk::OpenGLApplication::instance().getLatencyStats();
+      fmt::print("input latency: {} events, last {:.2f}ms avg {:.2f}ms p99 {:.2f}ms max {:.2f}ms\n", stats.events,
+                 stats.last_ms, stats.avg_ms, stats.p99_ms, stats.max_ms);
+    } else if (key == 'm') {
+      auto stats = texture_streamer.getStats();
+      fmt::print("texture streaming: {} textures, {} loading, {} pending, {:.2f}/{:.2f}MB resident\n", stats.textures,
+                 stats.loading, stats.pending, stats.resident_bytes / 1048576.0, stats.budget_bytes / 1048576.0);
+    } else if (key == 'v') {
+      // 开始/结束录制到capture.y4m
+      auto& app = gl_hwk::OpenGLApplication::instance();
+      if (recording) {
+        app.stopCapture();
+        auto stats = app.getCaptureStats();
+        fmt::print("capture: {} frames written, {} dropped, avg {:.3f}ms\n", stats.frames_written,
+                   stats.frames_dropped, stats.avg_capture_ms);
+      } else {
+        gl_hwk::CaptureOptions capture_options;
+        capture_options.format = gl_hwk::CaptureFormat::kY4m;
+        capture_options.path = "capture.y4m";
+        app.startCapture(capture_options);
+      }
+      recording = !recording;
     }
   };
 
+  auto keyboardReleaseCallback = [&](unsigned char key, int x, int y) { held_keys[key] = false; };
+
   // 鼠标回调
   int last_x = 0;
   int last_y = 0;
@@ -356,7 +525,9 @@ auto main(int argc, char** argv) -> int {
 
   // 注册回调
   gl_hwk::OpenGLApplication::instance().onDisplay(std::move(render_func));
+  gl_hwk::OpenGLApplication::instance().onUpdate(std::move(update_func));
   gl_hwk::OpenGLApplication::instance().onKeyboardPress(std::move(keyboardCallback));
+  gl_hwk::OpenGLApplication::instance().onKeyboardRelease(std::move(keyboardReleaseCallback));
   gl_hwk::OpenGLApplication::instance().onMouseMove(std::move(mouseCallback));
 
   // OpenGL ， 启动！
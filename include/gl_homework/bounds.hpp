@@ -0,0 +1,76 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_BOUNDS_HPP_
+#define GL_HOMEWORK_BOUNDS_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+#include <vector>
+// OpenGL
+#include <glm/glm.hpp>
+// clang-format on
+
+namespace gl_hwk {
+
+/**
+ * @brief 轴对齐包围盒，min大于max时为空
+ */
+struct Aabb {
+  glm::vec3 min = glm::vec3(1e30f);
+  glm::vec3 max = glm::vec3(-1e30f);
+
+  auto isEmpty() const -> bool { return min.x > max.x || min.y > max.y || min.z > max.z; }
+  auto expand(const glm::vec3& point) -> void;
+  auto expand(const Aabb& other) -> void;
+
+  /**
+   * @brief 变换后的包围盒，按列累加，不需要变换8个角点
+   */
+  auto transform(const glm::mat4& matrix) const -> Aabb;
+
+  static auto fromPoints(const std::vector<glm::vec3>& points) -> Aabb;
+};
+
+enum class CullResult {
+  kOutside,
+  kIntersect,
+  kInside,
+};
+
+/**
+ * @brief 视锥体的6个平面，法线指向内侧，plane.xyz * p + plane.w >= 0 的点在内侧
+ */
+struct Frustum {
+  glm::vec4 planes[6];
+
+  /**
+   * @brief 从projection * view矩阵提取平面(Gribb-Hartmann)
+   */
+  static auto fromMatrix(const glm::mat4& view_projection) -> Frustum;
+
+  auto test(const Aabb& box) const -> CullResult;
+  auto test(const glm::vec3& center, float radius) const -> CullResult;
+};
+
+/**
+ * @brief 多个视图的视锥体，最多32个；先用所有视锥体角点的包围盒粗测，通过后只测试掩码中的视锥体
+ * 平面测试会保留视锥体角附近实际在外的包围盒，粗测可能把其中一部分剔除，结果是逐个Frustum::test的子集
+ */
+struct FrustumSet {
+  std::vector<Frustum> frusta;
+  // 所有视锥体的并集的包围盒
+  Aabb bounds;
+
+  static auto fromMatrices(const std::vector<glm::mat4>& view_projections) -> FrustumSet;
+  auto allMask() const -> uint32_t;
+  /**
+   * @brief 测试box与mask中的视锥体
+   * @param inside 输出box完全在内的视锥体掩码
+   * @return 与box相交或包含box的视锥体掩码
+   */
+  auto test(const Aabb& box, uint32_t mask, uint32_t& inside) const -> uint32_t;
+};
+
+}  // namespace gl_hwk
+#endif
@@ -30,6 +30,21 @@ class Camera {
    */
   auto getProjectionMatrix() -> glm::mat4;
   auto getViewMatrix() -> glm::mat4;
+
+  /**
+   * @brief 透视投影的近、远裁剪面距离
+   */
+  auto getNearPlane() -> float;
+  auto getFarPlane() -> float;
+  /**
+   * @brief 竖直方向视场角，单位为弧度
+   */
+  auto getFovY() -> float;
+  auto getAspect() -> float;
+  /**
+   * @brief 以像素为单位的焦距，世界空间中距离d处长度l的物体在屏幕上约占l * f / d个像素
+   */
+  auto getFocalLength() -> float;
   auto setZoom(float zoom) -> void;
   auto getZoom() -> float;
   auto setYaw(float yaw) -> void;
@@ -38,6 +53,15 @@ class Camera {
   auto turnYaw(float angle) -> void;
   auto turnPitch(float angle) -> void;
 
+  /**
+   * @brief 固定步长更新开始时调用，保存当前位置和朝向作为插值的起点，并取消插值
+   */
+  auto saveState() -> void;
+  /**
+   * @brief 渲染前调用，之后的矩阵、位置和方向在saveState保存的状态和当前状态之间按alpha插值
+   */
+  auto interpolate(float alpha) -> void;
+
   auto getUp() -> glm::vec3;
   auto getFront() -> glm::vec3;
   auto getRight() -> glm::vec3;
@@ -0,0 +1,90 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_CLUSTERED_LIGHTING_HPP_
+#define GL_HOMEWORK_CLUSTERED_LIGHTING_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+#include <vector>
+// OpenGL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+// project
+#include "gl_homework/camera.hpp"
+#include "gl_homework/impl.hpp"
+#include "gl_homework/shader.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+/**
+ * @brief 点光源，radius之外不产生光照
+ */
+struct PointLight {
+  glm::vec3 position = glm::vec3(0.0f);
+  float radius = 10.0f;
+  glm::vec3 color = glm::vec3(1.0f);
+  float intensity = 1.0f;
+};
+
+/**
+ * @brief 视锥体划分为tiles_x * tiles_y * slices个cluster，深度方向按对数划分
+ */
+struct ClusterOptions {
+  uint32_t tiles_x = 16;
+  uint32_t tiles_y = 9;
+  uint32_t slices = 24;
+  // 每个cluster最多记录的光源数，超出的光源被忽略
+  uint32_t max_lights_per_cluster = 128;
+};
+
+struct ClusterStats {
+  uint32_t lights = 0;
+  // 所有cluster光源列表的总长度
+  uint32_t light_indices = 0;
+  uint32_t max_lights_in_cluster = 0;
+  // 因超过max_lights_per_cluster被忽略的次数
+  uint32_t overflows = 0;
+  double build_ms = 0.0;
+};
+
+class ClusteredLightingImpl;
+/**
+ * @brief 分簇前向光照，CPU把光源分配到摄像机视锥体的cluster中，以buffer texture上传
+ * 着色器根据片元所在的cluster只计算影响它的光源，配合phong_clustered和gouraud_clustered着色器使用
+ */
+class ClusteredLighting {
+ public:
+  explicit ClusteredLighting(const ClusterOptions& options = ClusterOptions());
+  ~ClusteredLighting();
+
+  auto setLights(const std::vector<PointLight>& lights) -> void;
+  auto getLights() -> std::vector<PointLight>&;
+  auto setAmbient(const glm::vec3& ambient) -> void;
+
+  /**
+   * @brief 用JobSystem按深度切片并行分配光源，不调用GL函数；摄像机投影参数不变时复用cluster包围盒
+   */
+  auto build(Camera& camera) -> void;
+
+  /**
+   * @brief 上传光源和cluster数据，需要在GL线程调用
+   */
+  auto upload() -> void;
+
+  /**
+   * @brief 启用着色器，把三个buffer texture绑定到first_unit开始的纹理单元，并设置相关uniform
+   * 按当前视口计算屏幕tile，需要在设置好绘制用的视口之后调用
+   */
+  auto bind(Shader& shader, int first_unit = 1) -> void;
+
+  auto getStats() -> ClusterStats;
+
+ private:
+  // 隐藏实现
+  unique_impl<ClusteredLightingImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
@@ -0,0 +1,137 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_COMMAND_LIST_HPP_
+#define GL_HOMEWORK_COMMAND_LIST_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+// OpenGL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+// project
+#include "gl_homework/impl.hpp"
+#include "gl_homework/primitive_builder.hpp"
+#include "gl_homework/shader.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+/**
+ * @brief 可以修改的命令参数，由set系列函数返回
+ */
+struct CommandParam {
+  static constexpr uint32_t kInvalid = UINT32_MAX;
+  // 参数在命令缓冲区中的偏移
+  uint32_t offset = kInvalid;
+};
+
+class CommandListImpl;
+/**
+ * @brief 命令列表，把着色器、纹理、uniform和绘制命令录制到连续的缓冲区中，之后每帧重放
+ * 录制时不调用任何GL函数，可以在任意线程进行；execute和patch只能在GL线程调用
+ * uniform位置和图元在第一次execute时解析并缓存，之后的重放不再按名字查找
+ */
+class CommandList {
+ public:
+  CommandList();
+  ~CommandList();
+
+  /**
+   * @brief 清空已录制的命令
+   */
+  auto reset() -> void;
+
+  auto useShader(const std::shared_ptr<Shader>& shader) -> void;
+  /**
+   * @brief 等同于TextureLoader::activeTexture
+   */
+  auto bindTexture(GLuint texture_id, int unit) -> void;
+  auto depthFunc(GLenum func) -> void;
+  auto clearBuffers(GLbitfield mask) -> void;
+
+  /**
+   * @brief 设置当前着色器的uniform，返回值可用于patch
+   */
+  auto setInt(const std::string& name, int value) -> CommandParam;
+  auto setFloat(const std::string& name, float value) -> CommandParam;
+  auto setVec2(const std::string& name, const glm::vec2& value) -> CommandParam;
+  auto setVec3(const std::string& name, const glm::vec3& value) -> CommandParam;
+  auto setVec4(const std::string& name, const glm::vec4& value) -> CommandParam;
+  auto setMat3(const std::string& name, const glm::mat3& value) -> CommandParam;
+  auto setMat4(const std::string& name, const glm::mat4& value) -> CommandParam;
+
+  /**
+   * @brief 绘制builder中已缓存的图元，图元不存在时跳过
+   */
+  auto draw(const std::shared_ptr<PrimitiveBuilder>& builder, const std::string& name) -> void;
+
+  /**
+   * @brief 同PrimitiveBuilder::buildTriangles，几何数据被拷贝一份，在图元不存在时用于创建
+   */
+  auto buildTriangles(const std::shared_ptr<PrimitiveBuilder>& builder, const std::string& name,
+                      const std::vector<glm::vec3>& positions, const std::vector<GLsizei>& indices,
+                      const std::vector<std::vector<float>>& other_data) -> void;
+
+  /**
+   * @brief 修改已录制的uniform的值，类型必须与录制时一致
+   */
+  auto patch(CommandParam param, int value) -> void;
+  auto patch(CommandParam param, float value) -> void;
+  auto patch(CommandParam param, const glm::vec2& value) -> void;
+  auto patch(CommandParam param, const glm::vec3& value) -> void;
+  auto patch(CommandParam param, const glm::vec4& value) -> void;
+  auto patch(CommandParam param, const glm::mat3& value) -> void;
+  auto patch(CommandParam param, const glm::mat4& value) -> void;
+
+  /**
+   * @brief 在GL线程上按顺序执行所有命令
+   */
+  auto execute() -> void;
+
+  /**
+   * @brief 命令缓冲区的字节数
+   */
+  auto size() -> size_t;
+
+ private:
+  // 隐藏实现
+  unique_impl<CommandListImpl> impl_;
+};
+
+class CommandQueueImpl;
+/**
+ * @brief 命令列表的提交队列，单例模式
+ * 工作线程录制好命令列表后submit，GL线程调用execute按sort_key从小到大执行
+ */
+class CommandQueue {
+ public:
+  static auto instance() -> CommandQueue&;
+
+  /**
+   * @brief 线程安全
+   */
+  auto submit(std::shared_ptr<CommandList> list, int64_t sort_key = 0) -> void;
+
+  /**
+   * @brief 执行并清空已提交的命令列表，在GL线程调用
+   */
+  auto execute() -> void;
+
+ private:
+  CommandQueue();
+  ~CommandQueue();
+  // 禁止拷贝和移动
+  CommandQueue(const CommandQueue&) = delete;
+  CommandQueue& operator=(const CommandQueue&) = delete;
+  CommandQueue(CommandQueue&&) = delete;
+  CommandQueue& operator=(CommandQueue&&) = delete;
+
+  unique_impl<CommandQueueImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
@@ -0,0 +1,98 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_DYNAMIC_RESOLUTION_HPP_
+#define GL_HOMEWORK_DYNAMIC_RESOLUTION_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+// OpenGL
+#include <GL/glew.h>
+// project
+#include "gl_homework/impl.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+struct DynamicResolutionOptions {
+  // 目标GPU帧时间，单位为毫秒
+  double target_ms = 16.0;
+  // 渲染分辨率相对输出分辨率的缩放范围，每个方向分别乘以scale
+  float min_scale = 0.5f;
+  float max_scale = 1.0f;
+  // 关闭时保持setScale设置的比例，只做放大
+  bool adaptive = true;
+  // GPU时间低于target_ms * (1 - headroom)时才提高分辨率，避免在目标附近来回切换
+  float headroom = 0.1f;
+  // 单次调整比例的最大变化量
+  float max_step = 0.1f;
+  // 比例变化后，至少收集到这么多帧新比例下的GPU时间才再次调整
+  uint32_t settle_frames = 4;
+  // 放大时的锐化强度[0, 1]，比例为1时直接复制不锐化
+  float sharpness = 0.5f;
+};
+
+struct DynamicResolutionStats {
+  float scale = 1.0f;
+  uint32_t render_width = 0;
+  uint32_t render_height = 0;
+  // 最近一帧和指数平均后的GPU时间，包括放大
+  double last_gpu_ms = 0.0;
+  double gpu_ms = 0.0;
+  // 比例被控制器修改的次数
+  uint32_t changes = 0;
+  uint64_t frames = 0;
+};
+
+class DynamicResolutionImpl;
+/**
+ * @brief 动态分辨率，场景先渲染到离屏目标中按比例缩小的区域，再锐化放大到begin时绑定的帧缓冲
+ * 控制器用GL_TIMESTAMP查询测量每帧的GPU时间(延迟几帧读取，不阻塞)，按像素数与时间成正比估计能满足target_ms的比例。
+ * 离屏目标按max_scale分配一次，比例变化只改变视口，不重新分配；缩小后的区域与输出的宽高比相同，
+ * 投影矩阵仍使用Camera按窗口大小计算的结果，透视不随比例变化
+ */
+class DynamicResolution {
+ public:
+  /**
+   * @brief width、height为输出(窗口)的大小
+   */
+  DynamicResolution(uint32_t width, uint32_t height,
+                    const DynamicResolutionOptions& options = DynamicResolutionOptions());
+  ~DynamicResolution();
+
+  /**
+   * @brief 输出大小变化，重新分配离屏目标
+   */
+  auto resize(uint32_t width, uint32_t height) -> void;
+
+  /**
+   * @brief 绑定离屏目标、设置视口为缩小后的区域并清除颜色和深度，之后的绘制都在低分辨率下进行
+   * 在场景中切换帧缓冲的代码应恢复到进入时绑定的帧缓冲和视口，而不是默认帧缓冲
+   */
+  auto begin() -> void;
+
+  /**
+   * @brief 放大到begin时绑定的帧缓冲和视口，恢复状态，并根据GPU时间调整下一帧的比例
+   */
+  auto end() -> void;
+
+  /**
+   * @brief 直接设置比例，限制在[min_scale, max_scale]内；adaptive时控制器会从这个比例继续调整
+   */
+  auto setScale(float scale) -> void;
+  auto getScale() -> float;
+  auto setOptions(const DynamicResolutionOptions& options) -> void;
+
+  /**
+   * @brief 离屏目标的颜色纹理，只有左下角getStats().render_width * render_height的区域有效
+   */
+  auto getColorTexture() -> GLuint;
+  auto getStats() -> DynamicResolutionStats;
+
+ private:
+  // 隐藏实现
+  unique_impl<DynamicResolutionImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
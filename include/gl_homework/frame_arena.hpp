@@ -0,0 +1,71 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_FRAME_ARENA_HPP_
+#define GL_HOMEWORK_FRAME_ARENA_HPP_
+
+// clang-format off
+// std
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+// project
+#include "gl_homework/impl.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+/**
+ * @brief 从FrameArena分配的临时数组，只在当前帧内有效
+ */
+template <typename T>
+using FrameVector = std::pmr::vector<T>;
+
+struct FrameArenaStats {
+  size_t capacity = 0;
+  // 本帧已分配的字节数
+  size_t used = 0;
+  // 历史最大的单帧用量
+  size_t peak = 0;
+  // 容量不足转而从堆上分配的次数
+  uint64_t overflows = 0;
+};
+
+class FrameArenaImpl;
+/**
+ * @brief 单例模式，每帧的线性分配器，分配只移动指针，释放为空操作，整帧结束后由OpenGLApplication统一reset
+ * 容量不足时从堆上分配，reset时按峰值扩容，稳定后不再产生堆分配；不是线程安全的，只在GL线程使用
+ */
+class FrameArena {
+ public:
+  static auto instance() -> FrameArena&;
+
+  auto resource() -> std::pmr::memory_resource*;
+
+  template <typename T>
+  auto makeVector(size_t reserve = 0) -> FrameVector<T> {
+    FrameVector<T> vector(resource());
+    vector.reserve(reserve);
+    return vector;
+  }
+
+  /**
+   * @brief 回收本帧的所有分配，之前分配的内存全部失效
+   */
+  auto reset() -> void;
+
+  auto getStats() -> FrameArenaStats;
+
+ private:
+  FrameArena();
+  // 禁止拷贝和移动
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+  FrameArena(FrameArena&&) = delete;
+  FrameArena& operator=(FrameArena&&) = delete;
+
+  unique_impl<FrameArenaImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
@@ -0,0 +1,85 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_FRAME_CAPTURE_HPP_
+#define GL_HOMEWORK_FRAME_CAPTURE_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+#include <string>
+// OpenGL
+#include <GL/glew.h>
+// project
+#include "gl_homework/impl.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+enum class CaptureFormat {
+  // 每帧一张PNG，frame_000000.png...
+  kPngSequence,
+  // YUV4MPEG2视频流，4:4:4采样，可以直接用ffmpeg/mpv打开
+  kY4m,
+  // 无文件头的BGRA帧序列，行从上到下
+  kRaw,
+};
+
+struct CaptureOptions {
+  CaptureFormat format = CaptureFormat::kPngSequence;
+  // PNG序列为输出目录，Y4M和raw为输出文件
+  std::string path = "capture";
+  // PBO环的大小，至少为3
+  uint32_t ring_size = 3;
+  // 等待编码的最大帧数
+  uint32_t max_pending = 8;
+  // PBO环或编码队列满时丢弃新帧而不阻塞渲染线程；录制无窗口的离线渲染时应关闭
+  bool drop_frames = true;
+  // 写入Y4M文件头的帧率
+  uint32_t fps = 30;
+};
+
+struct CaptureStats {
+  uint64_t frames_captured = 0;
+  uint64_t frames_written = 0;
+  // PBO环满或编码队列满时丢弃的帧
+  uint64_t frames_dropped = 0;
+  // 渲染线程上captureFrame的耗时
+  double avg_capture_ms = 0.0;
+  double max_capture_ms = 0.0;
+};
+
+class FrameCaptureImpl;
+/**
+ * @brief 非阻塞帧捕获
+ * glReadPixels写入PBO环并插入fence，几帧之后fence完成时再映射读取，编码和写文件在后台线程完成
+ */
+class FrameCapture {
+ public:
+  FrameCapture();
+  ~FrameCapture();
+
+  /**
+   * @brief 开始捕获当前读帧缓冲的width*height区域，需要在GL线程调用
+   */
+  auto start(const CaptureOptions& options, uint32_t width, uint32_t height) -> bool;
+
+  /**
+   * @brief 在一帧渲染结束后调用，发起本帧的异步读取并回收已完成的帧
+   */
+  auto captureFrame() -> void;
+
+  /**
+   * @brief 等待所有在途帧读取完成，写完文件后结束后台线程
+   */
+  auto stop() -> void;
+  auto isRunning() -> bool;
+
+  auto getStats() -> CaptureStats;
+
+ private:
+  // 隐藏实现
+  unique_impl<FrameCaptureImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
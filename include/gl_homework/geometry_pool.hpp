@@ -0,0 +1,112 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_GEOMETRY_POOL_HPP_
+#define GL_HOMEWORK_GEOMETRY_POOL_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+#include <vector>
+// OpenGL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+// project
+#include "gl_homework/impl.hpp"
+#include "gl_homework/instance_buffer.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+using MeshId = uint32_t;
+constexpr MeshId kInvalidMesh = UINT32_MAX;
+
+/**
+ * @brief 与glMultiDrawElementsIndirect要求的结构体布局一致
+ */
+struct DrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instance_count;
+  GLuint first_index;
+  GLint base_vertex;
+  GLuint base_instance;
+};
+
+/**
+ * @brief 一个池只保存一种顶点格式：位置加other_data_num个vec3，与PrimitiveBuilder的布局相同
+ */
+struct GeometryPoolOptions {
+  uint32_t other_data_num = 2;
+  // 初始容量，不足时按2倍扩容
+  uint32_t vertex_capacity = 1 << 16;
+  uint32_t index_capacity = 1 << 18;
+};
+
+struct GeometryPoolStats {
+  uint32_t meshes = 0;
+  uint32_t vertices_used = 0;
+  uint32_t vertex_capacity = 0;
+  uint32_t indices_used = 0;
+  uint32_t index_capacity = 0;
+  // 顶点和索引空闲链表中的块数
+  uint32_t free_blocks = 0;
+  // 扩容或整理碎片时重新分配缓冲区的次数
+  uint32_t relocations = 0;
+  // 上一次draw提交的间接绘制命令数
+  uint32_t draw_commands = 0;
+};
+
+class GeometryPoolImpl;
+/**
+ * @brief 几何体池，所有三角形网格共用一个大VBO和EBO，用空闲链表分配其中的区间
+ * 每帧用addDraw在CPU上生成间接绘制命令，draw时绑定一次VAO并用一次glMultiDrawElementsIndirect提交
+ * 每条命令的base_instance指向InstanceBuffer中的实例数据，配合phong_instanced等实例化着色器使用
+ */
+class GeometryPool {
+ public:
+  explicit GeometryPool(const GeometryPoolOptions& options = GeometryPoolOptions());
+  ~GeometryPool();
+
+  /**
+   * @brief 添加三角形网格，参数同PrimitiveBuilder::buildTriangles，indices为空时按顶点顺序绘制
+   * 空间不足时先整理碎片，仍不足再扩容；需要在GL线程调用
+   * @return 网格id，other_data格式与池不一致时返回kInvalidMesh
+   */
+  auto addMesh(const std::vector<glm::vec3>& positions, const std::vector<GLsizei>& indices,
+               const std::vector<std::vector<float>>& other_data) -> MeshId;
+
+  /**
+   * @brief 释放网格占用的区间，相邻的空闲区间会合并
+   */
+  auto removeMesh(MeshId id) -> void;
+
+  /**
+   * @brief 把所有网格紧密排列到新的缓冲区中，在GPU上复制，不需要重新上传
+   */
+  auto defragment() -> void;
+
+  /**
+   * @brief 碎片率，1 - 最大空闲块 / 空闲总量，没有空闲空间时为0
+   */
+  auto getFragmentation() -> float;
+
+  /**
+   * @brief 记录一条绘制命令，使用instances中从first_instance开始的instance_count个实例
+   */
+  auto addDraw(MeshId id, uint32_t first_instance, uint32_t instance_count = 1) -> void;
+  auto clearDraws() -> void;
+
+  /**
+   * @brief 上传命令缓冲区并一次提交所有已记录的命令，着色器由调用者启用
+   * 不支持glMultiDrawElementsIndirect时逐条绘制；不清空已记录的命令
+   */
+  auto draw(InstanceBuffer& instances) -> void;
+
+  auto getStats() -> GeometryPoolStats;
+
+ private:
+  // 隐藏实现
+  unique_impl<GeometryPoolImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
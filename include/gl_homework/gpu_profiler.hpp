@@ -0,0 +1,95 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_GPU_PROFILER_HPP_
+#define GL_HOMEWORK_GPU_PROFILER_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+// OpenGL
+#include <GL/glew.h>
+// project
+#include "gl_homework/impl.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+/**
+ * @brief 单个scope的GPU耗时统计，单位为毫秒，按帧聚合
+ */
+struct GpuScopeStats {
+  std::string name;
+  // 参与统计的帧数
+  uint32_t samples = 0;
+  double last_ms = 0.0;
+  double min_ms = 0.0;
+  double avg_ms = 0.0;
+  double p99_ms = 0.0;
+};
+
+class GpuProfilerImpl;
+/**
+ * @brief GPU计时器，用GL_TIME_ELAPSED查询测量每个scope的GPU耗时
+ * 查询结果延迟若干帧后再读取，不会阻塞管线；GL_TIME_ELAPSED不能嵌套，嵌套的scope计入最外层scope
+ * 默认关闭，调用setEnabled(true)后从下一帧开始生效
+ */
+class GpuProfiler {
+ public:
+  static auto instance() -> GpuProfiler&;
+
+  auto setEnabled(bool enable) -> void;
+  auto isEnabled() -> bool;
+
+  /**
+   * @brief 帧的开始和结束，由OpenGLApplication在display中调用
+   */
+  auto beginFrame() -> void;
+  auto endFrame() -> void;
+
+  auto beginScope(const std::string& name) -> void;
+  /**
+   * @brief 按地址缓存scope编号，name需要在程序运行期间保持有效且内容不变，例如字符串常量
+   */
+  auto beginScope(const char* name) -> void;
+  auto endScope() -> void;
+
+  /**
+   * @brief 获取每个scope最近若干帧的min/avg/p99
+   */
+  auto getReport() -> std::vector<GpuScopeStats>;
+  /**
+   * @brief 等待已结束的帧的查询完成后清空统计，需要在帧外调用
+   */
+  auto reset() -> void;
+
+  auto exportCsv(const std::string& path) -> bool;
+  auto exportJson(const std::string& path) -> bool;
+
+ private:
+  GpuProfiler();
+  // 禁止拷贝和移动
+  GpuProfiler(const GpuProfiler&) = delete;
+  GpuProfiler& operator=(const GpuProfiler&) = delete;
+  GpuProfiler(GpuProfiler&&) = delete;
+  GpuProfiler& operator=(GpuProfiler&&) = delete;
+
+  unique_impl<GpuProfilerImpl> impl_;
+};
+
+/**
+ * @brief RAII形式的GPU scope，构造时开始计时，析构时结束
+ */
+class GpuProfileScope {
+ public:
+  explicit GpuProfileScope(const std::string& name) { GpuProfiler::instance().beginScope(name); }
+  explicit GpuProfileScope(const char* name) { GpuProfiler::instance().beginScope(name); }
+  ~GpuProfileScope() { GpuProfiler::instance().endScope(); }
+
+  GpuProfileScope(const GpuProfileScope&) = delete;
+  GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+};
+
+}  // namespace gl_hwk
+#endif
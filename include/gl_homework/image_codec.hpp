@@ -0,0 +1,91 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_IMAGE_CODEC_HPP_
+#define GL_HOMEWORK_IMAGE_CODEC_HPP_
+
+// clang-format off
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+// project
+#include "gl_homework/impl.hpp"
+#include "gl_homework/transform_store.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+enum class PixelLayout {
+  // 对应glTexImage2D的GL_RGB/GL_UNSIGNED_BYTE
+  kRgb,
+  // 对应GL_RGBA/GL_UNSIGNED_BYTE，没有透明通道的图片alpha为255
+  kRgba,
+};
+
+struct DecodeOptions {
+  PixelLayout layout = PixelLayout::kRgb;
+  // 行从下到上输出，与OpenGL纹理坐标的v方向一致
+  bool flip = false;
+};
+
+/**
+ * @brief 行紧密排列的8位图像
+ */
+struct Image {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  PixelLayout layout = PixelLayout::kRgb;
+  std::vector<uint8_t> pixels;
+
+  auto channels() const -> uint32_t { return layout == PixelLayout::kRgba ? 4 : 3; }
+  auto empty() const -> bool { return pixels.empty(); }
+};
+
+class ImageCodecImpl;
+/**
+ * @brief 内置的JPEG(基线)和PNG解码器，直接解码为上传需要的RGB/RGBA布局，不依赖OpenCV
+ * YCbCr转RGB使用SSE2/AVX2、IDCT使用AVX2，运行时根据CPU选择；文件、系数和解压缓冲区在多次解码间复用，
+ * 因此一个实例不能同时在多个线程中使用。编译时开启opencv选项后，内置解码器不支持的格式交给cv::imread
+ */
+class ImageCodec {
+ public:
+  ImageCodec();
+  ~ImageCodec();
+
+  /**
+   * @brief 按文件头识别格式并解码，复用image.pixels已有的容量
+   */
+  auto decode(const std::string& path, const DecodeOptions& options, Image& image) -> bool;
+  auto decode(const uint8_t* data, size_t size, const DecodeOptions& options, Image& image) -> bool;
+
+  /**
+   * @brief 解码到调用者提供的缓冲区，大小至少为width * height * 通道数，可以先用readInfo得到尺寸
+   */
+  auto decode(const uint8_t* data, size_t size, const DecodeOptions& options, uint8_t* pixels, size_t capacity)
+      -> bool;
+
+  /**
+   * @brief 只解析文件头得到图像尺寸
+   */
+  auto readInfo(const uint8_t* data, size_t size, uint32_t& width, uint32_t& height) -> bool;
+
+  /**
+   * @brief 把行从上到下的RGB/RGBA像素编码为PNG文件
+   */
+  auto encodePng(const std::string& path, const uint8_t* pixels, uint32_t width, uint32_t height, PixelLayout layout)
+      -> bool;
+
+  /**
+   * @brief 指定IDCT和颜色转换使用的指令集，超过CPU支持的级别时使用支持的最高级别
+   */
+  auto setSimdLevel(SimdLevel level) -> void;
+  auto getSimdLevel() -> SimdLevel;
+
+ private:
+  // 隐藏实现
+  unique_impl<ImageCodecImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
@@ -0,0 +1,72 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_INSTANCE_BUFFER_HPP_
+#define GL_HOMEWORK_INSTANCE_BUFFER_HPP_
+
+// clang-format off
+// std
+#include <cstddef>
+#include <vector>
+// OpenGL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+// project
+#include "gl_homework/impl.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+/**
+ * @brief 物体的变换，model = translate(position) * rotate(angle, axis) * scale(scale)
+ */
+struct Transform {
+  glm::vec3 position = glm::vec3(0.0f);
+  // 旋转轴，不需要归一化
+  glm::vec3 axis = glm::vec3(0.0f, 1.0f, 0.0f);
+  // 旋转角，单位为角度
+  float angle = 0.0f;
+  glm::vec3 scale = glm::vec3(1.0f);
+};
+
+/**
+ * @brief 每个实例上传到GPU的数据，normal为法线矩阵，只使用左上3x3
+ */
+struct InstanceData {
+  glm::mat4 model;
+  glm::mat4 normal;
+};
+
+class InstanceBufferImpl;
+/**
+ * @brief 实例数据缓冲区，在CPU上并行计算变换矩阵，再整体上传到VBO
+ */
+class InstanceBuffer {
+ public:
+  InstanceBuffer();
+  ~InstanceBuffer();
+
+  /**
+   * @brief 用JobSystem分块并行计算model和法线矩阵，结果直接写入待上传的数组，不调用GL函数
+   */
+  auto updateTransforms(const std::vector<Transform>& transforms) -> void;
+
+  /**
+   * @brief 改变实例数，用于由外部直接写入data()
+   */
+  auto resize(size_t size) -> void;
+  auto data() -> InstanceData*;
+  auto size() -> size_t;
+
+  /**
+   * @brief 把数据上传到VBO，需要在GL线程调用；容量不足时重新分配，否则orphan后整体更新
+   */
+  auto upload() -> void;
+  auto getBuffer() -> GLuint;
+
+ private:
+  // 隐藏实现
+  unique_impl<InstanceBufferImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
@@ -0,0 +1,69 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_JOB_SYSTEM_HPP_
+#define GL_HOMEWORK_JOB_SYSTEM_HPP_
+
+// clang-format off
+// std
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+// project
+#include "gl_homework/impl.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+/**
+ * @brief 记录一组任务中尚未完成的数量，用于JobSystem::wait
+ */
+struct JobCounter {
+  std::atomic<int64_t> remaining{0};
+
+  auto isDone() const -> bool { return remaining.load(std::memory_order_acquire) == 0; }
+};
+
+class JobSystemImpl;
+/**
+ * @brief 任务系统，单例模式
+ * 每个工作线程有自己的任务队列，空闲时从其他队列的另一端窃取任务；等待的线程也会参与执行任务
+ */
+class JobSystem {
+ public:
+  static auto instance() -> JobSystem&;
+
+  /**
+   * @brief 工作线程数，为CPU核数减一，调用wait的线程补足最后一个核
+   */
+  auto getWorkerCount() -> uint32_t;
+
+  /**
+   * @brief 提交一个任务，counter不为空时在任务完成后减一
+   */
+  auto schedule(std::function<void()> job, JobCounter* counter = nullptr) -> void;
+
+  /**
+   * @brief 等待counter归零，等待期间在当前线程执行任务
+   */
+  auto wait(JobCounter& counter) -> void;
+
+  /**
+   * @brief 把[0, count)按grain大小分块并行执行func(begin, end)，返回时全部完成
+   */
+  auto parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& func) -> void;
+
+ private:
+  JobSystem();
+  ~JobSystem();
+  // 禁止拷贝和移动
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+  JobSystem(JobSystem&&) = delete;
+  JobSystem& operator=(JobSystem&&) = delete;
+
+  unique_impl<JobSystemImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
@@ -0,0 +1,129 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_MULTI_VIEW_HPP_
+#define GL_HOMEWORK_MULTI_VIEW_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+// OpenGL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+// project
+#include "gl_homework/bounds.hpp"
+#include "gl_homework/camera.hpp"
+#include "gl_homework/impl.hpp"
+#include "gl_homework/instance_buffer.hpp"
+#include "gl_homework/scene_graph.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+/**
+ * @brief 一个视图的矩阵和输出位置
+ */
+struct RenderView {
+  glm::mat4 view = glm::mat4(1.0f);
+  glm::mat4 projection = glm::mat4(1.0f);
+  // (x, y, width, height)，以像素为单位
+  glm::ivec4 viewport = glm::ivec4(0);
+  // 为0时绘制到render时绑定的帧缓冲，否则绘制到纹理，texture_target可以是立方体贴图的某个面
+  GLuint texture = 0;
+  GLenum texture_target = GL_TEXTURE_2D;
+  // 只清除视口内的颜色和深度
+  bool clear = true;
+  glm::vec4 clear_color = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+  /**
+   * @brief 使用摄像机的位置、朝向和视场角，按视口的宽高比重新计算投影矩阵
+   */
+  static auto fromCamera(Camera& camera, const glm::ivec4& viewport) -> RenderView;
+};
+
+struct MultiViewStats {
+  uint32_t views = 0;
+  // 最近一次cull测试的物体数，cull(SceneGraph&)时为场景图的节点数
+  uint32_t objects = 0;
+  // 不在任何视图中的物体，只测试一次
+  uint32_t rejected = 0;
+  // 各视图可见物体数之和
+  uint32_t visible = 0;
+  double cull_ms = 0.0;
+};
+
+/**
+ * @brief 绘制一个视图，调用时视口、裁剪矩形和帧缓冲已经设置好，只需设置view、projection并提交绘制
+ */
+using MultiViewDrawFunc = std::function<void(uint32_t view, const RenderView& render_view)>;
+
+class MultiViewRendererImpl;
+/**
+ * @brief 多视图渲染，例如分屏、画中画和立方体贴图的六个面
+ * 与视图无关的工作只做一次：所有视锥体合并成FrustumSet，一次遍历完成剔除，子树在所有视锥体外时整体跳过，
+ * 只对仍相交的视图逐个细化；各视图的可见实例收集到一个缓冲区，上传一次，每个视图只绘制自己的区间
+ */
+class MultiViewRenderer {
+ public:
+  MultiViewRenderer();
+  ~MultiViewRenderer();
+
+  auto clearViews() -> void;
+  /**
+   * @brief 最多32个视图
+   * @return 视图编号，超过上限时返回UINT32_MAX
+   */
+  auto addView(const RenderView& view) -> uint32_t;
+  auto setView(uint32_t index, const RenderView& view) -> void;
+  auto getView(uint32_t index) -> const RenderView&;
+  auto getViewCount() -> uint32_t;
+
+  /**
+   * @brief 把width * height的区域按行优先平均分成count个视口，第一行在上方，每行从左到右，例如4个视口为2x2
+   */
+  static auto splitViewports(uint32_t count, uint32_t width, uint32_t height) -> std::vector<glm::ivec4>;
+
+  /**
+   * @brief 添加绘制立方体贴图六个面的视图，视场角90度，面的顺序和朝向与GL_TEXTURE_CUBE_MAP_POSITIVE_X + i一致
+   * cubemap需要已经分配size * size的颜色存储
+   * @return 第一个面的视图编号
+   */
+  auto addCubemapViews(GLuint cubemap, uint32_t size, const glm::vec3& position, float near_plane, float far_plane)
+      -> uint32_t;
+
+  /**
+   * @brief 用所有视图的视锥体剔除bounds，visible中的编号为bounds的下标
+   */
+  auto cull(const std::vector<Aabb>& bounds) -> void;
+  /**
+   * @brief 用所有视图的视锥体剔除场景图，一次遍历，visible中的编号为NodeId
+   */
+  auto cull(SceneGraph& graph) -> void;
+  auto getVisible(uint32_t view) -> const std::vector<uint32_t>&;
+
+  /**
+   * @brief 按视图顺序把shared中各视图可见的实例复制到out，多个视图可见的实例复制多份，需要在之后upload
+   * 需要先用与shared下标对应的bounds调用cull
+   */
+  auto gatherInstances(InstanceBuffer& shared, InstanceBuffer& out) -> void;
+  /**
+   * @brief 视图在gatherInstances输出中的区间[first, first + count)，配合PrimitiveBuilder::drawInstanced使用
+   */
+  auto getInstanceRange(uint32_t view) -> std::pair<size_t, size_t>;
+
+  /**
+   * @brief 依次设置每个视图的帧缓冲、视口和裁剪矩形，清除后调用draw，最后恢复帧缓冲、视口和裁剪状态
+   */
+  auto render(const MultiViewDrawFunc& draw) -> void;
+
+  auto getStats() -> MultiViewStats;
+
+ private:
+  // 隐藏实现
+  unique_impl<MultiViewRendererImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
@@ -0,0 +1,97 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_OCCLUSION_CULLER_HPP_
+#define GL_HOMEWORK_OCCLUSION_CULLER_HPP_
+
+// clang-format off
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+// OpenGL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+// project
+#include "gl_homework/bounds.hpp"
+#include "gl_homework/impl.hpp"
+#include "gl_homework/transform_store.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+using OccluderId = uint32_t;
+
+struct OcclusionOptions {
+  // 深度缓冲的分辨率，向上取整为分块大小的整数倍
+  uint32_t width = 256;
+  uint32_t height = 128;
+};
+
+struct OcclusionStats {
+  uint32_t occluders = 0;
+  // 近平面裁剪后光栅化的三角形数
+  uint32_t triangles = 0;
+  uint32_t tested = 0;
+  uint32_t occluded = 0;
+  // 本帧光栅化遮挡物和测试包围盒的CPU耗时
+  double raster_ms = 0.0;
+  double test_ms = 0.0;
+};
+
+class OcclusionCullerImpl;
+/**
+ * @brief CPU遮挡剔除，把少量指定的遮挡物网格光栅化到低分辨率的分块深度缓冲中，再用包围盒测试物体是否被完全遮挡
+ * 光栅化按分块用JobSystem并行，逐行8/4个像素使用AVX2/SSE；不调用GL函数，可以在没有GPU的环境中使用
+ */
+class OcclusionCuller {
+ public:
+  explicit OcclusionCuller(const OcclusionOptions& options = OcclusionOptions());
+  ~OcclusionCuller();
+
+  /**
+   * @brief 添加遮挡物，positions为模型空间坐标，indices每3个为一个三角形；遮挡物应该是实心的大物体
+   */
+  auto addOccluder(const std::vector<glm::vec3>& positions, const std::vector<GLsizei>& indices,
+                   const glm::mat4& model = glm::mat4(1.0f)) -> OccluderId;
+  auto setOccluderTransform(OccluderId id, const glm::mat4& model) -> void;
+  auto removeOccluder(OccluderId id) -> void;
+  auto clearOccluders() -> void;
+
+  /**
+   * @brief 清空深度缓冲并光栅化所有遮挡物，每帧在测试前调用一次
+   */
+  auto render(const glm::mat4& view_projection) -> void;
+
+  /**
+   * @brief 世界空间包围盒是否可能可见；与近平面相交时总是可见，完全在屏幕外时不可见
+   * 只判断遮挡，调用前应先做视锥体剔除；可以在多个线程中同时调用
+   */
+  auto isVisible(const Aabb& box) -> bool;
+
+  /**
+   * @brief 用JobSystem并行测试一组包围盒，visible[i]为1时可见
+   */
+  auto cull(const std::vector<Aabb>& boxes, std::vector<uint8_t>& visible) -> void;
+
+  /**
+   * @brief 行优先的深度缓冲，值为[0, 1]的窗口深度，1为远平面，用于调试和可视化
+   */
+  auto getDepthBuffer() -> const std::vector<float>&;
+  auto getWidth() -> uint32_t;
+  auto getHeight() -> uint32_t;
+
+  /**
+   * @brief 指定使用的指令集，超过CPU支持的级别时使用支持的最高级别
+   */
+  auto setSimdLevel(SimdLevel level) -> void;
+  auto getSimdLevel() -> SimdLevel;
+
+  auto getStats() -> OcclusionStats;
+
+ private:
+  // 隐藏实现
+  unique_impl<OcclusionCullerImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
@@ -6,12 +6,15 @@
 // clang-format off
 // std
 #include <functional>
+#include <vector>
 // OpenGL
 #include <GL/glew.h>
 #include <GL/freeglut.h>
 // third party
 #include <fmt/core.h>
 // project
+#include "gl_homework/dynamic_resolution.hpp"
+#include "gl_homework/frame_capture.hpp"
 #include "gl_homework/impl.hpp"
 // clang-format on
 
@@ -25,6 +28,26 @@ struct WindowOptions {
   float r = 0.0;
   float b = 0.0;
   float g = 0.0;
+  // 无窗口模式，创建EGL surfaceless上下文并渲染到width*height的FBO，不需要显示器
+  bool headless = false;
+  // 无窗口模式下run渲染的帧数，0表示一直运行直到调用stop
+  uint32_t frames = 0;
+  // 固定步长更新的频率(次/秒)；无窗口模式下每帧模拟时间前进一个步长，结果与运行速度无关
+  uint32_t update_rate = 60;
+  // 每帧最多执行的更新次数，渲染跟不上时丢弃多出的模拟时间
+  uint32_t max_updates_per_frame = 8;
+};
+
+/**
+ * @brief 输入延迟：从输入事件发生到处理了该事件的帧提交(glFlush)之间的时间
+ */
+struct InputLatencyStats {
+  uint64_t events = 0;
+  double last_ms = 0.0;
+  double avg_ms = 0.0;
+  // 最近256个事件的p99
+  double p99_ms = 0.0;
+  double max_ms = 0.0;
 };
 
 class OpenGLApplicationImpl;
@@ -35,16 +58,64 @@ class OpenGLApplication {
 
   auto init(int argc, char** argv, const WindowOptions& options = WindowOptions()) -> void;
   auto run() -> void;
+  /**
+   * @brief 结束主循环，无窗口模式下在当前帧结束后返回
+   */
+  auto stop() -> void;
+  auto isHeadless() -> bool;
+
+  /**
+   * @brief 同步读取当前绑定的帧缓冲中窗口大小的区域，RGBA，行从下到上
+   */
+  auto readPixels() -> std::vector<uint8_t>;
+
+  /**
+   * @brief 开始捕获每一帧到文件，通过PBO异步读取，不阻塞渲染；需要在init之后调用
+   */
+  auto startCapture(const CaptureOptions& options) -> bool;
+  auto stopCapture() -> void;
+  auto getCaptureStats() -> CaptureStats;
 
   auto setDepthTest(bool enable) -> void;
 
+  /**
+   * @brief 开启动态分辨率，onDisplay回调渲染到按GPU帧时间缩放的离屏目标，再锐化放大到窗口；需要在init之后调用
+   */
+  auto enableDynamicResolution(const DynamicResolutionOptions& options = DynamicResolutionOptions()) -> void;
+  auto disableDynamicResolution() -> void;
+  auto getDynamicResolutionStats() -> DynamicResolutionStats;
+
+  /**
+   * @brief 固定步长的模拟更新，每帧渲染前按经过的时间调用0到max_updates_per_frame次，dt恒为1 / update_rate
+   * 设置后输入事件按时间戳排队，在时间戳之后的第一次更新前派发；未设置时在每帧开始时派发
+   */
+  auto onUpdate(std::function<void(float dt)>&& func) -> void;
+  /**
+   * @brief 最后一次更新之后剩余的时间占一个步长的比例[0, 1)，渲染时在上一次和最后一次更新的状态之间插值
+   */
+  auto getInterpolationAlpha() -> float;
+  /**
+   * @brief 模拟时间，单位为秒，只在更新时前进
+   */
+  auto getSimulationTime() -> double;
+  /**
+   * @brief 与插值后的状态对应的时间，即getSimulationTime() - (1 - alpha) * dt，用于直接由时间计算的动画
+   */
+  auto getRenderTime() -> double;
+  auto getLatencyStats() -> InputLatencyStats;
+
   auto onKeyboardPress(std::function<void(unsigned char key, int x, int y)>&& func) -> void;
+  /**
+   * @brief 按键抬起；设置后忽略按住按键时的自动重复，按下和抬起各派发一次
+   */
+  auto onKeyboardRelease(std::function<void(unsigned char key, int x, int y)>&& func) -> void;
   auto onDisplay(std::function<void()>&& func) -> void;
   auto onMouseButtonPress(std::function<void(int button, int state, int x, int y)>&& func) -> void;
   auto onMouseMove(std::function<void(int x, int y)>&& func) -> void;
 
  private:
   OpenGLApplication();
+  ~OpenGLApplication();
 
   // 禁止拷贝和移动 
   OpenGLApplication(const OpenGLApplication&) = delete;
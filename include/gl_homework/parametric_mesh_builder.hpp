@@ -0,0 +1,106 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_PARAMETRIC_MESH_BUILDER_HPP_
+#define GL_HOMEWORK_PARAMETRIC_MESH_BUILDER_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+#include <memory>
+#include <vector>
+// OpenGL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+// project
+#include "gl_homework/camera.hpp"
+#include "gl_homework/impl.hpp"
+#include "gl_homework/primitive_builder.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+enum class ParametricShape {
+  kUvSphere,
+  kIcoSphere,
+  kCylinder,
+  kTorus,
+  kPlane,
+  kCapsule,
+};
+
+/**
+ * @brief 形状参数，均以原点为中心，未用到的字段被忽略
+ * 球：radius；圆柱、胶囊：radius和沿Y轴的height(胶囊不含两端的半球)
+ * 圆环：radius为中心圆半径，minor_radius为管半径，位于XZ平面；平面：size，位于XZ平面，法线为+Y
+ */
+struct ParametricParams {
+  ParametricShape shape = ParametricShape::kUvSphere;
+  float radius = 0.5f;
+  float minor_radius = 0.2f;
+  float height = 1.0f;
+  glm::vec2 size = glm::vec2(1.0f);
+};
+
+/**
+ * @brief 生成的网格，other_data每个顶点9个float：纹理坐标(u, v, 0)、法线、切线
+ * 对应着色器的location 1、2、3，与立方体等图元的布局兼容
+ */
+struct ParametricMesh {
+  std::vector<glm::vec3> positions;
+  std::vector<GLsizei> indices;
+  std::vector<float> other_data;
+};
+
+struct ParametricLodOptions {
+  // 曲面与折线之间允许的最大屏幕误差，单位为像素
+  float pixel_error = 0.5f;
+  // 圆周方向的段数范围，实际段数为其中的2的幂；构造时min_segments向上取为至少4的2的幂，max_segments不小于它
+  uint32_t min_segments = 8;
+  uint32_t max_segments = 256;
+};
+
+class ParametricMeshBuilderImpl;
+/**
+ * @brief 参数化网格构建者，根据形状在屏幕上的大小选择细分段数，每种参数和段数只生成一次
+ * 网格通过PrimitiveBuilder上传和绘制，model等uniform由调用者设置
+ */
+class ParametricMeshBuilder {
+ public:
+  explicit ParametricMeshBuilder(std::shared_ptr<PrimitiveBuilder> primitive_builder,
+                                 const ParametricLodOptions& options = ParametricLodOptions());
+  ~ParametricMeshBuilder();
+
+  /**
+   * @brief 生成网格，segments为圆周方向的段数，平面为每边的段数，二十面体球按段数换算细分次数
+   * 不调用GL函数，顶点较多时用JobSystem按行并行
+   */
+  static auto generate(const ParametricParams& params, uint32_t segments) -> ParametricMesh;
+
+  /**
+   * @brief 按model变换后的曲率半径投影到屏幕上的像素数选择段数，使弦高误差不超过pixel_error
+   */
+  auto selectSegments(const ParametricParams& params, Camera& camera, const glm::mat4& model) -> uint32_t;
+
+  /**
+   * @brief 选择段数后绘制
+   * @return 使用的段数
+   */
+  auto draw(const ParametricParams& params, Camera& camera, const glm::mat4& model) -> uint32_t;
+
+  /**
+   * @brief 以固定段数绘制，第一次使用时生成并上传
+   */
+  auto draw(const ParametricParams& params, uint32_t segments) -> void;
+
+  /**
+   * @brief 已生成的网格数，每种参数的每个段数算一个
+   */
+  auto getCachedCount() -> size_t;
+
+ private:
+  // 隐藏实现
+  unique_impl<ParametricMeshBuilderImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
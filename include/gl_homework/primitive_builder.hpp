@@ -5,6 +5,7 @@
 
 // clang-format off
 // std
+#include <memory>
 #include <vector>
 // OpenGL
 #include <GL/glew.h>
@@ -14,11 +15,14 @@
 #include <fmt/core.h>
 // project
 #include "gl_homework/impl.hpp"
+#include "gl_homework/instance_buffer.hpp"
 // clang-format on
 
 namespace gl_hwk {
 
 class PrimitiveBuilderImpl;
+class SoftwareRenderer;
+struct Primitive;
 /**
  * @brief 图元构建者，用于构建基本几何体
  */
@@ -26,6 +30,13 @@ class PrimitiveBuilder {
  public:
   explicit PrimitiveBuilder();
 
+  /**
+   * @brief 使用CPU渲染后端，不调用任何GL函数，顶点数据保存在CPU上，绘制提交给renderer
+   * 着色器和uniform通过renderer设置，drawInstanced逐个实例设置model和法线矩阵
+   */
+  explicit PrimitiveBuilder(std::shared_ptr<SoftwareRenderer> renderer);
+  ~PrimitiveBuilder();
+
   auto buildPoints(const std::string& name, const std::vector<glm::vec3>& positions,
                    const std::vector<std::vector<float>>& other_data) -> void;
 
@@ -52,6 +63,13 @@ class PrimitiveBuilder {
   auto buildTriangles(const std::string& name, const std::vector<glm::vec3>& positions,
                       const std::vector<GLsizei>& indices, const std::vector<std::vector<float>>& other_data) -> void;
 
+  /**
+   * @brief 同上，other_data按顶点连续存放，每个顶点other_data_num个vec3，大网格不需要为每个顶点创建数组
+   */
+  auto buildTriangles(const std::string& name, const std::vector<glm::vec3>& positions,
+                      const std::vector<GLsizei>& indices, const std::vector<float>& other_data,
+                      uint32_t other_data_num) -> void;
+
   auto buildTriangle(const std::string& name, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3,
                      const std::vector<float>& other_data) -> void;
 
@@ -62,6 +80,31 @@ class PrimitiveBuilder {
   auto buildTriangleStrip(const std::string& name, const std::vector<glm::vec3>& positions,
                           const std::vector<std::vector<float>>& other_data) -> void;
 
+  /**
+   * @brief 查找已缓存的图元，不存在时返回nullptr；返回的指针在PrimitiveBuilder销毁前一直有效
+   */
+  auto findPrimitive(const std::string& name) -> const Primitive*;
+
+  /**
+   * @brief 让alias指向已创建的图元name，之后按alias构建、查找和绘制都使用同一份缓冲区
+   * alias已存在或name不存在时返回false
+   */
+  auto addAlias(const std::string& alias, const std::string& name) -> bool;
+
+  /**
+   * @brief 直接绘制findPrimitive得到的图元，省去按名字查找
+   */
+  auto drawPrimitive(const Primitive* primitive) -> void;
+
+  /**
+   * @brief 用实例数据绘制已缓存的图元，instances需要已经upload；图元不存在时返回false
+   */
+  auto drawInstanced(const std::string& name, InstanceBuffer& instances) -> bool;
+  /**
+   * @brief 只绘制instances中[first, first + count)的实例，多个视图共用一个实例缓冲区时使用
+   */
+  auto drawInstanced(const std::string& name, InstanceBuffer& instances, size_t first, size_t count) -> bool;
+
  private:
   // 隐藏实现
   unique_impl<PrimitiveBuilderImpl> impl_;
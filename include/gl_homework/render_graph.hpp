@@ -0,0 +1,219 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_RENDER_GRAPH_HPP_
+#define GL_HOMEWORK_RENDER_GRAPH_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+#include <functional>
+#include <string>
+// OpenGL
+#include <GL/glew.h>
+// project
+#include "gl_homework/impl.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+struct RenderTargetDesc {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  // 纹理的内部格式，深度格式(GL_DEPTH_COMPONENT24、GL_DEPTH24_STENCIL8等)作为深度附件，其余作为颜色附件
+  GLenum format = GL_RGBA8;
+
+  auto operator==(const RenderTargetDesc& other) const -> bool {
+    return width == other.width && height == other.height && format == other.format;
+  }
+  auto operator!=(const RenderTargetDesc& other) const -> bool { return !(*this == other); }
+};
+
+struct RenderTargetPoolStats {
+  // 池中所有纹理，包括正在使用的
+  uint32_t textures = 0;
+  uint32_t free = 0;
+  uint64_t bytes = 0;
+};
+
+class RenderTargetPoolImpl;
+/**
+ * @brief 单例模式，按尺寸和格式复用渲染目标纹理
+ * 与DepthTexturePool不同，空闲超过一定帧数的纹理会被删除，窗口大小变化后旧尺寸的纹理不会一直占用显存
+ */
+class RenderTargetPool {
+ public:
+  static auto instance() -> RenderTargetPool&;
+
+  auto acquire(const RenderTargetDesc& desc) -> GLuint;
+
+  /**
+   * @brief 归还纹理，之后可被acquire复用
+   */
+  auto release(GLuint texture) -> void;
+
+  /**
+   * @brief 结束一帧，删除连续max_idle_frames帧没有被取出的空闲纹理，由RenderGraph::execute调用
+   */
+  auto endFrame(uint32_t max_idle_frames) -> void;
+
+  /**
+   * @brief 删除所有空闲的纹理
+   */
+  auto trim() -> void;
+
+  auto getStats() -> RenderTargetPoolStats;
+
+ private:
+  RenderTargetPool();
+  // 禁止拷贝和移动
+  RenderTargetPool(const RenderTargetPool&) = delete;
+  RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+  RenderTargetPool(RenderTargetPool&&) = delete;
+  RenderTargetPool& operator=(RenderTargetPool&&) = delete;
+
+  unique_impl<RenderTargetPoolImpl> impl_;
+};
+
+/**
+ * @brief 渲染图中资源的句柄，每次写入产生新的版本；只在创建它的图下一次reset之前有效
+ */
+struct RenderResource {
+  uint32_t index = UINT32_MAX;
+
+  auto isValid() const -> bool { return index != UINT32_MAX; }
+};
+
+class RenderGraphImpl;
+
+/**
+ * @brief 在addPass的setup回调中声明pass读写的资源
+ */
+class RenderGraphBuilder {
+ public:
+  /**
+   * @brief 创建临时渲染目标；可能与生命周期不重叠的其他资源共用纹理，第一次写入前内容未定义，需要在pass中清除
+   */
+  auto create(const std::string& name, const RenderTargetDesc& desc) -> RenderResource;
+
+  /**
+   * @brief 读取资源，执行时通过RenderPassResources::getTexture得到纹理
+   */
+  auto read(RenderResource resource) -> RenderResource;
+
+  /**
+   * @brief 作为附件写入，返回新版本的句柄；资源之前已被其他pass写入时保留原有内容，相当于同时读取
+   */
+  auto write(RenderResource resource) -> RenderResource;
+
+  /**
+   * @brief pass有图外可见的效果(如绘制到默认帧缓冲)，不会被剔除
+   */
+  auto sideEffect() -> void;
+
+ private:
+  friend class RenderGraphImpl;
+  RenderGraphBuilder(RenderGraphImpl* graph, uint32_t pass) : graph_(graph), pass_(pass) {}
+
+  RenderGraphImpl* graph_;
+  uint32_t pass_;
+};
+
+/**
+ * @brief pass执行时查询资源对应的纹理
+ */
+class RenderPassResources {
+ public:
+  auto getTexture(RenderResource resource) const -> GLuint;
+  auto getDesc(RenderResource resource) const -> RenderTargetDesc;
+
+ private:
+  friend class RenderGraphImpl;
+  explicit RenderPassResources(RenderGraphImpl* graph) : graph_(graph) {}
+
+  RenderGraphImpl* graph_;
+};
+
+using RenderPassSetupFunc = std::function<void(RenderGraphBuilder& builder)>;
+
+/**
+ * @brief 执行pass，写入的资源已经按声明顺序绑定为帧缓冲的附件，视口为附件大小
+ * 没有写入任何资源的pass使用execute开始时绑定的帧缓冲和视口
+ */
+using RenderPassExecuteFunc = std::function<void(const RenderPassResources& resources)>;
+
+struct RenderGraphOptions {
+  // 生命周期不重叠、尺寸和格式相同的临时资源共用一个纹理
+  bool aliasing = true;
+  // 池中的渲染目标连续多少帧没有使用时删除
+  uint32_t max_idle_frames = 60;
+};
+
+struct RenderGraphStats {
+  uint32_t passes = 0;
+  uint32_t culled_passes = 0;
+  // 用到的临时资源数和实际分配的纹理数
+  uint32_t transient_resources = 0;
+  uint32_t textures = 0;
+  // 每个临时资源单独分配时的显存和共用纹理后的显存
+  uint64_t transient_bytes = 0;
+  uint64_t allocated_bytes = 0;
+  double compile_ms = 0.0;
+  uint64_t frames = 0;
+};
+
+/**
+ * @brief 每帧构建的渲染图
+ * pass声明读写的资源后，compile剔除对输出没有贡献的pass，按添加顺序排列剩下的pass，
+ * 计算临时资源的生命周期，让生命周期不重叠的资源共用从RenderTargetPool取出的纹理；execute依次绑定附件并执行
+ */
+class RenderGraph {
+ public:
+  explicit RenderGraph(const RenderGraphOptions& options = RenderGraphOptions());
+  ~RenderGraph();
+
+  /**
+   * @brief 清空上一帧的pass和资源，归还输出资源的纹理；每帧重新构建图之前调用
+   */
+  auto reset() -> void;
+
+  /**
+   * @brief 添加pass，setup立即调用以声明资源，execute在execute()中按添加顺序调用
+   */
+  auto addPass(const std::string& name, const RenderPassSetupFunc& setup, RenderPassExecuteFunc execute) -> void;
+
+  /**
+   * @brief 导入外部纹理(如阴影贴图)，不从池中分配，也不与其他资源共用
+   */
+  auto importTexture(const std::string& name, GLuint texture, const RenderTargetDesc& desc) -> RenderResource;
+
+  /**
+   * @brief 标记图执行之后仍需要的资源，写入它的pass不会被剔除，纹理在下一次reset前不会被复用
+   */
+  auto markOutput(RenderResource resource) -> void;
+
+  /**
+   * @brief 剔除pass并分配纹理，execute会在需要时自动调用
+   */
+  auto compile() -> bool;
+
+  /**
+   * @brief 执行没有被剔除的pass，需要在GL线程调用；会恢复帧缓冲和视口
+   */
+  auto execute() -> void;
+
+  /**
+   * @brief 资源当前对应的纹理，输出资源在execute之后、下一次reset之前有效；被剔除的资源返回0
+   */
+  auto getTexture(RenderResource resource) -> GLuint;
+
+  auto isCulled(const std::string& pass) -> bool;
+
+  auto getStats() -> RenderGraphStats;
+
+ private:
+  // 隐藏实现
+  unique_impl<RenderGraphImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
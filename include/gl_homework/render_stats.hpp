@@ -0,0 +1,125 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_RENDER_STATS_HPP_
+#define GL_HOMEWORK_RENDER_STATS_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+#include <string>
+// OpenGL
+#include <GL/glew.h>
+// project
+#include "gl_homework/impl.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+/**
+ * @brief 单帧内由库发出的GL调用计数
+ */
+struct FrameStats {
+  uint64_t frame = 0;
+  uint64_t draw_calls = 0;
+  uint64_t vertices = 0;
+  uint64_t triangles = 0;
+  // glBufferData/glBufferSubData上传的字节数
+  uint64_t buffer_bytes_uploaded = 0;
+  // glTexImage2D上传的字节数
+  uint64_t texture_bytes_uploaded = 0;
+  // 绑定program/VAO/buffer/纹理，开关和修改固定管线状态
+  uint64_t state_changes = 0;
+  uint64_t uniform_updates = 0;
+};
+
+/**
+ * @brief 最近若干帧的平均值
+ */
+struct AverageFrameStats {
+  uint32_t frames = 0;
+  double draw_calls = 0.0;
+  double vertices = 0.0;
+  double triangles = 0.0;
+  double buffer_bytes_uploaded = 0.0;
+  double texture_bytes_uploaded = 0.0;
+  double state_changes = 0.0;
+  double uniform_updates = 0.0;
+};
+
+/**
+ * @brief 当前存活的GPU资源
+ */
+struct ResourceStats {
+  // 所有PrimitiveBuilder缓存的图元数和VBO/EBO字节数
+  uint64_t primitives_cached = 0;
+  uint64_t primitive_buffer_bytes = 0;
+  // TextureLoader中的纹理，字节数包含mipmap
+  uint64_t textures_2d = 0;
+  uint64_t texture_2d_bytes = 0;
+  uint64_t textures_cube_map = 0;
+  uint64_t texture_cube_map_bytes = 0;
+  uint64_t shader_programs = 0;
+  // 图元以外的缓冲区，例如InstanceBuffer的VBO，字节数为分配的容量
+  uint64_t buffers = 0;
+  uint64_t buffer_bytes = 0;
+};
+
+class RenderStatsImpl;
+/**
+ * @brief 渲染统计，单例模式
+ * 库内部在发出GL调用时计数，只应在GL线程上使用；用户自己发出的GL调用可以通过add系列函数计入
+ */
+class RenderStats {
+ public:
+  static auto instance() -> RenderStats&;
+
+  /**
+   * @brief 帧的开始和结束，由OpenGLApplication在display中调用
+   */
+  auto beginFrame() -> void;
+  auto endFrame() -> void;
+
+  /**
+   * @brief instances为实例化绘制的实例数，顶点和三角形数按实例数累加
+   */
+  auto addDrawCall(GLenum mode, GLsizei count, GLsizei instances = 1) -> void;
+  auto addBufferUpload(uint64_t bytes) -> void;
+  auto addTextureUpload(uint64_t bytes) -> void;
+  auto addStateChange(uint32_t count = 1) -> void;
+  auto addUniformUpdate() -> void;
+
+  /**
+   * @brief 资源的创建和销毁，bytes为变化量
+   */
+  auto addPrimitive(int64_t count, int64_t bytes) -> void;
+  auto addTexture(GLenum type, int64_t count, int64_t bytes) -> void;
+  auto addShaderProgram(int64_t count) -> void;
+  auto addBuffer(int64_t count, int64_t bytes) -> void;
+
+  /**
+   * @brief 当前帧到目前为止的计数，可以在渲染回调中调用
+   */
+  auto getCurrentFrame() -> FrameStats;
+  auto getLastFrame() -> FrameStats;
+  auto getAverage() -> AverageFrameStats;
+  auto getResources() -> ResourceStats;
+
+  /**
+   * @brief 每interval帧打印一次平均值和资源统计，0表示不打印
+   */
+  auto setLogInterval(uint32_t interval) -> void;
+  auto format() -> std::string;
+
+ private:
+  RenderStats();
+  // 禁止拷贝和移动
+  RenderStats(const RenderStats&) = delete;
+  RenderStats& operator=(const RenderStats&) = delete;
+  RenderStats(RenderStats&&) = delete;
+  RenderStats& operator=(RenderStats&&) = delete;
+
+  unique_impl<RenderStatsImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
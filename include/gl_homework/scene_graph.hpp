@@ -0,0 +1,111 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_SCENE_GRAPH_HPP_
+#define GL_HOMEWORK_SCENE_GRAPH_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+// OpenGL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+// project
+#include "gl_homework/bounds.hpp"
+#include "gl_homework/impl.hpp"
+#include "gl_homework/occlusion_culler.hpp"
+#include "gl_homework/primitive_builder.hpp"
+#include "gl_homework/shader.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+using NodeId = uint32_t;
+constexpr NodeId kInvalidNode = UINT32_MAX;
+
+class SceneGraphImpl;
+/**
+ * @brief 场景图，节点保存局部变换、网格和材质
+ * 节点按深度优先顺序展开到连续数组中，update只重新计算被修改的子树，并缓存每个子树的包围盒用于剔除
+ */
+class SceneGraph {
+ public:
+  SceneGraph();
+  ~SceneGraph();
+
+  /**
+   * @brief 创建节点，parent为kInvalidNode时作为根节点
+   */
+  auto createNode(NodeId parent = kInvalidNode) -> NodeId;
+
+  /**
+   * @brief 删除节点及其所有子节点
+   */
+  auto removeNode(NodeId id) -> void;
+  auto setParent(NodeId id, NodeId parent) -> void;
+  auto getParent(NodeId id) -> NodeId;
+
+  /**
+   * @brief 局部变换，local = translate(position) * rotation * scale(scale)
+   */
+  auto setTransform(NodeId id, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) -> void;
+  auto setPosition(NodeId id, const glm::vec3& position) -> void;
+  auto setRotation(NodeId id, const glm::quat& rotation) -> void;
+  auto setScale(NodeId id, const glm::vec3& scale) -> void;
+
+  /**
+   * @brief 节点绘制的图元，名字对应PrimitiveBuilder中已创建的图元，bounds为图元的局部包围盒
+   */
+  auto setMesh(NodeId id, const std::string& mesh, const Aabb& bounds) -> void;
+  auto setMaterial(NodeId id, std::shared_ptr<Shader> shader, GLuint texture = 0) -> void;
+
+  /**
+   * @brief 更新被修改节点及其子树的世界矩阵和包围盒
+   * @return 重新计算世界矩阵的节点数
+   */
+  auto update() -> uint32_t;
+
+  /**
+   * @brief 以下查询、剔除和绘制函数都会先执行update，没有修改时update不做任何计算
+   */
+  auto getWorldMatrix(NodeId id) -> glm::mat4;
+
+  /**
+   * @brief 节点及其所有子节点的世界包围盒
+   */
+  auto getSubtreeBounds(NodeId id) -> Aabb;
+
+  /**
+   * @brief 视锥体剔除，整棵子树在视锥体外时跳过，完全在内时不再逐个测试；visible按展开顺序输出有网格的节点
+   */
+  auto cull(const Frustum& frustum, std::vector<NodeId>& visible) -> void;
+
+  /**
+   * @brief 视锥体剔除后再做遮挡剔除，整棵子树被遮挡时跳过；occlusion需要先用同一帧的矩阵render
+   */
+  auto cull(const Frustum& frustum, OcclusionCuller& occlusion, std::vector<NodeId>& visible) -> void;
+
+  /**
+   * @brief 多个视图共用一次遍历，子树在所有视锥体外时整体跳过，只对仍相交的视图继续测试
+   * visible[i]为第i个视锥体中可见的节点，顺序与单视图的cull相同，可能比单视图少几个实际不可见的节点
+   */
+  auto cull(const FrustumSet& frusta, std::vector<std::vector<NodeId>>& visible) -> void;
+
+  /**
+   * @brief 绘制节点，设置model和normalMatrix，相邻节点使用相同着色器和纹理时不重复绑定
+   * 着色器的view、projection等其余uniform由调用者设置
+   */
+  auto draw(PrimitiveBuilder& builder, const std::vector<NodeId>& nodes) -> void;
+
+  auto size() -> size_t;
+
+ private:
+  // 隐藏实现
+  unique_impl<SceneGraphImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
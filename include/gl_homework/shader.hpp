@@ -21,10 +21,12 @@ namespace gl_hwk {
 class ShaderImpl;
 /**
  * @brief 着色器，读取、编译并连接GLSL程序
+ * 源文件中单独一行的#include "file"会替换为同目录下file的内容，例如片段着色器共用的oit_output.GLSL
  */
 class Shader {
  public:
   Shader(const std::string &vertex_path, const std::string &fragment_path);
+  ~Shader();
   auto start() -> void;
 
   auto setBool(const std::string &name, bool value) const -> void;
@@ -32,6 +34,8 @@ class Shader {
   auto setFloat(const std::string &name, float value) const -> void;
   auto setVec2(const std::string &name, const glm::vec2 &value) const -> void;
   auto setVec2(const std::string &name, float x, float y) const -> void;
+  auto setIvec2(const std::string &name, const glm::ivec2 &value) const -> void;
+  auto setIvec2(const std::string &name, int x, int y) const -> void;
   auto setVec3(const std::string &name, const glm::vec3 &value) const -> void;
   auto setVec3(const std::string &name, float x, float y, float z) const -> void;
   auto setVec4(const std::string &name, const glm::vec4 &value) const -> void;
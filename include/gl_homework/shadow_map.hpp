@@ -0,0 +1,128 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_SHADOW_MAP_HPP_
+#define GL_HOMEWORK_SHADOW_MAP_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+#include <functional>
+#include <memory>
+// OpenGL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+// project
+#include "gl_homework/impl.hpp"
+#include "gl_homework/shader.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+class DepthTexturePoolImpl;
+/**
+ * @brief 单例模式，复用相同尺寸的深度纹理(2D或立方体贴图)，避免反复创建和销毁
+ */
+class DepthTexturePool {
+ public:
+  static auto instance() -> DepthTexturePool&;
+
+  /**
+   * @brief 取出一个size * size的深度纹理，target为GL_TEXTURE_2D或GL_TEXTURE_CUBE_MAP
+   */
+  auto acquire(GLenum target, uint32_t size) -> GLuint;
+
+  /**
+   * @brief 归还纹理，之后可被acquire复用
+   */
+  auto release(GLuint texture) -> void;
+
+  /**
+   * @brief 删除所有空闲的纹理
+   */
+  auto trim() -> void;
+
+ private:
+  DepthTexturePool();
+  // 禁止拷贝和移动
+  DepthTexturePool(const DepthTexturePool&) = delete;
+  DepthTexturePool& operator=(const DepthTexturePool&) = delete;
+  DepthTexturePool(DepthTexturePool&&) = delete;
+  DepthTexturePool& operator=(DepthTexturePool&&) = delete;
+
+  unique_impl<DepthTexturePoolImpl> impl_;
+};
+
+enum class ShadowType {
+  // 平行光，正交投影的2D深度纹理
+  kDirectional,
+  // 点光源，立方体深度纹理，保存到光源的线性距离
+  kPoint,
+};
+
+struct ShadowOptions {
+  ShadowType type = ShadowType::kDirectional;
+  uint32_t resolution = 1024;
+  // 点光源阴影的远裁剪面，超出的物体不产生阴影
+  float far_plane = 50.0f;
+};
+
+struct ShadowStats {
+  // 静态物体的阴影重新渲染的次数
+  uint64_t static_renders = 0;
+  // 把静态阴影复制后叠加动态物体的次数
+  uint64_t dynamic_renders = 0;
+  uint64_t frames = 0;
+};
+
+/**
+ * @brief 绘制投射阴影的物体，depth_shader已经启用并设置好光源矩阵，只需设置model并绘制
+ * 点光源会对立方体贴图的6个面各调用一次
+ */
+using ShadowCasterFunc = std::function<void(Shader& depth_shader)>;
+
+class ShadowMapImpl;
+/**
+ * @brief 阴影贴图，静态物体的深度缓存在单独的纹理中，只在光源或静态物体移动时重新渲染
+ * 每帧把缓存复制到结果纹理后再叠加绘制动态物体，没有动态物体时直接使用缓存
+ */
+class ShadowMap {
+ public:
+  explicit ShadowMap(const ShadowOptions& options = ShadowOptions());
+  ~ShadowMap();
+
+  /**
+   * @brief 平行光，阴影覆盖以center为中心、radius为半径的球
+   */
+  auto setDirectionalLight(const glm::vec3& direction, const glm::vec3& center, float radius) -> void;
+  auto setPointLight(const glm::vec3& position) -> void;
+
+  auto setStaticCasters(ShadowCasterFunc casters) -> void;
+  auto setDynamicCasters(ShadowCasterFunc casters) -> void;
+
+  /**
+   * @brief 静态物体移动后调用，下一次update重新渲染静态阴影
+   */
+  auto markStaticDirty() -> void;
+
+  /**
+   * @brief 按需更新阴影贴图，需要在GL线程调用；会恢复原来的帧缓冲和视口
+   */
+  auto update() -> void;
+
+  /**
+   * @brief 启用着色器，绑定阴影纹理并设置phong_shadow着色器需要的uniform
+   * 2D纹理使用first_unit，立方体贴图使用first_unit + 1
+   */
+  auto bind(Shader& shader, int first_unit = 4) -> void;
+
+  auto getLightSpaceMatrix() -> glm::mat4;
+  auto getTexture() -> GLuint;
+  auto getStats() -> ShadowStats;
+
+ private:
+  // 隐藏实现
+  unique_impl<ShadowMapImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
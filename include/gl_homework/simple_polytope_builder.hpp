@@ -21,6 +21,8 @@ namespace gl_hwk {
 class SimplePolytopeBuilderImpl;
 /**
  * @brief 多面体构建者，用于构建简单的多面体(立方体、四面体、平面)
+ * 按形状和参数缓存已创建的图元，参数相同的调用直接绘制，不再生成顶点和索引
+ * 命中缓存的新名字不登记到PrimitiveBuilder，避免生成的名字使别名无限增长；需要按新名字查找时用addAlias登记
  */
 class SimplePolytopeBuilder {
  public:
@@ -26,6 +26,10 @@ class SkyBox {
                   std::shared_ptr<Camera> camera);
 
   auto draw() -> void;
+  /**
+   * @brief 用给定视图的矩阵绘制，多视图渲染时每个视图调用一次；绘制后清除深度，应先设置好视图的裁剪矩形
+   */
+  auto draw(const glm::mat4 &view, const glm::mat4 &projection) -> void;
 
   auto setShader(std::shared_ptr<Shader> shader) -> void;
 
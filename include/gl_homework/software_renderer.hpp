@@ -0,0 +1,134 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_SOFTWARE_RENDERER_HPP_
+#define GL_HOMEWORK_SOFTWARE_RENDERER_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+#include <memory>
+#include <vector>
+// OpenGL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+// project
+#include "gl_homework/impl.hpp"
+#include "gl_homework/transform_store.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+/**
+ * @brief 内置着色器，与shader/下同名着色器的输入和计算一致
+ * kPureColor：location 1为颜色；kTexture：location 1为纹理坐标；kPhong：location 1、2为纹理坐标和法线
+ */
+enum class SoftwareShader {
+  kPureColor,
+  kTexture,
+  kPhong,
+};
+
+/**
+ * @brief RGBA8纹理，行的顺序与glTexImage2D的数据相同，第0行对应纹理坐标v = 0；双线性过滤，REPEAT环绕
+ */
+struct SoftwareTexture {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<uint8_t> rgba;
+};
+
+/**
+ * @brief 对应着色器中的uniform，每次绘制时复制一份，之后的修改不影响已提交的绘制
+ */
+struct SoftwareUniforms {
+  glm::mat4 model = glm::mat4(1.0f);
+  glm::mat4 view = glm::mat4(1.0f);
+  glm::mat4 projection = glm::mat4(1.0f);
+  glm::mat3 normal_matrix = glm::mat3(1.0f);
+  glm::vec3 light_pos = glm::vec3(0.0f);
+  glm::vec3 view_pos = glm::vec3(0.0f);
+  glm::vec3 light_color = glm::vec3(1.0f);
+  // texture1，为空时采样结果为白色
+  std::shared_ptr<const SoftwareTexture> texture;
+};
+
+struct SoftwareRendererOptions {
+  uint32_t width = 512;
+  uint32_t height = 512;
+};
+
+struct SoftwareRenderStats {
+  uint32_t draw_calls = 0;
+  // 提交的三角形和裁剪、剔除后实际光栅化的三角形
+  uint32_t triangles = 0;
+  uint32_t rasterized = 0;
+  uint32_t lines = 0;
+  uint32_t points = 0;
+  // 通过深度测试并执行着色的像素数
+  uint64_t fragments = 0;
+  double vertex_ms = 0.0;
+  double raster_ms = 0.0;
+};
+
+class SoftwareRendererImpl;
+/**
+ * @brief CPU渲染后端，绘制到内存中的帧缓冲；用于没有GPU的机器上的离屏渲染，以及作为确定性的参考实现
+ * 绘制时在当前线程变换顶点(顶点多时并行)、裁剪并按分块记录图元，flush时用JobSystem按分块并行光栅化
+ * 每个分块内按提交顺序处理，结果与线程数和指令集无关；通过PrimitiveBuilder(renderer)使用相同的绘制接口
+ */
+class SoftwareRenderer {
+ public:
+  explicit SoftwareRenderer(const SoftwareRendererOptions& options = SoftwareRendererOptions());
+  ~SoftwareRenderer();
+
+  auto setShader(SoftwareShader shader) -> void;
+  auto uniforms() -> SoftwareUniforms&;
+
+  /**
+   * @brief 对应GL_DEPTH_TEST(深度函数GL_LESS)、GL_CULL_FACE(剔除逆时针为正面时的背面)和
+   * glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA)
+   */
+  auto setDepthTest(bool enabled) -> void;
+  auto setCullFace(bool enabled) -> void;
+  auto setBlend(bool enabled) -> void;
+
+  /**
+   * @brief 先执行已提交的绘制，再清空颜色和深度缓冲，同时重置统计
+   */
+  auto clear(const glm::vec4& color = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)) -> void;
+
+  /**
+   * @brief 提交一次绘制，vertices每个顶点stride个float，前3个为位置，之后每3个对应一个location
+   * indices为空时按顶点顺序绘制；支持GL_POINTS、GL_LINES、GL_LINE_STRIP、GL_LINE_LOOP、GL_TRIANGLES、GL_TRIANGLE_STRIP
+   */
+  auto draw(GLenum type, const float* vertices, uint32_t stride, uint32_t vertex_count, const GLsizei* indices,
+            uint32_t index_count) -> void;
+
+  /**
+   * @brief 光栅化所有已提交的绘制
+   */
+  auto flush() -> void;
+
+  /**
+   * @brief 读取前会先flush；行从下到上，与glReadPixels的结果相同
+   */
+  auto getColorBuffer() -> const std::vector<uint8_t>&;
+  auto getDepthBuffer() -> const std::vector<float>&;
+  auto getWidth() -> uint32_t;
+  auto getHeight() -> uint32_t;
+
+  /**
+   * @brief 指定边函数使用的指令集，超过CPU支持的级别时使用支持的最高级别
+   */
+  auto setSimdLevel(SimdLevel level) -> void;
+  auto getSimdLevel() -> SimdLevel;
+
+  auto getStats() -> SoftwareRenderStats;
+
+ private:
+  // 隐藏实现
+  unique_impl<SoftwareRendererImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
@@ -30,6 +30,13 @@ class TextureLoader {
 
   auto activeTexture(GLuint texture_id, int idx) -> void;
 
+  /**
+   * @brief 登记在别处创建的纹理(如TextureStreamer)，使activeTexture可以绑定；显存统计由创建者负责
+   */
+  auto registerTexture(GLuint texture_id, GLenum type) -> void;
+
+  auto unregisterTexture(GLuint texture_id) -> void;
+
  private:
   TextureLoader();
   // 禁止拷贝和移动 
@@ -0,0 +1,108 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_TEXTURE_STREAMER_HPP_
+#define GL_HOMEWORK_TEXTURE_STREAMER_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+// OpenGL
+#include <GL/glew.h>
+// project
+#include "gl_homework/bounds.hpp"
+#include "gl_homework/camera.hpp"
+#include "gl_homework/impl.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+struct TextureStreamingOptions {
+  // 所有流式纹理的显存预算(字节)，最粗的几层常驻，不受预算限制
+  uint64_t budget_bytes = 64ull << 20;
+  // 边长不超过该值的mip层在加载后立即上传并一直常驻
+  uint32_t resident_size = 64;
+  // 每次update最多上传的字节数，至少上传一层，避免一帧内上传过多造成卡顿
+  uint64_t upload_bytes_per_frame = 4ull << 20;
+  // 连续多少帧不再需要时驱逐更精细的mip层
+  uint32_t evict_delay_frames = 60;
+  // 加到估计的mip层级上，正值更模糊、更省显存
+  float lod_bias = 0.0f;
+};
+
+struct TextureStreamingStats {
+  uint32_t textures = 0;
+  // 仍在后台解码的纹理数
+  uint32_t loading = 0;
+  // 需要更精细的mip但还没有上传的纹理数
+  uint32_t pending = 0;
+  uint64_t resident_bytes = 0;
+  uint64_t budget_bytes = 0;
+  // CPU上保留的mip数据
+  uint64_t cpu_bytes = 0;
+  // 上一次update上传和驱逐的字节数
+  uint64_t uploaded_bytes = 0;
+  uint64_t evicted_bytes = 0;
+  uint64_t frames = 0;
+};
+
+class TextureStreamerImpl;
+/**
+ * @brief 按屏幕上的需求流式加载纹理的mip层
+ * 纹理在后台解码并生成mip链，先上传最粗的几层；每帧根据使用纹理的物体在屏幕上的大小估计需要的层级，
+ * 在显存预算内逐层上传更精细的mip，不再需要的层通过GL_TEXTURE_BASE_LEVEL移出采样范围并释放
+ * 从文件加载的纹理在CPU上只保留常驻的几层，更精细的层需要时在后台重新解码，内存不随纹理总量增长
+ * 纹理会登记到TextureLoader，可以用activeTexture和CommandList::bindTexture绑定
+ */
+class TextureStreamer {
+ public:
+  explicit TextureStreamer(const TextureStreamingOptions& options = TextureStreamingOptions());
+  ~TextureStreamer();
+
+  /**
+   * @brief 在后台解码图片，立即返回纹理ID；解码完成前纹理是1x1的灰色，需要在GL线程调用
+   */
+  auto load(const std::string& texture_path, bool flip = false) -> GLuint;
+
+  /**
+   * @brief 从内存中的RGBA8像素创建纹理，mip链同样在后台生成；没有文件可以重新解码，CPU上保留完整的mip链
+   */
+  auto load(uint32_t width, uint32_t height, std::vector<uint8_t> rgba) -> GLuint;
+
+  /**
+   * @brief 报告本帧有一个物体使用该纹理，bounds为物体的世界坐标包围盒，假设纹理在物体上铺满一次
+   */
+  auto request(GLuint texture, Camera& camera, const Aabb& bounds) -> void;
+
+  /**
+   * @brief 报告本帧纹理在屏幕上覆盖的边长(像素)，同一纹理多次报告时取最大值
+   */
+  auto request(GLuint texture, float screen_pixels) -> void;
+
+  /**
+   * @brief 每帧在request之后调用，需要在GL线程：上传解码完成的纹理，按需求和预算上传或驱逐mip层，并清空本帧的需求
+   */
+  auto update() -> void;
+
+  auto setBudget(uint64_t budget_bytes) -> void;
+
+  /**
+   * @brief 当前最精细的常驻mip层级(GL_TEXTURE_BASE_LEVEL)，未加载完成时返回-1
+   */
+  auto getResidentLevel(GLuint texture) -> int;
+
+  /**
+   * @brief 上一次update估计需要的mip层级，未加载完成时返回-1
+   */
+  auto getWantedLevel(GLuint texture) -> int;
+
+  auto getStats() -> TextureStreamingStats;
+
+ private:
+  // 隐藏实现
+  unique_impl<TextureStreamerImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
@@ -0,0 +1,95 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_TRACE_HPP_
+#define GL_HOMEWORK_TRACE_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+#include <string>
+// project
+#include "gl_homework/impl.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+class TracerImpl;
+/**
+ * @brief CPU trace事件记录器，单例模式
+ * 每个线程写入各自的无锁环形缓冲区，writeChromeTrace时汇总为Chrome trace-event JSON，可用Perfetto打开
+ * 默认关闭，调用setEnabled(true)后开始记录；缓冲区满时丢弃新事件
+ */
+class Tracer {
+ public:
+  static auto instance() -> Tracer&;
+
+  auto setEnabled(bool enable) -> void;
+  auto isEnabled() -> bool;
+
+  /**
+   * @brief 当前时间，单位ns
+   */
+  static auto now() -> uint64_t;
+
+  /**
+   * @brief 记录一个完整事件
+   * @param name 事件名，只保存指针，必须是字符串字面量等静态字符串
+   */
+  auto record(const char* name, uint64_t begin_ns, uint64_t end_ns) -> void;
+
+  /**
+   * @brief 设置当前线程在trace中显示的名字
+   */
+  auto setThreadName(const std::string& name) -> void;
+
+  /**
+   * @brief 取出所有线程已记录的事件，写入Chrome trace-event JSON
+   * 每次只写出上次成功写出之后记录的事件，写出后清空，内存不随运行时间增长
+   */
+  auto writeChromeTrace(const std::string& path) -> bool;
+
+  auto getDroppedEvents() -> uint64_t;
+
+ private:
+  Tracer();
+  // 禁止拷贝和移动
+  Tracer(const Tracer&) = delete;
+  Tracer& operator=(const Tracer&) = delete;
+  Tracer(Tracer&&) = delete;
+  Tracer& operator=(Tracer&&) = delete;
+
+  unique_impl<TracerImpl> impl_;
+};
+
+/**
+ * @brief RAII形式的trace scope，析构时记录一个完整事件
+ */
+class TraceScope {
+ public:
+  explicit TraceScope(const char* name) : name_(name), begin_(Tracer::instance().isEnabled() ? Tracer::now() : 0) {}
+  ~TraceScope() {
+    if (begin_ != 0) {
+      Tracer::instance().record(name_, begin_, Tracer::now());
+    }
+  }
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+ private:
+  const char* name_;
+  uint64_t begin_;
+};
+
+}  // namespace gl_hwk
+
+// 定义GL_HWK_DISABLE_TRACE后trace宏在编译期被移除
+#define GL_HWK_TRACE_CONCAT_INNER(a, b) a##b
+#define GL_HWK_TRACE_CONCAT(a, b) GL_HWK_TRACE_CONCAT_INNER(a, b)
+#ifndef GL_HWK_DISABLE_TRACE
+#define GL_HWK_TRACE_SCOPE(name) ::gl_hwk::TraceScope GL_HWK_TRACE_CONCAT(gl_hwk_trace_scope_, __LINE__)(name)
+#else
+#define GL_HWK_TRACE_SCOPE(name) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,86 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_TRANSFORM_STORE_HPP_
+#define GL_HOMEWORK_TRANSFORM_STORE_HPP_
+
+// clang-format off
+// std
+#include <cstddef>
+#include <cstdint>
+// OpenGL
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+// project
+#include "gl_homework/impl.hpp"
+#include "gl_homework/instance_buffer.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+enum class SimdLevel {
+  kScalar,
+  kSse,
+  kAvx2,
+};
+
+class TransformStoreImpl;
+/**
+ * @brief SoA形式存储的变换(位置、旋转四元数、缩放)，批量计算model矩阵和法线矩阵
+ * 计算使用SSE/AVX2一次处理4/8个物体，运行时根据CPU选择，不支持时退回标量实现
+ */
+class TransformStore {
+ public:
+  TransformStore();
+  ~TransformStore();
+
+  /**
+   * @brief 添加一个物体，返回其编号
+   */
+  auto add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) -> uint32_t;
+  auto resize(size_t size) -> void;
+  auto size() -> size_t;
+
+  auto setPosition(uint32_t index, const glm::vec3& position) -> void;
+  /**
+   * @brief 旋转四元数会被归一化
+   */
+  auto setRotation(uint32_t index, const glm::quat& rotation) -> void;
+  auto setScale(uint32_t index, const glm::vec3& scale) -> void;
+  auto getPosition(uint32_t index) -> glm::vec3;
+  auto getRotation(uint32_t index) -> glm::quat;
+  auto getScale(uint32_t index) -> glm::vec3;
+
+  /**
+   * @brief 在当前线程计算[begin, end)的矩阵，法线矩阵为transpose(inverse(model))的左上3x3
+   */
+  auto compose(InstanceData* out, size_t begin, size_t end) -> void;
+
+  /**
+   * @brief 用JobSystem并行计算所有物体的矩阵，写入instances
+   */
+  auto compose(InstanceBuffer& instances) -> void;
+
+  /**
+   * @brief 固定步长更新开始时调用，保存当前的变换作为插值的起点
+   */
+  auto saveState() -> void;
+
+  /**
+   * @brief 在saveState保存的变换和当前变换之间按alpha插值后计算矩阵，位置和缩放线性插值，旋转归一化线性插值
+   * 之后添加、还没有保存过的物体直接使用当前变换
+   */
+  auto compose(InstanceBuffer& instances, float alpha) -> void;
+
+  /**
+   * @brief 指定使用的指令集，超过CPU支持的级别时使用支持的最高级别
+   */
+  auto setSimdLevel(SimdLevel level) -> void;
+  auto getSimdLevel() -> SimdLevel;
+
+ private:
+  // 隐藏实现
+  unique_impl<TransformStoreImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
@@ -0,0 +1,85 @@
+// Copyright 2024 Chengfu Zou
+
+#ifndef GL_HOMEWORK_TRANSPARENCY_RENDERER_HPP_
+#define GL_HOMEWORK_TRANSPARENCY_RENDERER_HPP_
+
+// clang-format off
+// std
+#include <cstdint>
+#include <functional>
+// OpenGL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+// project
+#include "gl_homework/impl.hpp"
+#include "gl_homework/shader.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+enum class TransparencyMode {
+  // 加权混合OIT，与绘制顺序无关，不需要排序；要求着色器通过writeColor输出(见shader/phong.frag.GLSL)
+  kWeightedBlended,
+  // 按视图空间深度基数排序后从远到近混合，结果精确，适用于不支持浮点渲染目标的情况
+  kSorted,
+};
+
+struct TransparencyOptions {
+  TransparencyMode mode = TransparencyMode::kWeightedBlended;
+};
+
+struct TransparencyStats {
+  // 上一次render绘制的物体数
+  uint32_t objects = 0;
+  double sort_ms = 0.0;
+  // 加权混合需要的帧缓冲不可用，已退回排序模式
+  bool fallback = false;
+  uint64_t frames = 0;
+};
+
+/**
+ * @brief 绘制一个半透明物体，shader已经启用，只需设置model等并绘制；id为add时传入的值
+ */
+using TransparentDrawFunc = std::function<void(Shader& shader, uint32_t id)>;
+
+class TransparencyRendererImpl;
+/**
+ * @brief 半透明物体的渲染，在不透明物体之后调用render
+ * 加权混合模式把半透明物体绘制到累积和透射率两个浮点纹理，再合成到当前帧缓冲，与提交顺序无关
+ * 排序模式按到摄像机的深度基数排序，不可用浮点渲染目标时自动使用
+ */
+class TransparencyRenderer {
+ public:
+  explicit TransparencyRenderer(const TransparencyOptions& options = TransparencyOptions());
+  ~TransparencyRenderer();
+
+  auto setMode(TransparencyMode mode) -> void;
+  /**
+   * @brief 实际使用的模式，退回排序时与setMode的值不同
+   */
+  auto getMode() -> TransparencyMode;
+
+  /**
+   * @brief 开始新的一帧，清空之前提交的物体；view用于计算排序深度
+   */
+  auto begin(const glm::mat4& view) -> void;
+
+  /**
+   * @brief 提交一个半透明物体，center为世界坐标中的中心，shader的公共uniform需要在render前设置好
+   */
+  auto add(const glm::vec3& center, Shader& shader, uint32_t id) -> void;
+
+  /**
+   * @brief 绘制提交的物体并合成到当前帧缓冲，需要在GL线程调用；会恢复帧缓冲、视口、深度写入和混合状态
+   */
+  auto render(const TransparentDrawFunc& draw) -> void;
+
+  auto getStats() -> TransparencyStats;
+
+ private:
+  // 隐藏实现
+  unique_impl<TransparencyRendererImpl> impl_;
+};
+
+}  // namespace gl_hwk
+#endif
@@ -0,0 +1,145 @@
+#include "gl_homework/bounds.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <cmath>
+// clang-format on
+
+namespace gl_hwk {
+
+auto Aabb::expand(const glm::vec3& point) -> void {
+  min = glm::min(min, point);
+  max = glm::max(max, point);
+}
+
+auto Aabb::expand(const Aabb& other) -> void {
+  if (other.isEmpty()) {
+    return;
+  }
+  min = glm::min(min, other.min);
+  max = glm::max(max, other.max);
+}
+
+auto Aabb::transform(const glm::mat4& matrix) const -> Aabb {
+  if (isEmpty()) {
+    return {};
+  }
+  Aabb result;
+  result.min = result.max = glm::vec3(matrix[3]);
+  for (int c = 0; c < 3; ++c) {
+    glm::vec3 a = glm::vec3(matrix[c]) * min[c];
+    glm::vec3 b = glm::vec3(matrix[c]) * max[c];
+    result.min += glm::min(a, b);
+    result.max += glm::max(a, b);
+  }
+  return result;
+}
+
+auto Aabb::fromPoints(const std::vector<glm::vec3>& points) -> Aabb {
+  Aabb box;
+  for (const auto& p : points) {
+    box.expand(p);
+  }
+  return box;
+}
+
+auto Frustum::fromMatrix(const glm::mat4& m) -> Frustum {
+  // glm为列主序，m[c][r]，第r行为(m[0][r], m[1][r], m[2][r], m[3][r])
+  auto row = [&m](int r) { return glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]); };
+  Frustum frustum;
+  frustum.planes[0] = row(3) + row(0);  // left
+  frustum.planes[1] = row(3) - row(0);  // right
+  frustum.planes[2] = row(3) + row(1);  // bottom
+  frustum.planes[3] = row(3) - row(1);  // top
+  frustum.planes[4] = row(3) + row(2);  // near
+  frustum.planes[5] = row(3) - row(2);  // far
+  for (auto& plane : frustum.planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  return frustum;
+}
+
+auto Frustum::test(const Aabb& box) const -> CullResult {
+  if (box.isEmpty()) {
+    return CullResult::kOutside;
+  }
+  glm::vec3 center = (box.min + box.max) * 0.5f;
+  glm::vec3 extent = (box.max - box.min) * 0.5f;
+  CullResult result = CullResult::kInside;
+  for (const auto& plane : planes) {
+    glm::vec3 normal = glm::vec3(plane);
+    float distance = glm::dot(normal, center) + plane.w;
+    float radius = glm::dot(extent, glm::abs(normal));
+    if (distance < -radius) {
+      return CullResult::kOutside;
+    }
+    if (distance < radius) {
+      result = CullResult::kIntersect;
+    }
+  }
+  return result;
+}
+
+auto Frustum::test(const glm::vec3& center, float radius) const -> CullResult {
+  CullResult result = CullResult::kInside;
+  for (const auto& plane : planes) {
+    float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+    if (distance < -radius) {
+      return CullResult::kOutside;
+    }
+    if (distance < radius) {
+      result = CullResult::kIntersect;
+    }
+  }
+  return result;
+}
+
+auto FrustumSet::fromMatrices(const std::vector<glm::mat4>& view_projections) -> FrustumSet {
+  FrustumSet set;
+  size_t count = std::min<size_t>(view_projections.size(), 32);
+  for (size_t i = 0; i < count; ++i) {
+    set.frusta.push_back(Frustum::fromMatrix(view_projections[i]));
+    // NDC立方体的8个角点变换回世界空间
+    glm::mat4 inverse = glm::inverse(view_projections[i]);
+    for (int corner = 0; corner < 8; ++corner) {
+      glm::vec4 p = inverse * glm::vec4(corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f,
+                                        1.0f);
+      set.bounds.expand(glm::vec3(p) / p.w);
+    }
+  }
+  return set;
+}
+
+auto FrustumSet::allMask() const -> uint32_t {
+  return frusta.size() >= 32 ? UINT32_MAX : (1u << frusta.size()) - 1;
+}
+
+auto FrustumSet::test(const Aabb& box, uint32_t mask, uint32_t& inside) const -> uint32_t {
+  inside = 0;
+  if (box.isEmpty()) {
+    return 0;
+  }
+  for (int axis = 0; axis < 3; ++axis) {
+    if (box.max[axis] < bounds.min[axis] || box.min[axis] > bounds.max[axis]) {
+      return 0;
+    }
+  }
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < frusta.size(); ++i) {
+    uint32_t bit = 1u << i;
+    if (!(mask & bit)) {
+      continue;
+    }
+    CullResult r = frusta[i].test(box);
+    if (r != CullResult::kOutside) {
+      result |= bit;
+    }
+    if (r == CullResult::kInside) {
+      inside |= bit;
+    }
+  }
+  return result;
+}
+
+}  // namespace gl_hwk
@@ -22,7 +22,10 @@ class CameraImpl {
         height_(height),
         world_up_(world_up),
         yaw_(yaw),
-        pitch_(pitch) {
+        pitch_(pitch),
+        previous_position_(position),
+        previous_yaw_(yaw),
+        previous_pitch_(pitch) {
     updateCameraVectors();
     glm::vec2 fov = intrinsicToFov(focal_length, width, height);
     fov_x_ = fov.x;
@@ -37,15 +40,21 @@ class CameraImpl {
 
   auto fovToIntrinsic(float fov_y, float h) const -> float { return h / (2 * tan(fov_y / 2)); }
 
+  /**
+   * @brief 按插值后的位置和朝向计算渲染使用的向量
+   */
   auto updateCameraVectors() -> void {
+    float yaw = glm::mix(previous_yaw_, yaw_, alpha_);
+    float pitch = glm::mix(previous_pitch_, pitch_, alpha_);
     glm::vec3 front;
-    front.x = sin(glm::radians(yaw_)) * cos(glm::radians(pitch_));
-    front.y = sin(glm::radians(pitch_));
-    front.z = cos(glm::radians(yaw_)) * cos(glm::radians(pitch_));
+    front.x = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
+    front.y = sin(glm::radians(pitch));
+    front.z = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
     front_ = glm::normalize(front);
 
     right_ = glm::normalize(glm::cross(front_, world_up_));
     up_ = glm::normalize(glm::cross(right_, front_));
+    render_position_ = glm::mix(previous_position_, position_, alpha_);
   }
 
   float focal_length_;
@@ -54,6 +63,8 @@ class CameraImpl {
 
   float fov_x_;
   float fov_y_;
+  float near_ = 0.1f;
+  float far_ = 100.0f;
 
   float yaw_;
   float pitch_;
@@ -62,6 +73,13 @@ class CameraImpl {
   glm::vec3 front_;
   glm::vec3 up_;
   glm::vec3 right_;
+
+  // saveState保存的状态，alpha_为1时不插值
+  glm::vec3 previous_position_;
+  float previous_yaw_;
+  float previous_pitch_;
+  float alpha_ = 1.0f;
+  glm::vec3 render_position_;
 };
 
 Camera::Camera(const glm::vec3 &position, float focal_length, uint32_t width, uint32_t height,
@@ -70,11 +88,21 @@ Camera::Camera(const glm::vec3 &position, float focal_length, uint32_t width, ui
 }
 
 auto Camera::getProjectionMatrix() -> glm::mat4 {
-  return glm::perspective(impl_->fov_y_, impl_->width_ / impl_->height_, 0.1f, 100.0f);
+  return glm::perspective(impl_->fov_y_, impl_->width_ / impl_->height_, impl_->near_, impl_->far_);
 }
 
+auto Camera::getNearPlane() -> float { return impl_->near_; }
+
+auto Camera::getFarPlane() -> float { return impl_->far_; }
+
+auto Camera::getFovY() -> float { return impl_->fov_y_; }
+
+auto Camera::getAspect() -> float { return impl_->width_ / impl_->height_; }
+
+auto Camera::getFocalLength() -> float { return impl_->focal_length_; }
+
 auto Camera::getViewMatrix() -> glm::mat4 {
-  return glm::lookAt(impl_->position_, impl_->position_ + impl_->front_, impl_->up_);
+  return glm::lookAt(impl_->render_position_, impl_->render_position_ + impl_->front_, impl_->up_);
 }
 
 auto Camera::setZoom(float zoom) -> void {
@@ -97,7 +125,10 @@ auto Camera::setPitch(float pitch) -> void {
   impl_->updateCameraVectors();
 }
 
-auto Camera::move(const glm::vec3 &vec) -> void { impl_->position_ += vec; }
+auto Camera::move(const glm::vec3 &vec) -> void {
+  impl_->position_ += vec;
+  impl_->updateCameraVectors();
+}
 
 auto Camera::turnYaw(float angle) -> void {
   impl_->yaw_ += angle;
@@ -109,6 +140,19 @@ auto Camera::turnPitch(float angle) -> void {
   impl_->updateCameraVectors();
 }
 
+auto Camera::saveState() -> void {
+  impl_->previous_position_ = impl_->position_;
+  impl_->previous_yaw_ = impl_->yaw_;
+  impl_->previous_pitch_ = impl_->pitch_;
+  impl_->alpha_ = 1.0f;
+  impl_->updateCameraVectors();
+}
+
+auto Camera::interpolate(float alpha) -> void {
+  impl_->alpha_ = glm::clamp(alpha, 0.0f, 1.0f);
+  impl_->updateCameraVectors();
+}
+
 auto Camera::getUp() -> glm::vec3 { return impl_->up_; }
 
 auto Camera::getFront() -> glm::vec3 { return impl_->front_; }
@@ -117,6 +161,6 @@ auto Camera::getRight() -> glm::vec3 { return impl_->right_; }
 
 auto Camera::getLeft() -> glm::vec3 { return -(impl_->right_); }
 
-auto Camera::getPosition() -> glm::vec3 { return impl_->position_; }
+auto Camera::getPosition() -> glm::vec3 { return impl_->render_position_; }
 
 }  // namespace gl_hwk
\ No newline at end of file
@@ -0,0 +1,307 @@
+#include "gl_homework/clustered_lighting.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+// third party
+#include <fmt/core.h>
+// project
+#include "gl_homework/job_system.hpp"
+#include "gl_homework/render_stats.hpp"
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define GL_HWK_CLUSTER_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace gl_hwk {
+
+// 每个深度切片的中间结果，各切片由不同线程写入
+struct ClusterSlice {
+  // 与切片深度范围相交的光源，按4个一组对齐，补齐的光源r2为负数
+  std::vector<float> x, y, z, r2;
+  std::vector<uint32_t> ids;
+  std::vector<uint32_t> indices;
+  std::vector<uint32_t> counts;
+  uint32_t overflows = 0;
+};
+
+class ClusteredLightingImpl {
+ public:
+  explicit ClusteredLightingImpl(const ClusterOptions& options) : options_(options) {
+    options_.tiles_x = std::max(1u, options_.tiles_x);
+    options_.tiles_y = std::max(1u, options_.tiles_y);
+    options_.slices = std::max(1u, options_.slices);
+    tiles_ = options_.tiles_x * options_.tiles_y;
+    slices_.resize(options_.slices);
+    box_min_.resize(static_cast<size_t>(tiles_) * options_.slices);
+    box_max_.resize(box_min_.size());
+  }
+
+  ~ClusteredLightingImpl() {
+    if (buffers_[0] != 0) {
+      glDeleteTextures(3, textures_);
+      glDeleteBuffers(3, buffers_);
+    }
+  }
+
+  /**
+   * @brief 计算每个cluster在观察空间中的包围盒，深度d_k = near * (far / near)^(k / slices)
+   */
+  auto buildClusters(float fov_y, float aspect, float near, float far) -> void {
+    GL_HWK_TRACE_SCOPE("ClusteredLighting::buildClusters");
+    float tan_y = std::tan(fov_y * 0.5f);
+    float tan_x = tan_y * aspect;
+    depths_.resize(options_.slices + 1);
+    for (uint32_t k = 0; k <= options_.slices; ++k) {
+      depths_[k] = near * std::pow(far / near, static_cast<float>(k) / options_.slices);
+    }
+    for (uint32_t k = 0; k < options_.slices; ++k) {
+      float d0 = depths_[k], d1 = depths_[k + 1];
+      for (uint32_t j = 0; j < options_.tiles_y; ++j) {
+        float y0 = -1.0f + 2.0f * j / options_.tiles_y;
+        float y1 = -1.0f + 2.0f * (j + 1) / options_.tiles_y;
+        for (uint32_t i = 0; i < options_.tiles_x; ++i) {
+          float x0 = -1.0f + 2.0f * i / options_.tiles_x;
+          float x1 = -1.0f + 2.0f * (i + 1) / options_.tiles_x;
+          // tile四条边在近、远两个深度处的端点决定包围盒，观察空间中摄像机朝向-z
+          float xs[4] = {x0 * d0 * tan_x, x1 * d0 * tan_x, x0 * d1 * tan_x, x1 * d1 * tan_x};
+          float ys[4] = {y0 * d0 * tan_y, y1 * d0 * tan_y, y0 * d1 * tan_y, y1 * d1 * tan_y};
+          size_t c = (static_cast<size_t>(k) * options_.tiles_y + j) * options_.tiles_x + i;
+          box_min_[c] = glm::vec3(*std::min_element(xs, xs + 4), *std::min_element(ys, ys + 4), -d1);
+          box_max_[c] = glm::vec3(*std::max_element(xs, xs + 4), *std::max_element(ys, ys + 4), -d0);
+        }
+      }
+    }
+    fov_y_ = fov_y;
+    aspect_ = aspect;
+    near_ = near;
+    far_ = far;
+  }
+
+  /**
+   * @brief 先选出与切片深度范围相交的光源，再逐个cluster做球与包围盒的相交测试
+   */
+  auto binSlice(uint32_t k) -> void {
+    auto& slice = slices_[k];
+    slice.x.clear();
+    slice.y.clear();
+    slice.z.clear();
+    slice.r2.clear();
+    slice.ids.clear();
+    slice.indices.clear();
+    slice.counts.assign(tiles_, 0);
+    slice.overflows = 0;
+    float d0 = depths_[k], d1 = depths_[k + 1];
+    for (uint32_t l = 0; l < view_lights_.size(); ++l) {
+      const auto& light = view_lights_[l];
+      float depth = -light.z;
+      if (depth + light.w < d0 || depth - light.w > d1) {
+        continue;
+      }
+      slice.x.push_back(light.x);
+      slice.y.push_back(light.y);
+      slice.z.push_back(light.z);
+      slice.r2.push_back(light.w * light.w);
+      slice.ids.push_back(l);
+    }
+    while (slice.ids.size() % 4 != 0) {
+      slice.x.push_back(0.0f);
+      slice.y.push_back(0.0f);
+      slice.z.push_back(0.0f);
+      slice.r2.push_back(-1.0f);
+      slice.ids.push_back(0);
+    }
+
+    uint32_t max_lights = options_.max_lights_per_cluster;
+    for (uint32_t t = 0; t < tiles_; ++t) {
+      size_t c = static_cast<size_t>(k) * tiles_ + t;
+      const glm::vec3& lo = box_min_[c];
+      const glm::vec3& hi = box_max_[c];
+      uint32_t count = 0;
+      auto accept = [&](size_t l) {
+        if (count < max_lights) {
+          slice.indices.push_back(slice.ids[l]);
+          count++;
+        } else {
+          slice.overflows++;
+        }
+      };
+#ifdef GL_HWK_CLUSTER_SSE
+      const __m128 zero = _mm_setzero_ps();
+      const __m128 min_x = _mm_set1_ps(lo.x), min_y = _mm_set1_ps(lo.y), min_z = _mm_set1_ps(lo.z);
+      const __m128 max_x = _mm_set1_ps(hi.x), max_y = _mm_set1_ps(hi.y), max_z = _mm_set1_ps(hi.z);
+      for (size_t l = 0; l < slice.ids.size(); l += 4) {
+        // 球心到包围盒的距离：每个轴上超出包围盒的部分
+        __m128 px = _mm_loadu_ps(&slice.x[l]), py = _mm_loadu_ps(&slice.y[l]), pz = _mm_loadu_ps(&slice.z[l]);
+        __m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(min_x, px), zero), _mm_max_ps(_mm_sub_ps(px, max_x), zero));
+        __m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(min_y, py), zero), _mm_max_ps(_mm_sub_ps(py, max_y), zero));
+        __m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(min_z, pz), zero), _mm_max_ps(_mm_sub_ps(pz, max_z), zero));
+        __m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        int mask = _mm_movemask_ps(_mm_cmple_ps(dist2, _mm_loadu_ps(&slice.r2[l])));
+        for (int b = 0; b < 4; ++b) {
+          if (mask & (1 << b)) {
+            accept(l + b);
+          }
+        }
+      }
+#else
+      for (size_t l = 0; l < slice.ids.size(); ++l) {
+        glm::vec3 p(slice.x[l], slice.y[l], slice.z[l]);
+        glm::vec3 d = glm::max(lo - p, glm::vec3(0.0f)) + glm::max(p - hi, glm::vec3(0.0f));
+        if (glm::dot(d, d) <= slice.r2[l]) {
+          accept(l);
+        }
+      }
+#endif
+      slice.counts[t] = count;
+    }
+  }
+
+  ClusterOptions options_;
+  uint32_t tiles_ = 0;
+  std::vector<PointLight> lights_;
+  glm::vec3 ambient_ = glm::vec3(0.1f);
+
+  // 生成cluster包围盒时的投影参数，变化时重新生成
+  float fov_y_ = 0.0f, aspect_ = 0.0f, near_ = 0.0f, far_ = 0.0f;
+  std::vector<float> depths_;
+  std::vector<glm::vec3> box_min_, box_max_;
+
+  // 观察空间中的光源位置和半径
+  std::vector<glm::vec4> view_lights_;
+  std::vector<ClusterSlice> slices_;
+
+  // 上传的数据：每个光源两个texel(位置、半径，颜色、强度)，每个cluster一个(offset, count)
+  std::vector<glm::vec4> light_data_;
+  std::vector<uint32_t> cluster_grid_;
+  std::vector<uint32_t> light_indices_;
+
+  // 光源、cluster、光源列表
+  GLuint buffers_[3] = {0, 0, 0};
+  GLuint textures_[3] = {0, 0, 0};
+  ClusterStats stats_;
+};
+
+ClusteredLighting::ClusteredLighting(const ClusterOptions& options)
+    : impl_(make_unique_impl<ClusteredLightingImpl>(options)) {}
+
+// 在ClusteredLightingImpl完整定义处析构，释放缓冲区
+ClusteredLighting::~ClusteredLighting() = default;
+
+auto ClusteredLighting::setLights(const std::vector<PointLight>& lights) -> void { impl_->lights_ = lights; }
+
+auto ClusteredLighting::getLights() -> std::vector<PointLight>& { return impl_->lights_; }
+
+auto ClusteredLighting::setAmbient(const glm::vec3& ambient) -> void { impl_->ambient_ = ambient; }
+
+auto ClusteredLighting::build(Camera& camera) -> void {
+  GL_HWK_TRACE_SCOPE("ClusteredLighting::build");
+  auto start = std::chrono::steady_clock::now();
+  auto& impl = *impl_;
+  if (camera.getFovY() != impl.fov_y_ || camera.getAspect() != impl.aspect_ || camera.getNearPlane() != impl.near_ ||
+      camera.getFarPlane() != impl.far_) {
+    impl.buildClusters(camera.getFovY(), camera.getAspect(), camera.getNearPlane(), camera.getFarPlane());
+  }
+
+  glm::mat4 view = camera.getViewMatrix();
+  impl.view_lights_.resize(impl.lights_.size());
+  impl.light_data_.resize(impl.lights_.size() * 2);
+  for (size_t i = 0; i < impl.lights_.size(); ++i) {
+    const auto& light = impl.lights_[i];
+    impl.view_lights_[i] = glm::vec4(glm::vec3(view * glm::vec4(light.position, 1.0f)), light.radius);
+    impl.light_data_[i * 2] = glm::vec4(light.position, light.radius);
+    impl.light_data_[i * 2 + 1] = glm::vec4(light.color, light.intensity);
+  }
+
+  auto* p = impl_.get();
+  JobSystem::instance().parallelFor(impl.options_.slices, 1, [p](size_t begin, size_t end) {
+    for (size_t k = begin; k < end; ++k) {
+      p->binSlice(static_cast<uint32_t>(k));
+    }
+  });
+
+  // 按cluster顺序拼接各切片的光源列表
+  ClusterStats stats;
+  stats.lights = static_cast<uint32_t>(impl.lights_.size());
+  impl.cluster_grid_.resize(impl.box_min_.size() * 2);
+  impl.light_indices_.clear();
+  for (uint32_t k = 0; k < impl.options_.slices; ++k) {
+    const auto& slice = impl.slices_[k];
+    for (uint32_t t = 0; t < impl.tiles_; ++t) {
+      size_t c = static_cast<size_t>(k) * impl.tiles_ + t;
+      impl.cluster_grid_[c * 2] = static_cast<uint32_t>(impl.light_indices_.size());
+      impl.cluster_grid_[c * 2 + 1] = slice.counts[t];
+      stats.max_lights_in_cluster = std::max(stats.max_lights_in_cluster, slice.counts[t]);
+      impl.light_indices_.resize(impl.light_indices_.size() + slice.counts[t]);
+    }
+    std::copy(slice.indices.begin(), slice.indices.end(), impl.light_indices_.end() - slice.indices.size());
+    stats.overflows += slice.overflows;
+  }
+  stats.light_indices = static_cast<uint32_t>(impl.light_indices_.size());
+  stats.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  impl.stats_ = stats;
+}
+
+auto ClusteredLighting::upload() -> void {
+  GL_HWK_TRACE_SCOPE("ClusteredLighting::upload");
+  auto& impl = *impl_;
+  if (impl.buffers_[0] == 0) {
+    glGenBuffers(3, impl.buffers_);
+    glGenTextures(3, impl.textures_);
+  }
+  // buffer texture不能为空，没有数据时上传一个元素
+  static const uint32_t kEmpty[4] = {0, 0, 0, 0};
+  auto pick = [](const auto& v) -> const void* { return v.empty() ? kEmpty : static_cast<const void*>(v.data()); };
+  const void* data[3] = {pick(impl.light_data_), pick(impl.cluster_grid_), pick(impl.light_indices_)};
+  size_t bytes[3] = {std::max<size_t>(1, impl.light_data_.size()) * sizeof(glm::vec4),
+                     std::max<size_t>(2, impl.cluster_grid_.size()) * sizeof(uint32_t),
+                     std::max<size_t>(1, impl.light_indices_.size()) * sizeof(uint32_t)};
+  const GLenum formats[3] = {GL_RGBA32F, GL_RG32UI, GL_R32UI};
+  for (int i = 0; i < 3; ++i) {
+    glBindBuffer(GL_TEXTURE_BUFFER, impl.buffers_[i]);
+    // 每帧大小不同，直接重新分配
+    glBufferData(GL_TEXTURE_BUFFER, bytes[i], data[i], GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, impl.textures_[i]);
+    glTexBuffer(GL_TEXTURE_BUFFER, formats[i], impl.buffers_[i]);
+    RenderStats::instance().addBufferUpload(bytes[i]);
+  }
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+auto ClusteredLighting::bind(Shader& shader, int first_unit) -> void {
+  auto& impl = *impl_;
+  shader.start();
+  const char* names[3] = {"clusterLights", "clusterGrid", "clusterLightIndices"};
+  for (int i = 0; i < 3; ++i) {
+    glActiveTexture(GL_TEXTURE0 + first_unit + i);
+    glBindTexture(GL_TEXTURE_BUFFER, impl.textures_[i]);
+    shader.setInt(names[i], first_unit + i);
+  }
+  glActiveTexture(GL_TEXTURE0);
+  RenderStats::instance().addStateChange(7);
+
+  if (impl.near_ <= 0.0f) {
+    fmt::print("ClusteredLighting: bind called before build\n");
+    return;
+  }
+  // 切片编号 = log(depth) * scale + bias
+  auto slices = static_cast<float>(impl.options_.slices);
+  float log_ratio = std::log(impl.far_ / impl.near_);
+  shader.setVec3("clusterSize", glm::vec3(impl.options_.tiles_x, impl.options_.tiles_y, slices));
+  shader.setVec2("clusterZParams", glm::vec2(slices / log_ratio, -slices * std::log(impl.near_) / log_ratio));
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  shader.setVec2("viewportOrigin", glm::vec2(viewport[0], viewport[1]));
+  shader.setVec2("viewportSize", glm::vec2(viewport[2], viewport[3]));
+  shader.setVec3("ambientColor", impl.ambient_);
+}
+
+auto ClusteredLighting::getStats() -> ClusterStats { return impl_->stats_; }
+
+}  // namespace gl_hwk
@@ -0,0 +1,427 @@
+#include "gl_homework/command_list.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <utility>
+// third party
+#include <fmt/core.h>
+// project
+#include "gl_homework/render_stats.hpp"
+#include "gl_homework/texture_loader.hpp"
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+enum class CommandType : uint16_t {
+  kUseProgram,
+  kBindTexture,
+  kDepthFunc,
+  kClear,
+  kUniform,
+  kDraw,
+};
+
+enum class UniformType : uint16_t {
+  kInt,
+  kFloat,
+  kVec2,
+  kVec3,
+  kVec4,
+  kMat3,
+  kMat4,
+};
+
+// 每条命令以header开头，size为包含header和附加数据在内的字节数，按8字节对齐
+struct CommandHeader {
+  CommandType type;
+  uint16_t size;
+};
+
+struct UseProgramCommand {
+  CommandHeader header;
+  GLuint program;
+};
+
+struct BindTextureCommand {
+  CommandHeader header;
+  GLuint texture;
+  GLint unit;
+};
+
+// depthFunc和clearBuffers共用
+struct ValueCommand {
+  CommandHeader header;
+  GLenum value;
+};
+
+// 后面紧跟uniform的值
+struct UniformCommand {
+  CommandHeader header;
+  UniformType type;
+  bool resolved;
+  GLuint program;
+  GLint location;
+  uint32_t name;
+};
+
+struct DrawCommand {
+  static constexpr uint32_t kNoGeometry = UINT32_MAX;
+
+  CommandHeader header;
+  uint32_t builder;
+  uint32_t name;
+  uint32_t geometry;
+  bool warned;
+  const Primitive* primitive;
+};
+
+// buildTriangles录制的几何数据，图元创建后释放
+struct CommandGeometry {
+  std::vector<glm::vec3> positions;
+  std::vector<GLsizei> indices;
+  std::vector<std::vector<float>> other_data;
+};
+
+inline auto uniformBytes(UniformType type) -> size_t {
+  switch (type) {
+    case UniformType::kInt:
+    case UniformType::kFloat:
+      return 4;
+    case UniformType::kVec2:
+      return 8;
+    case UniformType::kVec3:
+      return 12;
+    case UniformType::kVec4:
+      return 16;
+    case UniformType::kMat3:
+      return 36;
+    case UniformType::kMat4:
+      return 64;
+  }
+  return 0;
+}
+
+class CommandListImpl {
+ public:
+  CommandListImpl() = default;
+
+  template <typename T>
+  auto push(T command, const void* extra = nullptr, size_t extra_bytes = 0) -> uint32_t {
+    size_t bytes = sizeof(T) + extra_bytes;
+    size_t words = (bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    command.header.size = static_cast<uint16_t>(words * sizeof(uint64_t));
+    auto offset = static_cast<uint32_t>(buffer_.size() * sizeof(uint64_t));
+    buffer_.resize(buffer_.size() + words);
+    auto* dst = reinterpret_cast<uint8_t*>(buffer_.data()) + offset;
+    std::memcpy(dst, &command, sizeof(T));
+    if (extra_bytes) {
+      std::memcpy(dst + sizeof(T), extra, extra_bytes);
+    }
+    return offset;
+  }
+
+  template <typename T>
+  auto at(uint32_t offset) -> T* {
+    return reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(buffer_.data()) + offset);
+  }
+
+  auto addName(const std::string& name) -> uint32_t {
+    names_.push_back(name);
+    return static_cast<uint32_t>(names_.size() - 1);
+  }
+
+  auto addBuilder(const std::shared_ptr<PrimitiveBuilder>& builder) -> uint32_t {
+    auto it = std::find(builders_.begin(), builders_.end(), builder);
+    if (it != builders_.end()) {
+      return static_cast<uint32_t>(it - builders_.begin());
+    }
+    builders_.push_back(builder);
+    return static_cast<uint32_t>(builders_.size() - 1);
+  }
+
+  auto setUniform(const std::string& name, UniformType type, const void* value) -> CommandParam {
+    if (program_ == 0) {
+      fmt::print("CommandList: uniform {} is set before useShader\n", name);
+      return {};
+    }
+    UniformCommand command{{CommandType::kUniform, 0}, type, false, program_, -1, addName(name)};
+    return {push(command, value, uniformBytes(type))};
+  }
+
+  auto patch(CommandParam param, UniformType type, const void* value) -> void {
+    if (param.offset == CommandParam::kInvalid || param.offset >= buffer_.size() * sizeof(uint64_t)) {
+      fmt::print("CommandList: invalid param\n");
+      return;
+    }
+    auto* command = at<UniformCommand>(param.offset);
+    if (command->header.type != CommandType::kUniform || command->type != type) {
+      fmt::print("CommandList: param type mismatch: {}\n", names_[command->name]);
+      return;
+    }
+    std::memcpy(command + 1, value, uniformBytes(type));
+  }
+
+  auto executeUniform(UniformCommand* command) -> void {
+    if (!command->resolved) {
+      command->location = glGetUniformLocation(command->program, names_[command->name].c_str());
+      command->resolved = true;
+    }
+    auto* value = reinterpret_cast<const GLfloat*>(command + 1);
+    switch (command->type) {
+      case UniformType::kInt:
+        glUniform1iv(command->location, 1, reinterpret_cast<const GLint*>(value));
+        break;
+      case UniformType::kFloat:
+        glUniform1fv(command->location, 1, value);
+        break;
+      case UniformType::kVec2:
+        glUniform2fv(command->location, 1, value);
+        break;
+      case UniformType::kVec3:
+        glUniform3fv(command->location, 1, value);
+        break;
+      case UniformType::kVec4:
+        glUniform4fv(command->location, 1, value);
+        break;
+      case UniformType::kMat3:
+        glUniformMatrix3fv(command->location, 1, GL_FALSE, value);
+        break;
+      case UniformType::kMat4:
+        glUniformMatrix4fv(command->location, 1, GL_FALSE, value);
+        break;
+    }
+    RenderStats::instance().addUniformUpdate();
+  }
+
+  auto executeDraw(DrawCommand* command) -> void {
+    auto& builder = builders_[command->builder];
+    if (!command->primitive) {
+      command->primitive = builder->findPrimitive(names_[command->name]);
+      if (command->primitive && command->geometry != DrawCommand::kNoGeometry) {
+        // 图元已经由其他命令创建，拷贝的几何数据不会再用到
+        geometries_[command->geometry] = CommandGeometry();
+      }
+    }
+    if (!command->primitive && command->geometry != DrawCommand::kNoGeometry) {
+      // 首次执行时创建图元，buildTriangles会同时完成本次绘制
+      auto& geometry = geometries_[command->geometry];
+      builder->buildTriangles(names_[command->name], geometry.positions, geometry.indices, geometry.other_data);
+      command->primitive = builder->findPrimitive(names_[command->name]);
+      geometry = CommandGeometry();
+      return;
+    }
+    if (!command->primitive) {
+      if (!command->warned) {
+        fmt::print("CommandList: primitive not found: {}\n", names_[command->name]);
+        command->warned = true;
+      }
+      return;
+    }
+    builder->drawPrimitive(command->primitive);
+  }
+
+  // 用uint64_t存储保证每条命令8字节对齐
+  std::vector<uint64_t> buffer_;
+  std::vector<std::string> names_;
+  std::vector<std::shared_ptr<PrimitiveBuilder>> builders_;
+  std::vector<CommandGeometry> geometries_;
+  // 录制时的当前着色器程序
+  GLuint program_ = 0;
+};
+
+CommandList::CommandList() : impl_(make_unique_impl<CommandListImpl>()) {}
+
+// 在CommandListImpl完整定义处析构
+CommandList::~CommandList() = default;
+
+auto CommandList::reset() -> void {
+  impl_->buffer_.clear();
+  impl_->names_.clear();
+  impl_->builders_.clear();
+  impl_->geometries_.clear();
+  impl_->program_ = 0;
+}
+
+auto CommandList::useShader(const std::shared_ptr<Shader>& shader) -> void {
+  impl_->program_ = shader->ID;
+  impl_->push(UseProgramCommand{{CommandType::kUseProgram, 0}, shader->ID});
+}
+
+auto CommandList::bindTexture(GLuint texture_id, int unit) -> void {
+  impl_->push(BindTextureCommand{{CommandType::kBindTexture, 0}, texture_id, unit});
+}
+
+auto CommandList::depthFunc(GLenum func) -> void { impl_->push(ValueCommand{{CommandType::kDepthFunc, 0}, func}); }
+
+auto CommandList::clearBuffers(GLbitfield mask) -> void { impl_->push(ValueCommand{{CommandType::kClear, 0}, mask}); }
+
+auto CommandList::setInt(const std::string& name, int value) -> CommandParam {
+  return impl_->setUniform(name, UniformType::kInt, &value);
+}
+
+auto CommandList::setFloat(const std::string& name, float value) -> CommandParam {
+  return impl_->setUniform(name, UniformType::kFloat, &value);
+}
+
+auto CommandList::setVec2(const std::string& name, const glm::vec2& value) -> CommandParam {
+  return impl_->setUniform(name, UniformType::kVec2, &value[0]);
+}
+
+auto CommandList::setVec3(const std::string& name, const glm::vec3& value) -> CommandParam {
+  return impl_->setUniform(name, UniformType::kVec3, &value[0]);
+}
+
+auto CommandList::setVec4(const std::string& name, const glm::vec4& value) -> CommandParam {
+  return impl_->setUniform(name, UniformType::kVec4, &value[0]);
+}
+
+auto CommandList::setMat3(const std::string& name, const glm::mat3& value) -> CommandParam {
+  return impl_->setUniform(name, UniformType::kMat3, &value[0][0]);
+}
+
+auto CommandList::setMat4(const std::string& name, const glm::mat4& value) -> CommandParam {
+  return impl_->setUniform(name, UniformType::kMat4, &value[0][0]);
+}
+
+auto CommandList::draw(const std::shared_ptr<PrimitiveBuilder>& builder, const std::string& name) -> void {
+  impl_->push(DrawCommand{{CommandType::kDraw, 0},
+                          impl_->addBuilder(builder),
+                          impl_->addName(name),
+                          DrawCommand::kNoGeometry,
+                          false,
+                          nullptr});
+}
+
+auto CommandList::buildTriangles(const std::shared_ptr<PrimitiveBuilder>& builder, const std::string& name,
+                                 const std::vector<glm::vec3>& positions, const std::vector<GLsizei>& indices,
+                                 const std::vector<std::vector<float>>& other_data) -> void {
+  impl_->geometries_.push_back({positions, indices, other_data});
+  impl_->push(DrawCommand{{CommandType::kDraw, 0},
+                          impl_->addBuilder(builder),
+                          impl_->addName(name),
+                          static_cast<uint32_t>(impl_->geometries_.size() - 1),
+                          false,
+                          nullptr});
+}
+
+auto CommandList::patch(CommandParam param, int value) -> void { impl_->patch(param, UniformType::kInt, &value); }
+
+auto CommandList::patch(CommandParam param, float value) -> void { impl_->patch(param, UniformType::kFloat, &value); }
+
+auto CommandList::patch(CommandParam param, const glm::vec2& value) -> void {
+  impl_->patch(param, UniformType::kVec2, &value[0]);
+}
+
+auto CommandList::patch(CommandParam param, const glm::vec3& value) -> void {
+  impl_->patch(param, UniformType::kVec3, &value[0]);
+}
+
+auto CommandList::patch(CommandParam param, const glm::vec4& value) -> void {
+  impl_->patch(param, UniformType::kVec4, &value[0]);
+}
+
+auto CommandList::patch(CommandParam param, const glm::mat3& value) -> void {
+  impl_->patch(param, UniformType::kMat3, &value[0][0]);
+}
+
+auto CommandList::patch(CommandParam param, const glm::mat4& value) -> void {
+  impl_->patch(param, UniformType::kMat4, &value[0][0]);
+}
+
+auto CommandList::execute() -> void {
+  GL_HWK_TRACE_SCOPE("CommandList::execute");
+  auto& stats = RenderStats::instance();
+  // 跳过列表内重复的glUseProgram
+  GLuint current_program = 0;
+  size_t end = impl_->buffer_.size() * sizeof(uint64_t);
+  for (size_t offset = 0; offset < end;) {
+    auto* header = impl_->at<CommandHeader>(static_cast<uint32_t>(offset));
+    switch (header->type) {
+      case CommandType::kUseProgram: {
+        auto* command = reinterpret_cast<UseProgramCommand*>(header);
+        if (command->program != current_program) {
+          glUseProgram(command->program);
+          stats.addStateChange();
+          current_program = command->program;
+        }
+        break;
+      }
+      case CommandType::kBindTexture: {
+        auto* command = reinterpret_cast<BindTextureCommand*>(header);
+        TextureLoader::instance().activeTexture(command->texture, command->unit);
+        break;
+      }
+      case CommandType::kDepthFunc: {
+        glDepthFunc(reinterpret_cast<ValueCommand*>(header)->value);
+        stats.addStateChange();
+        break;
+      }
+      case CommandType::kClear: {
+        glClear(reinterpret_cast<ValueCommand*>(header)->value);
+        break;
+      }
+      case CommandType::kUniform: {
+        impl_->executeUniform(reinterpret_cast<UniformCommand*>(header));
+        break;
+      }
+      case CommandType::kDraw: {
+        impl_->executeDraw(reinterpret_cast<DrawCommand*>(header));
+        break;
+      }
+    }
+    offset += header->size;
+  }
+}
+
+auto CommandList::size() -> size_t { return impl_->buffer_.size() * sizeof(uint64_t); }
+
+struct QueuedCommandList {
+  int64_t sort_key;
+  std::shared_ptr<CommandList> list;
+};
+
+class CommandQueueImpl {
+ public:
+  CommandQueueImpl() = default;
+
+  std::mutex mutex_;
+  std::vector<QueuedCommandList> queue_;
+  // 在GL线程上复用，避免每帧分配
+  std::vector<QueuedCommandList> executing_;
+};
+
+CommandQueue::CommandQueue() : impl_(make_unique_impl<CommandQueueImpl>()) {}
+
+// 在CommandQueueImpl完整定义处析构
+CommandQueue::~CommandQueue() = default;
+
+auto CommandQueue::instance() -> CommandQueue& {
+  static CommandQueue instance;
+  return instance;
+}
+
+auto CommandQueue::submit(std::shared_ptr<CommandList> list, int64_t sort_key) -> void {
+  std::lock_guard<std::mutex> lock(impl_->mutex_);
+  impl_->queue_.push_back({sort_key, std::move(list)});
+}
+
+auto CommandQueue::execute() -> void {
+  GL_HWK_TRACE_SCOPE("CommandQueue::execute");
+  {
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    std::swap(impl_->queue_, impl_->executing_);
+  }
+  // 同一sort_key按提交顺序执行
+  std::stable_sort(impl_->executing_.begin(), impl_->executing_.end(),
+                   [](const QueuedCommandList& a, const QueuedCommandList& b) { return a.sort_key < b.sort_key; });
+  for (auto& queued : impl_->executing_) {
+    queued.list->execute();
+  }
+  impl_->executing_.clear();
+}
+
+}  // namespace gl_hwk
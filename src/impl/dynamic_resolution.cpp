@@ -0,0 +1,340 @@
+#include "gl_homework/dynamic_resolution.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <array>
+#include <cmath>
+// third party
+#include <fmt/core.h>
+// project
+#include "gl_homework/gpu_profiler.hpp"
+#include "gl_homework/render_graph.hpp"
+#include "gl_homework/render_stats.hpp"
+#include "gl_homework/shader.hpp"
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+class DynamicResolutionImpl {
+ public:
+  // 查询结果延迟kFrameLatency帧读取，与GpuProfiler相同
+  static constexpr size_t kFrameLatency = 4;
+  // GPU时间的指数平均系数
+  static constexpr double kSmoothing = 0.2;
+  // 比例变化小于这个值时不调整
+  static constexpr float kMinChange = 0.01f;
+
+  struct FrameTiming {
+    // 帧开始和放大结束时的GL_TIMESTAMP
+    std::array<GLuint, 2> queries = {0, 0};
+    float scale = 1.0f;
+    bool in_flight = false;
+  };
+
+  DynamicResolutionImpl(uint32_t width, uint32_t height, const DynamicResolutionOptions& options)
+      : options_(options), upscale_shader_("shader/fullscreen.vert.GLSL", "shader/upscale.frag.GLSL") {
+    scale_ = std::clamp(options_.max_scale, options_.min_scale, 1.0f);
+    timer_supported_ = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+    if (!timer_supported_) {
+      fmt::print("DynamicResolution: GL_TIMESTAMP query is not supported, scale is fixed\n");
+    }
+    allocate(width, height);
+  }
+
+  ~DynamicResolutionImpl() {
+    destroyTargets();
+    for (auto& frame : frames_) {
+      if (frame.queries[0] != 0) {
+        glDeleteQueries(2, frame.queries.data());
+      }
+    }
+    if (vao_ != 0) {
+      glDeleteVertexArrays(1, &vao_);
+    }
+  }
+
+  auto destroyTargets() -> void {
+    for (GLuint texture : {color_, depth_}) {
+      if (texture != 0) {
+        RenderTargetPool::instance().release(texture);
+      }
+    }
+    color_ = depth_ = 0;
+    if (fbo_ != 0) {
+      glDeleteFramebuffers(1, &fbo_);
+      fbo_ = 0;
+    }
+  }
+
+  /**
+   * @brief 按max_scale分配离屏目标，比例变化时只修改视口
+   */
+  auto allocate(uint32_t width, uint32_t height) -> void {
+    destroyTargets();
+    width_ = std::max(width, 1u);
+    height_ = std::max(height, 1u);
+    float max_scale = std::clamp(options_.max_scale, options_.min_scale, 1.0f);
+    target_width_ = std::max(static_cast<uint32_t>(std::ceil(width_ * max_scale)), 1u);
+    target_height_ = std::max(static_cast<uint32_t>(std::ceil(height_ * max_scale)), 1u);
+    color_ = RenderTargetPool::instance().acquire({target_width_, target_height_, GL_RGBA8});
+    depth_ = RenderTargetPool::instance().acquire({target_width_, target_height_, GL_DEPTH24_STENCIL8});
+
+    GLint framebuffer;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+    glGenFramebuffers(1, &fbo_);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depth_, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      fmt::print("DynamicResolution: offscreen framebuffer incomplete\n");
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    setScale(scale_);
+  }
+
+  auto setScale(float scale) -> void {
+    float max_scale = std::clamp(options_.max_scale, options_.min_scale, 1.0f);
+    scale_ = std::clamp(scale, options_.min_scale, max_scale);
+    // 两个方向用同一个比例，保持宽高比
+    render_width_ = std::clamp(static_cast<uint32_t>(std::lround(width_ * scale_)), 1u, target_width_);
+    render_height_ = std::clamp(static_cast<uint32_t>(std::lround(height_ * scale_)), 1u, target_height_);
+    samples_at_scale_ = 0;
+  }
+
+  /**
+   * @brief 读取一帧的GPU时间
+   * @param wait 结果未就绪时是否等待
+   * @return 是否已读取
+   */
+  auto collect(FrameTiming& frame, bool wait) -> bool {
+    if (!frame.in_flight) {
+      return true;
+    }
+    if (!wait) {
+      GLint available = 0;
+      glGetQueryObjectiv(frame.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available) {
+        return false;
+      }
+    }
+    GLuint64 begin = 0, end = 0;
+    glGetQueryObjectui64v(frame.queries[0], GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(frame.queries[1], GL_QUERY_RESULT, &end);
+    frame.in_flight = false;
+    record(static_cast<double>(end - begin) * 1e-6, frame.scale);
+    return true;
+  }
+
+  auto record(double ms, float scale) -> void {
+    stats_.last_gpu_ms = ms;
+    // 比例变化前提交的帧不能反映当前比例的开销
+    if (scale != scale_) {
+      return;
+    }
+    gpu_ms_ = samples_at_scale_ == 0 ? ms : gpu_ms_ + (ms - gpu_ms_) * kSmoothing;
+    samples_at_scale_++;
+    if (options_.adaptive && samples_at_scale_ >= std::max(options_.settle_frames, 1u)) {
+      adjust();
+    }
+  }
+
+  /**
+   * @brief GPU时间近似与像素数成正比，比例按时间之比的平方根缩放
+   */
+  auto adjust() -> void {
+    double target = options_.target_ms;
+    float next = scale_;
+    if (gpu_ms_ > target) {
+      next = std::max(scale_ * static_cast<float>(std::sqrt(target / gpu_ms_)), scale_ - options_.max_step);
+    } else if (gpu_ms_ < target * (1.0 - options_.headroom)) {
+      // 提高后落在滞回区间中间，而不是正好到达目标
+      double goal = target * (1.0 - options_.headroom * 0.5);
+      next = std::min(scale_ * static_cast<float>(std::sqrt(goal / std::max(gpu_ms_, 1e-3))),
+                      scale_ + options_.max_step);
+    }
+    float max_scale = std::clamp(options_.max_scale, options_.min_scale, 1.0f);
+    next = std::clamp(next, options_.min_scale, max_scale);
+    if (std::abs(next - scale_) < kMinChange) {
+      return;
+    }
+    setScale(next);
+    stats_.changes++;
+  }
+
+  auto begin() -> void {
+    GL_HWK_TRACE_SCOPE("DynamicResolution::begin");
+    if (in_frame_) {
+      fmt::print("DynamicResolution: begin called twice without end\n");
+      return;
+    }
+    if (timer_supported_) {
+      auto& frame = frames_[frame_index_ % kFrameLatency];
+      collect(frame, true);
+      // 顺便读取已经就绪的更早的帧
+      for (size_t i = 1; i < kFrameLatency; ++i) {
+        if (!collect(frames_[(frame_index_ + i) % kFrameLatency], false)) {
+          break;
+        }
+      }
+      if (frame.queries[0] == 0) {
+        glGenQueries(2, frame.queries.data());
+      }
+      frame.scale = scale_;
+      glQueryCounter(frame.queries[0], GL_TIMESTAMP);
+    }
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer_);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_framebuffer_);
+    glGetIntegerv(GL_VIEWPORT, viewport_.data());
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glViewport(0, 0, static_cast<GLsizei>(render_width_), static_cast<GLsizei>(render_height_));
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    RenderStats::instance().addStateChange(2);
+    in_frame_ = true;
+  }
+
+  auto upscale() -> void {
+    GpuProfileScope scope("upscale");
+    // 保存调用者的状态
+    GLint program, vao, texture;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vao);
+    glActiveTexture(GL_TEXTURE0);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean scissor_test = glIsEnabled(GL_SCISSOR_TEST);
+
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_SCISSOR_TEST);
+    upscale_shader_.start();
+    upscale_shader_.setInt("sourceTexture", 0);
+    upscale_shader_.setVec2("sourceSize", static_cast<float>(render_width_), static_cast<float>(render_height_));
+    upscale_shader_.setVec4("viewportRect", static_cast<float>(viewport_[0]), static_cast<float>(viewport_[1]),
+                            static_cast<float>(viewport_[2]), static_cast<float>(viewport_[3]));
+    upscale_shader_.setFloat("sharpness", std::clamp(options_.sharpness, 0.0f, 1.0f));
+    glBindTexture(GL_TEXTURE_2D, color_);
+    if (vao_ == 0) {
+      glGenVertexArrays(1, &vao_);
+    }
+    glBindVertexArray(vao_);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    RenderStats::instance().addDrawCall(GL_TRIANGLES, 3);
+    RenderStats::instance().addStateChange(10);
+
+    glUseProgram(program);
+    glBindVertexArray(vao);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (blend) {
+      glEnable(GL_BLEND);
+    }
+    if (depth_test) {
+      glEnable(GL_DEPTH_TEST);
+    }
+    if (scissor_test) {
+      glEnable(GL_SCISSOR_TEST);
+    }
+  }
+
+  auto end() -> void {
+    GL_HWK_TRACE_SCOPE("DynamicResolution::end");
+    if (!in_frame_) {
+      fmt::print("DynamicResolution: end called without begin\n");
+      return;
+    }
+    in_frame_ = false;
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer_);
+    glViewport(viewport_[0], viewport_[1], viewport_[2], viewport_[3]);
+    if (render_width_ == static_cast<uint32_t>(viewport_[2]) && render_height_ == static_cast<uint32_t>(viewport_[3])) {
+      // 没有缩小时直接复制
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo_);
+      glBlitFramebuffer(0, 0, render_width_, render_height_, viewport_[0], viewport_[1], viewport_[0] + viewport_[2],
+                        viewport_[1] + viewport_[3], GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    } else {
+      upscale();
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer_);
+    RenderStats::instance().addStateChange(3);
+
+    if (timer_supported_) {
+      auto& frame = frames_[frame_index_ % kFrameLatency];
+      glQueryCounter(frame.queries[1], GL_TIMESTAMP);
+      frame.in_flight = true;
+    }
+    frame_index_++;
+    stats_.frames++;
+  }
+
+  DynamicResolutionOptions options_;
+  Shader upscale_shader_;
+  bool timer_supported_ = false;
+  bool in_frame_ = false;
+  // 输出大小、离屏目标大小和当前渲染区域大小
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  uint32_t target_width_ = 0;
+  uint32_t target_height_ = 0;
+  uint32_t render_width_ = 0;
+  uint32_t render_height_ = 0;
+  float scale_ = 1.0f;
+  double gpu_ms_ = 0.0;
+  uint32_t samples_at_scale_ = 0;
+
+  GLuint fbo_ = 0;
+  GLuint color_ = 0;
+  GLuint depth_ = 0;
+  GLuint vao_ = 0;
+  // begin时绑定的帧缓冲和视口，即放大的目标
+  GLint framebuffer_ = 0;
+  GLint read_framebuffer_ = 0;
+  std::array<GLint, 4> viewport_ = {0, 0, 0, 0};
+
+  size_t frame_index_ = 0;
+  std::array<FrameTiming, kFrameLatency> frames_;
+  DynamicResolutionStats stats_;
+};
+
+DynamicResolution::DynamicResolution(uint32_t width, uint32_t height, const DynamicResolutionOptions& options)
+    : impl_(make_unique_impl<DynamicResolutionImpl>(width, height, options)) {}
+
+// 在DynamicResolutionImpl完整定义处析构
+DynamicResolution::~DynamicResolution() = default;
+
+auto DynamicResolution::resize(uint32_t width, uint32_t height) -> void {
+  if (width != impl_->width_ || height != impl_->height_) {
+    impl_->allocate(width, height);
+  }
+}
+
+auto DynamicResolution::begin() -> void { impl_->begin(); }
+
+auto DynamicResolution::end() -> void { impl_->end(); }
+
+auto DynamicResolution::setScale(float scale) -> void { impl_->setScale(scale); }
+
+auto DynamicResolution::getScale() -> float { return impl_->scale_; }
+
+auto DynamicResolution::setOptions(const DynamicResolutionOptions& options) -> void {
+  bool reallocate = options.max_scale != impl_->options_.max_scale || options.min_scale != impl_->options_.min_scale;
+  impl_->options_ = options;
+  if (reallocate) {
+    impl_->allocate(impl_->width_, impl_->height_);
+  } else {
+    impl_->setScale(impl_->scale_);
+  }
+}
+
+auto DynamicResolution::getColorTexture() -> GLuint { return impl_->color_; }
+
+auto DynamicResolution::getStats() -> DynamicResolutionStats {
+  auto stats = impl_->stats_;
+  stats.scale = impl_->scale_;
+  stats.render_width = impl_->render_width_;
+  stats.render_height = impl_->render_height_;
+  stats.gpu_ms = impl_->gpu_ms_;
+  return stats;
+}
+
+}  // namespace gl_hwk
@@ -0,0 +1,97 @@
+#include "gl_homework/frame_arena.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+// project
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+class FrameArenaImpl : public std::pmr::memory_resource {
+ public:
+  static constexpr size_t kInitialCapacity = 256 * 1024;
+
+  FrameArenaImpl() : buffer_(kInitialCapacity) {}
+
+  ~FrameArenaImpl() override { releaseOverflow(); }
+
+  auto reset() -> void {
+    releaseOverflow();
+    stats_.peak = std::max(stats_.peak, stats_.used);
+    // 上一帧溢出时按峰值扩容为2的幂
+    if (stats_.peak > buffer_.size()) {
+      size_t capacity = buffer_.size();
+      while (capacity < stats_.peak) {
+        capacity *= 2;
+      }
+      buffer_ = std::vector<std::byte>(capacity);
+    }
+    offset_ = 0;
+    stats_.used = 0;
+  }
+
+  auto capacity() const -> size_t { return buffer_.size(); }
+
+  auto releaseOverflow() -> void {
+    for (const auto& block : overflow_) {
+      std::pmr::new_delete_resource()->deallocate(block.pointer, block.bytes, block.alignment);
+    }
+    overflow_.clear();
+  }
+
+  FrameArenaStats stats_;
+
+ private:
+  struct OverflowBlock {
+    void* pointer;
+    size_t bytes;
+    size_t alignment;
+  };
+
+  auto do_allocate(size_t bytes, size_t alignment) -> void* override {
+    stats_.used += bytes;
+    size_t aligned = (offset_ + alignment - 1) & ~(alignment - 1);
+    if (aligned + bytes <= buffer_.size()) {
+      offset_ = aligned + bytes;
+      return buffer_.data() + aligned;
+    }
+    stats_.overflows++;
+    void* pointer = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    overflow_.push_back({pointer, bytes, alignment});
+    return pointer;
+  }
+
+  // 内存在reset时统一回收
+  auto do_deallocate(void*, size_t, size_t) -> void override {}
+
+  auto do_is_equal(const std::pmr::memory_resource& other) const noexcept -> bool override { return this == &other; }
+
+  std::vector<std::byte> buffer_;
+  size_t offset_ = 0;
+  std::vector<OverflowBlock> overflow_;
+};
+
+FrameArena::FrameArena() : impl_(make_unique_impl<FrameArenaImpl>()) {}
+
+auto FrameArena::instance() -> FrameArena& {
+  static FrameArena instance;
+  return instance;
+}
+
+auto FrameArena::resource() -> std::pmr::memory_resource* { return impl_.get(); }
+
+auto FrameArena::reset() -> void {
+  GL_HWK_TRACE_SCOPE("FrameArena::reset");
+  impl_->reset();
+}
+
+auto FrameArena::getStats() -> FrameArenaStats {
+  auto stats = impl_->stats_;
+  stats.capacity = impl_->capacity();
+  stats.peak = std::max(stats.peak, stats.used);
+  return stats;
+}
+
+}  // namespace gl_hwk
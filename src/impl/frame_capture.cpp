@@ -0,0 +1,362 @@
+#include "gl_homework/frame_capture.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+// third party
+#include <fmt/core.h>
+// project
+#include "gl_homework/image_codec.hpp"
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+struct CaptureSlot {
+  GLuint pbo = 0;
+  GLsync fence = nullptr;
+  uint64_t frame = 0;
+};
+
+struct CapturedFrame {
+  uint64_t frame;
+  std::vector<uint8_t> pixels;
+};
+
+class FrameCaptureImpl {
+ public:
+  // 等待在途帧的超时
+  static constexpr uint64_t kStopTimeoutNs = 1000000000;
+
+  FrameCaptureImpl() = default;
+  ~FrameCaptureImpl() {
+    // 析构时GL上下文可能已经销毁，只结束后台线程
+    stopEncoder();
+  }
+
+  auto frameBytes() const -> size_t { return static_cast<size_t>(width_) * height_ * 4; }
+
+  /**
+   * @brief 映射已完成的PBO，拷贝后交给编码线程
+   */
+  auto collect(CaptureSlot& slot) -> void {
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    std::vector<uint8_t> pixels;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (options_.drop_frames && queue_.size() >= options_.max_pending) {
+        dropped_++;
+        return;
+      }
+      space_cv_.wait(lock, [this] { return queue_.size() < options_.max_pending; });
+      if (!free_buffers_.empty()) {
+        pixels = std::move(free_buffers_.back());
+        free_buffers_.pop_back();
+      }
+    }
+    pixels.resize(frameBytes());
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameBytes(), GL_MAP_READ_BIT);
+    if (data) {
+      std::memcpy(pixels.data(), data, frameBytes());
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!data) {
+      fmt::print("FrameCapture: Failed to map pixel buffer\n");
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back({slot.frame, std::move(pixels)});
+    }
+    cv_.notify_one();
+  }
+
+  /**
+   * @brief 回收最早提交的帧，timeout为0时不等待，fence未完成返回false
+   */
+  auto collectOldest(uint64_t timeout_ns) -> bool {
+    auto& slot = slots_[(next_slot_ + slots_.size() - pending_) % slots_.size()];
+    GLenum result = glClientWaitSync(slot.fence, timeout_ns ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout_ns);
+    if (result == GL_TIMEOUT_EXPIRED) {
+      return false;
+    }
+    if (result == GL_WAIT_FAILED) {
+      fmt::print("FrameCapture: glClientWaitSync failed\n");
+    }
+    collect(slot);
+    pending_--;
+    return true;
+  }
+
+  /**
+   * @brief 按提交顺序回收所有fence已完成的帧
+   */
+  auto collectReady(uint64_t timeout_ns) -> void {
+    while (pending_ > 0 && collectOldest(timeout_ns)) {
+    }
+  }
+
+  auto encoderLoop() -> void {
+    Tracer::instance().setThreadName("capture_encoder");
+    while (true) {
+      CapturedFrame captured;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !queue_.empty() || exit_; });
+        if (queue_.empty()) {
+          return;
+        }
+        captured = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      space_cv_.notify_one();
+      encode(captured);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        written_++;
+        free_buffers_.push_back(std::move(captured.pixels));
+      }
+    }
+  }
+
+  auto encode(const CapturedFrame& captured) -> void {
+    GL_HWK_TRACE_SCOPE("FrameCapture::encode");
+    // OpenGL的行从下到上
+    const size_t row_bytes = static_cast<size_t>(width_) * 4;
+    flipped_.resize(row_bytes * height_);
+    for (uint32_t y = 0; y < height_; ++y) {
+      std::memcpy(flipped_.data() + y * row_bytes, captured.pixels.data() + (height_ - 1 - y) * row_bytes,
+                  row_bytes);
+    }
+
+    switch (options_.format) {
+      case CaptureFormat::kPngSequence: {
+        auto path = fmt::format("{}/frame_{:06d}.png", options_.path, captured.frame);
+        // PNG按RGBA顺序保存
+        for (size_t i = 0; i < flipped_.size(); i += 4) {
+          std::swap(flipped_[i], flipped_[i + 2]);
+        }
+        if (!codec_.encodePng(path, flipped_.data(), width_, height_, PixelLayout::kRgba)) {
+          fmt::print("FrameCapture: Failed to write image: {}\n", path);
+        }
+        break;
+      }
+      case CaptureFormat::kY4m: {
+        writeY4mFrame(flipped_.data());
+        break;
+      }
+      case CaptureFormat::kRaw: {
+        stream_.write(reinterpret_cast<const char*>(flipped_.data()), frameBytes());
+        break;
+      }
+    }
+  }
+
+  /**
+   * @brief BGRA转为BT.601 limited range的YUV 4:4:4平面
+   */
+  auto writeY4mFrame(const uint8_t* bgra) -> void {
+    size_t plane = static_cast<size_t>(width_) * height_;
+    yuv_.resize(plane * 3);
+    uint8_t* y_plane = yuv_.data();
+    uint8_t* u_plane = y_plane + plane;
+    uint8_t* v_plane = u_plane + plane;
+    const uint8_t* src = bgra;
+    for (size_t i = 0; i < plane; ++i) {
+      int b = src[i * 4 + 0];
+      int g = src[i * 4 + 1];
+      int r = src[i * 4 + 2];
+      y_plane[i] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+      u_plane[i] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+      v_plane[i] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+    stream_ << "FRAME\n";
+    stream_.write(reinterpret_cast<const char*>(yuv_.data()), yuv_.size());
+  }
+
+  auto stopEncoder() -> void {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      exit_ = true;
+    }
+    cv_.notify_one();
+    if (encoder_.joinable()) {
+      encoder_.join();
+    }
+    if (stream_.is_open()) {
+      stream_.close();
+    }
+  }
+
+  CaptureOptions options_;
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  bool running_ = false;
+
+  // 只在GL线程访问
+  std::vector<CaptureSlot> slots_;
+  size_t next_slot_ = 0;
+  size_t pending_ = 0;
+  uint64_t frame_ = 0;
+  double total_capture_ms_ = 0.0;
+  double max_capture_ms_ = 0.0;
+
+  // 由mutex_保护
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::condition_variable space_cv_;
+  std::deque<CapturedFrame> queue_;
+  std::vector<std::vector<uint8_t>> free_buffers_;
+  uint64_t written_ = 0;
+  uint64_t dropped_ = 0;
+  bool exit_ = false;
+
+  // 只在编码线程访问
+  std::thread encoder_;
+  std::ofstream stream_;
+  std::vector<uint8_t> flipped_;
+  std::vector<uint8_t> yuv_;
+  ImageCodec codec_;
+};
+
+FrameCapture::FrameCapture() : impl_(make_unique_impl<FrameCaptureImpl>()) {}
+
+// 在FrameCaptureImpl完整定义处析构，结束编码线程
+FrameCapture::~FrameCapture() = default;
+
+auto FrameCapture::start(const CaptureOptions& options, uint32_t width, uint32_t height) -> bool {
+  if (impl_->running_) {
+    fmt::print("FrameCapture: capture is already running\n");
+    return false;
+  }
+  if (!(GLEW_VERSION_3_2 || GLEW_ARB_sync)) {
+    fmt::print("FrameCapture: sync objects are not supported\n");
+    return false;
+  }
+
+  impl_->options_ = options;
+  impl_->options_.ring_size = std::max(3u, options.ring_size);
+  impl_->options_.max_pending = std::max(1u, options.max_pending);
+  impl_->width_ = width;
+  impl_->height_ = height;
+
+  if (options.format == CaptureFormat::kPngSequence) {
+    std::error_code ec;
+    std::filesystem::create_directories(options.path, ec);
+    if (ec) {
+      fmt::print("FrameCapture: Failed to create directory: {}\n", options.path);
+      return false;
+    }
+  } else {
+    impl_->stream_.open(options.path, std::ios::binary | std::ios::trunc);
+    if (!impl_->stream_.is_open()) {
+      fmt::print("FrameCapture: Failed to open file: {}\n", options.path);
+      return false;
+    }
+    if (options.format == CaptureFormat::kY4m) {
+      impl_->stream_ << fmt::format("YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C444\n", width, height, options.fps);
+    }
+  }
+
+  impl_->slots_.resize(impl_->options_.ring_size);
+  for (auto& slot : impl_->slots_) {
+    glGenBuffers(1, &slot.pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, impl_->frameBytes(), nullptr, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  impl_->next_slot_ = 0;
+  impl_->pending_ = 0;
+  impl_->frame_ = 0;
+  impl_->total_capture_ms_ = 0.0;
+  impl_->max_capture_ms_ = 0.0;
+  impl_->written_ = 0;
+  impl_->dropped_ = 0;
+  impl_->exit_ = false;
+  auto* impl = impl_.get();
+  impl_->encoder_ = std::thread([impl] { impl->encoderLoop(); });
+  impl_->running_ = true;
+  return true;
+}
+
+auto FrameCapture::captureFrame() -> void {
+  if (!impl_->running_) {
+    return;
+  }
+  GL_HWK_TRACE_SCOPE("FrameCapture::captureFrame");
+  auto begin = std::chrono::steady_clock::now();
+
+  impl_->collectReady(0);
+  if (impl_->pending_ == impl_->slots_.size() && !impl_->options_.drop_frames) {
+    impl_->collectOldest(FrameCaptureImpl::kStopTimeoutNs);
+  }
+  if (impl_->pending_ == impl_->slots_.size()) {
+    // 最老的帧还没读完，丢弃本帧而不是等待GPU
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->dropped_++;
+  } else {
+    auto& slot = impl_->slots_[impl_->next_slot_];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    // 绑定PBO时glReadPixels只发起拷贝，立即返回
+    glReadPixels(0, 0, impl_->width_, impl_->height_, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = impl_->frame_;
+    impl_->next_slot_ = (impl_->next_slot_ + 1) % impl_->slots_.size();
+    impl_->pending_++;
+  }
+  impl_->frame_++;
+
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+  impl_->total_capture_ms_ += ms;
+  impl_->max_capture_ms_ = std::max(impl_->max_capture_ms_, ms);
+}
+
+auto FrameCapture::stop() -> void {
+  if (!impl_->running_) {
+    return;
+  }
+  impl_->collectReady(FrameCaptureImpl::kStopTimeoutNs);
+  for (auto& slot : impl_->slots_) {
+    if (slot.fence) {
+      glDeleteSync(slot.fence);
+    }
+    glDeleteBuffers(1, &slot.pbo);
+  }
+  impl_->slots_.clear();
+  impl_->pending_ = 0;
+  impl_->stopEncoder();
+  impl_->running_ = false;
+}
+
+auto FrameCapture::isRunning() -> bool { return impl_->running_; }
+
+auto FrameCapture::getStats() -> CaptureStats {
+  CaptureStats stats;
+  stats.frames_captured = impl_->frame_;
+  stats.avg_capture_ms = impl_->frame_ == 0 ? 0.0 : impl_->total_capture_ms_ / impl_->frame_;
+  stats.max_capture_ms = impl_->max_capture_ms_;
+  std::lock_guard<std::mutex> lock(impl_->mutex_);
+  stats.frames_written = impl_->written_;
+  stats.frames_dropped = impl_->dropped_;
+  return stats;
+}
+
+}  // namespace gl_hwk
@@ -0,0 +1,451 @@
+#include "gl_homework/geometry_pool.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <optional>
+// third party
+#include <fmt/core.h>
+// project
+#include "gl_homework/gpu_profiler.hpp"
+#include "gl_homework/render_stats.hpp"
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+/**
+ * @brief 按首次适配分配[0, capacity)中的区间，空闲块按偏移保存，释放时与相邻的空闲块合并
+ */
+class RangeAllocator {
+ public:
+  /**
+   * @brief [0, used)已被占用，其余为一个空闲块
+   */
+  auto reset(uint32_t used, uint32_t capacity) -> void {
+    free_.clear();
+    if (capacity > used) {
+      free_[used] = capacity - used;
+    }
+    free_total_ = capacity - used;
+  }
+
+  auto allocate(uint32_t size) -> std::optional<uint32_t> {
+    for (auto it = free_.begin(); it != free_.end(); ++it) {
+      if (it->second < size) {
+        continue;
+      }
+      uint32_t offset = it->first;
+      uint32_t rest = it->second - size;
+      free_.erase(it);
+      if (rest > 0) {
+        free_[offset + size] = rest;
+      }
+      free_total_ -= size;
+      return offset;
+    }
+    return std::nullopt;
+  }
+
+  auto release(uint32_t offset, uint32_t size) -> void {
+    free_total_ += size;
+    auto next = free_.lower_bound(offset);
+    if (next != free_.end() && next->first == offset + size) {
+      size += next->second;
+      next = free_.erase(next);
+    }
+    if (next != free_.begin()) {
+      auto prev = std::prev(next);
+      if (prev->first + prev->second == offset) {
+        prev->second += size;
+        return;
+      }
+    }
+    free_[offset] = size;
+  }
+
+  auto freeTotal() const -> uint32_t { return free_total_; }
+
+  auto largestFree() const -> uint32_t {
+    uint32_t largest = 0;
+    for (const auto& [offset, size] : free_) {
+      largest = std::max(largest, size);
+    }
+    return largest;
+  }
+
+  auto blocks() const -> uint32_t { return static_cast<uint32_t>(free_.size()); }
+
+ private:
+  std::map<uint32_t, uint32_t> free_;
+  uint32_t free_total_ = 0;
+};
+
+class GeometryPoolImpl {
+ public:
+  static constexpr GLuint kInstanceAttribBegin = 8;
+  static constexpr GLuint kInstanceAttribCount = 8;
+
+  struct Mesh {
+    uint32_t vertex_offset = 0;
+    uint32_t vertex_count = 0;
+    uint32_t index_offset = 0;
+    uint32_t index_count = 0;
+    bool alive = false;
+  };
+
+  struct Draw {
+    MeshId mesh;
+    uint32_t first_instance;
+    uint32_t instance_count;
+  };
+
+  explicit GeometryPoolImpl(const GeometryPoolOptions& options)
+      : options_(options), stride_(static_cast<uint32_t>(sizeof(GLfloat)) * (3 + options.other_data_num * 3)) {}
+
+  ~GeometryPoolImpl() {
+    for (GLuint buffer : {vbo_, ebo_, indirect_buffer_}) {
+      if (buffer != 0) {
+        glDeleteBuffers(1, &buffer);
+      }
+    }
+    if (vao_ != 0) {
+      glDeleteVertexArrays(1, &vao_);
+    }
+  }
+
+  /**
+   * @brief 把存活的网格紧密复制到新容量的缓冲区中，扩容和整理碎片共用
+   * 使用GL_COPY_READ/WRITE_BUFFER，不影响当前绑定的VAO中的EBO
+   */
+  auto relocate(uint32_t vertex_capacity, uint32_t index_capacity) -> void {
+    GL_HWK_TRACE_SCOPE("GeometryPool::relocate");
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < meshes_.size(); ++i) {
+      if (meshes_[i].alive) {
+        order.push_back(i);
+      }
+    }
+
+    GLuint buffers[2];
+    glGenBuffers(2, buffers);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[0]);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(vertex_capacity) * stride_, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, vbo_);
+    // 按原来的偏移排序，保持网格的相对顺序
+    std::sort(order.begin(), order.end(),
+              [this](uint32_t a, uint32_t b) { return meshes_[a].vertex_offset < meshes_[b].vertex_offset; });
+    uint32_t vertex_cursor = 0;
+    for (uint32_t i : order) {
+      auto& mesh = meshes_[i];
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                          static_cast<GLintptr>(mesh.vertex_offset) * stride_,
+                          static_cast<GLintptr>(vertex_cursor) * stride_,
+                          static_cast<GLsizeiptr>(mesh.vertex_count) * stride_);
+      mesh.vertex_offset = vertex_cursor;
+      vertex_cursor += mesh.vertex_count;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[1]);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(index_capacity) * sizeof(GLuint), nullptr,
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, ebo_);
+    std::sort(order.begin(), order.end(),
+              [this](uint32_t a, uint32_t b) { return meshes_[a].index_offset < meshes_[b].index_offset; });
+    uint32_t index_cursor = 0;
+    for (uint32_t i : order) {
+      auto& mesh = meshes_[i];
+      // 索引相对于base_vertex，顶点移动后不需要改写
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, mesh.index_offset * sizeof(GLuint),
+                          index_cursor * sizeof(GLuint), mesh.index_count * sizeof(GLuint));
+      mesh.index_offset = index_cursor;
+      index_cursor += mesh.index_count;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (vbo_ != 0) {
+      glDeleteBuffers(1, &vbo_);
+      glDeleteBuffers(1, &ebo_);
+    }
+    vbo_ = buffers[0];
+    ebo_ = buffers[1];
+    vertex_capacity_ = vertex_capacity;
+    index_capacity_ = index_capacity;
+    vertices_.reset(vertex_cursor, vertex_capacity);
+    indices_.reset(index_cursor, index_capacity);
+    setupVertexArray();
+    stats_.relocations++;
+  }
+
+  /**
+   * @brief 顶点属性与PrimitiveBuilder相同：location 0为位置，1开始为other data
+   */
+  auto setupVertexArray() -> void {
+    if (vao_ == 0) {
+      glGenVertexArrays(1, &vao_);
+    }
+    glBindVertexArray(vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride_, (void*)0);
+    glEnableVertexAttribArray(0);
+    for (uint32_t i = 0; i < options_.other_data_num; ++i) {
+      glVertexAttribPointer(1 + i, 3, GL_FLOAT, GL_FALSE, stride_, (void*)((3 + i * 3) * sizeof(float)));
+      glEnableVertexAttribArray(1 + i);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // 实例属性需要重新设置
+    instance_vbo_ = 0;
+  }
+
+  /**
+   * @brief 实例数据占用location 8~15，与PrimitiveBuilder::drawInstanced相同；offset用于不支持base_instance时逐条绘制
+   */
+  auto bindInstances(GLuint instance_vbo, GLuint first_instance) -> void {
+    glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    for (GLuint i = 0; i < kInstanceAttribCount; ++i) {
+      GLuint location = kInstanceAttribBegin + i;
+      glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                            (void*)(first_instance * sizeof(InstanceData) + i * sizeof(glm::vec4)));
+      glVertexAttribDivisor(location, 1);
+      glEnableVertexAttribArray(location);
+    }
+    RenderStats::instance().addStateChange(1 + kInstanceAttribCount * 3);
+  }
+
+  auto multiDrawSupported() const -> bool {
+    // base_instance需要GL 4.2或ARB_base_instance，否则间接命令中的base_instance必须为0
+    return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+  }
+
+  GeometryPoolOptions options_;
+  // 每个顶点的字节数
+  uint32_t stride_;
+  GLuint vao_ = 0;
+  GLuint vbo_ = 0;
+  GLuint ebo_ = 0;
+  GLuint indirect_buffer_ = 0;
+  size_t indirect_capacity_ = 0;
+  // VAO中实例属性指向的缓冲区，改变时才重新设置
+  GLuint instance_vbo_ = 0;
+  uint32_t vertex_capacity_ = 0;
+  uint32_t index_capacity_ = 0;
+  RangeAllocator vertices_;
+  RangeAllocator indices_;
+
+  std::vector<Mesh> meshes_;
+  std::vector<MeshId> free_ids_;
+  std::vector<Draw> draws_;
+  std::vector<DrawElementsIndirectCommand> commands_;
+  GeometryPoolStats stats_;
+};
+
+GeometryPool::GeometryPool(const GeometryPoolOptions& options) : impl_(make_unique_impl<GeometryPoolImpl>(options)) {}
+
+// 在GeometryPoolImpl完整定义处析构，释放缓冲区
+GeometryPool::~GeometryPool() = default;
+
+auto GeometryPool::addMesh(const std::vector<glm::vec3>& positions, const std::vector<GLsizei>& indices,
+                           const std::vector<std::vector<float>>& other_data) -> MeshId {
+  GL_HWK_TRACE_SCOPE("GeometryPool::addMesh");
+  auto& impl = *impl_;
+  uint32_t other_data_num = other_data.empty() ? 0 : static_cast<uint32_t>(other_data.front().size() / 3);
+  if (positions.empty() || other_data_num != impl.options_.other_data_num ||
+      (other_data_num > 0 && other_data.size() < positions.size())) {
+    fmt::print("GeometryPool: vertex format mismatch, expected {} other data\n", impl.options_.other_data_num);
+    return kInvalidMesh;
+  }
+  if (impl.vbo_ == 0) {
+    impl.relocate(impl.options_.vertex_capacity, impl.options_.index_capacity);
+  }
+
+  auto vertex_count = static_cast<uint32_t>(positions.size());
+  auto index_count = static_cast<uint32_t>(indices.empty() ? positions.size() : indices.size());
+  auto vertex_offset = impl.vertices_.allocate(vertex_count);
+  auto index_offset = impl.indices_.allocate(index_count);
+  if (!vertex_offset || !index_offset) {
+    if (vertex_offset) {
+      impl.vertices_.release(*vertex_offset, vertex_count);
+    }
+    if (index_offset) {
+      impl.indices_.release(*index_offset, index_count);
+    }
+    // 空闲总量足够时只整理碎片，否则扩容，两者都会紧密排列
+    uint32_t vertex_capacity = std::max(impl.vertex_capacity_, 1u);
+    while (impl.vertices_.freeTotal() + (vertex_capacity - impl.vertex_capacity_) < vertex_count) {
+      vertex_capacity *= 2;
+    }
+    uint32_t index_capacity = std::max(impl.index_capacity_, 1u);
+    while (impl.indices_.freeTotal() + (index_capacity - impl.index_capacity_) < index_count) {
+      index_capacity *= 2;
+    }
+    impl.relocate(vertex_capacity, index_capacity);
+    vertex_offset = impl.vertices_.allocate(vertex_count);
+    index_offset = impl.indices_.allocate(index_count);
+  }
+
+  std::vector<GLfloat> vertices_data;
+  vertices_data.reserve(static_cast<size_t>(vertex_count) * impl.stride_ / sizeof(GLfloat));
+  for (size_t i = 0; i < positions.size(); ++i) {
+    vertices_data.emplace_back(positions[i].x);
+    vertices_data.emplace_back(positions[i].y);
+    vertices_data.emplace_back(positions[i].z);
+    for (size_t j = 0; j < other_data_num * 3; ++j) {
+      vertices_data.emplace_back(other_data[i][j]);
+    }
+  }
+  std::vector<GLuint> indices_data(index_count);
+  if (indices.empty()) {
+    std::iota(indices_data.begin(), indices_data.end(), 0u);
+  } else {
+    std::copy(indices.begin(), indices.end(), indices_data.begin());
+  }
+
+  uint64_t vertex_bytes = sizeof(GLfloat) * vertices_data.size();
+  uint64_t index_bytes = sizeof(GLuint) * indices_data.size();
+  glBindBuffer(GL_COPY_WRITE_BUFFER, impl.vbo_);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(*vertex_offset) * impl.stride_, vertex_bytes,
+                  vertices_data.data());
+  glBindBuffer(GL_COPY_WRITE_BUFFER, impl.ebo_);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, *index_offset * sizeof(GLuint), index_bytes, indices_data.data());
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  RenderStats::instance().addBufferUpload(vertex_bytes + index_bytes);
+  RenderStats::instance().addPrimitive(1, static_cast<int64_t>(vertex_bytes + index_bytes));
+
+  MeshId id;
+  if (!impl.free_ids_.empty()) {
+    id = impl.free_ids_.back();
+    impl.free_ids_.pop_back();
+  } else {
+    id = static_cast<MeshId>(impl.meshes_.size());
+    impl.meshes_.emplace_back();
+  }
+  impl.meshes_[id] = {*vertex_offset, vertex_count, *index_offset, index_count, true};
+  return id;
+}
+
+auto GeometryPool::removeMesh(MeshId id) -> void {
+  auto& impl = *impl_;
+  if (id >= impl.meshes_.size() || !impl.meshes_[id].alive) {
+    fmt::print("GeometryPool: invalid mesh {}\n", id);
+    return;
+  }
+  auto& mesh = impl.meshes_[id];
+  impl.vertices_.release(mesh.vertex_offset, mesh.vertex_count);
+  impl.indices_.release(mesh.index_offset, mesh.index_count);
+  uint64_t bytes = static_cast<uint64_t>(mesh.vertex_count) * impl.stride_ + mesh.index_count * sizeof(GLuint);
+  RenderStats::instance().addPrimitive(-1, -static_cast<int64_t>(bytes));
+  mesh.alive = false;
+  impl.free_ids_.push_back(id);
+}
+
+auto GeometryPool::defragment() -> void {
+  if (impl_->vbo_ != 0) {
+    impl_->relocate(impl_->vertex_capacity_, impl_->index_capacity_);
+  }
+}
+
+auto GeometryPool::getFragmentation() -> float {
+  auto fragmentation = [](const RangeAllocator& allocator) {
+    return allocator.freeTotal() == 0
+               ? 0.0f
+               : 1.0f - static_cast<float>(allocator.largestFree()) / static_cast<float>(allocator.freeTotal());
+  };
+  return std::max(fragmentation(impl_->vertices_), fragmentation(impl_->indices_));
+}
+
+auto GeometryPool::addDraw(MeshId id, uint32_t first_instance, uint32_t instance_count) -> void {
+  impl_->draws_.push_back({id, first_instance, instance_count});
+}
+
+auto GeometryPool::clearDraws() -> void { impl_->draws_.clear(); }
+
+auto GeometryPool::draw(InstanceBuffer& instances) -> void {
+  GL_HWK_TRACE_SCOPE("GeometryPool::draw");
+  auto& impl = *impl_;
+  if (impl.draws_.empty() || impl.vao_ == 0) {
+    return;
+  }
+  if (instances.getBuffer() == 0) {
+    fmt::print("GeometryPool: instance buffer not uploaded\n");
+    return;
+  }
+
+  // 命令在提交时生成，addDraw之后的整理碎片不会使命令失效
+  impl.commands_.clear();
+  uint64_t vertices = 0;
+  for (const auto& draw : impl.draws_) {
+    if (draw.mesh >= impl.meshes_.size() || !impl.meshes_[draw.mesh].alive || draw.instance_count == 0) {
+      continue;
+    }
+    const auto& mesh = impl.meshes_[draw.mesh];
+    impl.commands_.push_back({mesh.index_count, draw.instance_count, mesh.index_offset,
+                              static_cast<GLint>(mesh.vertex_offset), draw.first_instance});
+    vertices += static_cast<uint64_t>(mesh.index_count) * draw.instance_count;
+  }
+  impl.stats_.draw_commands = static_cast<uint32_t>(impl.commands_.size());
+  if (impl.commands_.empty()) {
+    return;
+  }
+
+  GpuProfileScope scope("geometry_pool");
+  auto& stats = RenderStats::instance();
+  glBindVertexArray(impl.vao_);
+  stats.addStateChange();
+  if (impl.multiDrawSupported()) {
+    if (impl.instance_vbo_ != instances.getBuffer()) {
+      impl.bindInstances(instances.getBuffer(), 0);
+      impl.instance_vbo_ = instances.getBuffer();
+    }
+    if (impl.indirect_buffer_ == 0) {
+      glGenBuffers(1, &impl.indirect_buffer_);
+    }
+    size_t bytes = sizeof(DrawElementsIndirectCommand) * impl.commands_.size();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, impl.indirect_buffer_);
+    if (impl.commands_.size() > impl.indirect_capacity_) {
+      impl.indirect_capacity_ = impl.commands_.size();
+      glBufferData(GL_DRAW_INDIRECT_BUFFER, bytes, impl.commands_.data(), GL_STREAM_DRAW);
+    } else {
+      // orphan旧的存储，避免等待上一帧的绘制
+      glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand) * impl.indirect_capacity_, nullptr,
+                   GL_STREAM_DRAW);
+      glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, bytes, impl.commands_.data());
+    }
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(impl.commands_.size()),
+                                0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    stats.addBufferUpload(bytes);
+    stats.addStateChange(2);
+    // 所有命令只有一次draw call，三角形数按命令累加
+    stats.addDrawCall(GL_TRIANGLES, static_cast<GLsizei>(vertices));
+  } else {
+    // 没有base_instance，逐条命令移动实例属性的起点
+    for (const auto& command : impl.commands_) {
+      impl.bindInstances(instances.getBuffer(), command.base_instance);
+      glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+                                        (void*)(command.first_index * sizeof(GLuint)), command.instance_count,
+                                        command.base_vertex);
+      stats.addDrawCall(GL_TRIANGLES, command.count, command.instance_count);
+    }
+    impl.instance_vbo_ = 0;
+  }
+  glBindVertexArray(0);
+}
+
+auto GeometryPool::getStats() -> GeometryPoolStats {
+  auto& impl = *impl_;
+  auto stats = impl.stats_;
+  stats.meshes = static_cast<uint32_t>(impl.meshes_.size() - impl.free_ids_.size());
+  stats.vertex_capacity = impl.vertex_capacity_;
+  stats.vertices_used = impl.vertex_capacity_ - impl.vertices_.freeTotal();
+  stats.index_capacity = impl.index_capacity_;
+  stats.indices_used = impl.index_capacity_ - impl.indices_.freeTotal();
+  stats.free_blocks = impl.vertices_.blocks() + impl.indices_.blocks();
+  return stats;
+}
+
+}  // namespace gl_hwk
@@ -0,0 +1,293 @@
+#include "gl_homework/gpu_profiler.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+// third party
+#include <fmt/core.h>
+// clang-format on
+
+namespace gl_hwk {
+
+struct PendingQuery {
+  uint32_t scope;
+  GLuint query;
+};
+
+struct FrameQueries {
+  std::vector<PendingQuery> queries;
+  bool in_flight = false;
+};
+
+// 每个scope最近kHistorySize帧的耗时，环形存储
+struct ScopeHistory {
+  std::string name;
+  std::vector<double> samples;
+  size_t next = 0;
+  double last_ms = 0.0;
+};
+
+class GpuProfilerImpl {
+ public:
+  // 查询结果延迟kFrameLatency帧读取
+  static constexpr size_t kFrameLatency = 4;
+  static constexpr size_t kHistorySize = 512;
+
+  GpuProfilerImpl() = default;
+
+  auto acquireQuery() -> GLuint {
+    if (free_queries_.empty()) {
+      GLuint query;
+      glGenQueries(1, &query);
+      return query;
+    }
+    GLuint query = free_queries_.back();
+    free_queries_.pop_back();
+    return query;
+  }
+
+  auto scopeIndex(const std::string& name) -> uint32_t {
+    auto it = scope_indices_.find(name);
+    if (it != scope_indices_.end()) {
+      return it->second;
+    }
+    auto idx = static_cast<uint32_t>(scopes_.size());
+    scope_indices_.emplace(name, idx);
+    scopes_.push_back({name, {}, 0, 0.0});
+    return idx;
+  }
+
+  /**
+   * @brief 字符串常量按地址缓存scope编号，每帧打开scope时不需要构造std::string
+   */
+  auto scopeIndex(const char* name) -> uint32_t {
+    auto it = literal_indices_.find(name);
+    if (it != literal_indices_.end()) {
+      return it->second;
+    }
+    auto idx = scopeIndex(std::string(name));
+    literal_indices_.emplace(name, idx);
+    return idx;
+  }
+
+  template <typename Name>
+  auto beginScope(const Name& name) -> void {
+    if (!in_frame_) {
+      return;
+    }
+    if (depth_++ > 0) {
+      return;
+    }
+    GLuint query = acquireQuery();
+    auto& frame = frames_[frame_index_ % kFrameLatency];
+    frame.queries.push_back({scopeIndex(name), query});
+    glBeginQuery(GL_TIME_ELAPSED, query);
+  }
+
+  /**
+   * @brief 读取一帧的查询结果，同一帧内同名scope的耗时累加
+   * @param wait 结果未就绪时是否等待
+   * @return 是否已读取
+   */
+  auto collect(FrameQueries& frame, bool wait) -> bool {
+    if (!frame.in_flight) {
+      return true;
+    }
+    // 查询按提交顺序完成，最后一个就绪则整帧就绪
+    if (!wait) {
+      GLint available = 0;
+      glGetQueryObjectiv(frame.queries.back().query, GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available) {
+        return false;
+      }
+    }
+
+    frame_totals_.assign(scopes_.size(), 0);
+    frame_hits_.assign(scopes_.size(), false);
+    for (const auto& pending : frame.queries) {
+      GLuint64 elapsed_ns = 0;
+      glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &elapsed_ns);
+      frame_totals_[pending.scope] += elapsed_ns;
+      frame_hits_[pending.scope] = true;
+      free_queries_.push_back(pending.query);
+    }
+    for (size_t i = 0; i < scopes_.size(); ++i) {
+      if (frame_hits_[i]) {
+        record(scopes_[i], static_cast<double>(frame_totals_[i]) * 1e-6);
+      }
+    }
+    frame.queries.clear();
+    frame.in_flight = false;
+    return true;
+  }
+
+  auto record(ScopeHistory& history, double ms) -> void {
+    if (history.samples.size() < kHistorySize) {
+      history.samples.push_back(ms);
+    } else {
+      history.samples[history.next] = ms;
+    }
+    history.next = (history.next + 1) % kHistorySize;
+    history.last_ms = ms;
+  }
+
+  auto checkSupport() -> bool {
+    if (!supported_checked_) {
+      supported_ = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+      supported_checked_ = true;
+      if (!supported_) {
+        fmt::print("GpuProfiler: GL_TIME_ELAPSED query is not supported, profiler disabled\n");
+      }
+    }
+    return supported_;
+  }
+
+  bool requested_enabled_ = false;
+  bool enabled_ = false;
+  bool supported_checked_ = false;
+  bool supported_ = false;
+  bool in_frame_ = false;
+  int depth_ = 0;
+  size_t frame_index_ = 0;
+  std::array<FrameQueries, kFrameLatency> frames_;
+  std::vector<GLuint> free_queries_;
+  std::unordered_map<std::string, uint32_t> scope_indices_;
+  std::unordered_map<const char*, uint32_t> literal_indices_;
+  std::vector<ScopeHistory> scopes_;
+  std::vector<GLuint64> frame_totals_;
+  std::vector<bool> frame_hits_;
+};
+
+GpuProfiler::GpuProfiler() : impl_(make_unique_impl<GpuProfilerImpl>()) {}
+
+auto GpuProfiler::instance() -> GpuProfiler& {
+  static GpuProfiler instance;
+  return instance;
+}
+
+auto GpuProfiler::setEnabled(bool enable) -> void { impl_->requested_enabled_ = enable; }
+
+auto GpuProfiler::isEnabled() -> bool { return impl_->enabled_; }
+
+auto GpuProfiler::beginFrame() -> void {
+  impl_->enabled_ = impl_->requested_enabled_ && impl_->checkSupport();
+  // 关闭后仍需回收已提交的查询
+  auto& frame = impl_->frames_[impl_->frame_index_ % GpuProfilerImpl::kFrameLatency];
+  impl_->collect(frame, true);
+  // 顺便读取已经就绪的更早的帧
+  for (size_t i = 1; i < GpuProfilerImpl::kFrameLatency; ++i) {
+    auto& older = impl_->frames_[(impl_->frame_index_ + i) % GpuProfilerImpl::kFrameLatency];
+    if (!impl_->collect(older, false)) {
+      break;
+    }
+  }
+  impl_->in_frame_ = impl_->enabled_;
+  impl_->depth_ = 0;
+}
+
+auto GpuProfiler::endFrame() -> void {
+  if (!impl_->in_frame_) {
+    return;
+  }
+  if (impl_->depth_ > 0) {
+    fmt::print("GpuProfiler: {} scope(s) not closed at end of frame\n", impl_->depth_);
+    glEndQuery(GL_TIME_ELAPSED);
+    impl_->depth_ = 0;
+  }
+  auto& frame = impl_->frames_[impl_->frame_index_ % GpuProfilerImpl::kFrameLatency];
+  frame.in_flight = !frame.queries.empty();
+  impl_->frame_index_++;
+  impl_->in_frame_ = false;
+}
+
+auto GpuProfiler::beginScope(const std::string& name) -> void { impl_->beginScope(name); }
+
+auto GpuProfiler::beginScope(const char* name) -> void { impl_->beginScope(name); }
+
+auto GpuProfiler::endScope() -> void {
+  if (!impl_->in_frame_ || impl_->depth_ == 0) {
+    return;
+  }
+  if (--impl_->depth_ == 0) {
+    glEndQuery(GL_TIME_ELAPSED);
+  }
+}
+
+auto GpuProfiler::getReport() -> std::vector<GpuScopeStats> {
+  std::vector<GpuScopeStats> report;
+  std::vector<double> sorted;
+  for (const auto& history : impl_->scopes_) {
+    if (history.samples.empty()) {
+      continue;
+    }
+    GpuScopeStats stats;
+    stats.name = history.name;
+    stats.samples = static_cast<uint32_t>(history.samples.size());
+    stats.last_ms = history.last_ms;
+    stats.min_ms = std::numeric_limits<double>::max();
+    double sum = 0.0;
+    for (double ms : history.samples) {
+      stats.min_ms = std::min(stats.min_ms, ms);
+      sum += ms;
+    }
+    stats.avg_ms = sum / history.samples.size();
+
+    sorted = history.samples;
+    size_t p99_idx = std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * 0.99));
+    std::nth_element(sorted.begin(), sorted.begin() + p99_idx, sorted.end());
+    stats.p99_ms = sorted[p99_idx];
+    report.push_back(std::move(stats));
+  }
+  return report;
+}
+
+auto GpuProfiler::reset() -> void {
+  // 先读取在途帧的查询，避免reset之前提交的scope计入之后的统计
+  for (auto& frame : impl_->frames_) {
+    impl_->collect(frame, true);
+  }
+  for (auto& history : impl_->scopes_) {
+    history.samples.clear();
+    history.next = 0;
+    history.last_ms = 0.0;
+  }
+}
+
+auto GpuProfiler::exportCsv(const std::string& path) -> bool {
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    fmt::print("GpuProfiler: Failed to open file: {}\n", path);
+    return false;
+  }
+  file << "name,samples,last_ms,min_ms,avg_ms,p99_ms\n";
+  for (const auto& stats : getReport()) {
+    file << fmt::format("{},{},{:.4f},{:.4f},{:.4f},{:.4f}\n", stats.name, stats.samples, stats.last_ms, stats.min_ms,
+                        stats.avg_ms, stats.p99_ms);
+  }
+  return true;
+}
+
+auto GpuProfiler::exportJson(const std::string& path) -> bool {
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    fmt::print("GpuProfiler: Failed to open file: {}\n", path);
+    return false;
+  }
+  auto report = getReport();
+  file << "{\n  \"scopes\": [";
+  for (size_t i = 0; i < report.size(); ++i) {
+    const auto& stats = report[i];
+    file << fmt::format(
+        "{}\n    {{\"name\": \"{}\", \"samples\": {}, \"last_ms\": {:.4f}, \"min_ms\": {:.4f}, \"avg_ms\": {:.4f}, "
+        "\"p99_ms\": {:.4f}}}",
+        i == 0 ? "" : ",", stats.name, stats.samples, stats.last_ms, stats.min_ms, stats.avg_ms, stats.p99_ms);
+  }
+  file << "\n  ]\n}\n";
+  return true;
+}
+
+}  // namespace gl_hwk
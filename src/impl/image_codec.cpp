@@ -0,0 +1,2035 @@
+#include "gl_homework/image_codec.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+// third party
+#include <fmt/core.h>
+#ifdef GL_HWK_WITH_OPENCV
+#include <opencv2/opencv.hpp>
+#endif
+// project
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GL_HWK_SIMD_X86 1
+#define GL_HWK_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_M_X64)
+// MSVC没有按函数指定指令集的方式，只使用x64必定支持的SSE2
+#define GL_HWK_SIMD_X86 1
+#define GL_HWK_SIMD_NO_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace gl_hwk {
+
+namespace {
+
+auto readBigEndian16(const uint8_t* p) -> uint32_t { return (static_cast<uint32_t>(p[0]) << 8) | p[1]; }
+
+auto readBigEndian32(const uint8_t* p) -> uint32_t {
+  return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+auto writeBigEndian32(uint8_t* p, uint32_t value) -> void {
+  p[0] = static_cast<uint8_t>(value >> 24);
+  p[1] = static_cast<uint8_t>(value >> 16);
+  p[2] = static_cast<uint8_t>(value >> 8);
+  p[3] = static_cast<uint8_t>(value);
+}
+
+auto reverseBits(uint32_t value, int count) -> uint32_t {
+  uint32_t result = 0;
+  for (int i = 0; i < count; ++i) {
+    result = (result << 1) | ((value >> i) & 1);
+  }
+  return result;
+}
+
+auto clampByte(int value) -> uint8_t { return static_cast<uint8_t>(std::clamp(value, 0, 255)); }
+
+/**
+ * @brief CPU支持的最高指令集
+ */
+auto supportedSimdLevel() -> SimdLevel {
+#if defined(GL_HWK_SIMD_X86) && !defined(GL_HWK_SIMD_NO_AVX2)
+  return __builtin_cpu_supports("avx2") ? SimdLevel::kAvx2 : SimdLevel::kSse;
+#elif defined(GL_HWK_SIMD_X86)
+  return SimdLevel::kSse;
+#else
+  return SimdLevel::kScalar;
+#endif
+}
+
+// YCbCr转RGB的定点系数，放大4096倍；SIMD用mulhi计算(cb - 128) * 256 * k >> 16，标量实现按相同的运算保证结果一致
+constexpr int kCrToR = 5743;
+constexpr int kCbToG = -1410;
+constexpr int kCrToG = -2925;
+constexpr int kCbToB = 7258;
+
+auto ycbcrToRgbScalar(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* out, uint32_t count,
+                      uint32_t channels) -> void {
+  for (uint32_t i = 0; i < count; ++i) {
+    const int luma = (y[i] << 4) + 8;
+    const int cbw = (cb[i] - 128) * 256;
+    const int crw = (cr[i] - 128) * 256;
+    uint8_t* pixel = out + i * channels;
+    pixel[0] = clampByte((luma + ((crw * kCrToR) >> 16)) >> 4);
+    pixel[1] = clampByte((luma + ((cbw * kCbToG) >> 16) + ((crw * kCrToG) >> 16)) >> 4);
+    pixel[2] = clampByte((luma + ((cbw * kCbToB) >> 16)) >> 4);
+    if (channels == 4) {
+      pixel[3] = 255;
+    }
+  }
+}
+
+#ifdef GL_HWK_SIMD_X86
+auto ycbcrToRgbSse(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* out, uint32_t count,
+                   uint32_t channels) -> void {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i half = _mm_set1_epi16(128);
+  const __m128i luma_bias = _mm_set1_epi16(8);
+  const __m128i alpha = _mm_set1_epi16(255);
+  const __m128i cr_r = _mm_set1_epi16(kCrToR);
+  const __m128i cb_g = _mm_set1_epi16(kCbToG);
+  const __m128i cr_g = _mm_set1_epi16(kCrToG);
+  const __m128i cb_b = _mm_set1_epi16(kCbToB);
+  alignas(16) uint8_t rgba[32];
+  uint32_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i luma = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + i));
+    __m128i cbw = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(cb + i));
+    __m128i crw = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(cr + i));
+    luma = _mm_add_epi16(_mm_slli_epi16(_mm_unpacklo_epi8(luma, zero), 4), luma_bias);
+    cbw = _mm_slli_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(cbw, zero), half), 8);
+    crw = _mm_slli_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(crw, zero), half), 8);
+    __m128i r = _mm_srai_epi16(_mm_add_epi16(luma, _mm_mulhi_epi16(crw, cr_r)), 4);
+    __m128i g = _mm_srai_epi16(
+        _mm_add_epi16(_mm_add_epi16(luma, _mm_mulhi_epi16(cbw, cb_g)), _mm_mulhi_epi16(crw, cr_g)), 4);
+    __m128i b = _mm_srai_epi16(_mm_add_epi16(luma, _mm_mulhi_epi16(cbw, cb_b)), 4);
+    // 饱和到8位后交错为RGBA
+    __m128i rb = _mm_packus_epi16(r, b);
+    __m128i ga = _mm_packus_epi16(g, alpha);
+    __m128i rg = _mm_unpacklo_epi8(rb, ga);
+    __m128i ba = _mm_unpackhi_epi8(rb, ga);
+    __m128i p0 = _mm_unpacklo_epi16(rg, ba);
+    __m128i p1 = _mm_unpackhi_epi16(rg, ba);
+    if (channels == 4) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), p0);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4 + 16), p1);
+    } else {
+      // SSE2没有字节重排，RGB经过临时缓冲区去掉alpha
+      _mm_store_si128(reinterpret_cast<__m128i*>(rgba), p0);
+      _mm_store_si128(reinterpret_cast<__m128i*>(rgba + 16), p1);
+      for (uint32_t k = 0; k < 8; ++k) {
+        std::memcpy(out + (i + k) * 3, rgba + k * 4, 3);
+      }
+    }
+  }
+  ycbcrToRgbScalar(y + i, cb + i, cr + i, out + i * channels, count - i, channels);
+}
+
+#ifndef GL_HWK_SIMD_NO_AVX2
+GL_HWK_TARGET_AVX2 auto ycbcrToRgbAvx2(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* out,
+                                       uint32_t count, uint32_t channels) -> void {
+  const __m256i half = _mm256_set1_epi16(128);
+  const __m256i luma_bias = _mm256_set1_epi16(8);
+  const __m256i alpha = _mm256_set1_epi16(255);
+  const __m256i cr_r = _mm256_set1_epi16(kCrToR);
+  const __m256i cb_g = _mm256_set1_epi16(kCbToG);
+  const __m256i cr_g = _mm256_set1_epi16(kCrToG);
+  const __m256i cb_b = _mm256_set1_epi16(kCbToB);
+  // 每个128位通道内把4个RGBA像素压成12字节RGB
+  const __m256i drop_alpha =
+      _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1, 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14,
+                       -1, -1, -1, -1);
+  // RGB每次写16字节只有12字节有效，最后一次写会越过4字节，需要后面还有至少两个像素
+  const uint32_t slack = channels == 3 ? 2 : 0;
+  uint32_t i = 0;
+  for (; i + 16 + slack <= count; i += 16) {
+    __m256i luma = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i)));
+    __m256i cbw = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cb + i)));
+    __m256i crw = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cr + i)));
+    luma = _mm256_add_epi16(_mm256_slli_epi16(luma, 4), luma_bias);
+    cbw = _mm256_slli_epi16(_mm256_sub_epi16(cbw, half), 8);
+    crw = _mm256_slli_epi16(_mm256_sub_epi16(crw, half), 8);
+    __m256i r = _mm256_srai_epi16(_mm256_add_epi16(luma, _mm256_mulhi_epi16(crw, cr_r)), 4);
+    __m256i g = _mm256_srai_epi16(
+        _mm256_add_epi16(_mm256_add_epi16(luma, _mm256_mulhi_epi16(cbw, cb_g)), _mm256_mulhi_epi16(crw, cr_g)), 4);
+    __m256i b = _mm256_srai_epi16(_mm256_add_epi16(luma, _mm256_mulhi_epi16(cbw, cb_b)), 4);
+    // pack和unpack都在128位通道内进行，低通道为像素0-7，高通道为像素8-15
+    __m256i rb = _mm256_packus_epi16(r, b);
+    __m256i ga = _mm256_packus_epi16(g, alpha);
+    __m256i rg = _mm256_unpacklo_epi8(rb, ga);
+    __m256i ba = _mm256_unpackhi_epi8(rb, ga);
+    __m256i lo = _mm256_unpacklo_epi16(rg, ba);
+    __m256i hi = _mm256_unpackhi_epi16(rg, ba);
+    __m256i p0 = _mm256_permute2x128_si256(lo, hi, 0x20);
+    __m256i p1 = _mm256_permute2x128_si256(lo, hi, 0x31);
+    if (channels == 4) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 4), p0);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 4 + 32), p1);
+    } else {
+      p0 = _mm256_shuffle_epi8(p0, drop_alpha);
+      p1 = _mm256_shuffle_epi8(p1, drop_alpha);
+      uint8_t* dst = out + i * 3;
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(p0));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 12), _mm256_extracti128_si256(p0, 1));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 24), _mm256_castsi256_si128(p1));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 36), _mm256_extracti128_si256(p1, 1));
+    }
+  }
+  ycbcrToRgbSse(y + i, cb + i, cr + i, out + i * channels, count - i, channels);
+}
+#endif
+#endif
+
+// ---------------------------------------- JPEG ----------------------------------------
+
+// zigzag顺序到自然顺序，多出的部分让损坏的数据不会越界
+constexpr uint8_t kZigzag[80] = {0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,  12, 19, 26, 33,
+                                 40, 48, 41, 34, 27, 20, 13, 6,  7,  14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36,
+                                 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54,
+                                 47, 55, 62, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63};
+
+constexpr int kJpegFastBits = 9;
+
+struct JpegHuffman {
+  // 码长不超过kJpegFastBits时直接查表：高8位为码长，低8位为符号，0表示需要逐个码长比较
+  std::array<uint16_t, 1 << kJpegFastBits> fast;
+  // 交流系数的码和幅值一共不超过kJpegFastBits位时一次查出：高8位为系数值，4-7位为游程，低4位为总位数
+  std::array<int16_t, 1 << kJpegFastBits> fast_ac;
+  std::array<uint8_t, 256> symbols;
+  // 每个码长的第一个码、最后一个码加一和第一个符号的位置
+  std::array<int32_t, 17> first_code;
+  std::array<int32_t, 17> end_code;
+  std::array<int32_t, 17> first_index;
+};
+
+auto buildJpegHuffman(JpegHuffman& table, const uint8_t* counts, const uint8_t* symbols, uint32_t total) -> bool {
+  table.fast.fill(0);
+  std::copy(symbols, symbols + total, table.symbols.begin());
+  int32_t code = 0;
+  int32_t index = 0;
+  for (int len = 1; len <= 16; ++len) {
+    table.first_code[len] = code;
+    table.first_index[len] = index;
+    for (uint32_t i = 0; i < counts[len - 1]; ++i, ++code, ++index) {
+      if (len <= kJpegFastBits) {
+        const int shift = kJpegFastBits - len;
+        for (int j = 0; j < (1 << shift); ++j) {
+          table.fast[(code << shift) | j] = static_cast<uint16_t>((len << 8) | symbols[index]);
+        }
+      }
+    }
+    table.end_code[len] = code;
+    if (code > (1 << len)) {
+      return false;
+    }
+    code <<= 1;
+  }
+  table.fast_ac.fill(0);
+  for (int i = 0; i < (1 << kJpegFastBits); ++i) {
+    const int len = table.fast[i] >> 8;
+    const int run = (table.fast[i] >> 4) & 0x0F;
+    const int size = table.fast[i] & 0x0F;
+    if (len == 0 || size == 0 || len + size > kJpegFastBits) {
+      continue;
+    }
+    int value = (i << len) & ((1 << kJpegFastBits) - 1);
+    value >>= kJpegFastBits - size;
+    value = value < (1 << (size - 1)) ? value - (1 << size) + 1 : value;
+    if (value >= -128 && value <= 127) {
+      table.fast_ac[i] = static_cast<int16_t>(value * 256 + (run << 4) + len + size);
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief 熵编码数据的位读取，去掉0xFF后填充的0x00，遇到标记后补0
+ */
+struct JpegBitReader {
+  const uint8_t* data;
+  size_t size;
+  size_t pos;
+  uint64_t bits = 0;
+  int count = 0;
+  bool marker = false;
+
+  auto fill() -> void {
+    while (count <= 56) {
+      uint64_t byte = 0;
+      if (!marker && pos < size) {
+        byte = data[pos];
+        if (byte == 0xFF) {
+          if (pos + 1 < size && data[pos + 1] == 0x00) {
+            pos += 2;
+          } else {
+            marker = true;
+            byte = 0;
+          }
+        } else {
+          pos++;
+        }
+      }
+      bits |= byte << (56 - count);
+      count += 8;
+    }
+  }
+
+  auto peek(int n) const -> uint32_t { return static_cast<uint32_t>(bits >> (64 - n)); }
+
+  auto skip(int n) -> void {
+    bits <<= n;
+    count -= n;
+  }
+
+  /**
+   * @brief 紧接在decode之后调用，decode填充的位数足够读取幅值
+   */
+  auto receive(int n) -> int {
+    if (n == 0) {
+      return 0;
+    }
+    int value = static_cast<int>(peek(n));
+    skip(n);
+    // 最高位为0时是负数
+    return value < (1 << (n - 1)) ? value - (1 << n) + 1 : value;
+  }
+
+  auto decode(const JpegHuffman& table) -> int {
+    fill();
+    const uint16_t entry = table.fast[peek(kJpegFastBits)];
+    if (entry != 0) {
+      skip(entry >> 8);
+      return entry & 0xFF;
+    }
+    for (int len = kJpegFastBits + 1; len <= 16; ++len) {
+      const int32_t code = static_cast<int32_t>(peek(len));
+      if (code < table.end_code[len]) {
+        skip(len);
+        return table.symbols[table.first_index[len] + code - table.first_code[len]];
+      }
+    }
+    return -1;
+  }
+
+  /**
+   * @brief 跳过RSTn标记，清空位缓冲
+   */
+  auto restart() -> void {
+    bits = 0;
+    count = 0;
+    marker = false;
+    while (pos + 1 < size) {
+      if (data[pos] == 0xFF && data[pos + 1] >= 0xD0 && data[pos + 1] <= 0xD7) {
+        pos += 2;
+        return;
+      }
+      pos++;
+    }
+  }
+};
+
+// libjpeg islow的整数IDCT，系数放大4096倍
+constexpr auto fixed(float x) -> int { return static_cast<int>(x * 4096.0f + 0.5f); }
+
+struct Idct1d {
+  int t0, t1, t2, t3, x0, x1, x2, x3;
+
+  Idct1d(int s0, int s1, int s2, int s3, int s4, int s5, int s6, int s7) {
+    int p2 = s2;
+    int p3 = s6;
+    int p1 = (p2 + p3) * fixed(0.5411961f);
+    t2 = p1 + p3 * fixed(-1.847759065f);
+    t3 = p1 + p2 * fixed(0.765366865f);
+    p2 = s0;
+    p3 = s4;
+    t0 = (p2 + p3) * 4096;
+    t1 = (p2 - p3) * 4096;
+    x0 = t0 + t3;
+    x3 = t0 - t3;
+    x1 = t1 + t2;
+    x2 = t1 - t2;
+    t0 = s7;
+    t1 = s5;
+    t2 = s3;
+    t3 = s1;
+    p3 = t0 + t2;
+    int p4 = t1 + t3;
+    p1 = t0 + t3;
+    p2 = t1 + t2;
+    int p5 = (p3 + p4) * fixed(1.175875602f);
+    t0 = t0 * fixed(0.298631336f);
+    t1 = t1 * fixed(2.053119869f);
+    t2 = t2 * fixed(3.072711026f);
+    t3 = t3 * fixed(1.501321110f);
+    p1 = p5 + p1 * fixed(-0.899976223f);
+    p2 = p5 + p2 * fixed(-2.562915447f);
+    p3 = p3 * fixed(-1.961570560f);
+    p4 = p4 * fixed(-0.390180644f);
+    t3 += p1 + p4;
+    t2 += p2 + p3;
+    t1 += p2 + p4;
+    t0 += p1 + p3;
+  }
+};
+
+/**
+ * @brief 反量化后的系数(自然顺序)做8x8 IDCT，加128后写入out
+ */
+auto idctBlock(const int32_t* coefficients, uint8_t* out, size_t stride) -> void {
+  int temp[64];
+  // 列变换，只有直流分量的列直接填充
+  for (int i = 0; i < 8; ++i) {
+    const int32_t* d = coefficients + i;
+    int* v = temp + i;
+    if (d[8] == 0 && d[16] == 0 && d[24] == 0 && d[32] == 0 && d[40] == 0 && d[48] == 0 && d[56] == 0) {
+      const int dc = d[0] * 4;
+      for (int k = 0; k < 8; ++k) {
+        v[k * 8] = dc;
+      }
+      continue;
+    }
+    Idct1d idct(d[0], d[8], d[16], d[24], d[32], d[40], d[48], d[56]);
+    idct.x0 += 512;
+    idct.x1 += 512;
+    idct.x2 += 512;
+    idct.x3 += 512;
+    v[0] = (idct.x0 + idct.t3) >> 10;
+    v[56] = (idct.x0 - idct.t3) >> 10;
+    v[8] = (idct.x1 + idct.t2) >> 10;
+    v[48] = (idct.x1 - idct.t2) >> 10;
+    v[16] = (idct.x2 + idct.t1) >> 10;
+    v[40] = (idct.x2 - idct.t1) >> 10;
+    v[24] = (idct.x3 + idct.t0) >> 10;
+    v[32] = (idct.x3 - idct.t0) >> 10;
+  }
+  // 行变换，同时加上128的偏移和舍入
+  for (int i = 0; i < 8; ++i) {
+    const int* v = temp + i * 8;
+    uint8_t* o = out + i * stride;
+    Idct1d idct(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]);
+    const int bias = 65536 + (128 << 17);
+    idct.x0 += bias;
+    idct.x1 += bias;
+    idct.x2 += bias;
+    idct.x3 += bias;
+    o[0] = clampByte((idct.x0 + idct.t3) >> 17);
+    o[7] = clampByte((idct.x0 - idct.t3) >> 17);
+    o[1] = clampByte((idct.x1 + idct.t2) >> 17);
+    o[6] = clampByte((idct.x1 - idct.t2) >> 17);
+    o[2] = clampByte((idct.x2 + idct.t1) >> 17);
+    o[5] = clampByte((idct.x2 - idct.t1) >> 17);
+    o[3] = clampByte((idct.x3 + idct.t0) >> 17);
+    o[4] = clampByte((idct.x3 - idct.t0) >> 17);
+  }
+}
+
+#if defined(GL_HWK_SIMD_X86) && !defined(GL_HWK_SIMD_NO_AVX2)
+GL_HWK_TARGET_AVX2 inline auto mulConst(__m256i a, int k) -> __m256i {
+  return _mm256_mullo_epi32(a, _mm256_set1_epi32(k));
+}
+
+GL_HWK_TARGET_AVX2 inline auto transpose8x8(__m256i* r) -> void {
+  const __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+  const __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+  const __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+  const __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+  const __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+  const __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+  const __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+  const __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+  const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+  const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+  const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+  const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+  const __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+  const __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+  const __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+  const __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+  r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+  r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+  r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+  r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+  r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+  r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+  r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+  r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+/**
+ * @brief 与Idct1d相同的一维变换，每个32位通道独立计算一列(或一行)
+ */
+template <int kShift>
+GL_HWK_TARGET_AVX2 inline auto idctPassAvx2(__m256i* v, int bias) -> void {
+  __m256i p1 = mulConst(_mm256_add_epi32(v[2], v[6]), fixed(0.5411961f));
+  __m256i t2 = _mm256_add_epi32(p1, mulConst(v[6], fixed(-1.847759065f)));
+  __m256i t3 = _mm256_add_epi32(p1, mulConst(v[2], fixed(0.765366865f)));
+  const __m256i even0 = _mm256_add_epi32(_mm256_slli_epi32(_mm256_add_epi32(v[0], v[4]), 12), _mm256_set1_epi32(bias));
+  const __m256i even1 = _mm256_add_epi32(_mm256_slli_epi32(_mm256_sub_epi32(v[0], v[4]), 12), _mm256_set1_epi32(bias));
+  const __m256i x0 = _mm256_add_epi32(even0, t3);
+  const __m256i x3 = _mm256_sub_epi32(even0, t3);
+  const __m256i x1 = _mm256_add_epi32(even1, t2);
+  const __m256i x2 = _mm256_sub_epi32(even1, t2);
+  __m256i t0 = v[7];
+  __m256i t1 = v[5];
+  t2 = v[3];
+  t3 = v[1];
+  __m256i p3 = _mm256_add_epi32(t0, t2);
+  __m256i p4 = _mm256_add_epi32(t1, t3);
+  p1 = _mm256_add_epi32(t0, t3);
+  __m256i p2 = _mm256_add_epi32(t1, t2);
+  const __m256i p5 = mulConst(_mm256_add_epi32(p3, p4), fixed(1.175875602f));
+  t0 = mulConst(t0, fixed(0.298631336f));
+  t1 = mulConst(t1, fixed(2.053119869f));
+  t2 = mulConst(t2, fixed(3.072711026f));
+  t3 = mulConst(t3, fixed(1.501321110f));
+  p1 = _mm256_add_epi32(p5, mulConst(p1, fixed(-0.899976223f)));
+  p2 = _mm256_add_epi32(p5, mulConst(p2, fixed(-2.562915447f)));
+  p3 = mulConst(p3, fixed(-1.961570560f));
+  p4 = mulConst(p4, fixed(-0.390180644f));
+  t3 = _mm256_add_epi32(t3, _mm256_add_epi32(p1, p4));
+  t2 = _mm256_add_epi32(t2, _mm256_add_epi32(p2, p3));
+  t1 = _mm256_add_epi32(t1, _mm256_add_epi32(p2, p4));
+  t0 = _mm256_add_epi32(t0, _mm256_add_epi32(p1, p3));
+  v[0] = _mm256_srai_epi32(_mm256_add_epi32(x0, t3), kShift);
+  v[7] = _mm256_srai_epi32(_mm256_sub_epi32(x0, t3), kShift);
+  v[1] = _mm256_srai_epi32(_mm256_add_epi32(x1, t2), kShift);
+  v[6] = _mm256_srai_epi32(_mm256_sub_epi32(x1, t2), kShift);
+  v[2] = _mm256_srai_epi32(_mm256_add_epi32(x2, t1), kShift);
+  v[5] = _mm256_srai_epi32(_mm256_sub_epi32(x2, t1), kShift);
+  v[3] = _mm256_srai_epi32(_mm256_add_epi32(x3, t0), kShift);
+  v[4] = _mm256_srai_epi32(_mm256_sub_epi32(x3, t0), kShift);
+}
+
+/**
+ * @brief idctBlock的AVX2版本，8列(行)同时计算，结果与标量完全相同
+ */
+GL_HWK_TARGET_AVX2 auto idctBlockAvx2(const int32_t* coefficients, uint8_t* out, size_t stride) -> void {
+  __m256i v[8];
+  for (int i = 0; i < 8; ++i) {
+    v[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(coefficients + i * 8));
+  }
+  idctPassAvx2<10>(v, 512);
+  transpose8x8(v);
+  idctPassAvx2<17>(v, 65536 + (128 << 17));
+  transpose8x8(v);
+  for (int i = 0; i < 8; ++i) {
+    const __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(v[i]), _mm256_extracti128_si256(v[i], 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i * stride), _mm_packus_epi16(words, words));
+  }
+}
+#endif
+
+struct JpegComponent {
+  uint8_t id = 0;
+  uint32_t h = 1;
+  uint32_t v = 1;
+  uint32_t quant = 0;
+  uint32_t dc_table = 0;
+  uint32_t ac_table = 0;
+  int dc_pred = 0;
+  // 实际尺寸和按MCU补齐后的平面尺寸
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t stride = 0;
+  uint32_t rows = 0;
+};
+
+struct JpegFrame {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t count = 0;
+  std::array<JpegComponent, 3> components;
+  uint32_t h_max = 1;
+  uint32_t v_max = 1;
+  uint32_t mcus_x = 0;
+  uint32_t mcus_y = 0;
+  uint32_t restart_interval = 0;
+  // Adobe APP14中的颜色变换，0表示三个分量直接是RGB
+  int adobe_transform = -1;
+  std::array<std::array<uint16_t, 64>, 4> quant;
+  std::array<JpegHuffman, 4> dc;
+  std::array<JpegHuffman, 4> ac;
+};
+
+// ---------------------------------------- PNG ----------------------------------------
+
+constexpr uint8_t kPngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+constexpr uint16_t kLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr uint16_t kDistanceBase[30] = {1,    2,    3,    4,    5,    7,    9,    13,    17,    25,
+                                        33,   49,   65,   97,   129,  193,  257,  385,   513,   769,
+                                        1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr uint8_t kDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                        6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+constexpr uint8_t kCodeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+constexpr int kDeflateFastBits = 9;
+
+struct DeflateHuffman {
+  // 低9位为符号，高位为码长，按读取顺序(位反转后)索引
+  std::array<uint16_t, 1 << kDeflateFastBits> fast;
+  std::array<uint16_t, 16> counts;
+  std::array<int32_t, 16> first_code;
+  std::array<int32_t, 16> first_index;
+  std::array<uint16_t, 288> symbols;
+};
+
+auto buildDeflateHuffman(DeflateHuffman& table, const uint8_t* lengths, uint32_t n) -> bool {
+  table.fast.fill(0);
+  table.counts.fill(0);
+  for (uint32_t i = 0; i < n; ++i) {
+    table.counts[lengths[i]]++;
+  }
+  table.counts[0] = 0;
+  std::array<int32_t, 16> next_code{};
+  int32_t code = 0;
+  int32_t index = 0;
+  for (int len = 1; len < 16; ++len) {
+    code = (code + table.counts[len - 1]) << 1;
+    next_code[len] = code;
+    table.first_code[len] = code;
+    table.first_index[len] = index;
+    index += table.counts[len];
+    if (code + table.counts[len] > (1 << len)) {
+      return false;
+    }
+  }
+  std::array<int32_t, 16> offsets = table.first_index;
+  for (uint32_t symbol = 0; symbol < n; ++symbol) {
+    const int len = lengths[symbol];
+    if (len == 0) {
+      continue;
+    }
+    table.symbols[offsets[len]++] = static_cast<uint16_t>(symbol);
+    const uint32_t reversed = reverseBits(static_cast<uint32_t>(next_code[len]++), len);
+    if (len <= kDeflateFastBits) {
+      for (uint32_t j = reversed; j < (1u << kDeflateFastBits); j += 1u << len) {
+        table.fast[j] = static_cast<uint16_t>((len << 9) | symbol);
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief zlib数据流的解压，输出大小在调用前已知
+ */
+class Inflater {
+ public:
+  Inflater(const uint8_t* data, size_t size, uint8_t* out, size_t out_size)
+      : data_(data), size_(size), out_(out), out_size_(out_size) {}
+
+  auto run() -> bool {
+    if (size_ < 2 || (data_[0] & 0x0F) != 8 || (data_[1] & 0x20) != 0 || readBigEndian16(data_) % 31 != 0) {
+      return false;
+    }
+    pos_ = 2;
+    bool last = false;
+    while (!last) {
+      last = bits(1) != 0;
+      const uint32_t type = bits(2);
+      bool ok = false;
+      if (type == 0) {
+        ok = stored();
+      } else if (type == 1) {
+        ok = fixedTables() && codes();
+      } else if (type == 2) {
+        ok = dynamicTables() && codes();
+      }
+      if (!ok || pos_ > size_ + 8) {
+        return false;
+      }
+    }
+    return out_pos_ == out_size_;
+  }
+
+ private:
+  auto fill() -> void {
+    while (count_ <= 56) {
+      const uint64_t byte = pos_ < size_ ? data_[pos_] : 0;
+      pos_++;
+      bits_ |= byte << count_;
+      count_ += 8;
+    }
+  }
+
+  auto bits(int n) -> uint32_t {
+    fill();
+    const uint32_t value = static_cast<uint32_t>(bits_ & ((1ull << n) - 1));
+    bits_ >>= n;
+    count_ -= n;
+    return value;
+  }
+
+  auto decode(const DeflateHuffman& table) -> int {
+    fill();
+    const uint16_t entry = table.fast[bits_ & ((1u << kDeflateFastBits) - 1)];
+    if (entry != 0) {
+      bits_ >>= entry >> 9;
+      count_ -= entry >> 9;
+      return entry & 0x1FF;
+    }
+    for (int len = kDeflateFastBits + 1; len < 16; ++len) {
+      const int32_t code = static_cast<int32_t>(reverseBits(static_cast<uint32_t>(bits_ & ((1u << len) - 1)), len));
+      const int32_t offset = code - table.first_code[len];
+      if (offset >= 0 && offset < table.counts[len]) {
+        bits_ >>= len;
+        count_ -= len;
+        return table.symbols[table.first_index[len] + offset];
+      }
+    }
+    return -1;
+  }
+
+  auto stored() -> bool {
+    // 丢弃到字节边界
+    bits(count_ & 7);
+    const uint32_t length = bits(16);
+    const uint32_t inverse = bits(16);
+    if ((length ^ 0xFFFF) != inverse || out_pos_ + length > out_size_) {
+      return false;
+    }
+    for (uint32_t i = 0; i < length; ++i) {
+      out_[out_pos_++] = static_cast<uint8_t>(bits(8));
+    }
+    return true;
+  }
+
+  auto fixedTables() -> bool {
+    uint8_t lengths[288 + 30];
+    std::fill(lengths, lengths + 144, 8);
+    std::fill(lengths + 144, lengths + 256, 9);
+    std::fill(lengths + 256, lengths + 280, 7);
+    std::fill(lengths + 280, lengths + 288, 8);
+    std::fill(lengths + 288, lengths + 318, 5);
+    return buildDeflateHuffman(literals_, lengths, 288) && buildDeflateHuffman(distances_, lengths + 288, 30);
+  }
+
+  auto dynamicTables() -> bool {
+    const uint32_t literal_count = bits(5) + 257;
+    const uint32_t distance_count = bits(5) + 1;
+    const uint32_t code_length_count = bits(4) + 4;
+    uint8_t code_lengths[19] = {};
+    for (uint32_t i = 0; i < code_length_count; ++i) {
+      code_lengths[kCodeLengthOrder[i]] = static_cast<uint8_t>(bits(3));
+    }
+    DeflateHuffman code_length_table;
+    if (!buildDeflateHuffman(code_length_table, code_lengths, 19)) {
+      return false;
+    }
+    uint8_t lengths[288 + 32] = {};
+    const uint32_t total = literal_count + distance_count;
+    uint32_t n = 0;
+    while (n < total) {
+      const int symbol = decode(code_length_table);
+      if (symbol < 0) {
+        return false;
+      }
+      if (symbol < 16) {
+        lengths[n++] = static_cast<uint8_t>(symbol);
+        continue;
+      }
+      uint32_t repeat = 0;
+      uint8_t value = 0;
+      if (symbol == 16) {
+        if (n == 0) {
+          return false;
+        }
+        repeat = bits(2) + 3;
+        value = lengths[n - 1];
+      } else if (symbol == 17) {
+        repeat = bits(3) + 3;
+      } else {
+        repeat = bits(7) + 11;
+      }
+      if (n + repeat > total) {
+        return false;
+      }
+      std::fill(lengths + n, lengths + n + repeat, value);
+      n += repeat;
+    }
+    return buildDeflateHuffman(literals_, lengths, literal_count) &&
+           buildDeflateHuffman(distances_, lengths + literal_count, distance_count);
+  }
+
+  auto codes() -> bool {
+    while (true) {
+      const int symbol = decode(literals_);
+      if (symbol < 0) {
+        return false;
+      }
+      if (symbol < 256) {
+        if (out_pos_ >= out_size_) {
+          return false;
+        }
+        out_[out_pos_++] = static_cast<uint8_t>(symbol);
+        continue;
+      }
+      if (symbol == 256) {
+        return true;
+      }
+      if (symbol > 285) {
+        return false;
+      }
+      const uint32_t length = kLengthBase[symbol - 257] + bits(kLengthExtra[symbol - 257]);
+      const int distance_symbol = decode(distances_);
+      if (distance_symbol < 0 || distance_symbol >= 30) {
+        return false;
+      }
+      const uint32_t distance = kDistanceBase[distance_symbol] + bits(kDistanceExtra[distance_symbol]);
+      if (distance > out_pos_ || out_pos_ + length > out_size_) {
+        return false;
+      }
+      // 源和目标可能重叠，逐字节复制
+      const uint8_t* src = out_ + out_pos_ - distance;
+      uint8_t* dst = out_ + out_pos_;
+      for (uint32_t i = 0; i < length; ++i) {
+        dst[i] = src[i];
+      }
+      out_pos_ += length;
+    }
+  }
+
+  const uint8_t* data_;
+  size_t size_;
+  size_t pos_ = 0;
+  uint64_t bits_ = 0;
+  int count_ = 0;
+  uint8_t* out_;
+  size_t out_size_;
+  size_t out_pos_ = 0;
+  DeflateHuffman literals_;
+  DeflateHuffman distances_;
+};
+
+struct PngHeader {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t depth = 0;
+  uint32_t color_type = 0;
+  bool interlaced = false;
+  // 每个像素的样本数
+  uint32_t samples = 0;
+  std::array<uint8_t, 256 * 4> palette{};
+  uint32_t palette_size = 0;
+  // 灰度和RGB图像的tRNS透明色，按原始位深
+  bool has_key = false;
+  std::array<uint32_t, 3> key{};
+  bool has_alpha = false;
+};
+
+auto pngSamples(uint32_t color_type) -> uint32_t {
+  switch (color_type) {
+    case 0:
+    case 3:
+      return 1;
+    case 2:
+      return 3;
+    case 4:
+      return 2;
+    case 6:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief 每行的字节数，不含滤波类型字节
+ */
+auto pngRowBytes(const PngHeader& header, uint32_t width) -> size_t {
+  return (static_cast<size_t>(width) * header.samples * header.depth + 7) / 8;
+}
+
+auto paeth(int a, int b, int c) -> int {
+  const int p = a + b - c;
+  const int pa = std::abs(p - a);
+  const int pb = std::abs(p - b);
+  const int pc = std::abs(p - c);
+  if (pa <= pb && pa <= pc) {
+    return a;
+  }
+  return pb <= pc ? b : c;
+}
+
+/**
+ * @brief 原地还原一行的滤波，prior为上一行(第一行为全0)
+ */
+auto unfilterRow(uint32_t filter, uint8_t* row, const uint8_t* prior, size_t bytes, size_t bpp) -> bool {
+  switch (filter) {
+    case 0:
+      return true;
+    case 1:
+      for (size_t i = bpp; i < bytes; ++i) {
+        row[i] = static_cast<uint8_t>(row[i] + row[i - bpp]);
+      }
+      return true;
+    case 2:
+      for (size_t i = 0; i < bytes; ++i) {
+        row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+      }
+      return true;
+    case 3:
+      for (size_t i = 0; i < bytes; ++i) {
+        const int left = i >= bpp ? row[i - bpp] : 0;
+        row[i] = static_cast<uint8_t>(row[i] + ((left + prior[i]) >> 1));
+      }
+      return true;
+    case 4:
+      for (size_t i = 0; i < bytes; ++i) {
+        const int left = i >= bpp ? row[i - bpp] : 0;
+        const int upper_left = i >= bpp ? prior[i - bpp] : 0;
+        row[i] = static_cast<uint8_t>(row[i] + paeth(left, prior[i], upper_left));
+      }
+      return true;
+    default:
+      return false;
+  }
+}
+
+/**
+ * @brief 第x个像素的第c个样本，位深为16时返回原始16位值
+ */
+auto pngSample(const PngHeader& header, const uint8_t* row, uint32_t x, uint32_t c) -> uint32_t {
+  const size_t index = static_cast<size_t>(x) * header.samples + c;
+  switch (header.depth) {
+    case 8:
+      return row[index];
+    case 16:
+      return readBigEndian16(row + index * 2);
+    default: {
+      const size_t bit = index * header.depth;
+      const uint32_t shift = 8 - header.depth - static_cast<uint32_t>(bit & 7);
+      return (row[bit >> 3] >> shift) & ((1u << header.depth) - 1);
+    }
+  }
+}
+
+/**
+ * @brief 解滤波后的一行转换为RGB/RGBA
+ */
+auto convertPngRow(const PngHeader& header, const uint8_t* row, uint32_t count, uint8_t* out, uint32_t channels)
+    -> void {
+  // 常见的8位RGB/RGBA直接复制或增减alpha
+  if (header.depth == 8 && !header.has_key && (header.color_type == 2 || header.color_type == 6)) {
+    if (header.samples == channels) {
+      std::memcpy(out, row, static_cast<size_t>(count) * channels);
+      return;
+    }
+    for (uint32_t x = 0; x < count; ++x) {
+      const uint8_t* src = row + x * header.samples;
+      uint8_t* dst = out + x * channels;
+      dst[0] = src[0];
+      dst[1] = src[1];
+      dst[2] = src[2];
+      if (channels == 4) {
+        dst[3] = 255;
+      }
+    }
+    return;
+  }
+  // 把低位深的灰度扩展到8位
+  const uint32_t max_value = (1u << header.depth) - 1;
+  auto to8 = [&](uint32_t value) -> uint8_t {
+    return header.depth == 16 ? static_cast<uint8_t>(value >> 8) : static_cast<uint8_t>(value * 255 / max_value);
+  };
+  for (uint32_t x = 0; x < count; ++x) {
+    uint8_t* dst = out + x * channels;
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+    uint8_t a = 255;
+    switch (header.color_type) {
+      case 0: {
+        const uint32_t gray = pngSample(header, row, x, 0);
+        r = g = b = to8(gray);
+        if (header.has_key && gray == header.key[0]) {
+          a = 0;
+        }
+        break;
+      }
+      case 2: {
+        const uint32_t sr = pngSample(header, row, x, 0);
+        const uint32_t sg = pngSample(header, row, x, 1);
+        const uint32_t sb = pngSample(header, row, x, 2);
+        r = to8(sr);
+        g = to8(sg);
+        b = to8(sb);
+        if (header.has_key && sr == header.key[0] && sg == header.key[1] && sb == header.key[2]) {
+          a = 0;
+        }
+        break;
+      }
+      case 3: {
+        const uint32_t index = pngSample(header, row, x, 0);
+        if (index < header.palette_size) {
+          r = header.palette[index * 4];
+          g = header.palette[index * 4 + 1];
+          b = header.palette[index * 4 + 2];
+          a = header.palette[index * 4 + 3];
+        }
+        break;
+      }
+      case 4:
+        r = g = b = to8(pngSample(header, row, x, 0));
+        a = to8(pngSample(header, row, x, 1));
+        break;
+      case 6:
+        r = to8(pngSample(header, row, x, 0));
+        g = to8(pngSample(header, row, x, 1));
+        b = to8(pngSample(header, row, x, 2));
+        a = to8(pngSample(header, row, x, 3));
+        break;
+      default:
+        break;
+    }
+    dst[0] = r;
+    dst[1] = g;
+    dst[2] = b;
+    if (channels == 4) {
+      dst[3] = a;
+    }
+  }
+}
+
+struct Adam7Pass {
+  uint32_t x0, y0, dx, dy;
+};
+constexpr Adam7Pass kAdam7[7] = {{0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4},
+                                 {0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2}};
+
+auto crc32Table() -> const std::array<uint32_t, 256>& {
+  static const std::array<uint32_t, 256> table = [] {
+    std::array<uint32_t, 256> result{};
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k) {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      result[i] = c;
+    }
+    return result;
+  }();
+  return table;
+}
+
+auto crc32(const uint8_t* data, size_t size, uint32_t crc = 0) -> uint32_t {
+  const auto& table = crc32Table();
+  crc = ~crc;
+  for (size_t i = 0; i < size; ++i) {
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+auto adler32(const uint8_t* data, size_t size) -> uint32_t {
+  uint32_t a = 1;
+  uint32_t b = 0;
+  while (size > 0) {
+    // 5552是保证32位累加不溢出的最大块长
+    const size_t block = std::min<size_t>(size, 5552);
+    for (size_t i = 0; i < block; ++i) {
+      a += data[i];
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+    data += block;
+    size -= block;
+  }
+  return (b << 16) | a;
+}
+
+/**
+ * @brief deflate的位输出，低位在前
+ */
+class BitWriter {
+ public:
+  explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+  auto put(uint32_t value, int count) -> void {
+    bits_ |= static_cast<uint64_t>(value) << count_;
+    count_ += count;
+    while (count_ >= 8) {
+      out_.push_back(static_cast<uint8_t>(bits_));
+      bits_ >>= 8;
+      count_ -= 8;
+    }
+  }
+
+  auto flush() -> void {
+    if (count_ > 0) {
+      out_.push_back(static_cast<uint8_t>(bits_));
+    }
+    bits_ = 0;
+    count_ = 0;
+  }
+
+ private:
+  std::vector<uint8_t>& out_;
+  uint64_t bits_ = 0;
+  int count_ = 0;
+};
+
+/**
+ * @brief 按固定哈夫曼码输出字面量/长度符号
+ */
+auto putFixedSymbol(BitWriter& writer, uint32_t symbol) -> void {
+  if (symbol < 144) {
+    writer.put(reverseBits(0x30 + symbol, 8), 8);
+  } else if (symbol < 256) {
+    writer.put(reverseBits(0x190 + symbol - 144, 9), 9);
+  } else if (symbol < 280) {
+    writer.put(reverseBits(symbol - 256, 7), 7);
+  } else {
+    writer.put(reverseBits(0xC0 + symbol - 280, 8), 8);
+  }
+}
+
+auto floorLog2(uint32_t value) -> int {
+  int result = 0;
+  while (value >>= 1) {
+    result++;
+  }
+  return result;
+}
+
+auto putMatch(BitWriter& writer, uint32_t length, uint32_t distance) -> void {
+  if (length == 258) {
+    putFixedSymbol(writer, 285);
+  } else if (length <= 10) {
+    putFixedSymbol(writer, 257 + length - 3);
+  } else {
+    const uint32_t v = length - 3;
+    const int bits = floorLog2(v);
+    putFixedSymbol(writer, 257 + 4 * (bits - 1) + ((v >> (bits - 2)) & 3));
+    writer.put(v & ((1u << (bits - 2)) - 1), bits - 2);
+  }
+  if (distance <= 4) {
+    writer.put(reverseBits(distance - 1, 5), 5);
+  } else {
+    const uint32_t v = distance - 1;
+    const int bits = floorLog2(v);
+    writer.put(reverseBits(2 * bits + ((v >> (bits - 1)) & 1), 5), 5);
+    writer.put(v & ((1u << (bits - 1)) - 1), bits - 1);
+  }
+}
+
+// 超过常见GL_MAX_TEXTURE_SIZE的图片无法作为纹理上传，同时防止损坏的文件头申请过大的内存
+constexpr uint32_t kMaxDimension = 16384;
+
+constexpr uint32_t kDeflateWindow = 32768;
+constexpr uint32_t kHashBits = 15;
+// 每个位置最多比较的候选数，平衡压缩率和编码速度
+constexpr int kMaxChain = 16;
+
+}  // namespace
+
+class ImageCodecImpl {
+ public:
+  ImageCodecImpl() : level_(supportedSimdLevel()) {}
+
+  auto readFile(const std::string& path) -> bool {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+      return false;
+    }
+    const std::streamsize size = file.tellg();
+    file.seekg(0);
+    file_.resize(static_cast<size_t>(size));
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(file_.data()), size));
+  }
+
+  auto readInfo(const uint8_t* data, size_t size, uint32_t& width, uint32_t& height) -> bool {
+    bool found = false;
+    if (size >= 2 && data[0] == 0xFF && data[1] == 0xD8) {
+      found = readJpegInfo(data, size, width, height);
+    } else if (size >= 33 && std::memcmp(data, kPngSignature, 8) == 0) {
+      width = readBigEndian32(data + 16);
+      height = readBigEndian32(data + 20);
+      found = true;
+    }
+    return found && width > 0 && height > 0 && width <= kMaxDimension && height <= kMaxDimension;
+  }
+
+  /**
+   * @brief width和height为readInfo得到的尺寸，文件中实际的尺寸不同时(损坏的文件)解码失败，避免写出缓冲区
+   */
+  auto decode(const uint8_t* data, size_t size, const DecodeOptions& options, uint8_t* pixels, uint32_t width,
+              uint32_t height) -> bool {
+    if (data[0] == 0xFF) {
+      return decodeJpeg(data, size, options, pixels, width, height);
+    }
+    return decodePng(data, size, options, pixels, width, height);
+  }
+
+  auto convertYCbCr(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* out, uint32_t count,
+                    uint32_t channels) -> void {
+    switch (level_) {
+#ifdef GL_HWK_SIMD_X86
+#ifndef GL_HWK_SIMD_NO_AVX2
+      case SimdLevel::kAvx2:
+        ycbcrToRgbAvx2(y, cb, cr, out, count, channels);
+        return;
+#endif
+      case SimdLevel::kSse:
+        ycbcrToRgbSse(y, cb, cr, out, count, channels);
+        return;
+#endif
+      default:
+        ycbcrToRgbScalar(y, cb, cr, out, count, channels);
+        return;
+    }
+  }
+
+  auto readJpegInfo(const uint8_t* data, size_t size, uint32_t& width, uint32_t& height) -> bool;
+  auto decodeJpeg(const uint8_t* data, size_t size, const DecodeOptions& options, uint8_t* pixels, uint32_t width,
+                  uint32_t height) -> bool;
+  auto parseFrame(const uint8_t* segment, uint32_t length) -> bool;
+  auto decodeScan(const uint8_t* data, size_t size, size_t& pos, const uint8_t* segment) -> bool;
+  auto decodeBlock(JpegBitReader& reader, JpegComponent& component, uint8_t* out) -> bool;
+  auto upsampleRow(uint32_t index, uint32_t y) -> const uint8_t*;
+  auto decodePng(const uint8_t* data, size_t size, const DecodeOptions& options, uint8_t* pixels, uint32_t width,
+                 uint32_t height) -> bool;
+  auto deflate(const uint8_t* data, size_t size) -> void;
+
+  SimdLevel level_;
+  // 以下缓冲区在多次解码间复用
+  std::vector<uint8_t> file_;
+  JpegFrame frame_{};
+  std::array<std::vector<uint8_t>, 3> planes_;
+  std::array<std::vector<uint8_t>, 3> upsampled_;
+  std::vector<uint8_t> idat_;
+  std::vector<uint8_t> inflated_;
+  std::vector<uint8_t> row_;
+  std::vector<uint8_t> filtered_;
+  std::vector<uint8_t> compressed_;
+  std::vector<int32_t> head_;
+  std::vector<int32_t> prev_;
+};
+
+auto ImageCodecImpl::readJpegInfo(const uint8_t* data, size_t size, uint32_t& width, uint32_t& height) -> bool {
+  size_t pos = 2;
+  while (pos + 4 <= size) {
+    if (data[pos] != 0xFF) {
+      return false;
+    }
+    const uint8_t marker = data[pos + 1];
+    if (marker == 0xFF) {
+      pos++;
+      continue;
+    }
+    const uint32_t length = readBigEndian16(data + pos + 2);
+    if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+      if (pos + 9 > size) {
+        return false;
+      }
+      height = readBigEndian16(data + pos + 5);
+      width = readBigEndian16(data + pos + 7);
+      return width > 0 && height > 0;
+    }
+    pos += 2 + length;
+  }
+  return false;
+}
+
+auto ImageCodecImpl::parseFrame(const uint8_t* segment, uint32_t length) -> bool {
+  JpegFrame& frame = frame_;
+  if (length < 6 || segment[0] != 8) {
+    fmt::print("ImageCodec: Only 8-bit JPEG is supported\n");
+    return false;
+  }
+  frame.height = readBigEndian16(segment + 1);
+  frame.width = readBigEndian16(segment + 3);
+  frame.count = segment[5];
+  if (frame.width == 0 || frame.height == 0 || (frame.count != 1 && frame.count != 3) ||
+      length < 6 + frame.count * 3) {
+    fmt::print("ImageCodec: Unsupported JPEG frame: {} components\n", frame.count);
+    return false;
+  }
+  frame.h_max = 1;
+  frame.v_max = 1;
+  for (uint32_t i = 0; i < frame.count; ++i) {
+    JpegComponent& component = frame.components[i];
+    component.id = segment[6 + i * 3];
+    component.h = segment[7 + i * 3] >> 4;
+    component.v = segment[7 + i * 3] & 0x0F;
+    component.quant = segment[8 + i * 3] & 0x03;
+    if (component.h == 0 || component.h > 4 || component.v == 0 || component.v > 4) {
+      return false;
+    }
+    frame.h_max = std::max(frame.h_max, component.h);
+    frame.v_max = std::max(frame.v_max, component.v);
+  }
+  frame.mcus_x = (frame.width + frame.h_max * 8 - 1) / (frame.h_max * 8);
+  frame.mcus_y = (frame.height + frame.v_max * 8 - 1) / (frame.v_max * 8);
+  for (uint32_t i = 0; i < frame.count; ++i) {
+    JpegComponent& component = frame.components[i];
+    if (frame.h_max % component.h != 0 || frame.v_max % component.v != 0) {
+      fmt::print("ImageCodec: Unsupported JPEG sampling factors\n");
+      return false;
+    }
+    component.width = (frame.width * component.h + frame.h_max - 1) / frame.h_max;
+    component.height = (frame.height * component.v + frame.v_max - 1) / frame.v_max;
+    component.stride = frame.mcus_x * component.h * 8;
+    component.rows = frame.mcus_y * component.v * 8;
+    planes_[i].resize(static_cast<size_t>(component.stride) * component.rows);
+  }
+  return true;
+}
+
+auto ImageCodecImpl::decodeBlock(JpegBitReader& reader, JpegComponent& component, uint8_t* out) -> bool {
+  int32_t coefficients[64] = {};
+  const auto& quant = frame_.quant[component.quant];
+  const int dc_size = reader.decode(frame_.dc[component.dc_table]);
+  if (dc_size < 0 || dc_size > 16) {
+    return false;
+  }
+  component.dc_pred += reader.receive(dc_size);
+  coefficients[0] = component.dc_pred * quant[0];
+  const JpegHuffman& ac = frame_.ac[component.ac_table];
+  bool has_ac = false;
+  for (int k = 1; k < 64;) {
+    reader.fill();
+    const int16_t fast = ac.fast_ac[reader.peek(kJpegFastBits)];
+    if (fast != 0) {
+      k += (fast >> 4) & 0x0F;
+      reader.skip(fast & 0x0F);
+      if (k > 63) {
+        return false;
+      }
+      coefficients[kZigzag[k]] = (fast >> 8) * quant[k];
+      has_ac = true;
+      k++;
+      continue;
+    }
+    const int rs = reader.decode(ac);
+    if (rs < 0) {
+      return false;
+    }
+    const int run = rs >> 4;
+    const int size = rs & 0x0F;
+    if (size == 0) {
+      // 0xF0跳过16个0，0x00为块结束
+      if (run != 15) {
+        break;
+      }
+      k += 16;
+      continue;
+    }
+    k += run;
+    if (k > 63) {
+      return false;
+    }
+    coefficients[kZigzag[k]] = reader.receive(size) * quant[k];
+    has_ac = true;
+    k++;
+  }
+  if (!has_ac) {
+    // 只有直流分量时IDCT的结果是常数，与完整计算的舍入相同
+    const uint8_t value = clampByte((coefficients[0] * 16384 + 65536 + (128 << 17)) >> 17);
+    for (int y = 0; y < 8; ++y) {
+      std::memset(out + y * component.stride, value, 8);
+    }
+    return true;
+  }
+#if defined(GL_HWK_SIMD_X86) && !defined(GL_HWK_SIMD_NO_AVX2)
+  if (level_ == SimdLevel::kAvx2) {
+    idctBlockAvx2(coefficients, out, component.stride);
+    return true;
+  }
+#endif
+  idctBlock(coefficients, out, component.stride);
+  return true;
+}
+
+auto ImageCodecImpl::decodeScan(const uint8_t* data, size_t size, size_t& pos, const uint8_t* segment) -> bool {
+  JpegFrame& frame = frame_;
+  const uint32_t count = segment[0];
+  if (count == 0 || count > frame.count) {
+    return false;
+  }
+  std::array<uint32_t, 3> indices{};
+  for (uint32_t i = 0; i < count; ++i) {
+    const uint8_t id = segment[1 + i * 2];
+    uint32_t index = 0;
+    while (index < frame.count && frame.components[index].id != id) {
+      index++;
+    }
+    if (index == frame.count) {
+      return false;
+    }
+    indices[i] = index;
+    frame.components[index].dc_table = (segment[2 + i * 2] >> 4) & 0x03;
+    frame.components[index].ac_table = segment[2 + i * 2] & 0x03;
+    frame.components[index].dc_pred = 0;
+  }
+
+  JpegBitReader reader{data, size, pos};
+  uint32_t todo = frame.restart_interval;
+  // 每个MCU之后检查重启间隔，到达时跳过RSTn并重置直流预测
+  auto next_mcu = [&](bool last) -> void {
+    if (frame.restart_interval == 0 || --todo > 0 || last) {
+      return;
+    }
+    reader.restart();
+    for (uint32_t i = 0; i < count; ++i) {
+      frame.components[indices[i]].dc_pred = 0;
+    }
+    todo = frame.restart_interval;
+  };
+
+  if (count == 1) {
+    // 非交错扫描，MCU为单个块
+    JpegComponent& component = frame.components[indices[0]];
+    uint8_t* plane = planes_[indices[0]].data();
+    const uint32_t blocks_x = (component.width + 7) / 8;
+    const uint32_t blocks_y = (component.height + 7) / 8;
+    for (uint32_t by = 0; by < blocks_y; ++by) {
+      for (uint32_t bx = 0; bx < blocks_x; ++bx) {
+        if (!decodeBlock(reader, component, plane + (static_cast<size_t>(by) * 8 * component.stride + bx * 8))) {
+          return false;
+        }
+        next_mcu(by + 1 == blocks_y && bx + 1 == blocks_x);
+      }
+    }
+  } else {
+    for (uint32_t my = 0; my < frame.mcus_y; ++my) {
+      for (uint32_t mx = 0; mx < frame.mcus_x; ++mx) {
+        for (uint32_t i = 0; i < count; ++i) {
+          JpegComponent& component = frame.components[indices[i]];
+          uint8_t* plane = planes_[indices[i]].data();
+          for (uint32_t by = 0; by < component.v; ++by) {
+            for (uint32_t bx = 0; bx < component.h; ++bx) {
+              const size_t row = (static_cast<size_t>(my) * component.v + by) * 8;
+              const size_t col = (static_cast<size_t>(mx) * component.h + bx) * 8;
+              if (!decodeBlock(reader, component, plane + row * component.stride + col)) {
+                return false;
+              }
+            }
+          }
+        }
+        next_mcu(my + 1 == frame.mcus_y && mx + 1 == frame.mcus_x);
+      }
+    }
+  }
+  // 跳过剩余的熵编码数据，停在下一个标记
+  pos = reader.pos;
+  while (pos + 1 < size) {
+    const uint8_t next = data[pos + 1];
+    if (data[pos] == 0xFF && next != 0x00 && (next < 0xD0 || next > 0xD7)) {
+      break;
+    }
+    pos++;
+  }
+  return true;
+}
+
+/**
+ * @brief 把分量的第y行上采样到全分辨率，2x1、1x2和2x2使用与libjpeg相同的三角滤波
+ */
+auto ImageCodecImpl::upsampleRow(uint32_t index, uint32_t y) -> const uint8_t* {
+  const JpegFrame& frame = frame_;
+  const JpegComponent& component = frame.components[index];
+  const uint8_t* plane = planes_[index].data();
+  const uint32_t hs = frame.h_max / component.h;
+  const uint32_t vs = frame.v_max / component.v;
+  if (hs == 1 && vs == 1) {
+    return plane + static_cast<size_t>(y) * component.stride;
+  }
+  uint8_t* out = upsampled_[index].data();
+  const uint32_t near_y = std::min(y / vs, component.height - 1);
+  const uint8_t* near = plane + static_cast<size_t>(near_y) * component.stride;
+  const uint32_t width = component.width;
+  if (hs <= 2 && vs <= 2) {
+    if (vs == 2) {
+      // 奇数行的另一行在下面，偶数行在上面
+      const uint32_t far_y = (y & 1) ? std::min(near_y + 1, component.height - 1) : (near_y == 0 ? 0 : near_y - 1);
+      const uint8_t* far = plane + static_cast<size_t>(far_y) * component.stride;
+      if (hs == 1) {
+        for (uint32_t x = 0; x < width; ++x) {
+          out[x] = static_cast<uint8_t>((3 * near[x] + far[x] + 2) >> 2);
+        }
+        return out;
+      }
+      if (width == 1) {
+        out[0] = out[1] = static_cast<uint8_t>((4 * (3 * near[0] + far[0]) + 8) >> 4);
+        return out;
+      }
+      int last = 3 * near[0] + far[0];
+      int current = last;
+      for (uint32_t x = 0; x < width; ++x) {
+        const int next = x + 1 < width ? 3 * near[x + 1] + far[x + 1] : current;
+        out[x * 2] = static_cast<uint8_t>((3 * current + last + 8) >> 4);
+        out[x * 2 + 1] = static_cast<uint8_t>((3 * current + next + 7) >> 4);
+        last = current;
+        current = next;
+      }
+      return out;
+    }
+    // 2x1
+    if (width == 1) {
+      out[0] = out[1] = near[0];
+      return out;
+    }
+    out[0] = near[0];
+    out[1] = static_cast<uint8_t>((near[0] * 3 + near[1] + 2) >> 2);
+    for (uint32_t x = 1; x + 1 < width; ++x) {
+      out[x * 2] = static_cast<uint8_t>((near[x] * 3 + near[x - 1] + 1) >> 2);
+      out[x * 2 + 1] = static_cast<uint8_t>((near[x] * 3 + near[x + 1] + 2) >> 2);
+    }
+    out[(width - 1) * 2] = static_cast<uint8_t>((near[width - 1] * 3 + near[width - 2] + 1) >> 2);
+    out[(width - 1) * 2 + 1] = near[width - 1];
+    return out;
+  }
+  // 其他采样比例直接复制最近的样本
+  for (uint32_t x = 0; x < frame.width; ++x) {
+    out[x] = near[x / hs];
+  }
+  return out;
+}
+
+auto ImageCodecImpl::decodeJpeg(const uint8_t* data, size_t size, const DecodeOptions& options, uint8_t* pixels,
+                                uint32_t width, uint32_t height) -> bool {
+  GL_HWK_TRACE_SCOPE("ImageCodec::decodeJpeg");
+  JpegFrame& frame = frame_;
+  frame.count = 0;
+  frame.restart_interval = 0;
+  frame.adobe_transform = -1;
+  bool scanned = false;
+  size_t pos = 2;
+  while (pos + 2 <= size) {
+    if (data[pos] != 0xFF) {
+      pos++;
+      continue;
+    }
+    const uint8_t marker = data[pos + 1];
+    pos += 2;
+    if (marker == 0xD9) {
+      break;
+    }
+    if (marker == 0xFF) {
+      pos--;
+      continue;
+    }
+    if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+      continue;
+    }
+    if (pos + 2 > size) {
+      return false;
+    }
+    const uint32_t length = readBigEndian16(data + pos);
+    if (length < 2 || pos + length > size) {
+      fmt::print("ImageCodec: Truncated JPEG segment\n");
+      return false;
+    }
+    const uint8_t* segment = data + pos + 2;
+    const uint32_t segment_length = length - 2;
+    switch (marker) {
+      case 0xDB: {
+        // 量化表，按zigzag顺序保存
+        uint32_t offset = 0;
+        while (offset < segment_length) {
+          const uint32_t precision = segment[offset] >> 4;
+          const uint32_t id = segment[offset] & 0x03;
+          offset++;
+          if (offset + (precision ? 128 : 64) > segment_length) {
+            return false;
+          }
+          for (int k = 0; k < 64; ++k) {
+            frame.quant[id][k] = static_cast<uint16_t>(precision ? readBigEndian16(segment + offset + k * 2)
+                                                                 : segment[offset + k]);
+          }
+          offset += precision ? 128 : 64;
+        }
+        break;
+      }
+      case 0xC4: {
+        uint32_t offset = 0;
+        while (offset + 17 <= segment_length) {
+          const uint32_t table_class = segment[offset] >> 4;
+          const uint32_t id = segment[offset] & 0x03;
+          const uint8_t* counts = segment + offset + 1;
+          uint32_t total = 0;
+          for (int i = 0; i < 16; ++i) {
+            total += counts[i];
+          }
+          if (total > 256 || offset + 17 + total > segment_length) {
+            return false;
+          }
+          auto& table = table_class == 0 ? frame.dc[id] : frame.ac[id];
+          if (!buildJpegHuffman(table, counts, counts + 16, total)) {
+            return false;
+          }
+          offset += 17 + total;
+        }
+        break;
+      }
+      case 0xDD:
+        if (segment_length < 2) {
+          return false;
+        }
+        frame.restart_interval = readBigEndian16(segment);
+        break;
+      case 0xC0:
+      case 0xC1:
+        if (frame.count != 0 || !parseFrame(segment, segment_length) || frame.width != width ||
+            frame.height != height) {
+          fmt::print("ImageCodec: Invalid JPEG frame header\n");
+          return false;
+        }
+        break;
+      case 0xC2:
+      case 0xC3:
+      case 0xC5:
+      case 0xC6:
+      case 0xC7:
+      case 0xC9:
+      case 0xCA:
+      case 0xCB:
+      case 0xCD:
+      case 0xCE:
+      case 0xCF:
+        fmt::print("ImageCodec: Progressive, lossless and arithmetic coded JPEG are not supported\n");
+        return false;
+      case 0xEE:
+        if (segment_length >= 12 && std::memcmp(segment, "Adobe", 5) == 0) {
+          frame.adobe_transform = segment[11];
+        }
+        break;
+      case 0xDA: {
+        if (frame.count == 0 || segment_length < 1 + segment[0] * 2u) {
+          return false;
+        }
+        pos += length;
+        if (!decodeScan(data, size, pos, segment)) {
+          fmt::print("ImageCodec: Corrupt JPEG data\n");
+          return false;
+        }
+        scanned = true;
+        continue;
+      }
+      default:
+        break;
+    }
+    pos += length;
+  }
+  if (!scanned) {
+    return false;
+  }
+
+  const uint32_t channels = options.layout == PixelLayout::kRgba ? 4 : 3;
+  const size_t row_bytes = static_cast<size_t>(frame.width) * channels;
+  for (uint32_t i = 0; i < frame.count; ++i) {
+    upsampled_[i].resize(static_cast<size_t>(frame.width) + 2);
+  }
+  for (uint32_t y = 0; y < frame.height; ++y) {
+    uint8_t* out = pixels + (options.flip ? frame.height - 1 - y : y) * row_bytes;
+    if (frame.count == 1) {
+      const uint8_t* gray = planes_[0].data() + static_cast<size_t>(y) * frame.components[0].stride;
+      for (uint32_t x = 0; x < frame.width; ++x) {
+        uint8_t* pixel = out + x * channels;
+        pixel[0] = pixel[1] = pixel[2] = gray[x];
+        if (channels == 4) {
+          pixel[3] = 255;
+        }
+      }
+      continue;
+    }
+    const uint8_t* c0 = upsampleRow(0, y);
+    const uint8_t* c1 = upsampleRow(1, y);
+    const uint8_t* c2 = upsampleRow(2, y);
+    if (frame.adobe_transform == 0) {
+      for (uint32_t x = 0; x < frame.width; ++x) {
+        uint8_t* pixel = out + x * channels;
+        pixel[0] = c0[x];
+        pixel[1] = c1[x];
+        pixel[2] = c2[x];
+        if (channels == 4) {
+          pixel[3] = 255;
+        }
+      }
+    } else {
+      convertYCbCr(c0, c1, c2, out, frame.width, channels);
+    }
+  }
+  return true;
+}
+
+auto ImageCodecImpl::decodePng(const uint8_t* data, size_t size, const DecodeOptions& options, uint8_t* pixels,
+                               uint32_t width, uint32_t height) -> bool {
+  GL_HWK_TRACE_SCOPE("ImageCodec::decodePng");
+  PngHeader header;
+  idat_.clear();
+  size_t pos = 8;
+  bool ended = false;
+  while (!ended && pos + 12 <= size) {
+    const uint32_t length = readBigEndian32(data + pos);
+    const uint8_t* type = data + pos + 4;
+    const uint8_t* chunk = data + pos + 8;
+    if (length > size - pos - 12) {
+      fmt::print("ImageCodec: Truncated PNG chunk\n");
+      return false;
+    }
+    if (std::memcmp(type, "IHDR", 4) == 0) {
+      // IHDR必须是第一个块，尺寸与readInfo读到的一致
+      if (pos != 8 || length < 13 || readBigEndian32(chunk) != width || readBigEndian32(chunk + 4) != height) {
+        fmt::print("ImageCodec: Invalid PNG header\n");
+        return false;
+      }
+      header.width = width;
+      header.height = height;
+      header.depth = chunk[8];
+      header.color_type = chunk[9];
+      header.interlaced = chunk[12] == 1;
+      header.samples = pngSamples(header.color_type);
+      const bool depth_ok = header.depth == 8 || header.depth == 16 ||
+                            ((header.color_type == 0 || header.color_type == 3) && header.depth < 8 &&
+                             (header.depth == 1 || header.depth == 2 || header.depth == 4));
+      if (header.samples == 0 || !depth_ok || (header.color_type == 3 && header.depth == 16) || chunk[10] != 0 ||
+          chunk[11] != 0 || chunk[12] > 1) {
+        fmt::print("ImageCodec: Unsupported PNG format: color type {}, depth {}\n", header.color_type, header.depth);
+        return false;
+      }
+    } else if (std::memcmp(type, "PLTE", 4) == 0) {
+      header.palette_size = std::min<uint32_t>(length / 3, 256);
+      for (uint32_t i = 0; i < header.palette_size; ++i) {
+        header.palette[i * 4] = chunk[i * 3];
+        header.palette[i * 4 + 1] = chunk[i * 3 + 1];
+        header.palette[i * 4 + 2] = chunk[i * 3 + 2];
+        header.palette[i * 4 + 3] = 255;
+      }
+    } else if (std::memcmp(type, "tRNS", 4) == 0) {
+      if (header.color_type == 3) {
+        for (uint32_t i = 0; i < std::min<uint32_t>(length, header.palette_size); ++i) {
+          header.palette[i * 4 + 3] = chunk[i];
+        }
+      } else if (header.color_type == 0 && length >= 2) {
+        header.has_key = true;
+        header.key[0] = readBigEndian16(chunk);
+      } else if (header.color_type == 2 && length >= 6) {
+        header.has_key = true;
+        for (int c = 0; c < 3; ++c) {
+          header.key[c] = readBigEndian16(chunk + c * 2);
+        }
+      }
+    } else if (std::memcmp(type, "IDAT", 4) == 0) {
+      idat_.insert(idat_.end(), chunk, chunk + length);
+    } else if (std::memcmp(type, "IEND", 4) == 0) {
+      ended = true;
+    }
+    pos += 12 + length;
+  }
+  if (header.samples == 0 || idat_.empty()) {
+    fmt::print("ImageCodec: Invalid PNG file\n");
+    return false;
+  }
+
+  // 每一趟(非隔行时只有一趟)的尺寸和在解压数据中的偏移
+  struct Pass {
+    uint32_t width, height;
+    size_t offset;
+  };
+  std::array<Pass, 7> passes{};
+  const int pass_count = header.interlaced ? 7 : 1;
+  size_t total = 0;
+  for (int p = 0; p < pass_count; ++p) {
+    const Adam7Pass& adam7 = header.interlaced ? kAdam7[p] : Adam7Pass{0, 0, 1, 1};
+    Pass& pass = passes[p];
+    pass.width = header.width > adam7.x0 ? (header.width - adam7.x0 + adam7.dx - 1) / adam7.dx : 0;
+    pass.height = header.height > adam7.y0 ? (header.height - adam7.y0 + adam7.dy - 1) / adam7.dy : 0;
+    pass.offset = total;
+    if (pass.width > 0 && pass.height > 0) {
+      total += (pngRowBytes(header, pass.width) + 1) * pass.height;
+    }
+  }
+  inflated_.resize(total);
+  {
+    GL_HWK_TRACE_SCOPE("ImageCodec::inflate");
+    Inflater inflater(idat_.data(), idat_.size(), inflated_.data(), total);
+    if (!inflater.run()) {
+      fmt::print("ImageCodec: Corrupt PNG data\n");
+      return false;
+    }
+  }
+
+  const uint32_t channels = options.layout == PixelLayout::kRgba ? 4 : 3;
+  const size_t out_row_bytes = static_cast<size_t>(header.width) * channels;
+  const size_t bpp = std::max<size_t>(1, header.samples * header.depth / 8);
+  row_.resize(static_cast<size_t>(header.width) * channels);
+  std::vector<uint8_t> zero(pngRowBytes(header, header.width), 0);
+  for (int p = 0; p < pass_count; ++p) {
+    const Pass& pass = passes[p];
+    if (pass.width == 0 || pass.height == 0) {
+      continue;
+    }
+    const Adam7Pass& adam7 = header.interlaced ? kAdam7[p] : Adam7Pass{0, 0, 1, 1};
+    const size_t row_bytes = pngRowBytes(header, pass.width);
+    const uint8_t* prior = zero.data();
+    for (uint32_t y = 0; y < pass.height; ++y) {
+      uint8_t* row = inflated_.data() + pass.offset + y * (row_bytes + 1);
+      if (!unfilterRow(row[0], row + 1, prior, row_bytes, bpp)) {
+        fmt::print("ImageCodec: Invalid PNG filter type: {}\n", row[0]);
+        return false;
+      }
+      prior = row + 1;
+      const uint32_t out_y = adam7.y0 + y * adam7.dy;
+      uint8_t* out = pixels + (options.flip ? header.height - 1 - out_y : out_y) * out_row_bytes;
+      if (!header.interlaced) {
+        convertPngRow(header, row + 1, pass.width, out, channels);
+        continue;
+      }
+      convertPngRow(header, row + 1, pass.width, row_.data(), channels);
+      for (uint32_t x = 0; x < pass.width; ++x) {
+        std::memcpy(out + (adam7.x0 + x * adam7.dx) * channels, row_.data() + x * channels, channels);
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief zlib格式，单个固定哈夫曼块，LZ77用哈希链查找匹配
+ */
+auto ImageCodecImpl::deflate(const uint8_t* data, size_t size) -> void {
+  GL_HWK_TRACE_SCOPE("ImageCodec::deflate");
+  compressed_.clear();
+  compressed_.reserve(size / 2 + 64);
+  compressed_.push_back(0x78);
+  compressed_.push_back(0x01);
+  BitWriter writer(compressed_);
+  // BFINAL=1，BTYPE=01
+  writer.put(1, 1);
+  writer.put(1, 2);
+
+  head_.assign(1u << kHashBits, -1);
+  prev_.resize(kDeflateWindow);
+  auto hash = [data](size_t pos) -> uint32_t {
+    const uint32_t v = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16);
+    return (v * 2654435761u) >> (32 - kHashBits);
+  };
+  auto insert = [&](size_t pos) -> void {
+    if (pos + 3 > size) {
+      return;
+    }
+    const uint32_t h = hash(pos);
+    prev_[pos & (kDeflateWindow - 1)] = head_[h];
+    head_[h] = static_cast<int32_t>(pos);
+  };
+
+  size_t pos = 0;
+  while (pos < size) {
+    uint32_t best_length = 0;
+    uint32_t best_distance = 0;
+    if (pos + 3 <= size) {
+      const size_t max_length = std::min<size_t>(258, size - pos);
+      int32_t candidate = head_[hash(pos)];
+      for (int chain = 0; chain < kMaxChain && candidate >= 0 && pos - candidate <= kDeflateWindow; ++chain) {
+        const uint8_t* a = data + candidate;
+        const uint8_t* b = data + pos;
+        if (a[best_length] == b[best_length]) {
+          uint32_t length = 0;
+          while (length < max_length && a[length] == b[length]) {
+            length++;
+          }
+          if (length > best_length) {
+            best_length = length;
+            best_distance = static_cast<uint32_t>(pos - candidate);
+            if (length == max_length) {
+              break;
+            }
+          }
+        }
+        candidate = prev_[candidate & (kDeflateWindow - 1)];
+      }
+    }
+    if (best_length >= 3) {
+      putMatch(writer, best_length, best_distance);
+      for (uint32_t i = 0; i < best_length; ++i) {
+        insert(pos + i);
+      }
+      pos += best_length;
+    } else {
+      putFixedSymbol(writer, data[pos]);
+      insert(pos);
+      pos++;
+    }
+  }
+  putFixedSymbol(writer, 256);
+  writer.flush();
+  uint8_t checksum[4];
+  writeBigEndian32(checksum, adler32(data, size));
+  compressed_.insert(compressed_.end(), checksum, checksum + 4);
+}
+
+ImageCodec::ImageCodec() : impl_(make_unique_impl<ImageCodecImpl>()) {}
+
+// 在ImageCodecImpl完整定义处析构
+ImageCodec::~ImageCodec() = default;
+
+auto ImageCodec::decode(const std::string& path, const DecodeOptions& options, Image& image) -> bool {
+  GL_HWK_TRACE_SCOPE("ImageCodec::decode");
+  if (!impl_->readFile(path)) {
+    fmt::print("ImageCodec: Failed to read file: {}\n", path);
+    return false;
+  }
+  if (decode(impl_->file_.data(), impl_->file_.size(), options, image)) {
+    return true;
+  }
+#ifdef GL_HWK_WITH_OPENCV
+  // 内置解码器不支持的格式交给OpenCV
+  cv::Mat bgr = cv::imread(path, cv::IMREAD_COLOR);
+  if (bgr.empty()) {
+    return false;
+  }
+  if (options.flip) cv::flip(bgr, bgr, 0);
+  cv::Mat converted;
+  cv::cvtColor(bgr, converted, options.layout == PixelLayout::kRgba ? cv::COLOR_BGR2RGBA : cv::COLOR_BGR2RGB);
+  image.width = static_cast<uint32_t>(converted.cols);
+  image.height = static_cast<uint32_t>(converted.rows);
+  image.layout = options.layout;
+  image.pixels.assign(converted.data, converted.data + converted.total() * converted.elemSize());
+  return true;
+#else
+  return false;
+#endif
+}
+
+auto ImageCodec::decode(const uint8_t* data, size_t size, const DecodeOptions& options, Image& image) -> bool {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  if (!readInfo(data, size, width, height)) {
+    fmt::print("ImageCodec: Unknown image format\n");
+    return false;
+  }
+  image.width = width;
+  image.height = height;
+  image.layout = options.layout;
+  image.pixels.resize(static_cast<size_t>(width) * height * image.channels());
+  if (!decode(data, size, options, image.pixels.data(), image.pixels.size())) {
+    image.width = 0;
+    image.height = 0;
+    image.pixels.clear();
+    return false;
+  }
+  return true;
+}
+
+auto ImageCodec::decode(const uint8_t* data, size_t size, const DecodeOptions& options, uint8_t* pixels,
+                        size_t capacity) -> bool {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  if (!readInfo(data, size, width, height)) {
+    fmt::print("ImageCodec: Unknown image format\n");
+    return false;
+  }
+  const size_t channels = options.layout == PixelLayout::kRgba ? 4 : 3;
+  if (capacity < static_cast<size_t>(width) * height * channels) {
+    fmt::print("ImageCodec: Buffer too small for {}x{} image\n", width, height);
+    return false;
+  }
+  return impl_->decode(data, size, options, pixels, width, height);
+}
+
+auto ImageCodec::readInfo(const uint8_t* data, size_t size, uint32_t& width, uint32_t& height) -> bool {
+  return data != nullptr && impl_->readInfo(data, size, width, height);
+}
+
+auto ImageCodec::encodePng(const std::string& path, const uint8_t* pixels, uint32_t width, uint32_t height,
+                           PixelLayout layout) -> bool {
+  GL_HWK_TRACE_SCOPE("ImageCodec::encodePng");
+  auto& impl = *impl_;
+  const size_t channels = layout == PixelLayout::kRgba ? 4 : 3;
+  const size_t row_bytes = static_cast<size_t>(width) * channels;
+  // 每行选择差值绝对值之和最小的滤波
+  impl.filtered_.resize((row_bytes + 1) * height);
+  std::vector<uint8_t>& candidate = impl.row_;
+  candidate.resize(row_bytes * 5);
+  for (uint32_t y = 0; y < height; ++y) {
+    const uint8_t* row = pixels + y * row_bytes;
+    const uint8_t* prior = y > 0 ? row - row_bytes : nullptr;
+    uint64_t best_score = UINT64_MAX;
+    uint32_t best_filter = 0;
+    for (uint32_t filter = 0; filter < 5; ++filter) {
+      uint8_t* out = candidate.data() + filter * row_bytes;
+      uint64_t score = 0;
+      for (size_t i = 0; i < row_bytes; ++i) {
+        const int left = i >= channels ? row[i - channels] : 0;
+        const int up = prior ? prior[i] : 0;
+        const int upper_left = prior && i >= channels ? prior[i - channels] : 0;
+        int predicted = 0;
+        switch (filter) {
+          case 1:
+            predicted = left;
+            break;
+          case 2:
+            predicted = up;
+            break;
+          case 3:
+            predicted = (left + up) >> 1;
+            break;
+          case 4:
+            predicted = paeth(left, up, upper_left);
+            break;
+          default:
+            break;
+        }
+        out[i] = static_cast<uint8_t>(row[i] - predicted);
+        score += static_cast<uint64_t>(std::abs(static_cast<int8_t>(out[i])));
+      }
+      if (score < best_score) {
+        best_score = score;
+        best_filter = filter;
+      }
+    }
+    uint8_t* dst = impl.filtered_.data() + y * (row_bytes + 1);
+    dst[0] = static_cast<uint8_t>(best_filter);
+    std::memcpy(dst + 1, candidate.data() + best_filter * row_bytes, row_bytes);
+  }
+  impl.deflate(impl.filtered_.data(), impl.filtered_.size());
+
+  std::ofstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    fmt::print("ImageCodec: Failed to open file: {}\n", path);
+    return false;
+  }
+  auto write_chunk = [&file](const char* type, const uint8_t* chunk, size_t length) -> void {
+    uint8_t prefix[8];
+    writeBigEndian32(prefix, static_cast<uint32_t>(length));
+    std::memcpy(prefix + 4, type, 4);
+    uint8_t crc[4];
+    writeBigEndian32(crc, crc32(chunk, length, crc32(prefix + 4, 4)));
+    file.write(reinterpret_cast<const char*>(prefix), 8);
+    file.write(reinterpret_cast<const char*>(chunk), static_cast<std::streamsize>(length));
+    file.write(reinterpret_cast<const char*>(crc), 4);
+  };
+  file.write(reinterpret_cast<const char*>(kPngSignature), 8);
+  uint8_t ihdr[13] = {};
+  writeBigEndian32(ihdr, width);
+  writeBigEndian32(ihdr + 4, height);
+  ihdr[8] = 8;
+  ihdr[9] = layout == PixelLayout::kRgba ? 6 : 2;
+  write_chunk("IHDR", ihdr, sizeof(ihdr));
+  write_chunk("IDAT", impl.compressed_.data(), impl.compressed_.size());
+  write_chunk("IEND", nullptr, 0);
+  return static_cast<bool>(file);
+}
+
+auto ImageCodec::setSimdLevel(SimdLevel level) -> void { impl_->level_ = std::min(level, supportedSimdLevel()); }
+
+auto ImageCodec::getSimdLevel() -> SimdLevel { return impl_->level_; }
+
+}  // namespace gl_hwk
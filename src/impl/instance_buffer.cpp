@@ -0,0 +1,101 @@
+#include "gl_homework/instance_buffer.hpp"
+
+// clang-format off
+// std
+#include <cmath>
+// OpenGL
+#include <glm/gtc/matrix_transform.hpp>
+// project
+#include "gl_homework/job_system.hpp"
+#include "gl_homework/render_stats.hpp"
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+class InstanceBufferImpl {
+ public:
+  // 每个任务处理的实例数
+  static constexpr size_t kGrain = 4096;
+
+  InstanceBufferImpl() = default;
+
+  ~InstanceBufferImpl() {
+    if (vbo_ != 0) {
+      glDeleteBuffers(1, &vbo_);
+      RenderStats::instance().addBuffer(-1, -static_cast<int64_t>(sizeof(InstanceData) * capacity_));
+    }
+  }
+
+  /**
+   * @brief 对TRS变换，法线矩阵transpose(inverse(R*S))等于R*S^-1，不需要求逆
+   */
+  static auto compute(const Transform& transform, InstanceData& out) -> void {
+    glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), glm::radians(transform.angle), transform.axis);
+    glm::mat4 model = rotation;
+    model[0] *= transform.scale.x;
+    model[1] *= transform.scale.y;
+    model[2] *= transform.scale.z;
+    model[3] = glm::vec4(transform.position, 1.0f);
+    out.model = model;
+
+    glm::mat4 normal = rotation;
+    normal[0] /= transform.scale.x;
+    normal[1] /= transform.scale.y;
+    normal[2] /= transform.scale.z;
+    out.normal = normal;
+  }
+
+  std::vector<InstanceData> instances_;
+  GLuint vbo_ = 0;
+  size_t capacity_ = 0;
+};
+
+InstanceBuffer::InstanceBuffer() : impl_(make_unique_impl<InstanceBufferImpl>()) {}
+
+// 在InstanceBufferImpl完整定义处析构，删除VBO
+InstanceBuffer::~InstanceBuffer() = default;
+
+auto InstanceBuffer::updateTransforms(const std::vector<Transform>& transforms) -> void {
+  GL_HWK_TRACE_SCOPE("InstanceBuffer::updateTransforms");
+  impl_->instances_.resize(transforms.size());
+  InstanceData* out = impl_->instances_.data();
+  JobSystem::instance().parallelFor(transforms.size(), InstanceBufferImpl::kGrain,
+                                    [&transforms, out](size_t begin, size_t end) {
+                                      for (size_t i = begin; i < end; ++i) {
+                                        InstanceBufferImpl::compute(transforms[i], out[i]);
+                                      }
+                                    });
+}
+
+auto InstanceBuffer::resize(size_t size) -> void { impl_->instances_.resize(size); }
+
+auto InstanceBuffer::data() -> InstanceData* { return impl_->instances_.data(); }
+
+auto InstanceBuffer::size() -> size_t { return impl_->instances_.size(); }
+
+auto InstanceBuffer::upload() -> void {
+  GL_HWK_TRACE_SCOPE("InstanceBuffer::upload");
+  auto& stats = RenderStats::instance();
+  if (impl_->vbo_ == 0) {
+    glGenBuffers(1, &impl_->vbo_);
+    stats.addBuffer(1, 0);
+  }
+  size_t bytes = sizeof(InstanceData) * impl_->instances_.size();
+  glBindBuffer(GL_ARRAY_BUFFER, impl_->vbo_);
+  if (impl_->instances_.size() > impl_->capacity_) {
+    stats.addBuffer(0, static_cast<int64_t>(sizeof(InstanceData) * (impl_->instances_.size() - impl_->capacity_)));
+    impl_->capacity_ = impl_->instances_.size();
+    glBufferData(GL_ARRAY_BUFFER, bytes, impl_->instances_.data(), GL_STREAM_DRAW);
+  } else {
+    // orphan旧的存储，避免等待仍在使用上一帧数据的绘制
+    glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData) * impl_->capacity_, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, impl_->instances_.data());
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  stats.addBufferUpload(bytes);
+}
+
+auto InstanceBuffer::getBuffer() -> GLuint { return impl_->vbo_; }
+
+}  // namespace gl_hwk
@@ -0,0 +1,181 @@
+#include "gl_homework/job_system.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+// third party
+#include <fmt/core.h>
+// project
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+struct Job {
+  std::function<void()> func;
+  JobCounter* counter;
+};
+
+// 所属线程从尾部取，其他线程从头部窃取
+struct JobQueue {
+  std::mutex mutex;
+  std::deque<Job> jobs;
+};
+
+class JobSystemImpl {
+ public:
+  JobSystemImpl() {
+    uint32_t cores = std::max(2u, std::thread::hardware_concurrency());
+    worker_count_ = cores - 1;
+    // 最后一个队列给非工作线程提交任务使用
+    for (uint32_t i = 0; i <= worker_count_; ++i) {
+      queues_.push_back(std::make_unique<JobQueue>());
+    }
+    for (uint32_t i = 0; i < worker_count_; ++i) {
+      threads_.emplace_back([this, i] { workerLoop(i); });
+    }
+  }
+
+  ~JobSystemImpl() {
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+      exit_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  auto queueIndex() const -> uint32_t { return worker_index_ >= 0 ? worker_index_ : worker_count_; }
+
+  auto push(Job job) -> void {
+    auto& queue = *queues_[queueIndex()];
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.jobs.push_back(std::move(job));
+    }
+    pending_.fetch_add(1, std::memory_order_release);
+    // 持锁后再通知，避免工作线程检查完pending_后错过唤醒
+    { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+    sleep_cv_.notify_one();
+  }
+
+  auto tryPop(uint32_t index, Job& job) -> bool {
+    {
+      auto& own = *queues_[index];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.jobs.empty()) {
+        job = std::move(own.jobs.back());
+        own.jobs.pop_back();
+        pending_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+    for (size_t i = 1; i < queues_.size(); ++i) {
+      auto& victim = *queues_[(index + i) % queues_.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.jobs.empty()) {
+        job = std::move(victim.jobs.front());
+        victim.jobs.pop_front();
+        pending_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static auto execute(Job& job) -> void {
+    job.func();
+    if (job.counter) {
+      job.counter->remaining.fetch_sub(1, std::memory_order_acq_rel);
+    }
+  }
+
+  auto workerLoop(uint32_t index) -> void {
+    worker_index_ = static_cast<int32_t>(index);
+    Tracer::instance().setThreadName(fmt::format("job_worker_{}", index));
+    Job job;
+    while (true) {
+      if (tryPop(index, job)) {
+        execute(job);
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(sleep_mutex_);
+      sleep_cv_.wait(lock, [this] { return exit_ || pending_.load(std::memory_order_acquire) > 0; });
+      if (exit_) {
+        return;
+      }
+    }
+  }
+
+  uint32_t worker_count_ = 0;
+  std::vector<std::unique_ptr<JobQueue>> queues_;
+  std::vector<std::thread> threads_;
+  // 所有队列中的任务总数
+  std::atomic<int64_t> pending_{0};
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_cv_;
+  bool exit_ = false;
+  // 工作线程的编号，其他线程为-1
+  static thread_local int32_t worker_index_;
+};
+
+thread_local int32_t JobSystemImpl::worker_index_ = -1;
+
+JobSystem::JobSystem() : impl_(make_unique_impl<JobSystemImpl>()) {}
+
+// 在JobSystemImpl完整定义处析构，结束工作线程
+JobSystem::~JobSystem() = default;
+
+auto JobSystem::instance() -> JobSystem& {
+  static JobSystem instance;
+  return instance;
+}
+
+auto JobSystem::getWorkerCount() -> uint32_t { return impl_->worker_count_; }
+
+auto JobSystem::schedule(std::function<void()> job, JobCounter* counter) -> void {
+  if (counter) {
+    counter->remaining.fetch_add(1, std::memory_order_relaxed);
+  }
+  impl_->push({std::move(job), counter});
+}
+
+auto JobSystem::wait(JobCounter& counter) -> void {
+  uint32_t index = impl_->queueIndex();
+  Job job;
+  while (!counter.isDone()) {
+    if (impl_->tryPop(index, job)) {
+      JobSystemImpl::execute(job);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+auto JobSystem::parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& func)
+    -> void {
+  GL_HWK_TRACE_SCOPE("JobSystem::parallelFor");
+  grain = std::max<size_t>(1, grain);
+  if (count <= grain) {
+    func(0, count);
+    return;
+  }
+  JobCounter counter;
+  // 第一块留给当前线程，其余提交给工作线程
+  for (size_t begin = grain; begin < count; begin += grain) {
+    size_t end = std::min(count, begin + grain);
+    schedule([&func, begin, end] { func(begin, end); }, &counter);
+  }
+  func(0, grain);
+  wait(counter);
+}
+
+}  // namespace gl_hwk
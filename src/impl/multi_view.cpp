@@ -0,0 +1,305 @@
+#include "gl_homework/multi_view.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+// OpenGL
+#include <glm/gtc/matrix_transform.hpp>
+// third party
+#include <fmt/core.h>
+// project
+#include "gl_homework/render_graph.hpp"
+#include "gl_homework/render_stats.hpp"
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+auto RenderView::fromCamera(Camera& camera, const glm::ivec4& viewport) -> RenderView {
+  RenderView view;
+  view.view = camera.getViewMatrix();
+  float aspect = static_cast<float>(std::max(viewport[2], 1)) / static_cast<float>(std::max(viewport[3], 1));
+  view.projection = glm::perspective(camera.getFovY(), aspect, camera.getNearPlane(), camera.getFarPlane());
+  view.viewport = viewport;
+  return view;
+}
+
+class MultiViewRendererImpl {
+ public:
+  // FrustumSet按位记录视图
+  static constexpr uint32_t kMaxViews = 32;
+
+  MultiViewRendererImpl() = default;
+
+  ~MultiViewRendererImpl() {
+    if (fbo_ != 0) {
+      glDeleteFramebuffers(1, &fbo_);
+    }
+  }
+
+  auto valid(uint32_t index) -> bool {
+    if (index < views_.size()) {
+      return true;
+    }
+    fmt::print("MultiViewRenderer: invalid view {}\n", index);
+    return false;
+  }
+
+  auto frustumSet() -> FrustumSet {
+    std::vector<glm::mat4> matrices;
+    matrices.reserve(views_.size());
+    for (const auto& view : views_) {
+      matrices.push_back(view.projection * view.view);
+    }
+    return FrustumSet::fromMatrices(matrices);
+  }
+
+  auto cull(const std::vector<Aabb>& bounds) -> void {
+    auto start = std::chrono::steady_clock::now();
+    FrustumSet set = frustumSet();
+    visible_.resize(views_.size());
+    for (auto& list : visible_) {
+      list.clear();
+    }
+    uint32_t all = set.allMask();
+    uint32_t rejected = 0;
+    for (uint32_t i = 0; i < bounds.size(); ++i) {
+      uint32_t inside = 0;
+      uint32_t mask = set.test(bounds[i], all, inside);
+      if (mask == 0) {
+        ++rejected;
+        continue;
+      }
+      for (uint32_t v = 0; v < views_.size(); ++v) {
+        if (mask & (1u << v)) {
+          visible_[v].push_back(i);
+        }
+      }
+    }
+    finishCull(static_cast<uint32_t>(bounds.size()), rejected, start);
+  }
+
+  auto cull(SceneGraph& graph) -> void {
+    auto start = std::chrono::steady_clock::now();
+    graph.cull(frustumSet(), visible_);
+    // 场景图按子树跳过，不逐个统计被拒绝的节点
+    finishCull(static_cast<uint32_t>(graph.size()), 0, start);
+  }
+
+  auto finishCull(uint32_t objects, uint32_t rejected, std::chrono::steady_clock::time_point start) -> void {
+    stats_.views = static_cast<uint32_t>(views_.size());
+    stats_.objects = objects;
+    stats_.rejected = rejected;
+    stats_.visible = 0;
+    for (const auto& list : visible_) {
+      stats_.visible += static_cast<uint32_t>(list.size());
+    }
+    stats_.cull_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ranges_.clear();
+  }
+
+  auto gatherInstances(InstanceBuffer& shared, InstanceBuffer& out) -> void {
+    GL_HWK_TRACE_SCOPE("MultiViewRenderer::gatherInstances");
+    size_t total = 0;
+    for (const auto& list : visible_) {
+      total += list.size();
+    }
+    out.resize(total);
+    const InstanceData* source = shared.data();
+    InstanceData* target = out.data();
+    size_t size = shared.size();
+    ranges_.assign(views_.size(), {0, 0});
+    size_t offset = 0;
+    for (size_t v = 0; v < visible_.size(); ++v) {
+      ranges_[v].first = offset;
+      for (uint32_t index : visible_[v]) {
+        if (index < size) {
+          target[offset++] = source[index];
+        }
+      }
+      ranges_[v].second = offset - ranges_[v].first;
+    }
+    out.resize(offset);
+  }
+
+  /**
+   * @brief 绑定绘制到纹理的帧缓冲，深度缓冲从RenderTargetPool借用，返回借用的深度纹理
+   */
+  auto bindTextureTarget(const RenderView& view) -> GLuint {
+    if (fbo_ == 0) {
+      glGenFramebuffers(1, &fbo_);
+    }
+    RenderTargetDesc desc;
+    desc.width = static_cast<uint32_t>(std::max(view.viewport[0] + view.viewport[2], 1));
+    desc.height = static_cast<uint32_t>(std::max(view.viewport[1] + view.viewport[3], 1));
+    desc.format = GL_DEPTH_COMPONENT24;
+    GLuint depth = RenderTargetPool::instance().acquire(desc);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo_);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, view.texture_target, view.texture, 0);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+    if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      fmt::print("MultiViewRenderer: framebuffer of texture {} is incomplete\n", view.texture);
+    }
+    RenderStats::instance().addStateChange(3);
+    return depth;
+  }
+
+  auto render(const MultiViewDrawFunc& draw) -> void {
+    GL_HWK_TRACE_SCOPE("MultiViewRenderer::render");
+    // 保存调用者的状态
+    GLint framebuffer;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLint scissor[4];
+    glGetIntegerv(GL_SCISSOR_BOX, scissor);
+    GLboolean scissor_test = glIsEnabled(GL_SCISSOR_TEST);
+    GLfloat clear_color[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clear_color);
+
+    // 裁剪矩形让清除和SkyBox的深度清除只影响当前视口
+    glEnable(GL_SCISSOR_TEST);
+    for (uint32_t v = 0; v < views_.size(); ++v) {
+      const RenderView& view = views_[v];
+      GLuint depth = 0;
+      if (view.texture != 0) {
+        depth = bindTextureTarget(view);
+      } else {
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+      }
+      glViewport(view.viewport[0], view.viewport[1], view.viewport[2], view.viewport[3]);
+      glScissor(view.viewport[0], view.viewport[1], view.viewport[2], view.viewport[3]);
+      if (view.clear) {
+        glClearColor(view.clear_color[0], view.clear_color[1], view.clear_color[2], view.clear_color[3]);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      }
+      RenderStats::instance().addStateChange(3);
+      draw(v, view);
+      if (depth != 0) {
+        RenderTargetPool::instance().release(depth);
+      }
+    }
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glScissor(scissor[0], scissor[1], scissor[2], scissor[3]);
+    if (!scissor_test) {
+      glDisable(GL_SCISSOR_TEST);
+    }
+    glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
+    RenderStats::instance().addStateChange(4);
+  }
+
+  std::vector<RenderView> views_;
+  std::vector<std::vector<uint32_t>> visible_;
+  // gatherInstances输出中每个视图的(first, count)
+  std::vector<std::pair<size_t, size_t>> ranges_;
+  // 绘制到纹理的视图共用的帧缓冲
+  GLuint fbo_ = 0;
+  MultiViewStats stats_;
+};
+
+MultiViewRenderer::MultiViewRenderer() : impl_(make_unique_impl<MultiViewRendererImpl>()) {}
+
+// 在MultiViewRendererImpl完整定义处析构
+MultiViewRenderer::~MultiViewRenderer() = default;
+
+auto MultiViewRenderer::clearViews() -> void {
+  impl_->views_.clear();
+  impl_->visible_.clear();
+  impl_->ranges_.clear();
+}
+
+auto MultiViewRenderer::addView(const RenderView& view) -> uint32_t {
+  if (impl_->views_.size() >= MultiViewRendererImpl::kMaxViews) {
+    fmt::print("MultiViewRenderer: at most {} views\n", MultiViewRendererImpl::kMaxViews);
+    return UINT32_MAX;
+  }
+  impl_->views_.push_back(view);
+  return static_cast<uint32_t>(impl_->views_.size() - 1);
+}
+
+auto MultiViewRenderer::setView(uint32_t index, const RenderView& view) -> void {
+  if (impl_->valid(index)) {
+    impl_->views_[index] = view;
+  }
+}
+
+auto MultiViewRenderer::getView(uint32_t index) -> const RenderView& {
+  static const RenderView kEmpty;
+  return impl_->valid(index) ? impl_->views_[index] : kEmpty;
+}
+
+auto MultiViewRenderer::getViewCount() -> uint32_t { return static_cast<uint32_t>(impl_->views_.size()); }
+
+auto MultiViewRenderer::splitViewports(uint32_t count, uint32_t width, uint32_t height) -> std::vector<glm::ivec4> {
+  std::vector<glm::ivec4> viewports;
+  if (count == 0) {
+    return viewports;
+  }
+  auto columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(count))));
+  uint32_t rows = (count + columns - 1) / columns;
+  auto w = static_cast<int>(width / columns);
+  auto h = static_cast<int>(height / rows);
+  for (uint32_t i = 0; i < count; ++i) {
+    // 第一行在屏幕上方
+    auto column = static_cast<int>(i % columns);
+    auto row = static_cast<int>(rows - 1 - i / columns);
+    viewports.emplace_back(column * w, row * h, w, h);
+  }
+  return viewports;
+}
+
+auto MultiViewRenderer::addCubemapViews(GLuint cubemap, uint32_t size, const glm::vec3& position, float near_plane,
+                                        float far_plane) -> uint32_t {
+  if (impl_->views_.size() + 6 > MultiViewRendererImpl::kMaxViews) {
+    fmt::print("MultiViewRenderer: at most {} views\n", MultiViewRendererImpl::kMaxViews);
+    return UINT32_MAX;
+  }
+  // 与ShadowMap的点光源阴影相同的观察方向和上方向
+  static const glm::vec3 kDirections[6][2] = {{{1, 0, 0}, {0, -1, 0}}, {{-1, 0, 0}, {0, -1, 0}},
+                                              {{0, 1, 0}, {0, 0, 1}},  {{0, -1, 0}, {0, 0, -1}},
+                                              {{0, 0, 1}, {0, -1, 0}}, {{0, 0, -1}, {0, -1, 0}}};
+  auto first = static_cast<uint32_t>(impl_->views_.size());
+  for (int face = 0; face < 6; ++face) {
+    RenderView view;
+    view.view = glm::lookAt(position, position + kDirections[face][0], kDirections[face][1]);
+    view.projection = glm::perspective(glm::radians(90.0f), 1.0f, near_plane, far_plane);
+    view.viewport = glm::ivec4(0, 0, static_cast<int>(size), static_cast<int>(size));
+    view.texture = cubemap;
+    view.texture_target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + face;
+    impl_->views_.push_back(view);
+  }
+  return first;
+}
+
+auto MultiViewRenderer::cull(const std::vector<Aabb>& bounds) -> void {
+  GL_HWK_TRACE_SCOPE("MultiViewRenderer::cull");
+  impl_->cull(bounds);
+}
+
+auto MultiViewRenderer::cull(SceneGraph& graph) -> void {
+  GL_HWK_TRACE_SCOPE("MultiViewRenderer::cull");
+  impl_->cull(graph);
+}
+
+auto MultiViewRenderer::getVisible(uint32_t view) -> const std::vector<uint32_t>& {
+  static const std::vector<uint32_t> kEmpty;
+  return view < impl_->visible_.size() ? impl_->visible_[view] : kEmpty;
+}
+
+auto MultiViewRenderer::gatherInstances(InstanceBuffer& shared, InstanceBuffer& out) -> void {
+  impl_->gatherInstances(shared, out);
+}
+
+auto MultiViewRenderer::getInstanceRange(uint32_t view) -> std::pair<size_t, size_t> {
+  return view < impl_->ranges_.size() ? impl_->ranges_[view] : std::pair<size_t, size_t>(0, 0);
+}
+
+auto MultiViewRenderer::render(const MultiViewDrawFunc& draw) -> void { impl_->render(draw); }
+
+auto MultiViewRenderer::getStats() -> MultiViewStats { return impl_->stats_; }
+
+}  // namespace gl_hwk
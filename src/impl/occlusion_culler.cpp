@@ -0,0 +1,524 @@
+#include "gl_homework/occlusion_culler.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+// third party
+#include <fmt/core.h>
+// project
+#include "gl_homework/job_system.hpp"
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GL_HWK_SIMD_X86 1
+#define GL_HWK_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_M_X64)
+// MSVC没有按函数指定指令集的方式，只使用x64必定支持的SSE2
+#define GL_HWK_SIMD_X86 1
+#define GL_HWK_SIMD_NO_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace gl_hwk {
+
+namespace {
+
+// 分块大小，宽度为8的倍数，AVX2每次处理的8个像素不会跨越分块
+constexpr uint32_t kTileWidth = 32;
+constexpr uint32_t kTileHeight = 16;
+// 每批测试的包围盒数
+constexpr size_t kCullGrain = 256;
+
+/**
+ * @brief 屏幕空间的三角形，边函数a * x + b * y + c在内侧非负，深度为平面za * x + zb * y + zc
+ */
+struct TriangleSetup {
+  float a[3], b[3], c[3];
+  float za, zb, zc;
+  int32_t min_x, min_y, max_x, max_y;
+};
+
+/**
+ * @brief 三角形包围盒与分块的交集，x0按8对齐
+ */
+struct Span {
+  int32_t x0, x1, y0, y1;
+};
+
+auto nowNs() -> uint64_t {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+auto rasterScalar(const TriangleSetup& t, const Span& span, float* depth, uint32_t width) -> void {
+  for (int32_t y = span.y0; y < span.y1; ++y) {
+    float py = y + 0.5f;
+    float* row = depth + static_cast<size_t>(y) * width;
+    // 与SIMD实现相同的求值顺序，各指令集的结果一致
+    const float e_row[3] = {t.b[0] * py + t.c[0], t.b[1] * py + t.c[1], t.b[2] * py + t.c[2]};
+    float z_row = t.zb * py + t.zc;
+    for (int32_t x = span.x0; x < span.x1; ++x) {
+      float px = static_cast<float>(x) + 0.5f;
+      if (t.a[0] * px + e_row[0] >= 0.0f && t.a[1] * px + e_row[1] >= 0.0f && t.a[2] * px + e_row[2] >= 0.0f) {
+        row[x] = std::min(row[x], t.za * px + z_row);
+      }
+    }
+  }
+}
+
+auto anyFartherScalar(const float* row, int32_t x0, int32_t x1, float z) -> bool {
+  for (int32_t x = x0; x < x1; ++x) {
+    if (row[x] > z) {
+      return true;
+    }
+  }
+  return false;
+}
+
+#ifdef GL_HWK_SIMD_X86
+auto rasterSse(const TriangleSetup& t, const Span& span, float* depth, uint32_t width) -> void {
+  const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+  const __m128 zero = _mm_setzero_ps();
+  for (int32_t y = span.y0; y < span.y1; ++y) {
+    float py = y + 0.5f;
+    float* row = depth + static_cast<size_t>(y) * width;
+    __m128 e_row[3];
+    for (int e = 0; e < 3; ++e) {
+      e_row[e] = _mm_set1_ps(t.b[e] * py + t.c[e]);
+    }
+    __m128 z_row = _mm_set1_ps(t.zb * py + t.zc);
+    for (int32_t x = span.x0; x < span.x1; x += 4) {
+      __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+      __m128 mask = _mm_castsi128_ps(_mm_set1_epi32(-1));
+      for (int e = 0; e < 3; ++e) {
+        __m128 value = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.a[e]), px), e_row[e]);
+        mask = _mm_and_ps(mask, _mm_cmpge_ps(value, zero));
+      }
+      if (_mm_movemask_ps(mask) == 0) {
+        continue;
+      }
+      __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.za), px), z_row);
+      __m128 old = _mm_loadu_ps(row + x);
+      __m128 nearer = _mm_min_ps(old, z);
+      _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(mask, nearer), _mm_andnot_ps(mask, old)));
+    }
+  }
+}
+
+auto anyFartherSse(const float* row, int32_t x0, int32_t x1, float z) -> bool {
+  const __m128 zz = _mm_set1_ps(z);
+  int32_t x = x0;
+  for (; x + 4 <= x1; x += 4) {
+    if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(row + x), zz)) != 0) {
+      return true;
+    }
+  }
+  return anyFartherScalar(row, x, x1, z);
+}
+
+#ifndef GL_HWK_SIMD_NO_AVX2
+GL_HWK_TARGET_AVX2 auto rasterAvx2(const TriangleSetup& t, const Span& span, float* depth, uint32_t width) -> void {
+  const __m256 offsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 step = _mm256_set1_ps(8.0f);
+  __m256 a[3];
+  for (int e = 0; e < 3; ++e) {
+    a[e] = _mm256_set1_ps(t.a[e]);
+  }
+  const __m256 za = _mm256_set1_ps(t.za);
+  for (int32_t y = span.y0; y < span.y1; ++y) {
+    float py = y + 0.5f;
+    float* row = depth + static_cast<size_t>(y) * width;
+    __m256 e_row[3];
+    for (int e = 0; e < 3; ++e) {
+      e_row[e] = _mm256_set1_ps(t.b[e] * py + t.c[e]);
+    }
+    __m256 z_row = _mm256_set1_ps(t.zb * py + t.zc);
+    __m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(span.x0)), offsets);
+    for (int32_t x = span.x0; x < span.x1; x += 8, px = _mm256_add_ps(px, step)) {
+      __m256 mask = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a[0], px), e_row[0]), zero, _CMP_GE_OQ);
+      mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a[1], px), e_row[1]), zero, _CMP_GE_OQ));
+      mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a[2], px), e_row[2]), zero, _CMP_GE_OQ));
+      if (_mm256_movemask_ps(mask) == 0) {
+        continue;
+      }
+      __m256 z = _mm256_add_ps(_mm256_mul_ps(za, px), z_row);
+      __m256 old = _mm256_loadu_ps(row + x);
+      _mm256_storeu_ps(row + x, _mm256_blendv_ps(old, _mm256_min_ps(old, z), mask));
+    }
+  }
+}
+
+GL_HWK_TARGET_AVX2 auto anyFartherAvx2(const float* row, int32_t x0, int32_t x1, float z) -> bool {
+  const __m256 zz = _mm256_set1_ps(z);
+  int32_t x = x0;
+  for (; x + 8 <= x1; x += 8) {
+    if (_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(row + x), zz, _CMP_GT_OQ)) != 0) {
+      return true;
+    }
+  }
+  return anyFartherScalar(row, x, x1, z);
+}
+#endif
+#endif
+
+/**
+ * @brief CPU支持的最高指令集
+ */
+auto supportedSimdLevel() -> SimdLevel {
+#if defined(GL_HWK_SIMD_X86) && !defined(GL_HWK_SIMD_NO_AVX2)
+  return __builtin_cpu_supports("avx2") ? SimdLevel::kAvx2 : SimdLevel::kSse;
+#elif defined(GL_HWK_SIMD_X86)
+  return SimdLevel::kSse;
+#else
+  return SimdLevel::kScalar;
+#endif
+}
+
+}  // namespace
+
+class OcclusionCullerImpl {
+ public:
+  struct Occluder {
+    std::vector<glm::vec3> positions;
+    std::vector<GLsizei> indices;
+    glm::mat4 model;
+    bool alive;
+  };
+
+  explicit OcclusionCullerImpl(const OcclusionOptions& options) : level_(supportedSimdLevel()) {
+    tiles_x_ = std::max<uint32_t>(1, (options.width + kTileWidth - 1) / kTileWidth);
+    tiles_y_ = std::max<uint32_t>(1, (options.height + kTileHeight - 1) / kTileHeight);
+    width_ = tiles_x_ * kTileWidth;
+    height_ = tiles_y_ * kTileHeight;
+    depth_.assign(static_cast<size_t>(width_) * height_, 1.0f);
+    tile_max_.assign(static_cast<size_t>(tiles_x_) * tiles_y_, 1.0f);
+    bins_.resize(tile_max_.size());
+  }
+
+  /**
+   * @brief 被近平面(z >= -w)裁剪后的多边形按扇形拆分为三角形
+   */
+  auto clipAndSetup(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2) -> void {
+    const glm::vec4 in[3] = {v0, v1, v2};
+    glm::vec4 out[4];
+    int count = 0;
+    for (int i = 0; i < 3; ++i) {
+      const glm::vec4& p = in[i];
+      const glm::vec4& q = in[(i + 1) % 3];
+      float dp = p.z + p.w, dq = q.z + q.w;
+      if (dp >= 0.0f) {
+        out[count++] = p;
+      }
+      if ((dp >= 0.0f) != (dq >= 0.0f)) {
+        out[count++] = p + (q - p) * (dp / (dp - dq));
+      }
+    }
+    for (int i = 1; i + 1 < count; ++i) {
+      setup(out[0], out[i], out[i + 1]);
+    }
+  }
+
+  auto toScreen(const glm::vec4& clip) const -> glm::vec3 {
+    float inv_w = 1.0f / clip.w;
+    return glm::vec3((clip.x * inv_w * 0.5f + 0.5f) * width_, (clip.y * inv_w * 0.5f + 0.5f) * height_,
+                     clip.z * inv_w * 0.5f + 0.5f);
+  }
+
+  auto setup(const glm::vec4& c0, const glm::vec4& c1, const glm::vec4& c2) -> void {
+    glm::vec3 v[3] = {toScreen(c0), toScreen(c1), toScreen(c2)};
+    float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+    if (!(std::abs(area) > 1e-6f)) {
+      return;
+    }
+    // 遮挡物不区分正反面，统一为逆时针
+    if (area < 0.0f) {
+      std::swap(v[1], v[2]);
+      area = -area;
+    }
+    TriangleSetup t;
+    float min_x = std::min({v[0].x, v[1].x, v[2].x}), max_x = std::max({v[0].x, v[1].x, v[2].x});
+    float min_y = std::min({v[0].y, v[1].y, v[2].y}), max_y = std::max({v[0].y, v[1].y, v[2].y});
+    t.min_x = static_cast<int32_t>(std::max(0.0f, std::floor(min_x)));
+    t.min_y = static_cast<int32_t>(std::max(0.0f, std::floor(min_y)));
+    t.max_x = static_cast<int32_t>(std::min(static_cast<float>(width_) - 1.0f, std::floor(max_x)));
+    t.max_y = static_cast<int32_t>(std::min(static_cast<float>(height_) - 1.0f, std::floor(max_y)));
+    if (t.min_x > t.max_x || t.min_y > t.max_y) {
+      return;
+    }
+    for (int e = 0; e < 3; ++e) {
+      const glm::vec3& p = v[e];
+      const glm::vec3& q = v[(e + 1) % 3];
+      t.a[e] = p.y - q.y;
+      t.b[e] = q.x - p.x;
+      t.c[e] = -(t.a[e] * p.x + t.b[e] * p.y);
+    }
+    float dz1 = v[1].z - v[0].z, dz2 = v[2].z - v[0].z;
+    t.za = (dz1 * (v[2].y - v[0].y) - dz2 * (v[1].y - v[0].y)) / area;
+    t.zb = (dz2 * (v[1].x - v[0].x) - dz1 * (v[2].x - v[0].x)) / area;
+    t.zc = v[0].z - t.za * v[0].x - t.zb * v[0].y;
+
+    auto index = static_cast<uint32_t>(triangles_.size());
+    triangles_.push_back(t);
+    for (uint32_t ty = t.min_y / kTileHeight; ty <= t.max_y / kTileHeight; ++ty) {
+      for (uint32_t tx = t.min_x / kTileWidth; tx <= t.max_x / kTileWidth; ++tx) {
+        bins_[ty * tiles_x_ + tx].push_back(index);
+      }
+    }
+  }
+
+  auto rasterTile(size_t tile) -> void {
+    auto tx = static_cast<int32_t>(tile % tiles_x_), ty = static_cast<int32_t>(tile / tiles_x_);
+    int32_t tile_x0 = tx * kTileWidth, tile_y0 = ty * kTileHeight;
+    for (uint32_t index : bins_[tile]) {
+      const TriangleSetup& t = triangles_[index];
+      Span span;
+      span.x0 = std::max(t.min_x, tile_x0) & ~7;
+      span.x1 = std::min(t.max_x + 1, tile_x0 + static_cast<int32_t>(kTileWidth));
+      span.y0 = std::max(t.min_y, tile_y0);
+      span.y1 = std::min(t.max_y + 1, tile_y0 + static_cast<int32_t>(kTileHeight));
+      switch (level_) {
+#ifdef GL_HWK_SIMD_X86
+#ifndef GL_HWK_SIMD_NO_AVX2
+        case SimdLevel::kAvx2:
+          rasterAvx2(t, span, depth_.data(), width_);
+          break;
+#endif
+        case SimdLevel::kSse:
+          // 4个像素一组，按4对齐后可能越过三角形的包围盒，但不会越过分块
+          span.x1 = (span.x1 + 3) & ~3;
+          rasterSse(t, span, depth_.data(), width_);
+          break;
+#endif
+        default:
+          rasterScalar(t, span, depth_.data(), width_);
+          break;
+      }
+    }
+    // 分块内的最大深度，包围盒比它更远时整个分块都被遮挡
+    float tile_max = 0.0f;
+    for (int32_t y = tile_y0; y < tile_y0 + static_cast<int32_t>(kTileHeight); ++y) {
+      const float* row = depth_.data() + static_cast<size_t>(y) * width_ + tile_x0;
+      tile_max = std::max(tile_max, *std::max_element(row, row + kTileWidth));
+    }
+    tile_max_[tile] = tile_max;
+  }
+
+  auto anyFarther(const float* row, int32_t x0, int32_t x1, float z) const -> bool {
+    switch (level_) {
+#ifdef GL_HWK_SIMD_X86
+#ifndef GL_HWK_SIMD_NO_AVX2
+      case SimdLevel::kAvx2:
+        return anyFartherAvx2(row, x0, x1, z);
+#endif
+      case SimdLevel::kSse:
+        return anyFartherSse(row, x0, x1, z);
+#endif
+      default:
+        return anyFartherScalar(row, x0, x1, z);
+    }
+  }
+
+  auto test(const Aabb& box) -> bool {
+    tested_.fetch_add(1, std::memory_order_relaxed);
+    if (box.isEmpty()) {
+      return false;
+    }
+    float min_x = 1e30f, min_y = 1e30f, max_x = -1e30f, max_y = -1e30f, min_z = 1e30f;
+    for (int i = 0; i < 8; ++i) {
+      glm::vec3 corner((i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y,
+                       (i & 4) ? box.max.z : box.min.z);
+      glm::vec4 clip = view_projection_ * glm::vec4(corner, 1.0f);
+      // 与近平面相交，投影不可靠
+      if (clip.z < -clip.w) {
+        return true;
+      }
+      glm::vec3 p = toScreen(clip);
+      min_x = std::min(min_x, p.x);
+      max_x = std::max(max_x, p.x);
+      min_y = std::min(min_y, p.y);
+      max_y = std::max(max_y, p.y);
+      min_z = std::min(min_z, p.z);
+    }
+    // 包含包围盒覆盖到的所有像素
+    auto x0 = static_cast<int32_t>(std::max(0.0f, std::floor(min_x)));
+    auto y0 = static_cast<int32_t>(std::max(0.0f, std::floor(min_y)));
+    auto x1 = static_cast<int32_t>(std::min(static_cast<float>(width_), std::ceil(max_x)));
+    auto y1 = static_cast<int32_t>(std::min(static_cast<float>(height_), std::ceil(max_y)));
+    if (x0 >= x1 || y0 >= y1) {
+      return false;
+    }
+    for (int32_t ty = y0 / kTileHeight; ty <= (y1 - 1) / static_cast<int32_t>(kTileHeight); ++ty) {
+      for (int32_t tx = x0 / kTileWidth; tx <= (x1 - 1) / static_cast<int32_t>(kTileWidth); ++tx) {
+        if (min_z >= tile_max_[ty * tiles_x_ + tx]) {
+          continue;
+        }
+        int32_t sx0 = std::max(x0, tx * static_cast<int32_t>(kTileWidth));
+        int32_t sx1 = std::min(x1, (tx + 1) * static_cast<int32_t>(kTileWidth));
+        int32_t sy0 = std::max(y0, ty * static_cast<int32_t>(kTileHeight));
+        int32_t sy1 = std::min(y1, (ty + 1) * static_cast<int32_t>(kTileHeight));
+        for (int32_t y = sy0; y < sy1; ++y) {
+          if (anyFarther(depth_.data() + static_cast<size_t>(y) * width_, sx0, sx1, min_z)) {
+            return true;
+          }
+        }
+      }
+    }
+    occluded_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  std::vector<Occluder> occluders_;
+  std::vector<OccluderId> free_ids_;
+  std::vector<glm::vec4> clip_;
+  std::vector<TriangleSetup> triangles_;
+  std::vector<std::vector<uint32_t>> bins_;
+  std::vector<float> depth_;
+  std::vector<float> tile_max_;
+  glm::mat4 view_projection_ = glm::mat4(1.0f);
+  uint32_t width_, height_;
+  uint32_t tiles_x_, tiles_y_;
+  SimdLevel level_;
+
+  OcclusionStats stats_;
+  std::atomic<uint32_t> tested_{0};
+  std::atomic<uint32_t> occluded_{0};
+  std::atomic<uint64_t> test_ns_{0};
+};
+
+OcclusionCuller::OcclusionCuller(const OcclusionOptions& options)
+    : impl_(make_unique_impl<OcclusionCullerImpl>(options)) {}
+
+// 在OcclusionCullerImpl完整定义处析构
+OcclusionCuller::~OcclusionCuller() = default;
+
+auto OcclusionCuller::addOccluder(const std::vector<glm::vec3>& positions, const std::vector<GLsizei>& indices,
+                                  const glm::mat4& model) -> OccluderId {
+  auto& impl = *impl_;
+  OcclusionCullerImpl::Occluder occluder{positions, indices, model, true};
+  if (!impl.free_ids_.empty()) {
+    OccluderId id = impl.free_ids_.back();
+    impl.free_ids_.pop_back();
+    impl.occluders_[id] = std::move(occluder);
+    return id;
+  }
+  impl.occluders_.push_back(std::move(occluder));
+  return static_cast<OccluderId>(impl.occluders_.size() - 1);
+}
+
+auto OcclusionCuller::setOccluderTransform(OccluderId id, const glm::mat4& model) -> void {
+  if (id >= impl_->occluders_.size() || !impl_->occluders_[id].alive) {
+    fmt::print("OcclusionCuller: invalid occluder {}\n", id);
+    return;
+  }
+  impl_->occluders_[id].model = model;
+}
+
+auto OcclusionCuller::removeOccluder(OccluderId id) -> void {
+  if (id >= impl_->occluders_.size() || !impl_->occluders_[id].alive) {
+    fmt::print("OcclusionCuller: invalid occluder {}\n", id);
+    return;
+  }
+  auto& occluder = impl_->occluders_[id];
+  occluder = {{}, {}, glm::mat4(1.0f), false};
+  impl_->free_ids_.push_back(id);
+}
+
+auto OcclusionCuller::clearOccluders() -> void {
+  impl_->occluders_.clear();
+  impl_->free_ids_.clear();
+}
+
+auto OcclusionCuller::render(const glm::mat4& view_projection) -> void {
+  GL_HWK_TRACE_SCOPE("OcclusionCuller::render");
+  auto& impl = *impl_;
+  uint64_t start = nowNs();
+  impl.view_projection_ = view_projection;
+  impl.triangles_.clear();
+  for (auto& bin : impl.bins_) {
+    bin.clear();
+  }
+  std::fill(impl.depth_.begin(), impl.depth_.end(), 1.0f);
+
+  // 变换、近平面裁剪和分块在当前线程完成，遮挡物数量很少
+  uint32_t occluders = 0;
+  for (const auto& occluder : impl.occluders_) {
+    if (!occluder.alive) {
+      continue;
+    }
+    occluders++;
+    glm::mat4 mvp = view_projection * occluder.model;
+    impl.clip_.resize(occluder.positions.size());
+    for (size_t i = 0; i < occluder.positions.size(); ++i) {
+      impl.clip_[i] = mvp * glm::vec4(occluder.positions[i], 1.0f);
+    }
+    for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3) {
+      impl.clipAndSetup(impl.clip_[occluder.indices[i]], impl.clip_[occluder.indices[i + 1]],
+                        impl.clip_[occluder.indices[i + 2]]);
+    }
+  }
+
+  // 每个分块只由一个任务写入，每个线程约分到4个任务
+  auto* p = impl_.get();
+  size_t grain = impl.bins_.size() / (4 * (JobSystem::instance().getWorkerCount() + 1)) + 1;
+  JobSystem::instance().parallelFor(impl.bins_.size(), grain, [p](size_t begin, size_t end) {
+    for (size_t tile = begin; tile < end; ++tile) {
+      p->rasterTile(tile);
+    }
+  });
+
+  impl.stats_ = OcclusionStats();
+  impl.stats_.occluders = occluders;
+  impl.stats_.triangles = static_cast<uint32_t>(impl.triangles_.size());
+  impl.stats_.raster_ms = (nowNs() - start) / 1e6;
+  impl.tested_ = 0;
+  impl.occluded_ = 0;
+  impl.test_ns_ = 0;
+}
+
+auto OcclusionCuller::isVisible(const Aabb& box) -> bool {
+  uint64_t start = nowNs();
+  bool visible = impl_->test(box);
+  impl_->test_ns_.fetch_add(nowNs() - start, std::memory_order_relaxed);
+  return visible;
+}
+
+auto OcclusionCuller::cull(const std::vector<Aabb>& boxes, std::vector<uint8_t>& visible) -> void {
+  GL_HWK_TRACE_SCOPE("OcclusionCuller::cull");
+  uint64_t start = nowNs();
+  visible.resize(boxes.size());
+  auto* p = impl_.get();
+  uint8_t* out = visible.data();
+  const Aabb* in = boxes.data();
+  JobSystem::instance().parallelFor(boxes.size(), kCullGrain, [p, in, out](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      out[i] = p->test(in[i]) ? 1 : 0;
+    }
+  });
+  impl_->test_ns_.fetch_add(nowNs() - start, std::memory_order_relaxed);
+}
+
+auto OcclusionCuller::getDepthBuffer() -> const std::vector<float>& { return impl_->depth_; }
+
+auto OcclusionCuller::getWidth() -> uint32_t { return impl_->width_; }
+
+auto OcclusionCuller::getHeight() -> uint32_t { return impl_->height_; }
+
+auto OcclusionCuller::setSimdLevel(SimdLevel level) -> void { impl_->level_ = std::min(level, supportedSimdLevel()); }
+
+auto OcclusionCuller::getSimdLevel() -> SimdLevel { return impl_->level_; }
+
+auto OcclusionCuller::getStats() -> OcclusionStats {
+  auto stats = impl_->stats_;
+  stats.tested = impl_->tested_.load();
+  stats.occluded = impl_->occluded_.load();
+  stats.test_ms = impl_->test_ns_.load() / 1e6;
+  return stats;
+}
+
+}  // namespace gl_hwk
@@ -1,58 +1,350 @@
 #include "gl_homework/opengl_application.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+#ifdef GL_HWK_WITH_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "gl_homework/frame_arena.hpp"
+#include "gl_homework/gpu_profiler.hpp"
 #include "gl_homework/impl.hpp"
+#include "gl_homework/render_graph.hpp"
+#include "gl_homework/render_stats.hpp"
+#include "gl_homework/trace.hpp"
 
 namespace gl_hwk {
 
+/**
+ * @brief 无窗口模式的EGL surfaceless上下文和离屏FBO
+ */
+class HeadlessContext {
+ public:
+  HeadlessContext() = default;
+  ~HeadlessContext() { destroy(); }
+
+  /**
+   * @brief 创建没有surface的上下文，帧缓冲的大小由createFramebuffer决定
+   */
+  auto create() -> bool {
+#ifdef GL_HWK_WITH_EGL
+    // 优先使用Mesa的surfaceless平台，不依赖X11/GBM设备
+    auto get_platform_display =
+        reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (get_platform_display) {
+      display_ = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display_ == EGL_NO_DISPLAY) {
+      display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, nullptr, nullptr)) {
+      fmt::print("HeadlessContext: eglInitialize failed\n");
+      return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+      fmt::print("HeadlessContext: eglBindAPI failed\n");
+      return false;
+    }
+
+    const EGLint config_attribs[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLConfig config = EGL_NO_CONFIG_KHR;
+    EGLint num_configs = 0;
+    if (!eglChooseConfig(display_, config_attribs, &config, 1, &num_configs) || num_configs == 0) {
+      // 依赖EGL_KHR_no_config_context
+      config = EGL_NO_CONFIG_KHR;
+    }
+
+    const EGLint context_attribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                      3,
+                                      EGL_CONTEXT_MINOR_VERSION,
+                                      3,
+                                      EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                      EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+                                      EGL_NONE};
+    context_ = eglCreateContext(display_, config, EGL_NO_CONTEXT, context_attribs);
+    if (context_ == EGL_NO_CONTEXT) {
+      fmt::print("HeadlessContext: eglCreateContext failed: 0x{:x}\n", eglGetError());
+      return false;
+    }
+    if (!eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, context_)) {
+      fmt::print("HeadlessContext: eglMakeCurrent failed: 0x{:x}\n", eglGetError());
+      return false;
+    }
+    return true;
+#else
+    fmt::print("HeadlessContext: headless mode requires EGL\n");
+    return false;
+#endif
+  }
+
+  /**
+   * @brief 创建离屏FBO，需要在glewInit之后调用
+   */
+  auto createFramebuffer(uint32_t width, uint32_t height) -> bool {
+    glGenFramebuffers(1, &fbo_);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+
+    glGenRenderbuffers(1, &color_rbo_);
+    glBindRenderbuffer(GL_RENDERBUFFER, color_rbo_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_rbo_);
+
+    glGenRenderbuffers(1, &depth_rbo_);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_rbo_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_rbo_);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      fmt::print("HeadlessContext: framebuffer is not complete\n");
+      return false;
+    }
+    glViewport(0, 0, width, height);
+    return true;
+  }
+
+  auto destroy() -> void {
+#ifdef GL_HWK_WITH_EGL
+    if (context_ != EGL_NO_CONTEXT) {
+      if (fbo_) {
+        glDeleteFramebuffers(1, &fbo_);
+        glDeleteRenderbuffers(1, &color_rbo_);
+        glDeleteRenderbuffers(1, &depth_rbo_);
+        fbo_ = 0;
+      }
+      eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+      eglDestroyContext(display_, context_);
+      context_ = EGL_NO_CONTEXT;
+    }
+    if (display_ != EGL_NO_DISPLAY) {
+      eglTerminate(display_);
+      display_ = EGL_NO_DISPLAY;
+    }
+#endif
+  }
+
+  GLuint fbo_ = 0;
+  GLuint color_rbo_ = 0;
+  GLuint depth_rbo_ = 0;
+#ifdef GL_HWK_WITH_EGL
+  EGLDisplay display_ = EGL_NO_DISPLAY;
+  EGLContext context_ = EGL_NO_CONTEXT;
+#endif
+};
+
 class OpenGLApplicationImpl {
  public:
-  OpenGLApplicationImpl() : init_(false), window_(0) {}
+  OpenGLApplicationImpl() : init_(false), running_(false), window_(0) {}
 
-  ~OpenGLApplicationImpl() = default;
+  ~OpenGLApplicationImpl() {
+    // 静态成员在所有单例之后析构，在这里提前释放，离屏目标在headless_上下文销毁前归还RenderTargetPool
+    dynamic_resolution_.reset();
+  }
 
   static auto timerProc(int value) -> void {
     glutPostRedisplay();
     glutTimerFunc(33, timerProc, 1);
   }
 
+  enum class InputType {
+    kKeyPress,
+    kKeyRelease,
+    kMouseButton,
+    kMouseMove,
+  };
+
+  struct InputEvent {
+    InputType type;
+    int key;
+    int state;
+    int x;
+    int y;
+    // 事件发生的时间，单位为秒
+    double time;
+  };
+
+  static auto clockNow() -> double {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  static auto timeStep() -> double { return 1.0 / std::max(options_.update_rate, 1u); }
+
+  /**
+   * @brief 派发时间不晚于limit的输入事件，事件按发生顺序排列
+   */
+  static auto dispatchInput(double limit) -> void {
+    size_t count = 0;
+    for (; count < events_.size() && events_[count].time <= limit; ++count) {
+      const auto& event = events_[count];
+      switch (event.type) {
+        case InputType::kKeyPress:
+          if (keyboard_callback_) {
+            keyboard_callback_(static_cast<unsigned char>(event.key), event.x, event.y);
+          }
+          break;
+        case InputType::kKeyRelease:
+          if (keyboard_release_callback_) {
+            keyboard_release_callback_(static_cast<unsigned char>(event.key), event.x, event.y);
+          }
+          break;
+        case InputType::kMouseButton:
+          if (mouse_button_callback_) {
+            mouse_button_callback_(event.key, event.state, event.x, event.y);
+          }
+          break;
+        case InputType::kMouseMove:
+          if (mouse_move_callback_) {
+            mouse_move_callback_(event.x, event.y);
+          }
+          break;
+      }
+      dispatched_times_.push_back(event.time);
+    }
+    events_.erase(events_.begin(), events_.begin() + count);
+  }
+
+  /**
+   * @brief 按经过的时间执行固定步长的更新，每次更新前派发在该次更新对应时刻之前发生的输入
+   */
+  static auto simulate() -> void {
+    GL_HWK_TRACE_SCOPE("OpenGLApplication::simulate");
+    double step = timeStep();
+    if (!update_callback_) {
+      dispatchInput(std::numeric_limits<double>::infinity());
+      return;
+    }
+    if (options_.headless) {
+      dispatchInput(std::numeric_limits<double>::infinity());
+      update_callback_(static_cast<float>(step));
+      simulation_time_ += step;
+      alpha_ = 0.0;
+      return;
+    }
+    double now = clockNow();
+    if (last_time_ < 0.0) {
+      last_time_ = now;
+    }
+    accumulator_ += now - last_time_;
+    last_time_ = now;
+    for (uint32_t updates = 0; accumulator_ >= step; ++updates) {
+      if (updates == options_.max_updates_per_frame) {
+        accumulator_ = std::fmod(accumulator_, step);
+        break;
+      }
+      accumulator_ -= step;
+      dispatchInput(now - accumulator_);
+      update_callback_(static_cast<float>(step));
+      simulation_time_ += step;
+    }
+    alpha_ = accumulator_ / step;
+  }
+
+  /**
+   * @brief 本帧处理过的输入事件到帧提交的延迟
+   */
+  static auto recordLatency() -> void {
+    if (dispatched_times_.empty()) {
+      return;
+    }
+    double now = clockNow();
+    for (double time : dispatched_times_) {
+      double ms = (now - time) * 1000.0;
+      latency_samples_[latency_.events % latency_samples_.size()] = ms;
+      latency_sum_ms_ += ms;
+      latency_.events++;
+      latency_.last_ms = ms;
+      latency_.max_ms = std::max(latency_.max_ms, ms);
+    }
+    dispatched_times_.clear();
+  }
+
   static auto display() -> void {
+    GL_HWK_TRACE_SCOPE("OpenGLApplication::display");
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glClearColor(options_.r, options_.g, options_.b, 1.0);
+    GpuProfiler::instance().beginFrame();
+    RenderStats::instance().beginFrame();
+    simulate();
     if (render_callback_) {
+      GL_HWK_TRACE_SCOPE("render_callback");
+      if (dynamic_resolution_) {
+        dynamic_resolution_->begin();
+      }
       render_callback_();
+      if (dynamic_resolution_) {
+        dynamic_resolution_->end();
+      }
     } else {
       fmt::print("render func is not available\n");
     }
-    glFlush();
+    RenderStats::instance().endFrame();
+    GpuProfiler::instance().endFrame();
+    capture_.captureFrame();
+    // 本帧的临时分配全部失效
+    FrameArena::instance().reset();
+    {
+      GL_HWK_TRACE_SCOPE("glFlush");
+      glFlush();
+    }
+    recordLatency();
   }
 
+  // 输入先带时间戳排队，在下一帧的更新中派发
   static auto keyboardCallback(unsigned char key, int x, int y) -> void {
-    if (keyboard_callback_) {
-      keyboard_callback_(key, x, y);
-    }
+    events_.push_back({InputType::kKeyPress, key, 0, x, y, clockNow()});
+  }
+
+  static auto keyboardUpCallback(unsigned char key, int x, int y) -> void {
+    events_.push_back({InputType::kKeyRelease, key, 0, x, y, clockNow()});
   }
 
   static auto mouseButtonCallback(int button, int state, int x, int y) -> void {
-    if (mouse_button_callback_) {
-      mouse_button_callback_(button, state, x, y);
-    }
+    events_.push_back({InputType::kMouseButton, button, state, x, y, clockNow()});
   }
 
   static auto mouseMoveCallback(int x, int y) -> void {
-    if (mouse_move_callback_) {
-      mouse_move_callback_(x, y);
-    }
+    events_.push_back({InputType::kMouseMove, 0, 0, x, y, clockNow()});
   }
   bool init_;
+  bool running_;
   GLuint window_;
+  HeadlessContext headless_;
   static WindowOptions options_;
+  static FrameCapture capture_;
+  static std::unique_ptr<DynamicResolution> dynamic_resolution_;
   static std::function<void()> render_callback_;
+  static std::function<void(float dt)> update_callback_;
   static std::function<void(unsigned char key, int x, int y)> keyboard_callback_;
+  static std::function<void(unsigned char key, int x, int y)> keyboard_release_callback_;
   static std::function<void(int button, int state, int x, int y)> mouse_button_callback_;
   static std::function<void(int x, int y)> mouse_move_callback_;
+
+  static std::vector<InputEvent> events_;
+  // 本帧派发的事件的发生时间，帧提交后计算延迟
+  static std::vector<double> dispatched_times_;
+  // 上一帧的时间，小于0表示还没有渲染过
+  static double last_time_;
+  static double accumulator_;
+  static double simulation_time_;
+  static double alpha_;
+  static InputLatencyStats latency_;
+  static double latency_sum_ms_;
+  static std::array<double, 256> latency_samples_;
 };
 
-OpenGLApplication::OpenGLApplication() { impl_ = make_unique_impl<OpenGLApplicationImpl>(); }
+OpenGLApplication::OpenGLApplication() {
+  // 先构造RenderTargetPool，使它在OpenGLApplication之后析构
+  RenderTargetPool::instance();
+  impl_ = make_unique_impl<OpenGLApplicationImpl>();
+}
+
+// 在OpenGLApplicationImpl完整定义处析构
+OpenGLApplication::~OpenGLApplication() = default;
 
 auto OpenGLApplication::instance() -> OpenGLApplication& {
   static OpenGLApplication instance;
@@ -62,14 +354,33 @@ auto OpenGLApplication::instance() -> OpenGLApplication& {
 auto OpenGLApplication::init(int argc, char** argv, const WindowOptions& options) -> void {
   impl_->options_ = options;
   if (!impl_->init_) {
-    glutInit(&argc, argv);
-    glutInitDisplayMode(GLUT_SINGLE | GLUT_RGB | GLUT_DEPTH);
-    glutInitWindowSize(options.width, options.height);
-    impl_->window_ = glutCreateWindow(options.name.c_str());
+    if (options.headless) {
+      if (!impl_->headless_.create()) {
+        fmt::print("Error: failed to create headless context\n");
+        std::abort();
+      }
+      glewExperimental = GL_TRUE;
+      // GLEW通过GLX加载函数，在EGL上下文中会返回GLEW_ERROR_NO_GLX_DISPLAY，但函数指针仍然可用
+      GLenum err = glewInit();
+      if (err != GLEW_OK && err != GLEW_ERROR_NO_GLX_DISPLAY) {
+        fmt::print("Error: glewInit failed\n");
+        std::abort();
+      }
+      if (!impl_->headless_.createFramebuffer(options.width, options.height)) {
+        std::abort();
+      }
+    } else {
+      glutInit(&argc, argv);
+      glutInitDisplayMode(GLUT_SINGLE | GLUT_RGB | GLUT_DEPTH);
+      glutInitWindowSize(options.width, options.height);
+      // 使stop()能从glutMainLoop返回
+      glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
+      impl_->window_ = glutCreateWindow(options.name.c_str());
 
-    if (glewInit()) {
-      fmt::print("Error: glewInit failed\n");
-      std::abort();
+      if (glewInit()) {
+        fmt::print("Error: glewInit failed\n");
+        std::abort();
+      }
     }
     // 默认开启深度测试
     glEnable(GL_DEPTH_TEST);
@@ -82,30 +393,134 @@ auto OpenGLApplication::init(int argc, char** argv, const WindowOptions& options
 }
 
 auto OpenGLApplication::run() -> void {
-  if (impl_->init_) {
+  if (impl_->init_ && impl_->options_.headless) {
+    impl_->running_ = true;
+    for (uint32_t frame = 0; impl_->running_; ++frame) {
+      if (impl_->options_.frames != 0 && frame >= impl_->options_.frames) {
+        break;
+      }
+      OpenGLApplicationImpl::display();
+    }
+    glFinish();
+    // 上下文销毁前写完在途帧
+    stopCapture();
+    impl_->running_ = false;
+  } else if (impl_->init_) {
     // 注册回调函数
     glutDisplayFunc(OpenGLApplicationImpl::display);
     glutKeyboardFunc(OpenGLApplicationImpl::keyboardCallback);
+    glutKeyboardUpFunc(OpenGLApplicationImpl::keyboardUpCallback);
+    if (impl_->keyboard_release_callback_) {
+      glutIgnoreKeyRepeat(1);
+    }
     glutMouseFunc(OpenGLApplicationImpl::mouseButtonCallback);
     glutMotionFunc(OpenGLApplicationImpl::mouseMoveCallback);
     glutTimerFunc(33, OpenGLApplicationImpl::timerProc, 1);
     // 进入主循环
     glutMainLoop();
+    stopCapture();
+  }
+}
+
+auto OpenGLApplication::stop() -> void {
+  impl_->running_ = false;
+  if (!impl_->options_.headless && impl_->init_) {
+    glutLeaveMainLoop();
+  }
+}
+
+auto OpenGLApplication::isHeadless() -> bool { return impl_->options_.headless; }
+
+auto OpenGLApplication::readPixels() -> std::vector<uint8_t> {
+  // 按窗口大小读取，渲染回调留下的分屏或阴影贴图视口不影响结果
+  const auto width = static_cast<GLsizei>(impl_->options_.width);
+  const auto height = static_cast<GLsizei>(impl_->options_.height);
+  std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  return pixels;
+}
+
+auto OpenGLApplication::startCapture(const CaptureOptions& options) -> bool {
+  if (!impl_->init_) {
+    fmt::print("OpenGLApplication: startCapture must be called after init\n");
+    return false;
   }
+  return impl_->capture_.start(options, impl_->options_.width, impl_->options_.height);
 }
 
+auto OpenGLApplication::stopCapture() -> void { impl_->capture_.stop(); }
+
+auto OpenGLApplication::getCaptureStats() -> CaptureStats { return impl_->capture_.getStats(); }
+
 auto OpenGLApplication::setDepthTest(bool enable) -> void {
   if (enable) {
     glEnable(GL_DEPTH_TEST);
   } else {
     glDisable(GL_DEPTH_TEST);
   }
+  RenderStats::instance().addStateChange();
+}
+
+auto OpenGLApplication::enableDynamicResolution(const DynamicResolutionOptions& options) -> void {
+  if (!impl_->init_) {
+    fmt::print("OpenGLApplication: enableDynamicResolution must be called after init\n");
+    return;
+  }
+  if (impl_->dynamic_resolution_) {
+    impl_->dynamic_resolution_->setOptions(options);
+    return;
+  }
+  impl_->dynamic_resolution_ =
+      std::make_unique<DynamicResolution>(impl_->options_.width, impl_->options_.height, options);
+}
+
+auto OpenGLApplication::disableDynamicResolution() -> void { impl_->dynamic_resolution_.reset(); }
+
+auto OpenGLApplication::getDynamicResolutionStats() -> DynamicResolutionStats {
+  if (!impl_->dynamic_resolution_) {
+    DynamicResolutionStats stats;
+    stats.render_width = impl_->options_.width;
+    stats.render_height = impl_->options_.height;
+    return stats;
+  }
+  return impl_->dynamic_resolution_->getStats();
+}
+
+auto OpenGLApplication::onUpdate(std::function<void(float dt)>&& func) -> void {
+  impl_->update_callback_ = std::move(func);
+}
+
+auto OpenGLApplication::getInterpolationAlpha() -> float { return static_cast<float>(impl_->alpha_); }
+
+auto OpenGLApplication::getSimulationTime() -> double { return impl_->simulation_time_; }
+
+auto OpenGLApplication::getRenderTime() -> double {
+  return impl_->simulation_time_ - (1.0 - impl_->alpha_) * OpenGLApplicationImpl::timeStep();
+}
+
+auto OpenGLApplication::getLatencyStats() -> InputLatencyStats {
+  auto stats = impl_->latency_;
+  if (stats.events == 0) {
+    return stats;
+  }
+  stats.avg_ms = impl_->latency_sum_ms_ / stats.events;
+  size_t count = std::min<size_t>(stats.events, impl_->latency_samples_.size());
+  std::array<double, 256> samples = impl_->latency_samples_;
+  size_t index = std::min(count - 1, static_cast<size_t>(count * 0.99));
+  std::nth_element(samples.begin(), samples.begin() + index, samples.begin() + count);
+  stats.p99_ms = samples[index];
+  return stats;
 }
 
 auto OpenGLApplication::onKeyboardPress(std::function<void(unsigned char key, int x, int y)>&& func) -> void {
   impl_->keyboard_callback_ = std::move(func);
 }
 
+auto OpenGLApplication::onKeyboardRelease(std::function<void(unsigned char key, int x, int y)>&& func) -> void {
+  impl_->keyboard_release_callback_ = std::move(func);
+}
+
 auto OpenGLApplication::onDisplay(std::function<void()>&& func) -> void { impl_->render_callback_ = std::move(func); }
 
 auto OpenGLApplication::onMouseButtonPress(std::function<void(int button, int state, int x, int y)>&& func) -> void {
@@ -118,9 +533,22 @@ auto OpenGLApplication::onMouseMove(std::function<void(int x, int y)>&& func) ->
 
 // 定义静态成员变量
 WindowOptions OpenGLApplicationImpl::options_;
+FrameCapture OpenGLApplicationImpl::capture_;
+std::unique_ptr<DynamicResolution> OpenGLApplicationImpl::dynamic_resolution_;
 std::function<void()> OpenGLApplicationImpl::render_callback_;
+std::function<void(float dt)> OpenGLApplicationImpl::update_callback_;
 std::function<void(unsigned char key, int x, int y)> OpenGLApplicationImpl::keyboard_callback_;
+std::function<void(unsigned char key, int x, int y)> OpenGLApplicationImpl::keyboard_release_callback_;
 std::function<void(int button, int state, int x, int y)> OpenGLApplicationImpl::mouse_button_callback_;
 std::function<void(int x, int y)> OpenGLApplicationImpl::mouse_move_callback_;
+std::vector<OpenGLApplicationImpl::InputEvent> OpenGLApplicationImpl::events_;
+std::vector<double> OpenGLApplicationImpl::dispatched_times_;
+double OpenGLApplicationImpl::last_time_ = -1.0;
+double OpenGLApplicationImpl::accumulator_ = 0.0;
+double OpenGLApplicationImpl::simulation_time_ = 0.0;
+double OpenGLApplicationImpl::alpha_ = 0.0;
+InputLatencyStats OpenGLApplicationImpl::latency_;
+double OpenGLApplicationImpl::latency_sum_ms_ = 0.0;
+std::array<double, 256> OpenGLApplicationImpl::latency_samples_;
 
 }  // namespace gl_hwk
\ No newline at end of file
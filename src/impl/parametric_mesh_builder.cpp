@@ -0,0 +1,443 @@
+#include "gl_homework/parametric_mesh_builder.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+// OpenGL
+#include <glm/gtc/constants.hpp>
+// third party
+#include <fmt/core.h>
+// project
+#include "gl_homework/job_system.hpp"
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+namespace {
+
+struct Vertex {
+  glm::vec3 position;
+  glm::vec2 uv;
+  glm::vec3 normal;
+  glm::vec3 tangent;
+};
+
+// 顶点数超过该值时并行生成
+constexpr size_t kParallelVertices = 16384;
+// 平面没有曲率，按每个格子在屏幕上约占的像素数选择段数
+constexpr float kPlaneCellPixels = 32.0f;
+
+auto writeVertex(ParametricMesh& mesh, size_t index, const Vertex& vertex) -> void {
+  mesh.positions[index] = vertex.position;
+  float* data = mesh.other_data.data() + index * 9;
+  const float values[9] = {vertex.uv.x,      vertex.uv.y,      0.0f,          vertex.normal.x, vertex.normal.y,
+                           vertex.normal.z, vertex.tangent.x, vertex.tangent.y, vertex.tangent.z};
+  std::memcpy(data, values, sizeof(values));
+}
+
+auto resize(ParametricMesh& mesh, size_t vertices, size_t indices) -> std::pair<size_t, size_t> {
+  size_t vertex_base = mesh.positions.size();
+  size_t index_base = mesh.indices.size();
+  mesh.positions.resize(vertex_base + vertices);
+  mesh.other_data.resize((vertex_base + vertices) * 9);
+  mesh.indices.resize(index_base + indices);
+  return {vertex_base, index_base};
+}
+
+struct GridOptions {
+  // 翻转三角形的环绕方向，使正面朝向法线
+  bool flip = false;
+  // 第一行和最后一行退化为极点，相邻的四边形只生成一个三角形
+  bool poles = false;
+};
+
+/**
+ * @brief rings * (cols + 1)个顶点的网格，每行首尾顶点位置相同、纹理坐标不同；vertex(i, j)返回第i行第j列的顶点
+ * 相邻两行之间的四边形拆成两个三角形，每行的索引位置固定，可以按行并行生成
+ */
+template <typename Func>
+auto grid(ParametricMesh& mesh, uint32_t rings, uint32_t cols, const GridOptions& options, Func&& vertex) -> void {
+  size_t row = cols + 1;
+  size_t quad_rows = rings - 1;
+  size_t index_count = options.poles ? (quad_rows - 1) * cols * 6 : quad_rows * cols * 6;
+  auto [vertex_base, index_base] = resize(mesh, rings * row, index_count);
+  auto row_start = [&](size_t i) -> size_t {
+    if (!options.poles) {
+      return i * cols * 6;
+    }
+    return i == 0 ? 0 : cols * 3 + (i - 1) * cols * 6;
+  };
+  auto fill = [&, vertex_base = vertex_base, index_base = index_base](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      for (uint32_t j = 0; j <= cols; ++j) {
+        writeVertex(mesh, vertex_base + i * row + j, vertex(static_cast<uint32_t>(i), j));
+      }
+      if (i + 1 == rings) {
+        continue;
+      }
+      bool first = options.poles && i == 0;
+      bool last = options.poles && i + 2 == rings;
+      GLsizei* out = mesh.indices.data() + index_base + row_start(i);
+      for (uint32_t j = 0; j < cols; ++j) {
+        auto a = static_cast<GLsizei>(vertex_base + i * row + j);
+        auto b = a + 1;
+        auto c = static_cast<GLsizei>(a + row);
+        auto d = c + 1;
+        if (options.flip) {
+          std::swap(b, c);
+        }
+        if (!first) {
+          *out++ = a;
+          *out++ = b;
+          *out++ = c;
+        }
+        if (!last) {
+          *out++ = b;
+          *out++ = d;
+          *out++ = c;
+        }
+      }
+    }
+  };
+  if (static_cast<size_t>(rings) * row >= kParallelVertices) {
+    JobSystem::instance().parallelFor(rings, std::max<size_t>(1, kParallelVertices / row / 4), fill);
+  } else {
+    fill(0, rings);
+  }
+}
+
+/**
+ * @brief 圆柱的端面，中心一个顶点加一圈顶点，up为true时法线朝+Y
+ */
+auto disk(ParametricMesh& mesh, float y, float radius, uint32_t cols, bool up) -> void {
+  auto [vertex_base, index_base] = resize(mesh, cols + 2, static_cast<size_t>(cols) * 3);
+  glm::vec3 normal(0.0f, up ? 1.0f : -1.0f, 0.0f);
+  writeVertex(mesh, vertex_base, {glm::vec3(0.0f, y, 0.0f), glm::vec2(0.5f), normal, glm::vec3(1.0f, 0.0f, 0.0f)});
+  for (uint32_t j = 0; j <= cols; ++j) {
+    float phi = glm::two_pi<float>() * j / cols;
+    float c = std::cos(phi), s = std::sin(phi);
+    writeVertex(mesh, vertex_base + 1 + j,
+                {glm::vec3(c * radius, y, s * radius), glm::vec2(0.5f + 0.5f * c, 0.5f + 0.5f * s), normal,
+                 glm::vec3(1.0f, 0.0f, 0.0f)});
+  }
+  auto center = static_cast<GLsizei>(vertex_base);
+  for (uint32_t j = 0; j < cols; ++j) {
+    GLsizei a = center + 1 + j, b = a + 1;
+    GLsizei* out = mesh.indices.data() + index_base + j * 3;
+    out[0] = center;
+    out[1] = up ? b : a;
+    out[2] = up ? a : b;
+  }
+}
+
+/**
+ * @brief 球面上的点，theta从+Y开始的极角，phi绕Y轴的方位角
+ */
+auto sphereNormal(float theta, float phi) -> glm::vec3 {
+  return glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+}
+
+auto phiTangent(float phi) -> glm::vec3 { return glm::vec3(-std::sin(phi), 0.0f, std::cos(phi)); }
+
+auto uvSphere(ParametricMesh& mesh, float radius, uint32_t segments) -> void {
+  uint32_t rings = segments / 2 + 1;
+  grid(mesh, rings, segments, {false, true}, [&](uint32_t i, uint32_t j) {
+    float v = static_cast<float>(i) / (rings - 1);
+    float u = static_cast<float>(j) / segments;
+    float theta = glm::pi<float>() * v, phi = glm::two_pi<float>() * u;
+    glm::vec3 normal = sphereNormal(theta, phi);
+    return Vertex{normal * radius, glm::vec2(u, 1.0f - v), normal, phiTangent(phi)};
+  });
+}
+
+auto cylinder(ParametricMesh& mesh, float radius, float height, uint32_t segments) -> void {
+  grid(mesh, 2, segments, {}, [&](uint32_t i, uint32_t j) {
+    float u = static_cast<float>(j) / segments;
+    float phi = glm::two_pi<float>() * u;
+    glm::vec3 normal(std::cos(phi), 0.0f, std::sin(phi));
+    float y = i == 0 ? height * 0.5f : -height * 0.5f;
+    return Vertex{normal * radius + glm::vec3(0.0f, y, 0.0f), glm::vec2(u, i == 0 ? 1.0f : 0.0f), normal,
+                  phiTangent(phi)};
+  });
+  disk(mesh, height * 0.5f, radius, segments, true);
+  disk(mesh, -height * 0.5f, radius, segments, false);
+}
+
+auto torus(ParametricMesh& mesh, float radius, float minor_radius, uint32_t segments) -> void {
+  uint32_t rings = std::max(3u, segments / 2) + 1;
+  grid(mesh, rings, segments, {true, false}, [&](uint32_t i, uint32_t j) {
+    float v = static_cast<float>(i) / (rings - 1);
+    float u = static_cast<float>(j) / segments;
+    float theta = glm::two_pi<float>() * v, phi = glm::two_pi<float>() * u;
+    glm::vec3 normal(std::cos(theta) * std::cos(phi), std::sin(theta), std::cos(theta) * std::sin(phi));
+    glm::vec3 center(radius * std::cos(phi), 0.0f, radius * std::sin(phi));
+    return Vertex{center + normal * minor_radius, glm::vec2(u, v), normal, phiTangent(phi)};
+  });
+}
+
+auto plane(ParametricMesh& mesh, const glm::vec2& size, uint32_t segments) -> void {
+  grid(mesh, segments + 1, segments, {true, false}, [&](uint32_t i, uint32_t j) {
+    float u = static_cast<float>(j) / segments;
+    float v = static_cast<float>(i) / segments;
+    return Vertex{glm::vec3((u - 0.5f) * size.x, 0.0f, (v - 0.5f) * size.y), glm::vec2(u, 1.0f - v),
+                  glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f)};
+  });
+}
+
+/**
+ * @brief 上下两个半球各hemi + 1行，两个半球的赤道之间为圆柱面
+ */
+auto capsule(ParametricMesh& mesh, float radius, float height, uint32_t segments) -> void {
+  uint32_t hemi = std::max(2u, segments / 4);
+  float total = height + 2.0f * radius;
+  grid(mesh, 2 * (hemi + 1), segments, {false, true}, [&](uint32_t i, uint32_t j) {
+    bool top = i <= hemi;
+    float theta = top ? glm::half_pi<float>() * i / hemi : glm::half_pi<float>() * (1.0f + (i - hemi - 1.0f) / hemi);
+    float u = static_cast<float>(j) / segments;
+    float phi = glm::two_pi<float>() * u;
+    glm::vec3 normal = sphereNormal(theta, phi);
+    glm::vec3 position = normal * radius + glm::vec3(0.0f, top ? height * 0.5f : -height * 0.5f, 0.0f);
+    return Vertex{position, glm::vec2(u, position.y / total + 0.5f), normal, phiTangent(phi)};
+  });
+}
+
+/**
+ * @brief 二十面体逐次细分后投影到球面，纹理坐标按经纬度计算
+ */
+auto icoSphere(ParametricMesh& mesh, float radius, uint32_t subdivisions) -> void {
+  const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+  std::vector<glm::vec3> points = {{-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0}, {0, -1, t}, {0, 1, t},
+                                   {0, -1, -t}, {0, 1, -t}, {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}};
+  for (auto& p : points) {
+    p = glm::normalize(p);
+  }
+  std::vector<uint32_t> faces = {0, 11, 5, 0, 5,  1,  0,  1,  7,  0,  7,  10, 0, 10, 11, 1, 5, 9, 5, 11,
+                                 4, 11, 10, 2, 10, 7, 6, 7, 1, 8, 3, 9,  4,  3,  4,  2,  3,  2,  6, 3,
+                                 6, 8,  3,  8, 9,  4,  9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1};
+  for (uint32_t level = 0; level < subdivisions; ++level) {
+    std::unordered_map<uint64_t, uint32_t> midpoints;
+    midpoints.reserve(faces.size());
+    auto midpoint = [&](uint32_t a, uint32_t b) {
+      uint64_t key = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+      auto [it, inserted] = midpoints.try_emplace(key, static_cast<uint32_t>(points.size()));
+      if (inserted) {
+        points.push_back(glm::normalize(points[a] + points[b]));
+      }
+      return it->second;
+    };
+    std::vector<uint32_t> next;
+    next.reserve(faces.size() * 4);
+    for (size_t f = 0; f < faces.size(); f += 3) {
+      uint32_t a = faces[f], b = faces[f + 1], c = faces[f + 2];
+      uint32_t ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+      next.insert(next.end(), {a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca});
+    }
+    faces.swap(next);
+  }
+
+  auto [vertex_base, index_base] = resize(mesh, points.size(), faces.size());
+  auto fill = [&, vertex_base = vertex_base](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const glm::vec3& n = points[i];
+      float phi = std::atan2(n.z, n.x);
+      float u = phi / glm::two_pi<float>() + 0.5f;
+      float v = 1.0f - std::acos(std::clamp(n.y, -1.0f, 1.0f)) / glm::pi<float>();
+      writeVertex(mesh, vertex_base + i, {n * radius, glm::vec2(u, v), n, phiTangent(phi)});
+    }
+  };
+  if (points.size() >= kParallelVertices) {
+    JobSystem::instance().parallelFor(points.size(), kParallelVertices / 4, fill);
+  } else {
+    fill(0, points.size());
+  }
+  for (size_t i = 0; i < faces.size(); ++i) {
+    mesh.indices[index_base + i] = static_cast<GLsizei>(vertex_base + faces[i]);
+  }
+}
+
+auto sameParams(const ParametricParams& a, const ParametricParams& b) -> bool {
+  return a.shape == b.shape && a.radius == b.radius && a.minor_radius == b.minor_radius && a.height == b.height &&
+         a.size == b.size;
+}
+
+}  // namespace
+
+class ParametricMeshBuilderImpl {
+ public:
+  // 段数上限，避免翻倍时溢出
+  static constexpr uint32_t kMaxSegments = 1u << 16;
+
+  struct CachedMesh {
+    ParametricParams params;
+    uint32_t segments;
+    const Primitive* primitive;
+  };
+
+  ParametricMeshBuilderImpl(std::shared_ptr<PrimitiveBuilder> primitive_builder, const ParametricLodOptions& options)
+      : primitive_builder_(std::move(primitive_builder)), options_(clampOptions(options)) {}
+
+  /**
+   * @brief 段数范围修正为2的幂：min_segments至少为4，max_segments不小于min_segments，都不超过kMaxSegments
+   */
+  static auto clampOptions(ParametricLodOptions options) -> ParametricLodOptions {
+    auto floor_pow2 = [](uint32_t value) {
+      uint32_t pow2 = 1;
+      while (pow2 * 2 <= value) {
+        pow2 *= 2;
+      }
+      return pow2;
+    };
+    const uint32_t min_segments = std::clamp(options.min_segments, 3u, kMaxSegments);
+    options.min_segments = floor_pow2(min_segments - 1) * 2;
+    options.max_segments = std::max(floor_pow2(std::min(options.max_segments, kMaxSegments)), options.min_segments);
+    return options;
+  }
+
+  static auto hash(const ParametricParams& params, uint32_t segments) -> uint64_t {
+    uint64_t h = 14695981039346656037ULL;
+    auto mix = [&h](uint32_t word) { h = (h ^ word) * 1099511628211ULL; };
+    const float values[5] = {params.radius, params.minor_radius, params.height, params.size.x, params.size.y};
+    for (float value : values) {
+      uint32_t word;
+      std::memcpy(&word, &value, sizeof(word));
+      mix(word);
+    }
+    mix(static_cast<uint32_t>(params.shape));
+    mix(segments);
+    return h;
+  }
+
+  /**
+   * @brief 弦高误差 = R * (1 - cos(pi / N)) ≈ R * pi^2 / (2 * N^2)，R为投影后的像素数
+   */
+  auto segmentsForRadius(float radius_pixels) const -> float {
+    return glm::pi<float>() * std::sqrt(std::max(radius_pixels, 0.0f) / (2.0f * options_.pixel_error));
+  }
+
+  std::shared_ptr<PrimitiveBuilder> primitive_builder_;
+  ParametricLodOptions options_;
+  std::unordered_map<uint64_t, std::vector<CachedMesh>> cache_;
+  size_t cached_count_ = 0;
+};
+
+ParametricMeshBuilder::ParametricMeshBuilder(std::shared_ptr<PrimitiveBuilder> primitive_builder,
+                                             const ParametricLodOptions& options)
+    : impl_(make_unique_impl<ParametricMeshBuilderImpl>(std::move(primitive_builder), options)) {}
+
+// 在ParametricMeshBuilderImpl完整定义处析构
+ParametricMeshBuilder::~ParametricMeshBuilder() = default;
+
+auto ParametricMeshBuilder::generate(const ParametricParams& params, uint32_t segments) -> ParametricMesh {
+  GL_HWK_TRACE_SCOPE("ParametricMeshBuilder::generate");
+  ParametricMesh mesh;
+  switch (params.shape) {
+    case ParametricShape::kUvSphere:
+      uvSphere(mesh, params.radius, std::max(4u, segments));
+      break;
+    case ParametricShape::kIcoSphere: {
+      // 二十面体赤道附近约5条边，每次细分翻倍
+      uint32_t subdivisions = 0;
+      while (subdivisions < 7 && (5u << subdivisions) < segments) {
+        subdivisions++;
+      }
+      icoSphere(mesh, params.radius, subdivisions);
+      break;
+    }
+    case ParametricShape::kCylinder:
+      cylinder(mesh, params.radius, params.height, std::max(3u, segments));
+      break;
+    case ParametricShape::kTorus:
+      torus(mesh, params.radius, params.minor_radius, std::max(3u, segments));
+      break;
+    case ParametricShape::kPlane:
+      plane(mesh, params.size, std::max(1u, segments));
+      break;
+    case ParametricShape::kCapsule:
+      capsule(mesh, params.radius, params.height, std::max(4u, segments));
+      break;
+  }
+  return mesh;
+}
+
+auto ParametricMeshBuilder::selectSegments(const ParametricParams& params, Camera& camera, const glm::mat4& model)
+    -> uint32_t {
+  auto& impl = *impl_;
+  float scale = std::max({glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])),
+                          glm::length(glm::vec3(model[2]))});
+  float bounds = 0.0f;
+  switch (params.shape) {
+    case ParametricShape::kUvSphere:
+    case ParametricShape::kIcoSphere:
+      bounds = params.radius;
+      break;
+    case ParametricShape::kCylinder:
+      bounds = glm::length(glm::vec2(params.radius, params.height * 0.5f));
+      break;
+    case ParametricShape::kTorus:
+      bounds = params.radius + params.minor_radius;
+      break;
+    case ParametricShape::kPlane:
+      bounds = glm::length(params.size) * 0.5f;
+      break;
+    case ParametricShape::kCapsule:
+      bounds = params.radius + params.height * 0.5f;
+      break;
+  }
+  // 到包围球表面的距离，摄像机在包围球内时按近裁剪面计算
+  float distance = glm::length(glm::vec3(model[3]) - camera.getPosition()) - bounds * scale;
+  float pixels_per_unit = scale * camera.getFocalLength() / std::max(distance, camera.getNearPlane());
+
+  float segments = 0.0f;
+  switch (params.shape) {
+    case ParametricShape::kTorus:
+      // 管的段数为圆周方向的一半
+      segments = std::max(impl.segmentsForRadius(params.radius * pixels_per_unit),
+                          2.0f * impl.segmentsForRadius(params.minor_radius * pixels_per_unit));
+      break;
+    case ParametricShape::kPlane:
+      segments = std::max(params.size.x, params.size.y) * pixels_per_unit / kPlaneCellPixels;
+      break;
+    default:
+      segments = impl.segmentsForRadius(params.radius * pixels_per_unit);
+      break;
+  }
+  // 量化为2的幂，相近距离的物体共用同一个网格
+  uint32_t level = impl.options_.min_segments;
+  while (level < impl.options_.max_segments && static_cast<float>(level) < segments) {
+    level *= 2;
+  }
+  return std::min(level, impl.options_.max_segments);
+}
+
+auto ParametricMeshBuilder::draw(const ParametricParams& params, Camera& camera, const glm::mat4& model) -> uint32_t {
+  uint32_t segments = selectSegments(params, camera, model);
+  draw(params, segments);
+  return segments;
+}
+
+auto ParametricMeshBuilder::draw(const ParametricParams& params, uint32_t segments) -> void {
+  auto& impl = *impl_;
+  uint64_t key = ParametricMeshBuilderImpl::hash(params, segments);
+  auto& bucket = impl.cache_[key];
+  for (const auto& cached : bucket) {
+    if (cached.segments == segments && sameParams(cached.params, params)) {
+      impl.primitive_builder_->drawPrimitive(cached.primitive);
+      return;
+    }
+  }
+  auto mesh = generate(params, segments);
+  auto name = fmt::format("parametric_{}_{}", key, bucket.size());
+  impl.primitive_builder_->buildTriangles(name, mesh.positions, mesh.indices, mesh.other_data, 3);
+  bucket.push_back({params, segments, impl.primitive_builder_->findPrimitive(name)});
+  impl.cached_count_++;
+}
+
+auto ParametricMeshBuilder::getCachedCount() -> size_t { return impl_->cached_count_; }
+
+}  // namespace gl_hwk
@@ -1,9 +1,16 @@
 #include "gl_homework/primitive_builder.hpp"
 
+#include <array>
 #include <cstdint>
 #include <optional>
 #include <unordered_map>
 
+#include "gl_homework/frame_arena.hpp"
+#include "gl_homework/gpu_profiler.hpp"
+#include "gl_homework/render_stats.hpp"
+#include "gl_homework/software_renderer.hpp"
+#include "gl_homework/trace.hpp"
+
 namespace gl_hwk {
 
 struct Primitive {
@@ -13,13 +20,116 @@ struct Primitive {
   GLenum type;
   GLsizei size;
   GLuint other_data_num;
+  // GPU计时使用的scope名，创建时生成避免每次绘制拼接字符串
+  std::string profile_name;
+  // 使用CPU渲染后端时保存的交错顶点数据和索引
+  std::vector<float> vertices;
+  std::vector<GLsizei> indices;
+  // 计入RenderStats的缓冲区字节数，析构时减去
+  uint64_t bytes = 0;
 };
 
 class PrimitiveBuilderImpl {
  public:
-  explicit PrimitiveBuilderImpl() {}
+  static constexpr GLuint kInstanceAttribBegin = 8;
+  static constexpr GLuint kInstanceAttribCount = 8;
+
+  explicit PrimitiveBuilderImpl(std::shared_ptr<SoftwareRenderer> software = nullptr)
+      : software_(std::move(software)) {}
+
+  ~PrimitiveBuilderImpl() {
+    // aliases_只指向infos_中的图元，不重复释放
+    for (auto& [name, info] : infos_) {
+      if (info.vao != 0) {
+        glDeleteVertexArrays(1, &info.vao);
+        glDeleteBuffers(1, &info.vbo);
+      }
+      if (info.ebo) {
+        glDeleteBuffers(1, &*info.ebo);
+      }
+      RenderStats::instance().addPrimitive(-1, -static_cast<int64_t>(info.bytes));
+    }
+  }
 
   auto draw(const Primitive& info) {
+    if (software_) {
+      drawSoftware(info);
+      RenderStats::instance().addDrawCall(info.type, info.size);
+      return;
+    }
+    GpuProfileScope scope(info.profile_name);
+    bind(info);
+    if (info.ebo.has_value()) {
+      glDrawElements(info.type, info.size, GL_UNSIGNED_INT, 0);
+    } else {
+      glDrawArrays(info.type, 0, info.size);
+    }
+
+    auto& stats = RenderStats::instance();
+    // VAO、VBO绑定，每个属性的pointer和enable，以及EBO绑定
+    stats.addStateChange(2 + (1 + info.other_data_num) * 2 + (info.ebo.has_value() ? 1 : 0));
+    stats.addDrawCall(info.type, info.size);
+  }
+
+  /**
+   * @brief 实例数据占用location 8~11(model)和12~15(法线矩阵)，每个mat4按4个vec4传入，每个实例前进一次
+   * GL 3.3没有base instance，从first开始绘制时偏移属性指针
+   */
+  auto drawInstanced(const Primitive& info, GLuint instance_vbo, size_t first, GLsizei count) {
+    GpuProfileScope scope(info.profile_name);
+    bind(info);
+    glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    for (GLuint i = 0; i < kInstanceAttribCount; ++i) {
+      GLuint location = kInstanceAttribBegin + i;
+      glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                            (void*)(first * sizeof(InstanceData) + i * sizeof(glm::vec4)));
+      glVertexAttribDivisor(location, 1);
+      glEnableVertexAttribArray(location);
+    }
+
+    if (info.ebo.has_value()) {
+      glDrawElementsInstanced(info.type, info.size, GL_UNSIGNED_INT, 0, count);
+    } else {
+      glDrawArraysInstanced(info.type, 0, info.size, count);
+    }
+
+    // VAO被普通绘制共用，绘制后关闭实例属性
+    for (GLuint i = 0; i < kInstanceAttribCount; ++i) {
+      glDisableVertexAttribArray(kInstanceAttribBegin + i);
+    }
+
+    auto& stats = RenderStats::instance();
+    stats.addStateChange(2 + (1 + info.other_data_num) * 2 + (info.ebo.has_value() ? 1 : 0) + 1 +
+                         kInstanceAttribCount * 4);
+    stats.addDrawCall(info.type, info.size, count);
+  }
+
+  auto drawSoftware(const Primitive& info) -> void {
+    auto stride = 3 + info.other_data_num * 3;
+    software_->draw(info.type, info.vertices.data(), stride, static_cast<uint32_t>(info.vertices.size() / stride),
+                    info.indices.empty() ? nullptr : info.indices.data(), static_cast<uint32_t>(info.indices.size()));
+  }
+
+  /**
+   * @brief CPU渲染时逐个实例绘制，临时替换renderer的model和法线矩阵
+   */
+  auto drawInstancedSoftware(const Primitive& info, const InstanceData* instances, size_t count) -> void {
+    auto& uniforms = software_->uniforms();
+    glm::mat4 model = uniforms.model;
+    glm::mat3 normal_matrix = uniforms.normal_matrix;
+    for (size_t i = 0; i < count; ++i) {
+      uniforms.model = instances[i].model;
+      uniforms.normal_matrix = glm::mat3(instances[i].normal);
+      drawSoftware(info);
+    }
+    uniforms.model = model;
+    uniforms.normal_matrix = normal_matrix;
+    RenderStats::instance().addDrawCall(info.type, info.size, static_cast<int64_t>(count));
+  }
+
+  auto isSoftware() const -> bool { return software_ != nullptr; }
+
+  auto bind(const Primitive& info) -> void {
     glBindVertexArray(info.vao);
     glBindBuffer(GL_ARRAY_BUFFER, info.vbo);
     uint32_t vertex_total_data_num = 3 + info.other_data_num * 3;
@@ -32,25 +142,35 @@ class PrimitiveBuilderImpl {
                             (void*)((3 + i * 3) * sizeof(float)));
       glEnableVertexAttribArray(1 + i);
     }
-
     if (info.ebo.has_value()) {
       glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, info.ebo.value());
-      glDrawElements(info.type, info.size, GL_UNSIGNED_INT, 0);
-    } else {
-      glDrawArrays(info.type, 0, info.size);
     }
   }
 
   auto buildPrimitvie(GLenum type, const std::string& name, const std::vector<glm::vec3>& positions,
                       const std::vector<GLsizei>& indices, const std::vector<std::vector<float>>& other_data) -> void {
     assert(positions.size() >= other_data.size());
+    uint32_t other_data_num = other_data.empty() ? 0 : other_data.front().size();
+    other_data_num = static_cast<uint32_t>(other_data_num / 3);
+    buildPrimitvie(type, name, positions, indices, other_data_num,
+                   [&other_data](size_t i) { return other_data[i].data(); });
+  }
+
+  /**
+   * @brief 所有build函数共用的创建和上传，row(i)返回第i个顶点的other data
+   */
+  template <typename Row>
+  auto buildPrimitvie(GLenum type, const std::string& name, const std::vector<glm::vec3>& positions,
+                      const std::vector<GLsizei>& indices, uint32_t other_data_num, Row&& row) -> void {
     assert(!name.empty());
 
-    if (infos_.find(name) != infos_.end()) {
-      auto& info = infos_[name];
-      assert(info.type == type);
-      draw(info);
+    if (const auto* info = find(name)) {
+      assert(info->type == type);
+      draw(*info);
+    } else if (software_) {
+      buildSoftware(type, name, positions, indices, other_data_num, row);
     } else {
+      GL_HWK_TRACE_SCOPE("PrimitiveBuilder::createBuffers");
       GLuint vao, vbo;
       glGenVertexArrays(1, &vao);
       glGenBuffers(1, &vbo);
@@ -58,23 +178,24 @@ class PrimitiveBuilderImpl {
       glBindBuffer(GL_ARRAY_BUFFER, vbo);
 
       infos_[name] = {vao, vbo, std::nullopt, type, static_cast<GLsizei>(positions.size())};
-
-      uint32_t other_data_num = other_data.empty() ? 0 : other_data.front().size();
-      other_data_num = static_cast<uint32_t>(other_data_num / 3);
+      infos_[name].profile_name = "primitive/" + name;
       infos_[name].other_data_num = other_data_num;
 
-      std::vector<GLfloat> vertices_data;
+      // 交错后的顶点数据上传后即丢弃，从每帧的线性分配器中分配
+      auto vertices_data = FrameArena::instance().makeVector<GLfloat>(positions.size() * (3 + other_data_num * 3));
       for (size_t i = 0; i < positions.size(); ++i) {
         vertices_data.emplace_back(positions[i].x);
         vertices_data.emplace_back(positions[i].y);
         vertices_data.emplace_back(positions[i].z);
 
-        for (size_t j = 0; j < other_data_num * 3; ++j) {
-          vertices_data.emplace_back(other_data[i][j]);
+        if (other_data_num > 0) {
+          const float* data = row(i);
+          vertices_data.insert(vertices_data.end(), data, data + other_data_num * 3);
         }
       }
 
       glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertices_data.size(), vertices_data.data(), GL_STATIC_DRAW);
+      uint64_t buffer_bytes = sizeof(GLfloat) * vertices_data.size();
 
       if (!indices.empty()) {
         GLuint ebo;
@@ -83,18 +204,95 @@ class PrimitiveBuilderImpl {
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLsizei) * indices.size(), indices.data(), GL_STATIC_DRAW);
         infos_[name].size = indices.size();
         infos_[name].ebo = ebo;
+        buffer_bytes += sizeof(GLsizei) * indices.size();
       }
+      RenderStats::instance().addBufferUpload(buffer_bytes);
+      infos_[name].bytes = buffer_bytes;
+      RenderStats::instance().addPrimitive(1, static_cast<int64_t>(buffer_bytes));
 
       draw(infos_[name]);
     }
   }
 
+  /**
+   * @brief CPU渲染后端的图元，交错数据保存在Primitive中，不创建GL对象
+   */
+  template <typename Row>
+  auto buildSoftware(GLenum type, const std::string& name, const std::vector<glm::vec3>& positions,
+                     const std::vector<GLsizei>& indices, uint32_t other_data_num, Row&& row) -> void {
+    auto& info = infos_[name];
+    info = {0, 0, std::nullopt, type, static_cast<GLsizei>(indices.empty() ? positions.size() : indices.size())};
+    info.other_data_num = other_data_num;
+    info.vertices.reserve(positions.size() * (3 + other_data_num * 3));
+    for (size_t i = 0; i < positions.size(); ++i) {
+      info.vertices.insert(info.vertices.end(), {positions[i].x, positions[i].y, positions[i].z});
+      if (other_data_num > 0) {
+        const float* data = row(i);
+        info.vertices.insert(info.vertices.end(), data, data + other_data_num * 3);
+      }
+    }
+    info.indices = indices;
+    info.bytes = sizeof(float) * info.vertices.size() + sizeof(GLsizei) * indices.size();
+    RenderStats::instance().addPrimitive(1, static_cast<int64_t>(info.bytes));
+    draw(info);
+  }
+
+  /**
+   * @brief 单个顶点数据的build函数：已缓存时直接绘制，不构造临时数组；否则每个顶点使用同一份other_data
+   */
+  template <size_t N>
+  auto buildSingle(GLenum type, const std::string& name, const std::array<glm::vec3, N>& positions,
+                   const std::vector<float>& other_data) -> void {
+    if (const auto* info = find(name)) {
+      assert(info->type == type);
+      draw(*info);
+      return;
+    }
+    buildPrimitvie(type, name, {positions.begin(), positions.end()}, {},
+                   std::vector<std::vector<float>>(other_data.empty() ? 0 : N, other_data));
+  }
+
+  auto find(const std::string& name) -> const Primitive* {
+    if (auto it = infos_.find(name); it != infos_.end()) {
+      return &it->second;
+    }
+    if (auto it = aliases_.find(name); it != aliases_.end()) {
+      return it->second;
+    }
+    return nullptr;
+  }
+
+  auto addAlias(const std::string& alias, const std::string& name) -> bool {
+    if (find(alias)) {
+      fmt::print("PrimitiveBuilder: primitive {} already exists\n", alias);
+      return false;
+    }
+    const auto* primitive = find(name);
+    if (!primitive) {
+      fmt::print("PrimitiveBuilder: primitive {} not built\n", name);
+      return false;
+    }
+    aliases_[alias] = primitive;
+    return true;
+  }
+
  private:
+  std::shared_ptr<SoftwareRenderer> software_;
+  // unordered_map的元素地址在插入后保持不变，findPrimitive返回的指针依赖这一点
   std::unordered_map<std::string, Primitive> infos_;
+  // 共用其他名字图元的别名，不单独占用缓冲区
+  std::unordered_map<std::string, const Primitive*> aliases_;
 };
 
 PrimitiveBuilder::PrimitiveBuilder() { impl_ = make_unique_impl<PrimitiveBuilderImpl>(); }
 
+PrimitiveBuilder::PrimitiveBuilder(std::shared_ptr<SoftwareRenderer> renderer) {
+  impl_ = make_unique_impl<PrimitiveBuilderImpl>(std::move(renderer));
+}
+
+// 在PrimitiveBuilderImpl完整定义处析构，释放图元的缓冲区和持有的SoftwareRenderer
+PrimitiveBuilder::~PrimitiveBuilder() = default;
+
 auto PrimitiveBuilder::buildPoints(const std::string& name, const std::vector<glm::vec3>& positions,
                                    const std::vector<std::vector<float>>& other_data) -> void {
   impl_->buildPrimitvie(GL_POINTS, name, positions, {}, other_data);
@@ -102,8 +300,7 @@ auto PrimitiveBuilder::buildPoints(const std::string& name, const std::vector<gl
 
 auto PrimitiveBuilder::buildPoint(const std::string& name, const glm::vec3& position,
                                   const std::vector<float>& other_data) -> void {
-  auto positions = std::vector<glm::vec3>{position};
-  impl_->buildPrimitvie(GL_POINTS, name, positions, {}, {other_data});
+  impl_->buildSingle<1>(GL_POINTS, name, {position}, other_data);
 }
 
 auto PrimitiveBuilder::buildLines(const std::string& name, const std::vector<glm::vec3>& positions,
@@ -114,8 +311,7 @@ auto PrimitiveBuilder::buildLines(const std::string& name, const std::vector<glm
 
 auto PrimitiveBuilder::buildLine(const std::string& name, const glm::vec3& start, const glm::vec3& end,
                                  const std::vector<float>& other_data) -> void {
-  auto positions = std::vector<glm::vec3>{start, end};
-  impl_->buildPrimitvie(GL_LINES, name, positions, {}, {other_data});
+  impl_->buildSingle<2>(GL_LINES, name, {start, end}, other_data);
 }
 
 auto PrimitiveBuilder::buildLineStrip(const std::string& name, const std::vector<glm::vec3>& positions,
@@ -146,10 +342,19 @@ auto PrimitiveBuilder::buildTriangles(const std::string& name, const std::vector
   impl_->buildPrimitvie(GL_TRIANGLES, name, positions, indices, other_data);
 }
 
+auto PrimitiveBuilder::buildTriangles(const std::string& name, const std::vector<glm::vec3>& positions,
+                                      const std::vector<GLsizei>& indices, const std::vector<float>& other_data,
+                                      uint32_t other_data_num) -> void {
+  assert(other_data.size() >= positions.size() * other_data_num * 3);
+  const float* data = other_data.data();
+  size_t stride = other_data_num * 3;
+  impl_->buildPrimitvie(GL_TRIANGLES, name, positions, indices, other_data_num,
+                        [data, stride](size_t i) { return data + i * stride; });
+}
+
 auto PrimitiveBuilder::buildTriangle(const std::string& name, const glm::vec3& p1, const glm::vec3& p2,
                                      const glm::vec3& p3, const std::vector<float>& other_data) -> void {
-  auto positions = std::vector<glm::vec3>{p1, p2, p3};
-  impl_->buildPrimitvie(GL_TRIANGLES, name, positions, {}, {other_data});
+  impl_->buildSingle<3>(GL_TRIANGLES, name, {p1, p2, p3}, other_data);
 }
 
 auto PrimitiveBuilder::buildTriangleStrip(const std::string& name, const std::vector<glm::vec3>& positions,
@@ -162,4 +367,47 @@ auto PrimitiveBuilder::buildTriangleStrip(const std::string& name, const std::ve
                                           const std::vector<std::vector<float>>& other_data) -> void {
   impl_->buildPrimitvie(GL_TRIANGLE_STRIP, name, positions, {}, other_data);
 }
+
+auto PrimitiveBuilder::findPrimitive(const std::string& name) -> const Primitive* { return impl_->find(name); }
+
+auto PrimitiveBuilder::addAlias(const std::string& alias, const std::string& name) -> bool {
+  return impl_->addAlias(alias, name);
+}
+
+auto PrimitiveBuilder::drawPrimitive(const Primitive* primitive) -> void {
+  if (primitive) {
+    impl_->draw(*primitive);
+  }
+}
+
+auto PrimitiveBuilder::drawInstanced(const std::string& name, InstanceBuffer& instances) -> bool {
+  return drawInstanced(name, instances, 0, instances.size());
+}
+
+auto PrimitiveBuilder::drawInstanced(const std::string& name, InstanceBuffer& instances, size_t first, size_t count)
+    -> bool {
+  auto* primitive = impl_->find(name);
+  if (!primitive) {
+    fmt::print("PrimitiveBuilder: primitive {} not built\n", name);
+    return false;
+  }
+  if (first + count > instances.size()) {
+    fmt::print("PrimitiveBuilder: instance range [{}, {}) of {} out of {}\n", first, first + count, name,
+               instances.size());
+    return false;
+  }
+  if (count == 0) {
+    return true;
+  }
+  if (impl_->isSoftware()) {
+    impl_->drawInstancedSoftware(*primitive, instances.data() + first, count);
+    return true;
+  }
+  if (instances.getBuffer() == 0) {
+    fmt::print("PrimitiveBuilder: instance buffer of {} not uploaded\n", name);
+    return false;
+  }
+  impl_->drawInstanced(*primitive, instances.getBuffer(), first, static_cast<GLsizei>(count));
+  return true;
+}
 }  // namespace gl_hwk
\ No newline at end of file
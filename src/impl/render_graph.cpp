@@ -0,0 +1,633 @@
+#include "gl_homework/render_graph.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+// third party
+#include <fmt/core.h>
+// project
+#include "gl_homework/gpu_profiler.hpp"
+#include "gl_homework/render_stats.hpp"
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+namespace {
+
+auto isDepthFormat(GLenum format) -> bool {
+  switch (format) {
+    case GL_DEPTH_COMPONENT16:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32:
+    case GL_DEPTH_COMPONENT32F:
+    case GL_DEPTH24_STENCIL8:
+    case GL_DEPTH32F_STENCIL8:
+      return true;
+    default:
+      return false;
+  }
+}
+
+auto hasStencil(GLenum format) -> bool { return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8; }
+
+auto bytesPerPixel(GLenum format) -> uint32_t {
+  switch (format) {
+    case GL_R8:
+      return 1;
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:
+      return 2;
+    case GL_RGB8:
+      return 3;
+    case GL_RGB16F:
+      return 6;
+    case GL_RGBA16F:
+    case GL_RG32F:
+    case GL_DEPTH32F_STENCIL8:
+      return 8;
+    case GL_RGB32F:
+      return 12;
+    case GL_RGBA32F:
+      return 16;
+    default:
+      // RGBA8、RG16F、R32F、R11F_G11F_B10F、RGB10_A2和24/32位深度
+      return 4;
+  }
+}
+
+auto textureBytes(const RenderTargetDesc& desc) -> uint64_t {
+  return static_cast<uint64_t>(desc.width) * desc.height * bytesPerPixel(desc.format);
+}
+
+}  // namespace
+
+class RenderTargetPoolImpl {
+ public:
+  struct Entry {
+    RenderTargetDesc desc;
+    // 最近一次归还时的帧号
+    uint64_t released_frame = 0;
+  };
+
+  static auto key(const RenderTargetDesc& desc) -> uint64_t {
+    return (static_cast<uint64_t>(desc.format) << 40) | (static_cast<uint64_t>(desc.width) << 20) | desc.height;
+  }
+
+  auto create(const RenderTargetDesc& desc) -> GLuint {
+    GLenum format = GL_RGBA;
+    GLenum type = GL_UNSIGNED_BYTE;
+    if (hasStencil(desc.format)) {
+      format = GL_DEPTH_STENCIL;
+      type = desc.format == GL_DEPTH32F_STENCIL8 ? GL_FLOAT_32_UNSIGNED_INT_24_8_REV : GL_UNSIGNED_INT_24_8;
+    } else if (isDepthFormat(desc.format)) {
+      format = GL_DEPTH_COMPONENT;
+      type = GL_FLOAT;
+    }
+    GLint previous;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, desc.format, desc.width, desc.height, 0, format, type, nullptr);
+    GLint filter = isDepthFormat(desc.format) ? GL_NEAREST : GL_LINEAR;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, previous);
+    RenderStats::instance().addTexture(GL_TEXTURE_2D, 1, static_cast<int64_t>(textureBytes(desc)));
+    bytes_ += textureBytes(desc);
+    return texture;
+  }
+
+  auto destroy(GLuint texture) -> void {
+    const auto& desc = entries_[texture].desc;
+    RenderStats::instance().addTexture(GL_TEXTURE_2D, -1, -static_cast<int64_t>(textureBytes(desc)));
+    bytes_ -= textureBytes(desc);
+    entries_.erase(texture);
+    glDeleteTextures(1, &texture);
+  }
+
+  std::unordered_map<uint64_t, std::vector<GLuint>> free_;
+  std::unordered_map<GLuint, Entry> entries_;
+  uint64_t frame_ = 0;
+  uint64_t bytes_ = 0;
+};
+
+RenderTargetPool::RenderTargetPool() : impl_(make_unique_impl<RenderTargetPoolImpl>()) {}
+
+auto RenderTargetPool::instance() -> RenderTargetPool& {
+  static RenderTargetPool instance;
+  return instance;
+}
+
+auto RenderTargetPool::acquire(const RenderTargetDesc& desc) -> GLuint {
+  if (desc.width == 0 || desc.height == 0 || desc.width >= (1u << 20) || desc.height >= (1u << 20)) {
+    fmt::print("RenderTargetPool: invalid size {}x{}\n", desc.width, desc.height);
+    return 0;
+  }
+  auto& free = impl_->free_[RenderTargetPoolImpl::key(desc)];
+  if (!free.empty()) {
+    // 取最近归还的，长时间没用的留在前面等待endFrame删除
+    GLuint texture = free.back();
+    free.pop_back();
+    return texture;
+  }
+  GLuint texture = impl_->create(desc);
+  impl_->entries_[texture] = {desc, impl_->frame_};
+  return texture;
+}
+
+auto RenderTargetPool::release(GLuint texture) -> void {
+  auto it = impl_->entries_.find(texture);
+  if (it == impl_->entries_.end()) {
+    fmt::print("RenderTargetPool: texture {} not from pool\n", texture);
+    return;
+  }
+  it->second.released_frame = impl_->frame_;
+  impl_->free_[RenderTargetPoolImpl::key(it->second.desc)].push_back(texture);
+}
+
+auto RenderTargetPool::endFrame(uint32_t max_idle_frames) -> void {
+  impl_->frame_++;
+  for (auto it = impl_->free_.begin(); it != impl_->free_.end();) {
+    auto& textures = it->second;
+    // 按归还顺序排列，过期的都在前面
+    size_t expired = 0;
+    while (expired < textures.size() &&
+           impl_->frame_ - impl_->entries_[textures[expired]].released_frame > max_idle_frames) {
+      impl_->destroy(textures[expired]);
+      expired++;
+    }
+    textures.erase(textures.begin(), textures.begin() + expired);
+    it = textures.empty() ? impl_->free_.erase(it) : std::next(it);
+  }
+}
+
+auto RenderTargetPool::trim() -> void {
+  for (auto& [key, textures] : impl_->free_) {
+    for (GLuint texture : textures) {
+      impl_->destroy(texture);
+    }
+  }
+  impl_->free_.clear();
+}
+
+auto RenderTargetPool::getStats() -> RenderTargetPoolStats {
+  RenderTargetPoolStats stats;
+  stats.textures = static_cast<uint32_t>(impl_->entries_.size());
+  for (const auto& [key, textures] : impl_->free_) {
+    stats.free += static_cast<uint32_t>(textures.size());
+  }
+  stats.bytes = impl_->bytes_;
+  return stats;
+}
+
+class RenderGraphImpl {
+ public:
+  struct Resource {
+    std::string name;
+    RenderTargetDesc desc;
+    bool imported = false;
+    bool output = false;
+    GLuint imported_texture = 0;
+    // 最新的版本，只能在最新版本上写入
+    uint32_t latest = 0;
+    // 第一个和最后一个使用它的pass，compile时计算
+    uint32_t first = UINT32_MAX;
+    uint32_t last = 0;
+    uint32_t slot = UINT32_MAX;
+  };
+
+  struct Version {
+    uint32_t resource;
+    uint32_t producer = UINT32_MAX;
+    // 读取这个版本的pass数，输出资源额外加1
+    uint32_t refs = 0;
+  };
+
+  struct Pass {
+    std::string name;
+    RenderPassExecuteFunc execute;
+    std::vector<uint32_t> reads;
+    std::vector<uint32_t> writes;
+    bool side_effect = false;
+    bool culled = false;
+    uint32_t refs = 0;
+  };
+
+  struct Slot {
+    RenderTargetDesc desc;
+    GLuint texture = 0;
+    bool in_use = false;
+    bool output = false;
+  };
+
+  explicit RenderGraphImpl(const RenderGraphOptions& options) : options_(options) {}
+
+  ~RenderGraphImpl() {
+    reset();
+    if (fbo_ != 0) {
+      glDeleteFramebuffers(1, &fbo_);
+    }
+  }
+
+  auto reset() -> void {
+    releaseSlots(true);
+    slots_.clear();
+    passes_.clear();
+    resources_.clear();
+    versions_.clear();
+    compiled_ = false;
+  }
+
+  /**
+   * @brief 归还slot的纹理，outputs为false时保留输出资源的纹理
+   */
+  auto releaseSlots(bool outputs) -> void {
+    for (auto& slot : slots_) {
+      if (slot.texture != 0 && (outputs || !slot.output)) {
+        RenderTargetPool::instance().release(slot.texture);
+        slot.texture = 0;
+      }
+    }
+  }
+
+  auto addResource(const std::string& name, const RenderTargetDesc& desc, bool imported, GLuint texture)
+      -> RenderResource {
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.imported = imported;
+    resource.imported_texture = texture;
+    resource.latest = static_cast<uint32_t>(versions_.size());
+    resources_.push_back(std::move(resource));
+    versions_.push_back({static_cast<uint32_t>(resources_.size() - 1)});
+    compiled_ = false;
+    return {static_cast<uint32_t>(versions_.size() - 1)};
+  }
+
+  auto addPass(const std::string& name, const RenderPassSetupFunc& setup, RenderPassExecuteFunc execute) -> void {
+    Pass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    passes_.push_back(std::move(pass));
+    compiled_ = false;
+    RenderGraphBuilder builder(this, static_cast<uint32_t>(passes_.size() - 1));
+    if (setup) {
+      setup(builder);
+    }
+  }
+
+  auto validVersion(RenderResource resource) const -> bool { return resource.index < versions_.size(); }
+
+  auto read(uint32_t pass, RenderResource resource) -> RenderResource {
+    if (!validVersion(resource)) {
+      fmt::print("RenderGraph: pass {} reads an invalid resource\n", passes_[pass].name);
+      return {};
+    }
+    auto& reads = passes_[pass].reads;
+    if (std::find(reads.begin(), reads.end(), resource.index) == reads.end()) {
+      reads.push_back(resource.index);
+      versions_[resource.index].refs++;
+    }
+    return resource;
+  }
+
+  auto write(uint32_t pass, RenderResource resource) -> RenderResource {
+    if (!validVersion(resource)) {
+      fmt::print("RenderGraph: pass {} writes an invalid resource\n", passes_[pass].name);
+      return {};
+    }
+    auto& entry = resources_[versions_[resource.index].resource];
+    if (entry.latest != resource.index) {
+      fmt::print("RenderGraph: pass {} writes an old version of {}\n", passes_[pass].name, entry.name);
+      return {};
+    }
+    // 之前写入的内容(或导入纹理的内容)需要保留，写入它的pass不能被剔除；同一个pass重复写入不算读取
+    uint32_t producer = versions_[resource.index].producer;
+    if ((producer != UINT32_MAX && producer != pass) || (producer == UINT32_MAX && entry.imported)) {
+      read(pass, resource);
+    }
+    versions_.push_back({versions_[resource.index].resource, pass});
+    entry.latest = static_cast<uint32_t>(versions_.size() - 1);
+    passes_[pass].writes.push_back(entry.latest);
+    return {entry.latest};
+  }
+
+  auto cull() -> void {
+    std::vector<uint32_t> unused;
+    for (uint32_t v = 0; v < versions_.size(); ++v) {
+      if (versions_[v].refs == 0) {
+        unused.push_back(v);
+      }
+    }
+    auto cull_pass = [&](Pass& pass) {
+      pass.culled = true;
+      for (uint32_t v : pass.reads) {
+        if (--versions_[v].refs == 0) {
+          unused.push_back(v);
+        }
+      }
+    };
+    for (auto& pass : passes_) {
+      pass.culled = false;
+      pass.refs = static_cast<uint32_t>(pass.writes.size()) + (pass.side_effect ? 1 : 0);
+      if (pass.refs == 0) {
+        cull_pass(pass);
+      }
+    }
+    while (!unused.empty()) {
+      uint32_t v = unused.back();
+      unused.pop_back();
+      uint32_t producer = versions_[v].producer;
+      if (producer != UINT32_MAX && --passes_[producer].refs == 0) {
+        cull_pass(passes_[producer]);
+      }
+    }
+  }
+
+  auto compile() -> bool {
+    auto start = std::chrono::steady_clock::now();
+    releaseSlots(true);
+    slots_.clear();
+    // 剔除会修改引用计数，保存下来以便重复compile
+    std::vector<uint32_t> refs(versions_.size());
+    for (uint32_t v = 0; v < versions_.size(); ++v) {
+      refs[v] = versions_[v].refs;
+    }
+    cull();
+    for (uint32_t v = 0; v < versions_.size(); ++v) {
+      versions_[v].refs = refs[v];
+    }
+
+    // 生命周期，pass已经按添加顺序排列
+    auto end = static_cast<uint32_t>(passes_.size());
+    for (auto& resource : resources_) {
+      resource.first = UINT32_MAX;
+      resource.last = 0;
+      resource.slot = UINT32_MAX;
+    }
+    for (uint32_t i = 0; i < end; ++i) {
+      if (passes_[i].culled) {
+        continue;
+      }
+      for (const auto* list : {&passes_[i].reads, &passes_[i].writes}) {
+        for (uint32_t v : *list) {
+          auto& resource = resources_[versions_[v].resource];
+          resource.first = std::min(resource.first, i);
+          resource.last = std::max(resource.last, i);
+        }
+      }
+    }
+
+    // 在第一次使用时分配slot，最后一次使用后归还，之后的资源可以复用
+    std::vector<std::vector<uint32_t>> begins(end), ends(end);
+    for (uint32_t r = 0; r < resources_.size(); ++r) {
+      auto& resource = resources_[r];
+      if (resource.imported || resource.first == UINT32_MAX) {
+        continue;
+      }
+      begins[resource.first].push_back(r);
+      if (!resource.output) {
+        ends[resource.last].push_back(r);
+      }
+    }
+    stats_.transient_resources = 0;
+    stats_.transient_bytes = 0;
+    for (uint32_t i = 0; i < end; ++i) {
+      for (uint32_t r : begins[i]) {
+        auto& resource = resources_[r];
+        uint32_t slot = UINT32_MAX;
+        if (options_.aliasing && !resource.output) {
+          for (uint32_t s = 0; s < slots_.size(); ++s) {
+            if (!slots_[s].in_use && !slots_[s].output && slots_[s].desc == resource.desc) {
+              slot = s;
+              break;
+            }
+          }
+        }
+        if (slot == UINT32_MAX) {
+          slot = static_cast<uint32_t>(slots_.size());
+          slots_.push_back({resource.desc});
+        }
+        slots_[slot].in_use = true;
+        slots_[slot].output = resource.output;
+        resource.slot = slot;
+        stats_.transient_resources++;
+        stats_.transient_bytes += textureBytes(resource.desc);
+      }
+      for (uint32_t r : ends[i]) {
+        slots_[resources_[r].slot].in_use = false;
+      }
+    }
+
+    stats_.allocated_bytes = 0;
+    for (auto& slot : slots_) {
+      slot.texture = RenderTargetPool::instance().acquire(slot.desc);
+      if (slot.texture == 0) {
+        fmt::print("RenderGraph: failed to allocate {}x{} target\n", slot.desc.width, slot.desc.height);
+        releaseSlots(true);
+        return false;
+      }
+      stats_.allocated_bytes += textureBytes(slot.desc);
+    }
+    stats_.textures = static_cast<uint32_t>(slots_.size());
+    stats_.passes = static_cast<uint32_t>(passes_.size());
+    stats_.culled_passes = static_cast<uint32_t>(
+        std::count_if(passes_.begin(), passes_.end(), [](const Pass& pass) { return pass.culled; }));
+    stats_.compile_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    compiled_ = true;
+    return true;
+  }
+
+  auto getTexture(RenderResource resource) const -> GLuint {
+    if (!validVersion(resource)) {
+      return 0;
+    }
+    const auto& entry = resources_[versions_[resource.index].resource];
+    if (entry.imported) {
+      return entry.imported_texture;
+    }
+    return entry.slot == UINT32_MAX ? 0 : slots_[entry.slot].texture;
+  }
+
+  /**
+   * @brief 把pass写入的资源绑定到fbo_，返回false表示pass没有附件
+   */
+  auto bindAttachments(const Pass& pass) -> bool {
+    if (pass.writes.empty()) {
+      return false;
+    }
+    if (fbo_ == 0) {
+      glGenFramebuffers(1, &fbo_);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    std::vector<GLenum> buffers;
+    GLenum depth_attachment = GL_NONE;
+    GLuint depth_texture = 0;
+    RenderTargetDesc size;
+    std::vector<uint32_t> attached;
+    for (uint32_t v : pass.writes) {
+      // 同一个资源的多个版本只绑定一次
+      if (std::find(attached.begin(), attached.end(), versions_[v].resource) != attached.end()) {
+        continue;
+      }
+      attached.push_back(versions_[v].resource);
+      const auto& resource = resources_[versions_[v].resource];
+      GLuint texture = getTexture({v});
+      size = resource.desc;
+      if (isDepthFormat(resource.desc.format)) {
+        depth_attachment = hasStencil(resource.desc.format) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        depth_texture = texture;
+      } else {
+        GLenum attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(buffers.size());
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+        buffers.push_back(attachment);
+      }
+    }
+    // 清除上一个pass留下的附件
+    for (uint32_t i = static_cast<uint32_t>(buffers.size()); i < color_attachments_; ++i) {
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, 0, 0);
+    }
+    color_attachments_ = static_cast<uint32_t>(buffers.size());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, 0, 0);
+    if (depth_texture != 0) {
+      glFramebufferTexture2D(GL_FRAMEBUFFER, depth_attachment, GL_TEXTURE_2D, depth_texture, 0);
+    }
+    // 只有深度附件时读缓冲也要关闭，否则部分驱动认为帧缓冲不完整
+    if (buffers.empty()) {
+      glDrawBuffer(GL_NONE);
+      glReadBuffer(GL_NONE);
+    } else {
+      glDrawBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+      glReadBuffer(GL_COLOR_ATTACHMENT0);
+    }
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      fmt::print("RenderGraph: framebuffer of pass {} incomplete\n", pass.name);
+    }
+    glViewport(0, 0, static_cast<GLsizei>(size.width), static_cast<GLsizei>(size.height));
+    return true;
+  }
+
+  auto execute() -> void {
+    GL_HWK_TRACE_SCOPE("RenderGraph::execute");
+    if (!compiled_ && !compile()) {
+      return;
+    }
+    GLint framebuffer, read_framebuffer, viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_framebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    RenderPassResources resources(this);
+    for (const auto& pass : passes_) {
+      if (pass.culled) {
+        continue;
+      }
+      GpuProfileScope scope(pass.name);
+      if (!bindAttachments(pass)) {
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+      }
+      if (pass.execute) {
+        pass.execute(resources);
+      }
+    }
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    // 临时资源的纹理立即归还，下一帧或其他图可以复用
+    releaseSlots(false);
+    RenderTargetPool::instance().endFrame(options_.max_idle_frames);
+    compiled_ = false;
+    stats_.frames++;
+  }
+
+  RenderGraphOptions options_;
+  std::vector<Pass> passes_;
+  std::vector<Resource> resources_;
+  std::vector<Version> versions_;
+  std::vector<Slot> slots_;
+  GLuint fbo_ = 0;
+  uint32_t color_attachments_ = 0;
+  bool compiled_ = false;
+  RenderGraphStats stats_;
+};
+
+auto RenderGraphBuilder::create(const std::string& name, const RenderTargetDesc& desc) -> RenderResource {
+  return graph_->addResource(name, desc, false, 0);
+}
+
+auto RenderGraphBuilder::read(RenderResource resource) -> RenderResource { return graph_->read(pass_, resource); }
+
+auto RenderGraphBuilder::write(RenderResource resource) -> RenderResource { return graph_->write(pass_, resource); }
+
+auto RenderGraphBuilder::sideEffect() -> void { graph_->passes_[pass_].side_effect = true; }
+
+auto RenderPassResources::getTexture(RenderResource resource) const -> GLuint { return graph_->getTexture(resource); }
+
+auto RenderPassResources::getDesc(RenderResource resource) const -> RenderTargetDesc {
+  if (!graph_->validVersion(resource)) {
+    return {};
+  }
+  return graph_->resources_[graph_->versions_[resource.index].resource].desc;
+}
+
+RenderGraph::RenderGraph(const RenderGraphOptions& options) : impl_(make_unique_impl<RenderGraphImpl>(options)) {}
+
+// 在RenderGraphImpl完整定义处析构
+RenderGraph::~RenderGraph() = default;
+
+auto RenderGraph::reset() -> void { impl_->reset(); }
+
+auto RenderGraph::addPass(const std::string& name, const RenderPassSetupFunc& setup, RenderPassExecuteFunc execute)
+    -> void {
+  impl_->addPass(name, setup, std::move(execute));
+}
+
+auto RenderGraph::importTexture(const std::string& name, GLuint texture, const RenderTargetDesc& desc)
+    -> RenderResource {
+  return impl_->addResource(name, desc, true, texture);
+}
+
+auto RenderGraph::markOutput(RenderResource resource) -> void {
+  if (!impl_->validVersion(resource)) {
+    fmt::print("RenderGraph: markOutput with an invalid resource\n");
+    return;
+  }
+  auto& version = impl_->versions_[resource.index];
+  auto& entry = impl_->resources_[version.resource];
+  if (!entry.output) {
+    entry.output = true;
+    version.refs++;
+    impl_->compiled_ = false;
+  }
+}
+
+auto RenderGraph::compile() -> bool { return impl_->compile(); }
+
+auto RenderGraph::execute() -> void { impl_->execute(); }
+
+auto RenderGraph::getTexture(RenderResource resource) -> GLuint { return impl_->getTexture(resource); }
+
+auto RenderGraph::isCulled(const std::string& pass) -> bool {
+  for (const auto& entry : impl_->passes_) {
+    if (entry.name == pass) {
+      return entry.culled;
+    }
+  }
+  return false;
+}
+
+auto RenderGraph::getStats() -> RenderGraphStats { return impl_->stats_; }
+
+}  // namespace gl_hwk
@@ -0,0 +1,145 @@
+#include "gl_homework/render_stats.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <array>
+// third party
+#include <fmt/core.h>
+// clang-format on
+
+namespace gl_hwk {
+
+class RenderStatsImpl {
+ public:
+  // 滑动平均的窗口大小
+  static constexpr uint32_t kHistorySize = 120;
+
+  RenderStatsImpl() = default;
+
+  FrameStats current_;
+  FrameStats last_;
+  std::array<FrameStats, kHistorySize> history_{};
+  uint64_t frames_done_ = 0;
+  ResourceStats resources_;
+  uint32_t log_interval_ = 0;
+};
+
+RenderStats::RenderStats() : impl_(make_unique_impl<RenderStatsImpl>()) {}
+
+auto RenderStats::instance() -> RenderStats& {
+  static RenderStats instance;
+  return instance;
+}
+
+auto RenderStats::beginFrame() -> void {
+  impl_->current_ = FrameStats();
+  impl_->current_.frame = impl_->frames_done_;
+}
+
+auto RenderStats::endFrame() -> void {
+  impl_->last_ = impl_->current_;
+  impl_->history_[impl_->frames_done_ % RenderStatsImpl::kHistorySize] = impl_->current_;
+  impl_->frames_done_++;
+  if (impl_->log_interval_ != 0 && impl_->frames_done_ % impl_->log_interval_ == 0) {
+    fmt::print("{}", format());
+  }
+}
+
+auto RenderStats::addDrawCall(GLenum mode, GLsizei count, GLsizei instances) -> void {
+  auto& frame = impl_->current_;
+  frame.draw_calls++;
+  frame.vertices += static_cast<uint64_t>(count) * instances;
+  switch (mode) {
+    case GL_TRIANGLES:
+      frame.triangles += static_cast<uint64_t>(count / 3) * instances;
+      break;
+    case GL_TRIANGLE_STRIP:
+    case GL_TRIANGLE_FAN:
+      frame.triangles += static_cast<uint64_t>(count > 2 ? count - 2 : 0) * instances;
+      break;
+    default:
+      break;
+  }
+}
+
+auto RenderStats::addBufferUpload(uint64_t bytes) -> void { impl_->current_.buffer_bytes_uploaded += bytes; }
+
+auto RenderStats::addTextureUpload(uint64_t bytes) -> void { impl_->current_.texture_bytes_uploaded += bytes; }
+
+auto RenderStats::addStateChange(uint32_t count) -> void { impl_->current_.state_changes += count; }
+
+auto RenderStats::addUniformUpdate() -> void { impl_->current_.uniform_updates++; }
+
+auto RenderStats::addPrimitive(int64_t count, int64_t bytes) -> void {
+  impl_->resources_.primitives_cached += count;
+  impl_->resources_.primitive_buffer_bytes += bytes;
+}
+
+auto RenderStats::addTexture(GLenum type, int64_t count, int64_t bytes) -> void {
+  if (type == GL_TEXTURE_CUBE_MAP) {
+    impl_->resources_.textures_cube_map += count;
+    impl_->resources_.texture_cube_map_bytes += bytes;
+  } else {
+    impl_->resources_.textures_2d += count;
+    impl_->resources_.texture_2d_bytes += bytes;
+  }
+}
+
+auto RenderStats::addShaderProgram(int64_t count) -> void { impl_->resources_.shader_programs += count; }
+
+auto RenderStats::addBuffer(int64_t count, int64_t bytes) -> void {
+  impl_->resources_.buffers += count;
+  impl_->resources_.buffer_bytes += bytes;
+}
+
+auto RenderStats::getCurrentFrame() -> FrameStats { return impl_->current_; }
+
+auto RenderStats::getLastFrame() -> FrameStats { return impl_->last_; }
+
+auto RenderStats::getAverage() -> AverageFrameStats {
+  AverageFrameStats average;
+  uint64_t frames = std::min<uint64_t>(impl_->frames_done_, RenderStatsImpl::kHistorySize);
+  if (frames == 0) {
+    return average;
+  }
+  for (uint64_t i = 0; i < frames; ++i) {
+    const auto& frame = impl_->history_[i];
+    average.draw_calls += frame.draw_calls;
+    average.vertices += frame.vertices;
+    average.triangles += frame.triangles;
+    average.buffer_bytes_uploaded += frame.buffer_bytes_uploaded;
+    average.texture_bytes_uploaded += frame.texture_bytes_uploaded;
+    average.state_changes += frame.state_changes;
+    average.uniform_updates += frame.uniform_updates;
+  }
+  average.frames = static_cast<uint32_t>(frames);
+  average.draw_calls /= frames;
+  average.vertices /= frames;
+  average.triangles /= frames;
+  average.buffer_bytes_uploaded /= frames;
+  average.texture_bytes_uploaded /= frames;
+  average.state_changes /= frames;
+  average.uniform_updates /= frames;
+  return average;
+}
+
+auto RenderStats::getResources() -> ResourceStats { return impl_->resources_; }
+
+auto RenderStats::setLogInterval(uint32_t interval) -> void { impl_->log_interval_ = interval; }
+
+auto RenderStats::format() -> std::string {
+  auto average = getAverage();
+  const auto& res = impl_->resources_;
+  return fmt::format(
+      "RenderStats: frame {} (avg of {}): draw calls {:.1f}, triangles {:.0f}, vertices {:.0f}, state changes {:.1f}, "
+      "uniforms {:.1f}, buffer upload {:.1f} KB, texture upload {:.1f} KB\n"
+      "RenderStats: primitives {} ({:.1f} KB), 2D textures {} ({:.1f} MB), cube maps {} ({:.1f} MB), programs {}\n",
+      impl_->frames_done_, average.frames, average.draw_calls, average.triangles, average.vertices,
+      average.state_changes, average.uniform_updates, average.buffer_bytes_uploaded / 1024.0,
+      average.texture_bytes_uploaded / 1024.0, res.primitives_cached, res.primitive_buffer_bytes / 1024.0,
+      res.textures_2d, res.texture_2d_bytes / (1024.0 * 1024.0), res.textures_cube_map,
+      res.texture_cube_map_bytes / (1024.0 * 1024.0), res.shader_programs);
+}
+
+}  // namespace gl_hwk
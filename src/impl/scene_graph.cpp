@@ -0,0 +1,424 @@
+#include "gl_homework/scene_graph.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+// third party
+#include <fmt/core.h>
+// project
+#include "gl_homework/texture_loader.hpp"
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+// 按编号保存的节点数据，只在修改和重建展开顺序时访问
+struct SceneNode {
+  NodeId parent = kInvalidNode;
+  std::vector<NodeId> children;
+  glm::vec3 position = glm::vec3(0.0f);
+  glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+  glm::vec3 scale = glm::vec3(1.0f);
+  std::string mesh;
+  Aabb bounds;
+  std::shared_ptr<Shader> shader;
+  GLuint texture = 0;
+  bool alive = false;
+  // 在展开数组中的位置
+  uint32_t flat = 0;
+};
+
+// 多视图剔除时祖先子树的结果：仍需测试的视图和已经完全在内的视图
+struct CullFrame {
+  size_t end;
+  uint32_t test;
+  uint32_t inside;
+};
+
+class SceneGraphImpl {
+ public:
+  SceneGraphImpl() = default;
+
+  auto valid(NodeId id) -> bool {
+    if (id < nodes_.size() && nodes_[id].alive) {
+      return true;
+    }
+    fmt::print("SceneGraph: invalid node {}\n", id);
+    return false;
+  }
+
+  /**
+   * @brief 标记节点需要重新计算世界矩阵，并标记所有祖先的包围盒需要重新合并
+   */
+  auto markDirty(NodeId id) -> void {
+    any_dirty_ = true;
+    if (structure_dirty_) {
+      // 重建时会全部重新计算
+      return;
+    }
+    uint32_t f = nodes_[id].flat;
+    dirty_[f] = 1;
+    // 祖先已经标记时，更上层的祖先一定也已经标记
+    for (uint32_t p = f; p != kInvalidNode && !bounds_dirty_[p]; p = flat_parent_[p]) {
+      bounds_dirty_[p] = 1;
+    }
+  }
+
+  auto detach(NodeId id) -> void {
+    auto& siblings = nodes_[id].parent == kInvalidNode ? roots_ : nodes_[nodes_[id].parent].children;
+    siblings.erase(std::find(siblings.begin(), siblings.end(), id));
+    nodes_[id].parent = kInvalidNode;
+  }
+
+  auto attach(NodeId id, NodeId parent) -> void {
+    nodes_[id].parent = parent;
+    (parent == kInvalidNode ? roots_ : nodes_[parent].children).push_back(id);
+  }
+
+  /**
+   * @brief 按深度优先顺序重新展开所有节点，父节点总在子节点之前，子树在数组中连续
+   */
+  auto rebuild() -> void {
+    GL_HWK_TRACE_SCOPE("SceneGraph::rebuild");
+    order_.clear();
+    flat_parent_.clear();
+    std::vector<NodeId> stack(roots_.rbegin(), roots_.rend());
+    while (!stack.empty()) {
+      NodeId id = stack.back();
+      stack.pop_back();
+      auto& node = nodes_[id];
+      node.flat = static_cast<uint32_t>(order_.size());
+      order_.push_back(id);
+      flat_parent_.push_back(node.parent == kInvalidNode ? kInvalidNode : nodes_[node.parent].flat);
+      stack.insert(stack.end(), node.children.rbegin(), node.children.rend());
+    }
+
+    size_t n = order_.size();
+    subtree_size_.assign(n, 1);
+    for (size_t i = n; i-- > 0;) {
+      if (flat_parent_[i] != kInvalidNode) {
+        subtree_size_[flat_parent_[i]] += subtree_size_[i];
+      }
+    }
+    world_.resize(n);
+    normal_.resize(n);
+    own_bounds_.resize(n);
+    subtree_bounds_.resize(n);
+    dirty_.assign(n, 1);
+    bounds_dirty_.assign(n, 1);
+    structure_dirty_ = false;
+    any_dirty_ = true;
+  }
+
+  /**
+   * @brief occlusion不为空时，视锥体测试通过的子树和节点还要通过遮挡测试
+   */
+  auto cull(const Frustum& frustum, OcclusionCuller* occlusion, std::vector<NodeId>& visible) -> void {
+    update();
+    visible.clear();
+    auto occluded = [occlusion](const Aabb& box) { return occlusion && !occlusion->isVisible(box); };
+    size_t n = order_.size();
+    size_t i = 0;
+    while (i < n) {
+      // 没有网格的子树包围盒为空，同样被跳过
+      CullResult result = frustum.test(subtree_bounds_[i]);
+      size_t end = i + subtree_size_[i];
+      if (result == CullResult::kOutside || (subtree_size_[i] > 1 && occluded(subtree_bounds_[i]))) {
+        i = end;
+      } else if (result == CullResult::kInside) {
+        for (; i < end; ++i) {
+          if (!own_bounds_[i].isEmpty() && !occluded(own_bounds_[i])) {
+            visible.push_back(order_[i]);
+          }
+        }
+      } else {
+        if (frustum.test(own_bounds_[i]) != CullResult::kOutside && !occluded(own_bounds_[i])) {
+          visible.push_back(order_[i]);
+        }
+        ++i;
+      }
+    }
+  }
+
+  auto cull(const FrustumSet& frusta, std::vector<std::vector<NodeId>>& visible) -> void {
+    update();
+    auto views = static_cast<uint32_t>(frusta.frusta.size());
+    visible.resize(views);
+    for (auto& list : visible) {
+      list.clear();
+    }
+    cull_stack_.clear();
+    size_t n = order_.size();
+    size_t i = 0;
+    while (i < n) {
+      while (!cull_stack_.empty() && cull_stack_.back().end <= i) {
+        cull_stack_.pop_back();
+      }
+      uint32_t test = cull_stack_.empty() ? frusta.allMask() : cull_stack_.back().test;
+      uint32_t inside = cull_stack_.empty() ? 0 : cull_stack_.back().inside;
+      uint32_t subtree_inside = 0;
+      uint32_t hit = test != 0 ? frusta.test(subtree_bounds_[i], test, subtree_inside) : 0;
+      inside |= subtree_inside;
+      test = hit & ~subtree_inside;
+      size_t end = i + subtree_size_[i];
+      if ((test | inside) == 0) {
+        i = end;
+        continue;
+      }
+      if (!own_bounds_[i].isEmpty()) {
+        uint32_t own_inside = 0;
+        uint32_t mask = inside | (test != 0 ? frusta.test(own_bounds_[i], test, own_inside) : 0);
+        for (uint32_t v = 0; v < views; ++v) {
+          if (mask & (1u << v)) {
+            visible[v].push_back(order_[i]);
+          }
+        }
+      }
+      if (end > i + 1) {
+        cull_stack_.push_back({end, test, inside});
+      }
+      ++i;
+    }
+  }
+
+  auto update() -> uint32_t {
+    if (structure_dirty_) {
+      rebuild();
+    }
+    if (!any_dirty_) {
+      return 0;
+    }
+    GL_HWK_TRACE_SCOPE("SceneGraph::update");
+    uint32_t updated = 0;
+    size_t n = order_.size();
+    // 父节点在前，一次顺序遍历即可把修改传递到整棵子树
+    for (size_t i = 0; i < n; ++i) {
+      uint32_t p = flat_parent_[i];
+      if (p != kInvalidNode && dirty_[p]) {
+        dirty_[i] = 1;
+      }
+      if (!dirty_[i]) {
+        continue;
+      }
+      const auto& node = nodes_[order_[i]];
+      glm::mat4 local = glm::mat4_cast(node.rotation);
+      local[0] *= node.scale.x;
+      local[1] *= node.scale.y;
+      local[2] *= node.scale.z;
+      local[3] = glm::vec4(node.position, 1.0f);
+      world_[i] = p == kInvalidNode ? local : world_[p] * local;
+      normal_[i] = glm::transpose(glm::inverse(glm::mat3(world_[i])));
+      own_bounds_[i] = node.mesh.empty() ? Aabb() : node.bounds.transform(world_[i]);
+      bounds_dirty_[i] = 1;
+      updated++;
+    }
+    // 子节点在后，逆序遍历时子树的包围盒已经合并好
+    for (size_t i = n; i-- > 0;) {
+      if (!bounds_dirty_[i]) {
+        continue;
+      }
+      Aabb bounds = own_bounds_[i];
+      for (size_t j = i + 1; j < i + subtree_size_[i]; j += subtree_size_[j]) {
+        bounds.expand(subtree_bounds_[j]);
+      }
+      subtree_bounds_[i] = bounds;
+      bounds_dirty_[i] = 0;
+    }
+    std::fill(dirty_.begin(), dirty_.end(), 0);
+    any_dirty_ = false;
+    return updated;
+  }
+
+  std::vector<SceneNode> nodes_;
+  std::vector<NodeId> free_;
+  std::vector<NodeId> roots_;
+
+  // 以下数组按展开顺序排列
+  std::vector<NodeId> order_;
+  std::vector<uint32_t> flat_parent_;
+  // 包含自身的子树节点数，跳过子树时使用
+  std::vector<uint32_t> subtree_size_;
+  std::vector<glm::mat4> world_;
+  std::vector<glm::mat3> normal_;
+  std::vector<Aabb> own_bounds_;
+  std::vector<Aabb> subtree_bounds_;
+  std::vector<uint8_t> dirty_;
+  std::vector<uint8_t> bounds_dirty_;
+  // 复用的多视图剔除栈，避免每帧分配
+  std::vector<CullFrame> cull_stack_;
+
+  bool structure_dirty_ = false;
+  bool any_dirty_ = false;
+};
+
+SceneGraph::SceneGraph() : impl_(make_unique_impl<SceneGraphImpl>()) {}
+
+// 在SceneGraphImpl完整定义处析构
+SceneGraph::~SceneGraph() = default;
+
+auto SceneGraph::createNode(NodeId parent) -> NodeId {
+  if (parent != kInvalidNode && !impl_->valid(parent)) {
+    return kInvalidNode;
+  }
+  NodeId id;
+  if (!impl_->free_.empty()) {
+    id = impl_->free_.back();
+    impl_->free_.pop_back();
+    impl_->nodes_[id] = SceneNode();
+  } else {
+    id = static_cast<NodeId>(impl_->nodes_.size());
+    impl_->nodes_.emplace_back();
+  }
+  impl_->nodes_[id].alive = true;
+  impl_->attach(id, parent);
+  impl_->structure_dirty_ = true;
+  return id;
+}
+
+auto SceneGraph::removeNode(NodeId id) -> void {
+  if (!impl_->valid(id)) {
+    return;
+  }
+  impl_->detach(id);
+  std::vector<NodeId> stack{id};
+  while (!stack.empty()) {
+    NodeId current = stack.back();
+    stack.pop_back();
+    auto& node = impl_->nodes_[current];
+    stack.insert(stack.end(), node.children.begin(), node.children.end());
+    node = SceneNode();
+    impl_->free_.push_back(current);
+  }
+  impl_->structure_dirty_ = true;
+}
+
+auto SceneGraph::setParent(NodeId id, NodeId parent) -> void {
+  if (!impl_->valid(id) || (parent != kInvalidNode && !impl_->valid(parent))) {
+    return;
+  }
+  for (NodeId p = parent; p != kInvalidNode; p = impl_->nodes_[p].parent) {
+    if (p == id) {
+      fmt::print("SceneGraph: node {} can not be a child of its descendant {}\n", id, parent);
+      return;
+    }
+  }
+  impl_->detach(id);
+  impl_->attach(id, parent);
+  impl_->structure_dirty_ = true;
+}
+
+auto SceneGraph::getParent(NodeId id) -> NodeId { return impl_->valid(id) ? impl_->nodes_[id].parent : kInvalidNode; }
+
+auto SceneGraph::setTransform(NodeId id, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+    -> void {
+  if (!impl_->valid(id)) {
+    return;
+  }
+  auto& node = impl_->nodes_[id];
+  node.position = position;
+  node.rotation = glm::normalize(rotation);
+  node.scale = scale;
+  impl_->markDirty(id);
+}
+
+auto SceneGraph::setPosition(NodeId id, const glm::vec3& position) -> void {
+  if (impl_->valid(id)) {
+    impl_->nodes_[id].position = position;
+    impl_->markDirty(id);
+  }
+}
+
+auto SceneGraph::setRotation(NodeId id, const glm::quat& rotation) -> void {
+  if (impl_->valid(id)) {
+    impl_->nodes_[id].rotation = glm::normalize(rotation);
+    impl_->markDirty(id);
+  }
+}
+
+auto SceneGraph::setScale(NodeId id, const glm::vec3& scale) -> void {
+  if (impl_->valid(id)) {
+    impl_->nodes_[id].scale = scale;
+    impl_->markDirty(id);
+  }
+}
+
+auto SceneGraph::setMesh(NodeId id, const std::string& mesh, const Aabb& bounds) -> void {
+  if (impl_->valid(id)) {
+    impl_->nodes_[id].mesh = mesh;
+    impl_->nodes_[id].bounds = bounds;
+    impl_->markDirty(id);
+  }
+}
+
+auto SceneGraph::setMaterial(NodeId id, std::shared_ptr<Shader> shader, GLuint texture) -> void {
+  if (impl_->valid(id)) {
+    impl_->nodes_[id].shader = std::move(shader);
+    impl_->nodes_[id].texture = texture;
+  }
+}
+
+auto SceneGraph::update() -> uint32_t { return impl_->update(); }
+
+auto SceneGraph::getWorldMatrix(NodeId id) -> glm::mat4 {
+  if (!impl_->valid(id)) {
+    return glm::mat4(1.0f);
+  }
+  impl_->update();
+  return impl_->world_[impl_->nodes_[id].flat];
+}
+
+auto SceneGraph::getSubtreeBounds(NodeId id) -> Aabb {
+  if (!impl_->valid(id)) {
+    return {};
+  }
+  impl_->update();
+  return impl_->subtree_bounds_[impl_->nodes_[id].flat];
+}
+
+auto SceneGraph::cull(const Frustum& frustum, std::vector<NodeId>& visible) -> void {
+  GL_HWK_TRACE_SCOPE("SceneGraph::cull");
+  impl_->cull(frustum, nullptr, visible);
+}
+
+auto SceneGraph::cull(const Frustum& frustum, OcclusionCuller& occlusion, std::vector<NodeId>& visible) -> void {
+  GL_HWK_TRACE_SCOPE("SceneGraph::cull");
+  impl_->cull(frustum, &occlusion, visible);
+}
+
+auto SceneGraph::cull(const FrustumSet& frusta, std::vector<std::vector<NodeId>>& visible) -> void {
+  GL_HWK_TRACE_SCOPE("SceneGraph::cull");
+  impl_->cull(frusta, visible);
+}
+
+auto SceneGraph::draw(PrimitiveBuilder& builder, const std::vector<NodeId>& nodes) -> void {
+  GL_HWK_TRACE_SCOPE("SceneGraph::draw");
+  impl_->update();
+  Shader* current_shader = nullptr;
+  GLuint current_texture = 0;
+  for (NodeId id : nodes) {
+    if (!impl_->valid(id)) {
+      continue;
+    }
+    const auto& node = impl_->nodes_[id];
+    // 图元还未通过PrimitiveBuilder创建时跳过
+    const auto* primitive = node.mesh.empty() ? nullptr : builder.findPrimitive(node.mesh);
+    if (!primitive || !node.shader) {
+      continue;
+    }
+    if (node.shader.get() != current_shader) {
+      current_shader = node.shader.get();
+      current_shader->start();
+    }
+    if (node.texture != 0 && node.texture != current_texture) {
+      current_texture = node.texture;
+      TextureLoader::instance().activeTexture(current_texture, 0);
+    }
+    current_shader->setMat4("model", impl_->world_[node.flat]);
+    current_shader->setMat3("normalMatrix", impl_->normal_[node.flat]);
+    builder.drawPrimitive(primitive);
+  }
+}
+
+auto SceneGraph::size() -> size_t { return impl_->nodes_.size() - impl_->free_.size(); }
+
+}  // namespace gl_hwk
@@ -3,6 +3,9 @@
 #include <fstream>
 #include <sstream>
 
+#include "gl_homework/render_stats.hpp"
+#include "gl_homework/trace.hpp"
+
 namespace gl_hwk {
 class ShaderImpl {
  public:
@@ -27,9 +30,42 @@ class ShaderImpl {
       }
     }
   }
+
+  /**
+   * @brief 把单独一行的#include "file"替换为与path同目录下file的内容，GLSL 330本身不支持#include
+   */
+  auto expandIncludes(const std::string &code, const std::string &path) const -> std::string {
+    const std::string directive = "#include \"";
+    auto slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+    std::istringstream lines(code);
+    std::string result;
+    std::string line;
+    while (std::getline(lines, line)) {
+      if (line.rfind(directive, 0) != 0 || line.size() <= directive.size() || line.back() != '"') {
+        result += line + '\n';
+        continue;
+      }
+      std::string include_path = directory + line.substr(directive.size(), line.size() - directive.size() - 1);
+      std::ifstream include_file(include_path);
+      if (!include_file) {
+        fmt::print("ERROR::SHADER::INCLUDE_NOT_FOUND: {}\n", include_path);
+        continue;
+      }
+      std::stringstream include_stream;
+      include_stream << include_file.rdbuf();
+      result += include_stream.str();
+      if (result.back() != '\n') {
+        result += '\n';
+      }
+    }
+    return result;
+  }
 };
 
 Shader::Shader(const std::string &vertex_path, const std::string &fragment_path) {
+  GL_HWK_TRACE_SCOPE("Shader::Shader");
   impl_ = make_unique_impl<ShaderImpl>();
 
   // 1. retrieve the vertex/fragment source code from filePath
@@ -52,8 +88,8 @@ Shader::Shader(const std::string &vertex_path, const std::string &fragment_path)
     v_shader_file.close();
     f_shader_file.close();
     // convert stream into string
-    vertex_code = v_shader_stream.str();
-    fragment_code = f_shader_stream.str();
+    vertex_code = impl_->expandIncludes(v_shader_stream.str(), vertex_path);
+    fragment_code = impl_->expandIncludes(f_shader_stream.str(), fragment_path);
   } catch (std::ifstream::failure e) {
     fmt::print("ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ, e.what() : {}\n", e.what());
   }
@@ -81,6 +117,7 @@ Shader::Shader(const std::string &vertex_path, const std::string &fragment_path)
   glLinkProgram(ID);
 
   impl_->checkCompileErrors(ID, "PROGRAM");
+  RenderStats::instance().addShaderProgram(1);
 
   // delete the shaders as they're linked into our program now and no longer
   // necessary
@@ -88,54 +125,82 @@ Shader::Shader(const std::string &vertex_path, const std::string &fragment_path)
   glDeleteShader(f_shader);
 }
 
-auto Shader::start() -> void { glUseProgram(ID); }
+// 在ShaderImpl完整定义处析构
+Shader::~Shader() = default;
+
+auto Shader::start() -> void {
+  glUseProgram(ID);
+  RenderStats::instance().addStateChange();
+}
 
 auto Shader::setBool(const std::string &name, bool value) const -> void {
   glUniform1i(glGetUniformLocation(ID, name.c_str()), static_cast<int>(value));
+  RenderStats::instance().addUniformUpdate();
 }
 
 auto Shader::setInt(const std::string &name, int value) const -> void {
   glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+  RenderStats::instance().addUniformUpdate();
 }
 
 auto Shader::setFloat(const std::string &name, float value) const -> void {
   glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+  RenderStats::instance().addUniformUpdate();
 }
 
 auto Shader::setVec2(const std::string &name, const glm::vec2 &value) const -> void {
   glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+  RenderStats::instance().addUniformUpdate();
 }
 
 auto Shader::setVec2(const std::string &name, float x, float y) const -> void {
   glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+  RenderStats::instance().addUniformUpdate();
+}
+
+auto Shader::setIvec2(const std::string &name, const glm::ivec2 &value) const -> void {
+  glUniform2iv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+  RenderStats::instance().addUniformUpdate();
+}
+
+auto Shader::setIvec2(const std::string &name, int x, int y) const -> void {
+  glUniform2i(glGetUniformLocation(ID, name.c_str()), x, y);
+  RenderStats::instance().addUniformUpdate();
 }
 
 auto Shader::setVec3(const std::string &name, const glm::vec3 &value) const -> void {
   glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+  RenderStats::instance().addUniformUpdate();
 }
 
 auto Shader::setVec3(const std::string &name, float x, float y, float z) const -> void {
   glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+  RenderStats::instance().addUniformUpdate();
 }
 
 auto Shader::setVec4(const std::string &name, const glm::vec4 &value) const -> void {
   glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+  RenderStats::instance().addUniformUpdate();
 }
 
 auto Shader::setVec4(const std::string &name, float x, float y, float z, float w) const -> void {
   glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+  RenderStats::instance().addUniformUpdate();
 }
 
 auto Shader::setMat2(const std::string &name, const glm::mat2 &mat) const -> void {
   glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+  RenderStats::instance().addUniformUpdate();
 }
 
 auto Shader::setMat3(const std::string &name, const glm::mat3 &mat) const -> void {
   glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+  RenderStats::instance().addUniformUpdate();
 }
 
 auto Shader::setMat4(const std::string &name, const glm::mat4 &mat) const -> void {
   glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+  RenderStats::instance().addUniformUpdate();
 }
 
 }  // namespace gl_hwk
\ No newline at end of file
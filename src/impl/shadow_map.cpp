@@ -0,0 +1,343 @@
+#include "gl_homework/shadow_map.hpp"
+
+// clang-format off
+// std
+#include <unordered_map>
+#include <vector>
+// OpenGL
+#include <glm/gtc/matrix_transform.hpp>
+// third party
+#include <fmt/core.h>
+// project
+#include "gl_homework/gpu_profiler.hpp"
+#include "gl_homework/render_stats.hpp"
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+class DepthTexturePoolImpl {
+ public:
+  struct Entry {
+    GLenum target;
+    uint32_t size;
+  };
+
+  static auto key(GLenum target, uint32_t size) -> uint64_t { return (static_cast<uint64_t>(target) << 32) | size; }
+
+  static auto bytes(GLenum target, uint32_t size) -> int64_t {
+    return static_cast<int64_t>(size) * size * 4 * (target == GL_TEXTURE_CUBE_MAP ? 6 : 1);
+  }
+
+  auto create(GLenum target, uint32_t size) -> GLuint {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(target, texture);
+    if (target == GL_TEXTURE_CUBE_MAP) {
+      for (int face = 0; face < 6; ++face) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT24, size, size, 0,
+                     GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+      }
+      glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    } else {
+      glTexImage2D(target, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+      // 阴影贴图范围外视为没有遮挡
+      const float border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+      glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+      glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+      glTexParameterfv(target, GL_TEXTURE_BORDER_COLOR, border);
+    }
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(target, 0);
+    RenderStats::instance().addTexture(target, 1, bytes(target, size));
+    return texture;
+  }
+
+  std::unordered_map<uint64_t, std::vector<GLuint>> free_;
+  std::unordered_map<GLuint, Entry> entries_;
+};
+
+DepthTexturePool::DepthTexturePool() : impl_(make_unique_impl<DepthTexturePoolImpl>()) {}
+
+auto DepthTexturePool::instance() -> DepthTexturePool& {
+  static DepthTexturePool instance;
+  return instance;
+}
+
+auto DepthTexturePool::acquire(GLenum target, uint32_t size) -> GLuint {
+  if (target != GL_TEXTURE_2D && target != GL_TEXTURE_CUBE_MAP) {
+    fmt::print("DepthTexturePool: unsupported target {}\n", target);
+    return 0;
+  }
+  auto& free = impl_->free_[DepthTexturePoolImpl::key(target, size)];
+  if (!free.empty()) {
+    GLuint texture = free.back();
+    free.pop_back();
+    return texture;
+  }
+  GLuint texture = impl_->create(target, size);
+  impl_->entries_[texture] = {target, size};
+  return texture;
+}
+
+auto DepthTexturePool::release(GLuint texture) -> void {
+  auto it = impl_->entries_.find(texture);
+  if (it == impl_->entries_.end()) {
+    fmt::print("DepthTexturePool: texture {} not from pool\n", texture);
+    return;
+  }
+  impl_->free_[DepthTexturePoolImpl::key(it->second.target, it->second.size)].push_back(texture);
+}
+
+auto DepthTexturePool::trim() -> void {
+  for (auto& [key, textures] : impl_->free_) {
+    for (GLuint texture : textures) {
+      const auto& entry = impl_->entries_[texture];
+      RenderStats::instance().addTexture(entry.target, -1, -DepthTexturePoolImpl::bytes(entry.target, entry.size));
+      impl_->entries_.erase(texture);
+    }
+    if (!textures.empty()) {
+      glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+    }
+    textures.clear();
+  }
+}
+
+class ShadowMapImpl {
+ public:
+  explicit ShadowMapImpl(const ShadowOptions& options)
+      : options_(options),
+        depth_shader_("shader/shadow_depth.vert.GLSL", "shader/shadow_depth.frag.GLSL"),
+        target_(options.type == ShadowType::kPoint ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D) {}
+
+  ~ShadowMapImpl() {
+    for (GLuint texture : {static_texture_, frame_texture_}) {
+      if (texture != 0) {
+        DepthTexturePool::instance().release(texture);
+      }
+    }
+    if (fbo_ != 0) {
+      glDeleteFramebuffers(1, &fbo_);
+      glDeleteFramebuffers(1, &read_fbo_);
+    }
+  }
+
+  auto faceCount() const -> int { return options_.type == ShadowType::kPoint ? 6 : 1; }
+
+  /**
+   * @brief 立方体贴图6个面的观察方向和上方向
+   */
+  auto faceMatrix(int face) const -> glm::mat4 {
+    if (options_.type == ShadowType::kDirectional) {
+      return light_space_;
+    }
+    static const glm::vec3 kDirections[6][2] = {{{1, 0, 0}, {0, -1, 0}}, {{-1, 0, 0}, {0, -1, 0}},
+                                                {{0, 1, 0}, {0, 0, 1}},  {{0, -1, 0}, {0, 0, -1}},
+                                                {{0, 0, 1}, {0, -1, 0}}, {{0, 0, -1}, {0, -1, 0}}};
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.05f, options_.far_plane);
+    return projection * glm::lookAt(position_, position_ + kDirections[face][0], kDirections[face][1]);
+  }
+
+  auto attach(GLuint texture, int face) -> void {
+    GLenum target = options_.type == ShadowType::kPoint ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target, texture, 0);
+  }
+
+  /**
+   * @brief 把casters绘制到texture；clear为false时在已有深度上叠加
+   */
+  auto render(GLuint texture, const ShadowCasterFunc& casters, bool clear) -> void {
+    depth_shader_.start();
+    depth_shader_.setInt("linearDepth", options_.type == ShadowType::kPoint ? 1 : 0);
+    depth_shader_.setVec3("lightPos", position_);
+    depth_shader_.setFloat("farPlane", options_.far_plane);
+    for (int face = 0; face < faceCount(); ++face) {
+      attach(texture, face);
+      if (clear) {
+        glClear(GL_DEPTH_BUFFER_BIT);
+      }
+      depth_shader_.setMat4("lightSpaceMatrix", faceMatrix(face));
+      if (casters) {
+        casters(depth_shader_);
+      }
+    }
+  }
+
+  /**
+   * @brief 复制静态阴影，优先使用glCopyImageSubData，不支持时逐面blit
+   */
+  auto copyStatic() -> void {
+    GLsizei size = static_cast<GLsizei>(options_.resolution);
+    if (GLEW_VERSION_4_3 || GLEW_ARB_copy_image) {
+      glCopyImageSubData(static_texture_, target_, 0, 0, 0, 0, frame_texture_, target_, 0, 0, 0, 0, size, size,
+                         faceCount());
+      return;
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, read_fbo_);
+    for (int face = 0; face < faceCount(); ++face) {
+      GLenum target = options_.type == ShadowType::kPoint ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+      glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target, static_texture_, 0);
+      glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target, frame_texture_, 0);
+      glBlitFramebuffer(0, 0, size, size, 0, 0, size, size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+  }
+
+  auto update() -> void {
+    GL_HWK_TRACE_SCOPE("ShadowMap::update");
+    stats_.frames++;
+    if (!static_dirty_ && !dynamic_casters_) {
+      return;
+    }
+    GpuProfileScope scope("shadow");
+    // 保存调用者的状态，需要在创建帧缓冲之前
+    GLint previous_fbo, previous_read_fbo, viewport[4], depth_func;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_fbo);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous_read_fbo);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_DEPTH_FUNC, &depth_func);
+    GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+
+    if (fbo_ == 0) {
+      glGenFramebuffers(1, &fbo_);
+      glGenFramebuffers(1, &read_fbo_);
+      glBindFramebuffer(GL_FRAMEBUFFER, read_fbo_);
+      glReadBuffer(GL_NONE);
+      glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+      glDrawBuffer(GL_NONE);
+      glReadBuffer(GL_NONE);
+    }
+    if (static_texture_ == 0) {
+      static_texture_ = DepthTexturePool::instance().acquire(target_, options_.resolution);
+    }
+    if (dynamic_casters_ && frame_texture_ == 0) {
+      frame_texture_ = DepthTexturePool::instance().acquire(target_, options_.resolution);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glViewport(0, 0, options_.resolution, options_.resolution);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    // 斜率偏移减少阴影粉刺
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+
+    if (static_dirty_) {
+      render(static_texture_, static_casters_, true);
+      static_dirty_ = false;
+      stats_.static_renders++;
+    }
+    if (dynamic_casters_) {
+      copyStatic();
+      render(frame_texture_, dynamic_casters_, false);
+      stats_.dynamic_renders++;
+    }
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previous_fbo);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, previous_read_fbo);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glDepthFunc(depth_func);
+    if (!depth_test) {
+      glDisable(GL_DEPTH_TEST);
+    }
+    RenderStats::instance().addStateChange(10);
+  }
+
+  auto result() const -> GLuint { return dynamic_casters_ ? frame_texture_ : static_texture_; }
+
+  ShadowOptions options_;
+  Shader depth_shader_;
+  GLenum target_;
+  GLuint fbo_ = 0;
+  // 不支持glCopyImageSubData时用于blit
+  GLuint read_fbo_ = 0;
+  GLuint static_texture_ = 0;
+  GLuint frame_texture_ = 0;
+
+  glm::vec3 position_ = glm::vec3(0.0f);
+  glm::mat4 light_space_ = glm::mat4(1.0f);
+  ShadowCasterFunc static_casters_;
+  ShadowCasterFunc dynamic_casters_;
+  bool static_dirty_ = true;
+  ShadowStats stats_;
+};
+
+ShadowMap::ShadowMap(const ShadowOptions& options) : impl_(make_unique_impl<ShadowMapImpl>(options)) {}
+
+// 在ShadowMapImpl完整定义处析构，归还纹理
+ShadowMap::~ShadowMap() = default;
+
+auto ShadowMap::setDirectionalLight(const glm::vec3& direction, const glm::vec3& center, float radius) -> void {
+  if (impl_->options_.type != ShadowType::kDirectional) {
+    fmt::print("ShadowMap: not a directional shadow map\n");
+    return;
+  }
+  glm::vec3 dir = glm::normalize(direction);
+  glm::vec3 up = std::abs(dir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+  // 光源放在球外2倍半径处，深度范围覆盖整个球
+  glm::vec3 eye = center - dir * radius * 2.0f;
+  glm::mat4 light_space = glm::ortho(-radius, radius, -radius, radius, radius, radius * 3.0f) *
+                          glm::lookAt(eye, center, up);
+  if (light_space != impl_->light_space_) {
+    impl_->light_space_ = light_space;
+    impl_->position_ = eye;
+    impl_->static_dirty_ = true;
+  }
+}
+
+auto ShadowMap::setPointLight(const glm::vec3& position) -> void {
+  if (impl_->options_.type != ShadowType::kPoint) {
+    fmt::print("ShadowMap: not a point shadow map\n");
+    return;
+  }
+  if (position != impl_->position_) {
+    impl_->position_ = position;
+    impl_->static_dirty_ = true;
+  }
+}
+
+auto ShadowMap::setStaticCasters(ShadowCasterFunc casters) -> void {
+  impl_->static_casters_ = std::move(casters);
+  impl_->static_dirty_ = true;
+}
+
+auto ShadowMap::setDynamicCasters(ShadowCasterFunc casters) -> void {
+  impl_->dynamic_casters_ = std::move(casters);
+  if (!impl_->dynamic_casters_ && impl_->frame_texture_ != 0) {
+    DepthTexturePool::instance().release(impl_->frame_texture_);
+    impl_->frame_texture_ = 0;
+  }
+}
+
+auto ShadowMap::markStaticDirty() -> void { impl_->static_dirty_ = true; }
+
+auto ShadowMap::update() -> void { impl_->update(); }
+
+auto ShadowMap::bind(Shader& shader, int first_unit) -> void {
+  auto& impl = *impl_;
+  shader.start();
+  bool point = impl.options_.type == ShadowType::kPoint;
+  glActiveTexture(GL_TEXTURE0 + first_unit + (point ? 1 : 0));
+  glBindTexture(impl.target_, impl.result());
+  glActiveTexture(GL_TEXTURE0);
+  RenderStats::instance().addStateChange(3);
+  // 两种采样器必须使用不同的纹理单元
+  shader.setInt("shadowMap", first_unit);
+  shader.setInt("shadowCube", first_unit + 1);
+  shader.setInt("shadowType", point ? 1 : 0);
+  shader.setMat4("lightSpaceMatrix", impl.light_space_);
+  shader.setVec3("shadowLightPos", impl.position_);
+  shader.setFloat("shadowFarPlane", impl.options_.far_plane);
+}
+
+auto ShadowMap::getLightSpaceMatrix() -> glm::mat4 { return impl_->light_space_; }
+
+auto ShadowMap::getTexture() -> GLuint { return impl_->result(); }
+
+auto ShadowMap::getStats() -> ShadowStats { return impl_->stats_; }
+
+}  // namespace gl_hwk
@@ -3,8 +3,12 @@
 // clang-format off
 // std
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <glm/fwd.hpp>
 #include <memory>
+#include <unordered_map>
 // glm
 #include <glm/glm.hpp>
 // project
@@ -13,12 +17,75 @@
 // clang-format on
 
 namespace gl_hwk {
+
+enum class PolytopeShape : uint8_t {
+  kCube,
+  kTetrahedron,
+  kRect,
+};
+
 class SimplePolytopeBuilderImpl {
  public:
+  /**
+   * @brief 缓存项，params对立方体和四面体为{center, size}，对平面为{p1, p2, p3}
+   */
+  struct CachedPolytope {
+    PolytopeShape shape;
+    std::array<glm::vec3, 3> params;
+    std::vector<std::vector<float>> other_data;
+    const Primitive* primitive;
+  };
+
   SimplePolytopeBuilderImpl(std::shared_ptr<PrimitiveBuilder> primitive_builder)
       : primitive_builder_(primitive_builder) {}
 
+  /**
+   * @brief 按32位字的FNV-1a，只包含形状、参数和顶点数据的行数，顶点数据在查找时逐个比较
+   */
+  static auto hash(PolytopeShape shape, const std::array<glm::vec3, 3>& params,
+                   const std::vector<std::vector<float>>& other_data) -> uint64_t {
+    uint64_t h = 14695981039346656037ULL;
+    auto mix = [&h](uint32_t word) { h = (h ^ word) * 1099511628211ULL; };
+    mix(static_cast<uint32_t>(shape));
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        uint32_t word;
+        std::memcpy(&word, &params[i][j], sizeof(word));
+        mix(word);
+      }
+    }
+    mix(static_cast<uint32_t>(other_data.size()));
+    return h;
+  }
+
+  /**
+   * @brief 形状和参数都相同时直接绘制缓存的图元，否则调用generate生成顶点并创建图元
+   */
+  template <typename Generate>
+  auto draw(PolytopeShape shape, const std::string& name, const std::array<glm::vec3, 3>& params,
+            const std::vector<std::vector<float>>& other_data, Generate&& generate) -> void {
+    uint64_t key = hash(shape, params, other_data);
+    auto it = cache_.find(key);
+    if (it != cache_.end()) {
+      for (const auto& cached : it->second) {
+        if (cached.shape == shape && cached.params == params && cached.other_data == other_data) {
+          primitive_builder_->drawPrimitive(cached.primitive);
+          return;
+        }
+      }
+    }
+    // 名字已被其他参数的几何体占用时沿用PrimitiveBuilder的行为，绘制已有的图元，不加入缓存
+    if (auto* primitive = primitive_builder_->findPrimitive(name)) {
+      primitive_builder_->drawPrimitive(primitive);
+      return;
+    }
+    generate();
+    cache_[key].push_back({shape, params, other_data, primitive_builder_->findPrimitive(name)});
+  }
+
   std::shared_ptr<PrimitiveBuilder> primitive_builder_;
+  // 相同参数的不同名字共用第一次创建的图元
+  std::unordered_map<uint64_t, std::vector<CachedPolytope>> cache_;
 };
 
 SimplePolytopeBuilder::SimplePolytopeBuilder(std::shared_ptr<PrimitiveBuilder> primitive_builder) {
@@ -27,44 +94,50 @@ SimplePolytopeBuilder::SimplePolytopeBuilder(std::shared_ptr<PrimitiveBuilder> p
 
 auto SimplePolytopeBuilder::buildCube(const std::string& name, const glm::vec3& center, const glm::vec3& size,
                                       const std::vector<std::vector<float>>& other_data) -> void {
-  auto vertices = std::vector<glm::vec3>{
-      {-0.5F, -0.5F, -0.5F}, {-0.5F, 0.5F, -0.5F}, {0.5F, 0.5F, -0.5F}, {0.5F, -0.5F, -0.5F},
-      {-0.5F, -0.5F, 0.5F},  {-0.5F, 0.5F, 0.5F},  {0.5F, 0.5F, 0.5F},  {0.5F, -0.5F, 0.5F},
-  };
+  impl_->draw(PolytopeShape::kCube, name, {center, size, glm::vec3(0.0f)}, other_data, [&]() {
+    auto vertices = std::vector<glm::vec3>{
+        {-0.5F, -0.5F, -0.5F}, {-0.5F, 0.5F, -0.5F}, {0.5F, 0.5F, -0.5F}, {0.5F, -0.5F, -0.5F},
+        {-0.5F, -0.5F, 0.5F},  {-0.5F, 0.5F, 0.5F},  {0.5F, 0.5F, 0.5F},  {0.5F, -0.5F, 0.5F},
+    };
 
-  auto indices = std::vector<GLsizei>{
-      0, 1, 2, 2, 3, 0, 1, 5, 6, 6, 2, 1, 5, 4, 7, 7, 6, 5, 4, 0, 3, 3, 7, 4, 3, 2, 6, 6, 7, 3, 4, 5, 1, 1, 0, 4,
-  };
+    auto indices = std::vector<GLsizei>{
+        0, 1, 2, 2, 3, 0, 1, 5, 6, 6, 2, 1, 5, 4, 7, 7, 6, 5, 4, 0, 3, 3, 7, 4, 3, 2, 6, 6, 7, 3, 4, 5, 1, 1, 0, 4,
+    };
 
-  std::for_each(vertices.begin(), vertices.end(), [center, size](glm::vec3& v) { v = center + v * size; });
+    std::for_each(vertices.begin(), vertices.end(), [center, size](glm::vec3& v) { v = center + v * size; });
 
-  impl_->primitive_builder_->buildTriangles(name, vertices, indices, other_data);
+    impl_->primitive_builder_->buildTriangles(name, vertices, indices, other_data);
+  });
 }
 
 auto SimplePolytopeBuilder::buildTeraHedron(const std::string& name, const glm::vec3& center, const glm::vec3& size,
                                             const std::vector<std::vector<float>>& other_data) -> void {
-  auto vertices = std::vector<glm::vec3>{
-      {0.0F, 0.0F, 1.0F},
-      {0.0F, 0.942809F, -0.333333F},
-      {-0.816497F, -0.471405F, -0.333333F},
-      {0.816497F, -0.471405F, -0.333333F},
-  };
-  auto indices = std::vector<GLsizei>{0, 1, 2, 0, 2, 3, 0, 3, 1, 1, 2, 3};
+  impl_->draw(PolytopeShape::kTetrahedron, name, {center, size, glm::vec3(0.0f)}, other_data, [&]() {
+    auto vertices = std::vector<glm::vec3>{
+        {0.0F, 0.0F, 1.0F},
+        {0.0F, 0.942809F, -0.333333F},
+        {-0.816497F, -0.471405F, -0.333333F},
+        {0.816497F, -0.471405F, -0.333333F},
+    };
+    auto indices = std::vector<GLsizei>{0, 1, 2, 0, 2, 3, 0, 3, 1, 1, 2, 3};
 
-  std::for_each(vertices.begin(), vertices.end(), [center, size](glm::vec3& v) { v = center + v * size; });
+    std::for_each(vertices.begin(), vertices.end(), [center, size](glm::vec3& v) { v = center + v * size; });
 
-  impl_->primitive_builder_->buildTriangles(name, vertices, indices, other_data);
+    impl_->primitive_builder_->buildTriangles(name, vertices, indices, other_data);
+  });
 }
 
 auto SimplePolytopeBuilder::buildRect(const std::string& name, const glm::vec3& p1, const glm::vec3& p2,
                                       const glm::vec3& p3, const std::vector<std::vector<float>>& other_data) -> void {
-  // v04 = (v12 + v13) - v01
-  glm::vec3 p4 = p2 + p3 - p1;
+  impl_->draw(PolytopeShape::kRect, name, {p1, p2, p3}, other_data, [&]() {
+    // v04 = (v12 + v13) - v01
+    glm::vec3 p4 = p2 + p3 - p1;
 
-  auto vertices = std::vector<glm::vec3>{p1, p2, p3, p4};
-  auto indices = std::vector<GLsizei>{0, 1, 2, 2, 3, 1};
+    auto vertices = std::vector<glm::vec3>{p1, p2, p3, p4};
+    auto indices = std::vector<GLsizei>{0, 1, 2, 2, 3, 1};
 
-  impl_->primitive_builder_->buildTriangles(name, vertices, indices, other_data);
+    impl_->primitive_builder_->buildTriangles(name, vertices, indices, other_data);
+  });
 }
 
 }  // namespace gl_hwk
\ No newline at end of file
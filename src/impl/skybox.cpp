@@ -6,8 +6,10 @@
 #include <memory>
 
 #include "gl_homework/camera.hpp"
+#include "gl_homework/gpu_profiler.hpp"
 #include "gl_homework/impl.hpp"
 #include "gl_homework/primitive_builder.hpp"
+#include "gl_homework/render_stats.hpp"
 #include "gl_homework/texture_loader.hpp"
 
 namespace gl_hwk {
@@ -39,16 +41,18 @@ class SkyBoxImpl {
     shader->setInt("skybox", 0);
   }
 
-  auto draw() -> void {
+  auto draw(const glm::mat4& view, const glm::mat4& projection) -> void {
+    GpuProfileScope scope("skybox");
     // glClear(GL_DEPTH_BUFFER_BIT);
     glDepthFunc(GL_LEQUAL);
     shader_->start();
     gl_hwk::TextureLoader::instance().activeTexture(texture_id_, 0);
-    shader_->setMat4("projection", camera_->getProjectionMatrix());
-    shader_->setMat4("view", glm::mat4(glm::mat3(camera_->getViewMatrix())));
+    shader_->setMat4("projection", projection);
+    shader_->setMat4("view", glm::mat4(glm::mat3(view)));
     builder_->buildTriangles("skybox", vertices_, {}, {});
     glClear(GL_DEPTH_BUFFER_BIT);
     glDepthFunc(GL_LESS);
+    RenderStats::instance().addStateChange(2);
   }
 
   std::shared_ptr<Shader> shader_;
@@ -63,7 +67,9 @@ SkyBox::SkyBox(const std::vector<std::string>& paths, std::shared_ptr<Shader> sh
   impl_ = make_unique_impl<SkyBoxImpl>(texture_id, shader, camera);
 }
 
-auto SkyBox::draw() -> void { impl_->draw(); }
+auto SkyBox::draw() -> void { impl_->draw(impl_->camera_->getViewMatrix(), impl_->camera_->getProjectionMatrix()); }
+
+auto SkyBox::draw(const glm::mat4& view, const glm::mat4& projection) -> void { impl_->draw(view, projection); }
 
 auto SkyBox::setShader(std::shared_ptr<Shader> shader) -> void { impl_->shader_ = shader; }
 
@@ -0,0 +1,749 @@
+#include "gl_homework/software_renderer.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+// third party
+#include <fmt/core.h>
+// project
+#include "gl_homework/job_system.hpp"
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GL_HWK_SIMD_X86 1
+#define GL_HWK_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_M_X64)
+// MSVC没有按函数指定指令集的方式，只使用x64必定支持的SSE2
+#define GL_HWK_SIMD_X86 1
+#define GL_HWK_SIMD_NO_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace gl_hwk {
+
+namespace {
+
+// 分块大小，8的倍数
+constexpr int32_t kTileSize = 64;
+// 插值变量的最大个数，phong需要世界坐标、法线和纹理坐标
+constexpr int kMaxVaryings = 8;
+// 顶点数超过该值时并行变换
+constexpr size_t kParallelVertices = 4096;
+// 裁剪空间中x、y方向的保护带，超出屏幕这么多倍的三角形才裁剪，避免边函数精度不足
+constexpr float kGuardBand = 4.0f;
+
+struct DrawState {
+  SoftwareShader shader;
+  SoftwareUniforms uniforms;
+  bool depth_test;
+  bool blend;
+};
+
+struct ClipVertex {
+  glm::vec4 position;
+  float varyings[kMaxVaryings];
+};
+
+/**
+ * @brief 屏幕空间的顶点，x、y为像素坐标，z为窗口深度；varyings已经乘以inv_w，用于透视校正插值
+ */
+struct ScreenVertex {
+  float x, y, z, inv_w;
+  float varyings[kMaxVaryings];
+};
+
+enum class PrimitiveKind : uint8_t {
+  kTriangle,
+  kLine,
+  kPoint,
+};
+
+/**
+ * @brief 分块光栅化的图元；三角形为逆时针，边函数a * x + b * y + c在内侧为正，top_left的边上的像素也算在内
+ */
+struct RasterPrimitive {
+  PrimitiveKind kind;
+  uint32_t state;
+  ScreenVertex v[3];
+  float a[3], b[3], c[3];
+  bool top_left[3];
+  float inv_area;
+  int32_t min_x, min_y, max_x, max_y;
+};
+
+auto nowNs() -> uint64_t {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+auto varyingCount(SoftwareShader shader) -> int {
+  switch (shader) {
+    case SoftwareShader::kPureColor:
+      return 3;
+    case SoftwareShader::kTexture:
+      return 2;
+    case SoftwareShader::kPhong:
+      return 8;
+  }
+  return 0;
+}
+
+auto toByte(float value) -> uint8_t { return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f); }
+
+/**
+ * @brief 双线性过滤，REPEAT环绕，与GL_LINEAR相同以纹素中心为采样点
+ */
+auto sample(const SoftwareTexture* texture, float u, float v) -> glm::vec4 {
+  if (!texture || texture->width == 0 || texture->height == 0) {
+    return glm::vec4(1.0f);
+  }
+  auto w = static_cast<int32_t>(texture->width), h = static_cast<int32_t>(texture->height);
+  float x = u * w - 0.5f, y = v * h - 0.5f;
+  float fx = std::floor(x), fy = std::floor(y);
+  float tx = x - fx, ty = y - fy;
+  auto wrap = [](int32_t i, int32_t n) { return ((i % n) + n) % n; };
+  int32_t x0 = wrap(static_cast<int32_t>(fx), w), x1 = wrap(static_cast<int32_t>(fx) + 1, w);
+  int32_t y0 = wrap(static_cast<int32_t>(fy), h), y1 = wrap(static_cast<int32_t>(fy) + 1, h);
+  auto texel = [&](int32_t px, int32_t py) {
+    const uint8_t* p = texture->rgba.data() + (static_cast<size_t>(py) * w + px) * 4;
+    return glm::vec4(p[0], p[1], p[2], p[3]) * (1.0f / 255.0f);
+  };
+  glm::vec4 top = texel(x0, y0) * (1.0f - tx) + texel(x1, y0) * tx;
+  glm::vec4 bottom = texel(x0, y1) * (1.0f - tx) + texel(x1, y1) * tx;
+  return top * (1.0f - ty) + bottom * ty;
+}
+
+/**
+ * @brief 内置的顶点着色器，attribute(i)返回location i的数据，不存在时为0
+ */
+template <typename Attribute>
+auto shadeVertex(const DrawState& state, const glm::mat4& pvm, const float* position, Attribute&& attribute)
+    -> ClipVertex {
+  ClipVertex out{};
+  glm::vec4 p(position[0], position[1], position[2], 1.0f);
+  switch (state.shader) {
+    case SoftwareShader::kPureColor: {
+      out.position = pvm * p;
+      glm::vec3 color = attribute(1);
+      out.varyings[0] = color.x;
+      out.varyings[1] = color.y;
+      out.varyings[2] = color.z;
+      break;
+    }
+    case SoftwareShader::kTexture: {
+      out.position = pvm * p;
+      glm::vec3 uv = attribute(1);
+      out.varyings[0] = uv.x;
+      out.varyings[1] = uv.y;
+      break;
+    }
+    case SoftwareShader::kPhong: {
+      glm::vec4 world = state.uniforms.model * p;
+      out.position = state.uniforms.projection * state.uniforms.view * world;
+      glm::vec3 normal = state.uniforms.normal_matrix * attribute(2);
+      glm::vec3 uv = attribute(1);
+      const float values[kMaxVaryings] = {world.x, world.y, world.z, normal.x, normal.y, normal.z, uv.x, uv.y};
+      std::copy(values, values + kMaxVaryings, out.varyings);
+      break;
+    }
+  }
+  return out;
+}
+
+/**
+ * @brief 内置的片段着色器
+ */
+auto shadeFragment(const DrawState& state, const float* varyings) -> glm::vec4 {
+  const auto& u = state.uniforms;
+  switch (state.shader) {
+    case SoftwareShader::kPureColor:
+      return glm::vec4(varyings[0], varyings[1], varyings[2], 1.0f);
+    case SoftwareShader::kTexture:
+      return sample(u.texture.get(), varyings[0], varyings[1]);
+    case SoftwareShader::kPhong: {
+      glm::vec3 frag_pos(varyings[0], varyings[1], varyings[2]);
+      glm::vec4 texture_color = sample(u.texture.get(), varyings[6], varyings[7]);
+      glm::vec3 ambient = 0.1f * u.light_color;
+      glm::vec3 norm = glm::normalize(glm::vec3(varyings[3], varyings[4], varyings[5]));
+      glm::vec3 light_dir = glm::normalize(u.light_pos - frag_pos);
+      glm::vec3 diffuse = std::max(glm::dot(norm, light_dir), 0.0f) * u.light_color;
+      glm::vec3 view_dir = glm::normalize(u.view_pos - frag_pos);
+      // reflect(-lightDir, norm)
+      glm::vec3 reflect_dir = -light_dir + 2.0f * glm::dot(light_dir, norm) * norm;
+      float spec = std::pow(std::max(glm::dot(view_dir, reflect_dir), 0.0f), 32.0f);
+      glm::vec3 specular = 0.5f * spec * u.light_color;
+      glm::vec3 result = (ambient + diffuse + specular) * glm::vec3(texture_color);
+      return glm::vec4(result, texture_color.w);
+    }
+  }
+  return glm::vec4(1.0f);
+}
+
+/**
+ * @brief 8个像素的覆盖掩码，第i位对应x + i；与标量实现的求值顺序相同
+ */
+auto coverageScalar(const RasterPrimitive& t, const float* e_row, int32_t x) -> uint32_t {
+  uint32_t mask = 0;
+  for (int32_t i = 0; i < 8; ++i) {
+    float px = static_cast<float>(x + i) + 0.5f;
+    bool inside = true;
+    for (int e = 0; e < 3; ++e) {
+      float value = t.a[e] * px + e_row[e];
+      inside = inside && (t.top_left[e] ? value >= 0.0f : value > 0.0f);
+    }
+    mask |= static_cast<uint32_t>(inside) << i;
+  }
+  return mask;
+}
+
+#ifdef GL_HWK_SIMD_X86
+auto coverageSse(const RasterPrimitive& t, const float* e_row, int32_t x) -> uint32_t {
+  const __m128 zero = _mm_setzero_ps();
+  uint32_t result = 0;
+  for (int32_t half = 0; half < 2; ++half) {
+    __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x + half * 4)), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+    __m128 mask = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int e = 0; e < 3; ++e) {
+      __m128 value = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.a[e]), px), _mm_set1_ps(e_row[e]));
+      mask = _mm_and_ps(mask, t.top_left[e] ? _mm_cmpge_ps(value, zero) : _mm_cmpgt_ps(value, zero));
+    }
+    result |= static_cast<uint32_t>(_mm_movemask_ps(mask)) << (half * 4);
+  }
+  return result;
+}
+
+#ifndef GL_HWK_SIMD_NO_AVX2
+GL_HWK_TARGET_AVX2 auto coverageAvx2(const RasterPrimitive& t, const float* e_row, int32_t x) -> uint32_t {
+  const __m256 zero = _mm256_setzero_ps();
+  __m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)),
+                            _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f));
+  __m256 mask = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+  for (int e = 0; e < 3; ++e) {
+    __m256 value = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(t.a[e]), px), _mm256_set1_ps(e_row[e]));
+    mask = _mm256_and_ps(mask, t.top_left[e] ? _mm256_cmp_ps(value, zero, _CMP_GE_OQ)
+                                             : _mm256_cmp_ps(value, zero, _CMP_GT_OQ));
+  }
+  return static_cast<uint32_t>(_mm256_movemask_ps(mask));
+}
+#endif
+#endif
+
+/**
+ * @brief CPU支持的最高指令集
+ */
+auto supportedSimdLevel() -> SimdLevel {
+#if defined(GL_HWK_SIMD_X86) && !defined(GL_HWK_SIMD_NO_AVX2)
+  return __builtin_cpu_supports("avx2") ? SimdLevel::kAvx2 : SimdLevel::kSse;
+#elif defined(GL_HWK_SIMD_X86)
+  return SimdLevel::kSse;
+#else
+  return SimdLevel::kScalar;
+#endif
+}
+
+/**
+ * @brief 裁剪平面，dot(plane, position) >= 0为内侧
+ */
+const glm::vec4 kClipPlanes[6] = {{0, 0, 1, 1},          {0, 0, -1, 1},         {1, 0, 0, kGuardBand},
+                                  {-1, 0, 0, kGuardBand}, {0, 1, 0, kGuardBand}, {0, -1, 0, kGuardBand}};
+
+auto lerp(const ClipVertex& p, const ClipVertex& q, float t) -> ClipVertex {
+  ClipVertex out;
+  out.position = p.position + (q.position - p.position) * t;
+  for (int i = 0; i < kMaxVaryings; ++i) {
+    out.varyings[i] = p.varyings[i] + (q.varyings[i] - p.varyings[i]) * t;
+  }
+  return out;
+}
+
+auto planeDistance(const glm::vec4& plane, const glm::vec4& p) -> float {
+  return plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w * p.w;
+}
+
+}  // namespace
+
+class SoftwareRendererImpl {
+ public:
+  explicit SoftwareRendererImpl(const SoftwareRendererOptions& options)
+      : width_(std::max<uint32_t>(1, options.width)),
+        height_(std::max<uint32_t>(1, options.height)),
+        level_(supportedSimdLevel()) {
+    tiles_x_ = (width_ + kTileSize - 1) / kTileSize;
+    tiles_y_ = (height_ + kTileSize - 1) / kTileSize;
+    bins_.resize(static_cast<size_t>(tiles_x_) * tiles_y_);
+    color_.assign(static_cast<size_t>(width_) * height_ * 4, 0);
+    depth_.assign(static_cast<size_t>(width_) * height_, 1.0f);
+  }
+
+  auto toScreen(const ClipVertex& clip) const -> ScreenVertex {
+    ScreenVertex out;
+    out.inv_w = 1.0f / clip.position.w;
+    out.x = (clip.position.x * out.inv_w * 0.5f + 0.5f) * width_;
+    out.y = (clip.position.y * out.inv_w * 0.5f + 0.5f) * height_;
+    out.z = clip.position.z * out.inv_w * 0.5f + 0.5f;
+    for (int i = 0; i < kMaxVaryings; ++i) {
+      out.varyings[i] = clip.varyings[i] * out.inv_w;
+    }
+    return out;
+  }
+
+  auto bin(const RasterPrimitive& primitive) -> void {
+    auto index = static_cast<uint32_t>(primitives_.size());
+    primitives_.push_back(primitive);
+    for (int32_t ty = primitive.min_y / kTileSize; ty <= primitive.max_y / kTileSize; ++ty) {
+      for (int32_t tx = primitive.min_x / kTileSize; tx <= primitive.max_x / kTileSize; ++tx) {
+        bins_[ty * tiles_x_ + tx].push_back(index);
+      }
+    }
+  }
+
+  auto clampBounds(RasterPrimitive& p, float min_x, float min_y, float max_x, float max_y) const -> bool {
+    p.min_x = static_cast<int32_t>(std::max(0.0f, std::floor(min_x)));
+    p.min_y = static_cast<int32_t>(std::max(0.0f, std::floor(min_y)));
+    p.max_x = static_cast<int32_t>(std::min(static_cast<float>(width_) - 1.0f, std::floor(max_x)));
+    p.max_y = static_cast<int32_t>(std::min(static_cast<float>(height_) - 1.0f, std::floor(max_y)));
+    return p.min_x <= p.max_x && p.min_y <= p.max_y;
+  }
+
+  auto triangle(const ClipVertex& c0, const ClipVertex& c1, const ClipVertex& c2) -> void {
+    stats_.triangles++;
+    // Sutherland-Hodgman，每个平面最多增加一个顶点
+    ClipVertex buffers[2][9] = {{c0, c1, c2}};
+    int count = 3, current = 0;
+    for (const auto& plane : kClipPlanes) {
+      const ClipVertex* in = buffers[current];
+      ClipVertex* out = buffers[current ^ 1];
+      int out_count = 0;
+      for (int i = 0; i < count; ++i) {
+        const ClipVertex& p = in[i];
+        const ClipVertex& q = in[(i + 1) % count];
+        float dp = planeDistance(plane, p.position), dq = planeDistance(plane, q.position);
+        if (dp >= 0.0f) {
+          out[out_count++] = p;
+        }
+        if ((dp >= 0.0f) != (dq >= 0.0f)) {
+          out[out_count++] = lerp(p, q, dp / (dp - dq));
+        }
+      }
+      count = out_count;
+      current ^= 1;
+      if (count < 3) {
+        return;
+      }
+    }
+    ScreenVertex screen[9];
+    for (int i = 0; i < count; ++i) {
+      screen[i] = toScreen(buffers[current][i]);
+    }
+    for (int i = 1; i + 1 < count; ++i) {
+      setupTriangle(screen[0], screen[i], screen[i + 1]);
+    }
+  }
+
+  auto setupTriangle(const ScreenVertex& v0, const ScreenVertex& v1, const ScreenVertex& v2) -> void {
+    RasterPrimitive t;
+    t.kind = PrimitiveKind::kTriangle;
+    t.state = static_cast<uint32_t>(states_.size() - 1);
+    t.v[0] = v0;
+    t.v[1] = v1;
+    t.v[2] = v2;
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    // y轴向上，逆时针为正面
+    if (!(area != 0.0f) || (cull_face_ && area < 0.0f)) {
+      return;
+    }
+    if (area < 0.0f) {
+      std::swap(t.v[1], t.v[2]);
+      area = -area;
+    }
+    if (!clampBounds(t, std::min({v0.x, v1.x, v2.x}), std::min({v0.y, v1.y, v2.y}), std::max({v0.x, v1.x, v2.x}),
+                     std::max({v0.y, v1.y, v2.y}))) {
+      return;
+    }
+    for (int e = 0; e < 3; ++e) {
+      const ScreenVertex& p = t.v[e];
+      const ScreenVertex& q = t.v[(e + 1) % 3];
+      t.a[e] = p.y - q.y;
+      t.b[e] = q.x - p.x;
+      t.c[e] = -(t.a[e] * p.x + t.b[e] * p.y);
+      // 梯度指向内侧，左边(a > 0)和上边(a == 0且b < 0)上的像素属于这个三角形
+      t.top_left[e] = t.a[e] > 0.0f || (t.a[e] == 0.0f && t.b[e] < 0.0f);
+    }
+    t.inv_area = 1.0f / area;
+    stats_.rasterized++;
+    bin(t);
+  }
+
+  auto line(const ClipVertex& c0, const ClipVertex& c1) -> void {
+    stats_.lines++;
+    ClipVertex p = c0, q = c1;
+    for (const auto& plane : kClipPlanes) {
+      float dp = planeDistance(plane, p.position), dq = planeDistance(plane, q.position);
+      if (dp < 0.0f && dq < 0.0f) {
+        return;
+      }
+      if (dp < 0.0f) {
+        p = lerp(p, q, dp / (dp - dq));
+      } else if (dq < 0.0f) {
+        q = lerp(p, q, dp / (dp - dq));
+      }
+    }
+    RasterPrimitive l;
+    l.kind = PrimitiveKind::kLine;
+    l.state = static_cast<uint32_t>(states_.size() - 1);
+    l.v[0] = toScreen(p);
+    l.v[1] = toScreen(q);
+    if (clampBounds(l, std::min(l.v[0].x, l.v[1].x), std::min(l.v[0].y, l.v[1].y), std::max(l.v[0].x, l.v[1].x),
+                    std::max(l.v[0].y, l.v[1].y))) {
+      bin(l);
+    }
+  }
+
+  auto point(const ClipVertex& c) -> void {
+    stats_.points++;
+    for (const auto& plane : kClipPlanes) {
+      if (planeDistance(plane, c.position) < 0.0f) {
+        return;
+      }
+    }
+    RasterPrimitive p;
+    p.kind = PrimitiveKind::kPoint;
+    p.state = static_cast<uint32_t>(states_.size() - 1);
+    p.v[0] = toScreen(c);
+    if (clampBounds(p, p.v[0].x, p.v[0].y, p.v[0].x, p.v[0].y)) {
+      bin(p);
+    }
+  }
+
+  /**
+   * @brief 深度测试、着色和写入一个像素，返回是否执行了着色
+   */
+  auto fragment(const DrawState& state, int32_t x, int32_t y, float z, const float* varyings) -> bool {
+    size_t index = static_cast<size_t>(y) * width_ + x;
+    if (state.depth_test && !(z < depth_[index])) {
+      return false;
+    }
+    glm::vec4 color = shadeFragment(state, varyings);
+    uint8_t* out = color_.data() + index * 4;
+    if (state.blend) {
+      float alpha = std::clamp(color.w, 0.0f, 1.0f);
+      for (int i = 0; i < 4; ++i) {
+        out[i] = toByte(color[i] * alpha + out[i] / 255.0f * (1.0f - alpha));
+      }
+    } else {
+      for (int i = 0; i < 4; ++i) {
+        out[i] = toByte(color[i]);
+      }
+    }
+    if (state.depth_test) {
+      depth_[index] = z;
+    }
+    return true;
+  }
+
+  /**
+   * @brief 透视校正插值，weights为屏幕空间的重心坐标
+   */
+  static auto interpolate(const ScreenVertex* v, int n, const float* weights, int varying_count, float* out)
+      -> void {
+    float inv_w = 0.0f;
+    for (int k = 0; k < n; ++k) {
+      inv_w += weights[k] * v[k].inv_w;
+    }
+    float w = 1.0f / inv_w;
+    for (int i = 0; i < varying_count; ++i) {
+      float value = 0.0f;
+      for (int k = 0; k < n; ++k) {
+        value += weights[k] * v[k].varyings[i];
+      }
+      out[i] = value * w;
+    }
+  }
+
+  auto rasterTriangle(const RasterPrimitive& t, int32_t x0, int32_t y0, int32_t x1, int32_t y1) -> uint64_t {
+    const DrawState& state = states_[t.state];
+    int varying_count = varyingCount(state.shader);
+    uint64_t fragments = 0;
+    float varyings[kMaxVaryings];
+    for (int32_t y = y0; y < y1; ++y) {
+      float py = static_cast<float>(y) + 0.5f;
+      const float e_row[3] = {t.b[0] * py + t.c[0], t.b[1] * py + t.c[1], t.b[2] * py + t.c[2]};
+      for (int32_t x = x0; x < x1; x += 8) {
+        uint32_t mask;
+        switch (level_) {
+#ifdef GL_HWK_SIMD_X86
+#ifndef GL_HWK_SIMD_NO_AVX2
+          case SimdLevel::kAvx2:
+            mask = coverageAvx2(t, e_row, x);
+            break;
+#endif
+          case SimdLevel::kSse:
+            mask = coverageSse(t, e_row, x);
+            break;
+#endif
+          default:
+            mask = coverageScalar(t, e_row, x);
+            break;
+        }
+        // 8个像素可能超出分块右边界
+        mask &= (1u << std::min(8, x1 - x)) - 1;
+        for (int32_t i = 0; mask != 0; ++i, mask >>= 1) {
+          if ((mask & 1u) == 0) {
+            continue;
+          }
+          float px = static_cast<float>(x + i) + 0.5f;
+          // 边e的边函数与对边顶点(e + 2) % 3的重心坐标成正比
+          float e0 = t.a[0] * px + e_row[0], e1 = t.a[1] * px + e_row[1], e2 = t.a[2] * px + e_row[2];
+          const float weights[3] = {e1 * t.inv_area, e2 * t.inv_area, e0 * t.inv_area};
+          float z = weights[0] * t.v[0].z + weights[1] * t.v[1].z + weights[2] * t.v[2].z;
+          interpolate(t.v, 3, weights, varying_count, varyings);
+          fragments += fragment(state, x + i, y, z, varyings);
+        }
+      }
+    }
+    return fragments;
+  }
+
+  /**
+   * @brief DDA，沿主方向每个像素一步，只写入分块内的像素
+   */
+  auto rasterLine(const RasterPrimitive& l, int32_t x0, int32_t y0, int32_t x1, int32_t y1) -> uint64_t {
+    const DrawState& state = states_[l.state];
+    int varying_count = varyingCount(state.shader);
+    float dx = l.v[1].x - l.v[0].x, dy = l.v[1].y - l.v[0].y;
+    auto steps = static_cast<int32_t>(std::ceil(std::max(std::abs(dx), std::abs(dy))));
+    uint64_t fragments = 0;
+    float varyings[kMaxVaryings];
+    for (int32_t s = 0; s <= steps; ++s) {
+      float t = steps == 0 ? 0.0f : static_cast<float>(s) / steps;
+      auto x = static_cast<int32_t>(std::floor(l.v[0].x + dx * t));
+      auto y = static_cast<int32_t>(std::floor(l.v[0].y + dy * t));
+      if (x < x0 || x >= x1 || y < y0 || y >= y1) {
+        continue;
+      }
+      const float weights[2] = {1.0f - t, t};
+      float z = weights[0] * l.v[0].z + weights[1] * l.v[1].z;
+      interpolate(l.v, 2, weights, varying_count, varyings);
+      fragments += fragment(state, x, y, z, varyings);
+    }
+    return fragments;
+  }
+
+  auto rasterTile(size_t tile) -> uint64_t {
+    auto tx = static_cast<int32_t>(tile % tiles_x_), ty = static_cast<int32_t>(tile / tiles_x_);
+    int32_t tile_x0 = tx * kTileSize, tile_y0 = ty * kTileSize;
+    int32_t tile_x1 = std::min(tile_x0 + kTileSize, static_cast<int32_t>(width_));
+    int32_t tile_y1 = std::min(tile_y0 + kTileSize, static_cast<int32_t>(height_));
+    uint64_t fragments = 0;
+    for (uint32_t index : bins_[tile]) {
+      const RasterPrimitive& p = primitives_[index];
+      int32_t x0 = std::max(p.min_x, tile_x0), y0 = std::max(p.min_y, tile_y0);
+      int32_t x1 = std::min(p.max_x + 1, tile_x1), y1 = std::min(p.max_y + 1, tile_y1);
+      switch (p.kind) {
+        case PrimitiveKind::kTriangle:
+          // 按8对齐，与分块的起点一致
+          fragments += rasterTriangle(p, tile_x0 + ((x0 - tile_x0) & ~7), y0, x1, y1);
+          break;
+        case PrimitiveKind::kLine:
+          fragments += rasterLine(p, x0, y0, x1, y1);
+          break;
+        case PrimitiveKind::kPoint: {
+          const DrawState& state = states_[p.state];
+          const float weight = 1.0f;
+          float varyings[kMaxVaryings];
+          interpolate(p.v, 1, &weight, varyingCount(state.shader), varyings);
+          fragments += fragment(state, p.min_x, p.min_y, p.v[0].z, varyings);
+          break;
+        }
+      }
+    }
+    bins_[tile].clear();
+    return fragments;
+  }
+
+  auto flush() -> void {
+    if (primitives_.empty()) {
+      states_.clear();
+      return;
+    }
+    GL_HWK_TRACE_SCOPE("SoftwareRenderer::flush");
+    uint64_t start = nowNs();
+    std::atomic<uint64_t> fragments{0};
+    size_t grain = bins_.size() / (4 * (JobSystem::instance().getWorkerCount() + 1)) + 1;
+    JobSystem::instance().parallelFor(bins_.size(), grain, [this, &fragments](size_t begin, size_t end) {
+      uint64_t count = 0;
+      for (size_t tile = begin; tile < end; ++tile) {
+        count += rasterTile(tile);
+      }
+      fragments.fetch_add(count, std::memory_order_relaxed);
+    });
+    primitives_.clear();
+    states_.clear();
+    stats_.fragments += fragments.load();
+    stats_.raster_ms += (nowNs() - start) / 1e6;
+  }
+
+  uint32_t width_, height_;
+  int32_t tiles_x_, tiles_y_;
+  SimdLevel level_;
+  SoftwareShader shader_ = SoftwareShader::kPureColor;
+  SoftwareUniforms uniforms_;
+  bool depth_test_ = true;
+  bool cull_face_ = false;
+  bool blend_ = false;
+
+  std::vector<DrawState> states_;
+  std::vector<ClipVertex> clip_;
+  std::vector<RasterPrimitive> primitives_;
+  std::vector<std::vector<uint32_t>> bins_;
+  std::vector<uint8_t> color_;
+  std::vector<float> depth_;
+  SoftwareRenderStats stats_;
+};
+
+SoftwareRenderer::SoftwareRenderer(const SoftwareRendererOptions& options)
+    : impl_(make_unique_impl<SoftwareRendererImpl>(options)) {}
+
+// 在SoftwareRendererImpl完整定义处析构
+SoftwareRenderer::~SoftwareRenderer() = default;
+
+auto SoftwareRenderer::setShader(SoftwareShader shader) -> void { impl_->shader_ = shader; }
+
+auto SoftwareRenderer::uniforms() -> SoftwareUniforms& { return impl_->uniforms_; }
+
+auto SoftwareRenderer::setDepthTest(bool enabled) -> void { impl_->depth_test_ = enabled; }
+
+auto SoftwareRenderer::setCullFace(bool enabled) -> void { impl_->cull_face_ = enabled; }
+
+auto SoftwareRenderer::setBlend(bool enabled) -> void { impl_->blend_ = enabled; }
+
+auto SoftwareRenderer::clear(const glm::vec4& color) -> void {
+  impl_->flush();
+  const uint8_t rgba[4] = {toByte(color.x), toByte(color.y), toByte(color.z), toByte(color.w)};
+  for (size_t i = 0; i < impl_->color_.size(); i += 4) {
+    std::copy(rgba, rgba + 4, impl_->color_.data() + i);
+  }
+  std::fill(impl_->depth_.begin(), impl_->depth_.end(), 1.0f);
+  impl_->stats_ = SoftwareRenderStats();
+}
+
+auto SoftwareRenderer::draw(GLenum type, const float* vertices, uint32_t stride, uint32_t vertex_count,
+                            const GLsizei* indices, uint32_t index_count) -> void {
+  GL_HWK_TRACE_SCOPE("SoftwareRenderer::draw");
+  auto& impl = *impl_;
+  if (stride < 3) {
+    fmt::print("SoftwareRenderer: invalid vertex stride {}\n", stride);
+    return;
+  }
+  uint64_t start = nowNs();
+  impl.stats_.draw_calls++;
+  impl.states_.push_back({impl.shader_, impl.uniforms_, impl.depth_test_, impl.blend_});
+  const DrawState& state = impl.states_.back();
+
+  // 顶点着色，每个顶点只计算一次
+  glm::mat4 pvm = state.uniforms.projection * state.uniforms.view * state.uniforms.model;
+  impl.clip_.resize(vertex_count);
+  auto* clip = impl.clip_.data();
+  auto shade = [&state, &pvm, clip, vertices, stride](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const float* vertex = vertices + i * stride;
+      clip[i] = shadeVertex(state, pvm, vertex, [vertex, stride](uint32_t location) {
+        uint32_t offset = location * 3;
+        return offset + 3 <= stride ? glm::vec3(vertex[offset], vertex[offset + 1], vertex[offset + 2])
+                                    : glm::vec3(0.0f);
+      });
+    }
+  };
+  if (vertex_count >= kParallelVertices) {
+    JobSystem::instance().parallelFor(vertex_count, kParallelVertices / 4, shade);
+  } else {
+    shade(0, vertex_count);
+  }
+
+  // 图元装配
+  uint32_t count = indices ? index_count : vertex_count;
+  auto at = [&](uint32_t i) -> const ClipVertex& {
+    return clip[indices ? static_cast<uint32_t>(indices[i]) : i];
+  };
+  auto valid = [&](uint32_t i) { return !indices || static_cast<uint32_t>(indices[i]) < vertex_count; };
+  switch (type) {
+    case GL_TRIANGLES:
+      for (uint32_t i = 0; i + 2 < count; i += 3) {
+        if (valid(i) && valid(i + 1) && valid(i + 2)) {
+          impl.triangle(at(i), at(i + 1), at(i + 2));
+        }
+      }
+      break;
+    case GL_TRIANGLE_STRIP:
+      for (uint32_t i = 0; i + 2 < count; ++i) {
+        if (!(valid(i) && valid(i + 1) && valid(i + 2))) {
+          continue;
+        }
+        // 奇数个三角形交换前两个顶点，保持环绕方向一致
+        if (i % 2 == 0) {
+          impl.triangle(at(i), at(i + 1), at(i + 2));
+        } else {
+          impl.triangle(at(i + 1), at(i), at(i + 2));
+        }
+      }
+      break;
+    case GL_LINES:
+      for (uint32_t i = 0; i + 1 < count; i += 2) {
+        if (valid(i) && valid(i + 1)) {
+          impl.line(at(i), at(i + 1));
+        }
+      }
+      break;
+    case GL_LINE_STRIP:
+    case GL_LINE_LOOP:
+      for (uint32_t i = 0; i + 1 < count; ++i) {
+        if (valid(i) && valid(i + 1)) {
+          impl.line(at(i), at(i + 1));
+        }
+      }
+      if (type == GL_LINE_LOOP && count > 2 && valid(count - 1) && valid(0)) {
+        impl.line(at(count - 1), at(0));
+      }
+      break;
+    case GL_POINTS:
+      for (uint32_t i = 0; i < count; ++i) {
+        if (valid(i)) {
+          impl.point(at(i));
+        }
+      }
+      break;
+    default:
+      fmt::print("SoftwareRenderer: unsupported primitive type {:#x}\n", type);
+      break;
+  }
+  impl.stats_.vertex_ms += (nowNs() - start) / 1e6;
+}
+
+auto SoftwareRenderer::flush() -> void { impl_->flush(); }
+
+auto SoftwareRenderer::getColorBuffer() -> const std::vector<uint8_t>& {
+  impl_->flush();
+  return impl_->color_;
+}
+
+auto SoftwareRenderer::getDepthBuffer() -> const std::vector<float>& {
+  impl_->flush();
+  return impl_->depth_;
+}
+
+auto SoftwareRenderer::getWidth() -> uint32_t { return impl_->width_; }
+
+auto SoftwareRenderer::getHeight() -> uint32_t { return impl_->height_; }
+
+auto SoftwareRenderer::setSimdLevel(SimdLevel level) -> void { impl_->level_ = std::min(level, supportedSimdLevel()); }
+
+auto SoftwareRenderer::getSimdLevel() -> SimdLevel { return impl_->level_; }
+
+auto SoftwareRenderer::getStats() -> SoftwareRenderStats { return impl_->stats_; }
+
+}  // namespace gl_hwk
@@ -1,23 +1,43 @@
 #include "gl_homework/texture_loader.hpp"
 
 #include <filesystem>
-#include <opencv2/opencv.hpp>
 #include <unordered_map>
 
-#include "opencv2/imgcodecs.hpp"
+#include "gl_homework/image_codec.hpp"
+#include "gl_homework/render_stats.hpp"
+#include "gl_homework/trace.hpp"
 
 namespace gl_hwk {
 
 struct TextureInfo {
   GLuint id;
-  std::vector<cv::Mat> textures;
+  std::vector<Image> textures;
   int type;
+  // 显存占用估计，用于渲染统计
+  uint64_t bytes = 0;
 };
 
+// 完整mipmap链约为第0层的4/3
+inline auto mipmappedBytes(uint64_t level0_bytes) -> uint64_t { return level0_bytes * 4 / 3; }
+
+/**
+ * @brief 上传行紧密排列的像素，RGB的行长不一定是4的倍数
+ */
+inline auto uploadImage(GLenum target, const Image& image) -> void {
+  GLint alignment = 4;
+  glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  const GLenum format = image.layout == PixelLayout::kRgba ? GL_RGBA : GL_RGB;
+  glTexImage2D(target, 0, static_cast<GLint>(format), static_cast<GLsizei>(image.width),
+               static_cast<GLsizei>(image.height), 0, format, GL_UNSIGNED_BYTE, image.pixels.data());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+}
+
 class TextureLoaderImpl {
  public:
   TextureLoaderImpl() = default;
   std::unordered_map<GLuint, TextureInfo> textures_;
+  ImageCodec codec_;
 };
 
 TextureLoader::TextureLoader() : impl_(make_unique_impl<TextureLoaderImpl>()) {}
@@ -32,8 +52,14 @@ auto TextureLoader::loadTexture(const std::string& texture_path, bool flip) -> G
     fmt::print("TextureLoader: Texture file not found: {}\n", texture_path);
     return 0;
   }
-  cv::Mat image = cv::imread(texture_path, cv::IMREAD_COLOR);
-  if (flip) cv::flip(image, image, 0);
+  GL_HWK_TRACE_SCOPE("TextureLoader::loadTexture");
+  Image image;
+  {
+    GL_HWK_TRACE_SCOPE("TextureLoader::decode");
+    DecodeOptions options;
+    options.flip = flip;
+    impl_->codec_.decode(texture_path, options, image);
+  }
 
   if (image.empty()) {
     fmt::print("TextureLoader: Failed to load image: {}\n", texture_path);
@@ -51,20 +77,28 @@ auto TextureLoader::loadTexture(const std::string& texture_path, bool flip) -> G
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.cols, image.rows, 0, GL_BGR_EXT, GL_UNSIGNED_BYTE, image.data);
-  glGenerateMipmap(GL_TEXTURE_2D);
+  {
+    GL_HWK_TRACE_SCOPE("TextureLoader::upload");
+    uploadImage(GL_TEXTURE_2D, image);
+    glGenerateMipmap(GL_TEXTURE_2D);
+  }
 
-  impl_->textures_[texture_id] = {texture_id, {std::move(image)}, GL_TEXTURE_2D};
+  uint64_t upload_bytes = static_cast<uint64_t>(image.width) * image.height * 3;
+  RenderStats::instance().addTextureUpload(upload_bytes);
+  RenderStats::instance().addTexture(GL_TEXTURE_2D, 1, mipmappedBytes(upload_bytes));
+  impl_->textures_[texture_id] = {texture_id, {std::move(image)}, GL_TEXTURE_2D, mipmappedBytes(upload_bytes)};
 
   return texture_id;
 }
 
 auto TextureLoader::loadBoxMap(const std::vector<std::string>& paths) -> GLuint {
+  GL_HWK_TRACE_SCOPE("TextureLoader::loadBoxMap");
   GLuint texture_id;
   glGenTextures(1, &texture_id);
   glBindTexture(GL_TEXTURE_CUBE_MAP, texture_id);
 
   impl_->textures_[texture_id] = {texture_id, {}, GL_TEXTURE_CUBE_MAP};
+  RenderStats::instance().addTexture(GL_TEXTURE_CUBE_MAP, 1, 0);
 
   for (unsigned int i = 0; i < paths.size(); i++) {
     const std::string& path = paths[i];
@@ -73,15 +107,25 @@ auto TextureLoader::loadBoxMap(const std::vector<std::string>& paths) -> GLuint
       return 0;
     }
 
-    cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
+    Image image;
+    {
+      GL_HWK_TRACE_SCOPE("TextureLoader::decode");
+      impl_->codec_.decode(path, DecodeOptions(), image);
+    }
 
     if (image.empty()) {
       fmt::print("TextureLoader: Failed to load image: {}\n", path);
       return 0;
     }
 
-    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, image.cols, image.rows, 0, GL_BGR_EXT, GL_UNSIGNED_BYTE,
-                 image.data);
+    {
+      GL_HWK_TRACE_SCOPE("TextureLoader::upload");
+      uploadImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, image);
+    }
+    uint64_t face_bytes = static_cast<uint64_t>(image.width) * image.height * 3;
+    RenderStats::instance().addTextureUpload(face_bytes);
+    RenderStats::instance().addTexture(GL_TEXTURE_CUBE_MAP, 0, static_cast<int64_t>(face_bytes));
+    impl_->textures_[texture_id].bytes += face_bytes;
 
     impl_->textures_[texture_id].textures.push_back(std::move(image));
   }
@@ -102,36 +146,60 @@ auto TextureLoader::activeTexture(GLuint texture_id, int idx) -> void {
   int type = impl_->textures_[texture_id].type;
   glActiveTexture(GL_TEXTURE0 + idx);
   glBindTexture(type, texture_id);
+  RenderStats::instance().addStateChange(2);
 }
 
+auto TextureLoader::registerTexture(GLuint texture_id, GLenum type) -> void {
+  impl_->textures_[texture_id] = {texture_id, {}, static_cast<int>(type)};
+}
+
+auto TextureLoader::unregisterTexture(GLuint texture_id) -> void { impl_->textures_.erase(texture_id); }
+
 auto TextureLoader::setTextureAlpha(GLuint texture_id, float alpha) -> void {
+  GL_HWK_TRACE_SCOPE("TextureLoader::setTextureAlpha");
   if (impl_->textures_.find(texture_id) == impl_->textures_.end()) {
     fmt::print("TextureLoader: Texture ID not found: {}\n", texture_id);
     return;
   }
 
-  auto texture_info = impl_->textures_[texture_id];
+  const auto& texture_info = impl_->textures_[texture_id];
   if (texture_info.type != GL_TEXTURE_2D) {
     fmt::print("TextureLoader: Texture type is not GL_TEXTURE_2D: {}\n", texture_id);
     return;
   }
-
-  cv::Mat& image = impl_->textures_[texture_id].textures[0];
-  int channels = image.channels();
-  if (channels == 3) {
-    cv::Mat temp;
-    cv::cvtColor(image, temp, cv::COLOR_BGR2BGRA);
-    image = temp;
+  if (texture_info.textures.empty()) {
+    fmt::print("TextureLoader: Texture has no CPU copy: {}\n", texture_id);
+    return;
   }
-  for (int i = 0; i < image.rows; i++) {
-    for (int j = 0; j < image.cols; j++) {
-      image.at<cv::Vec4b>(i, j)[3] = static_cast<unsigned char>(alpha * 255);
+
+  Image& image = impl_->textures_[texture_id].textures[0];
+  const size_t pixel_count = static_cast<size_t>(image.width) * image.height;
+  if (image.layout == PixelLayout::kRgb) {
+    // 从后往前原地扩展为RGBA
+    image.pixels.resize(pixel_count * 4);
+    for (size_t i = pixel_count; i-- > 0;) {
+      image.pixels[i * 4 + 2] = image.pixels[i * 3 + 2];
+      image.pixels[i * 4 + 1] = image.pixels[i * 3 + 1];
+      image.pixels[i * 4] = image.pixels[i * 3];
     }
+    image.layout = PixelLayout::kRgba;
+  }
+  for (size_t i = 0; i < pixel_count; i++) {
+    image.pixels[i * 4 + 3] = static_cast<unsigned char>(alpha * 255);
   }
 
   glBindTexture(GL_TEXTURE_2D, texture_id);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.cols, image.rows, 0, GL_BGRA_EXT, GL_UNSIGNED_BYTE, image.data);
+  uploadImage(GL_TEXTURE_2D, image);
   glGenerateMipmap(GL_TEXTURE_2D);
+
+  // 纹理重新分配为RGBA
+  uint64_t upload_bytes = static_cast<uint64_t>(image.width) * image.height * 4;
+  uint64_t& bytes = impl_->textures_[texture_id].bytes;
+  RenderStats::instance().addStateChange();
+  RenderStats::instance().addTextureUpload(upload_bytes);
+  RenderStats::instance().addTexture(GL_TEXTURE_2D, 0,
+                                     static_cast<int64_t>(mipmappedBytes(upload_bytes)) - static_cast<int64_t>(bytes));
+  bytes = mipmappedBytes(upload_bytes);
 }
 
 }  // namespace gl_hwk
\ No newline at end of file
@@ -0,0 +1,575 @@
+#include "gl_homework/texture_streamer.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <mutex>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+// third party
+#include <fmt/core.h>
+// project
+#include "gl_homework/image_codec.hpp"
+#include "gl_homework/job_system.hpp"
+#include "gl_homework/render_stats.hpp"
+#include "gl_homework/texture_loader.hpp"
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+namespace {
+
+struct MipLevel {
+  uint32_t width;
+  uint32_t height;
+  std::vector<uint8_t> rgba;
+};
+
+/**
+ * @brief 2x2盒式滤波逐层缩小，奇数边长时最后一行(列)重复采样
+ */
+auto buildMipChain(uint32_t width, uint32_t height, std::vector<uint8_t> rgba) -> std::vector<MipLevel> {
+  std::vector<MipLevel> mips;
+  mips.push_back({width, height, std::move(rgba)});
+  while (mips.back().width > 1 || mips.back().height > 1) {
+    const MipLevel& src = mips.back();
+    MipLevel dst{std::max(src.width / 2, 1u), std::max(src.height / 2, 1u), {}};
+    dst.rgba.resize(static_cast<size_t>(dst.width) * dst.height * 4);
+    for (uint32_t y = 0; y < dst.height; ++y) {
+      const uint32_t y0 = std::min(y * 2, src.height - 1);
+      const uint32_t y1 = std::min(y * 2 + 1, src.height - 1);
+      for (uint32_t x = 0; x < dst.width; ++x) {
+        const uint32_t x0 = std::min(x * 2, src.width - 1);
+        const uint32_t x1 = std::min(x * 2 + 1, src.width - 1);
+        const uint8_t* p00 = &src.rgba[(static_cast<size_t>(y0) * src.width + x0) * 4];
+        const uint8_t* p01 = &src.rgba[(static_cast<size_t>(y0) * src.width + x1) * 4];
+        const uint8_t* p10 = &src.rgba[(static_cast<size_t>(y1) * src.width + x0) * 4];
+        const uint8_t* p11 = &src.rgba[(static_cast<size_t>(y1) * src.width + x1) * 4];
+        uint8_t* out = &dst.rgba[(static_cast<size_t>(y) * dst.width + x) * 4];
+        for (int c = 0; c < 4; ++c) {
+          out[c] = static_cast<uint8_t>((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+        }
+      }
+    }
+    mips.push_back(std::move(dst));
+  }
+  return mips;
+}
+
+auto levelBytes(const MipLevel& level) -> uint64_t { return static_cast<uint64_t>(level.width) * level.height * 4; }
+
+}  // namespace
+
+struct StreamedTexture {
+  GLuint id = 0;
+  // mip链的尺寸，第0层最精细；从文件加载的纹理只在CPU上保留常驻的几层和需要但还没上传的层，其余层的rgba为空
+  std::vector<MipLevel> mips;
+  // 为空表示从内存创建，没有文件可以重新解码，保留完整的mip链
+  std::string path;
+  bool flip = false;
+  // 正在后台重新解码更精细的层
+  bool reloading = false;
+  // 重新解码得到的层等待上传的帧数
+  uint32_t staged_frames = 0;
+  bool ready = false;
+  // 常驻的最粗几层中最精细的一层，加载后一直常驻
+  uint32_t tail = 0;
+  // 当前最精细的常驻层级，即GL_TEXTURE_BASE_LEVEL
+  uint32_t resident = 0;
+  // 本帧需要的层级和屏幕上的边长
+  uint32_t wanted = 0;
+  float pixels = 0.0f;
+  bool requested = false;
+  // 常驻层级比需要的更精细的连续帧数
+  uint32_t idle_frames = 0;
+  uint64_t bytes = 0;
+
+  // 比需要的层级模糊几层，负数表示比需要的更精细
+  auto error() const -> int { return static_cast<int>(resident) - static_cast<int>(wanted); }
+};
+
+struct DecodedTexture {
+  size_t index;
+  std::vector<MipLevel> mips;
+};
+
+class TextureStreamerImpl {
+ public:
+  explicit TextureStreamerImpl(const TextureStreamingOptions& options) : options_(options) {}
+
+  ~TextureStreamerImpl() {
+    // 等待后台解码结束，任务持有this
+    JobSystem::instance().wait(decoding_);
+    for (auto& texture : textures_) {
+      TextureLoader::instance().unregisterTexture(texture.id);
+      RenderStats::instance().addTexture(GL_TEXTURE_2D, -1, -static_cast<int64_t>(texture.bytes));
+      glDeleteTextures(1, &texture.id);
+    }
+  }
+
+  auto create() -> size_t {
+    StreamedTexture texture;
+    glGenTextures(1, &texture.id);
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    // 解码完成前的占位
+    const uint8_t gray[4] = {128, 128, 128, 255};
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, gray);
+    RenderStats::instance().addTexture(GL_TEXTURE_2D, 1, 0);
+    RenderStats::instance().addTextureUpload(sizeof(gray));
+    // 占位也计入常驻字节，allocate替换为mip链时按差值调整
+    addBytes(texture, sizeof(gray));
+    TextureLoader::instance().registerTexture(texture.id, GL_TEXTURE_2D);
+
+    index_[texture.id] = textures_.size();
+    textures_.push_back(std::move(texture));
+    return textures_.size() - 1;
+  }
+
+  /**
+   * @brief 在后台解码path并生成mip链，首次加载和重新解码更精细的层都使用
+   */
+  auto decode(size_t index, const std::string& path, bool flip) -> void {
+    JobSystem::instance().schedule(
+        [this, index, path, flip]() {
+          GL_HWK_TRACE_SCOPE("TextureStreamer::decode");
+          // 每个工作线程一个解码器，解码缓冲区在线程内复用
+          thread_local ImageCodec codec;
+          DecodeOptions options;
+          options.layout = PixelLayout::kRgba;
+          options.flip = flip;
+          Image image;
+          if (!codec.decode(path, options, image)) {
+            fmt::print("TextureStreamer: Failed to load image: {}\n", path);
+            finish(index, {});
+            return;
+          }
+          finish(index, buildMipChain(image.width, image.height, std::move(image.pixels)));
+        },
+        &decoding_);
+  }
+
+  /**
+   * @brief 需要上传的层不在CPU上时从文件重新解码，完成前保持当前层级
+   */
+  auto reload(StreamedTexture& texture, size_t index) -> void {
+    texture.reloading = true;
+    decode(index, texture.path, texture.flip);
+  }
+
+  /**
+   * @brief 重新解码的结果取出下一层，以及剩余预算放得下的更精细的层
+   */
+  auto restore(StreamedTexture& texture, std::vector<MipLevel>& mips) -> void {
+    texture.reloading = false;
+    texture.staged_frames = 0;
+    if (mips.size() != texture.mips.size()) {
+      // 文件已经变化或无法读取，不再尝试加载更精细的层
+      fmt::print("TextureStreamer: Failed to reload mip levels: {}\n", texture.path);
+      texture.path.clear();
+      return;
+    }
+    const uint64_t room = options_.budget_bytes > resident_bytes_ ? options_.budget_bytes - resident_bytes_ : 0;
+    uint64_t staged = 0;
+    for (uint32_t level = texture.resident; level-- > texture.wanted;) {
+      staged += levelBytes(texture.mips[level]);
+      if (level + 1 < texture.resident && staged > room) {
+        break;
+      }
+      if (texture.mips[level].rgba.empty()) {
+        texture.mips[level].rgba = std::move(mips[level].rgba);
+      }
+    }
+  }
+
+  /**
+   * @brief 从文件加载的纹理释放不再需要的CPU副本：已经上传的层、比需要的更精细的层，
+   * 以及重新解码后evict_delay_frames帧内仍没有上传的层
+   */
+  auto releaseCpuLevels(StreamedTexture& texture) -> void {
+    if (texture.path.empty()) {
+      return;
+    }
+    bool staged = false;
+    for (uint32_t level = texture.wanted; level < texture.resident && level < texture.tail; ++level) {
+      staged = staged || !texture.mips[level].rgba.empty();
+    }
+    const bool expired = staged && ++texture.staged_frames > options_.evict_delay_frames;
+    for (uint32_t level = 0; level < texture.tail; ++level) {
+      if ((expired || level < texture.wanted || level >= texture.resident) && !texture.mips[level].rgba.empty()) {
+        std::vector<uint8_t>().swap(texture.mips[level].rgba);
+      }
+    }
+    if (!staged || expired) {
+      texture.staged_frames = 0;
+    }
+  }
+
+  auto finish(size_t index, std::vector<MipLevel> mips) -> void {
+    std::lock_guard<std::mutex> lock(mutex_);
+    decoded_.push_back({index, std::move(mips)});
+  }
+
+  auto find(GLuint texture) -> StreamedTexture* {
+    auto it = index_.find(texture);
+    if (it == index_.end()) {
+      return nullptr;
+    }
+    return &textures_[it->second];
+  }
+
+  /**
+   * @brief 解码完成后上传最粗的几层，释放占位的第0层
+   */
+  auto allocate(StreamedTexture& texture) -> void {
+    const uint32_t levels = static_cast<uint32_t>(texture.mips.size());
+    texture.tail = levels - 1;
+    while (texture.tail > 0 && std::max(texture.mips[texture.tail - 1].width, texture.mips[texture.tail - 1].height) <=
+                                   options_.resident_size) {
+      texture.tail--;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    uint64_t bytes = 0;
+    for (uint32_t level = texture.tail; level < levels; ++level) {
+      const MipLevel& mip = texture.mips[level];
+      glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_RGBA8, static_cast<GLsizei>(mip.width),
+                   static_cast<GLsizei>(mip.height), 0, GL_RGBA, GL_UNSIGNED_BYTE, mip.rgba.data());
+      bytes += levelBytes(mip);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(texture.tail));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels - 1));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    texture.resident = texture.tail;
+    texture.wanted = texture.tail;
+    texture.ready = true;
+    RenderStats::instance().addTextureUpload(bytes);
+    addBytes(texture, static_cast<int64_t>(bytes) - static_cast<int64_t>(texture.bytes));
+  }
+
+  /**
+   * @brief 上传下一层更精细的mip，再把BASE_LEVEL降到这一层
+   */
+  auto upgrade(StreamedTexture& texture) -> uint64_t {
+    const uint32_t level = texture.resident - 1;
+    const MipLevel& mip = texture.mips[level];
+    assert(!mip.rgba.empty());
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_RGBA8, static_cast<GLsizei>(mip.width),
+                 static_cast<GLsizei>(mip.height), 0, GL_RGBA, GL_UNSIGNED_BYTE, mip.rgba.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(level));
+    texture.resident = level;
+    texture.staged_frames = 0;
+    const uint64_t bytes = levelBytes(mip);
+    RenderStats::instance().addTextureUpload(bytes);
+    addBytes(texture, static_cast<int64_t>(bytes));
+    stats_.uploaded_bytes += bytes;
+    return bytes;
+  }
+
+  /**
+   * @brief 先把BASE_LEVEL升高一层使最精细的层不再参与采样，再把它重新分配为空以释放显存
+   */
+  auto evict(StreamedTexture& texture) -> uint64_t {
+    const uint32_t level = texture.resident;
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(level + 1));
+    glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    texture.resident = level + 1;
+    const uint64_t bytes = levelBytes(texture.mips[level]);
+    addBytes(texture, -static_cast<int64_t>(bytes));
+    stats_.evicted_bytes += bytes;
+    return bytes;
+  }
+
+  auto addBytes(StreamedTexture& texture, int64_t delta) -> void {
+    texture.bytes = static_cast<uint64_t>(static_cast<int64_t>(texture.bytes) + delta);
+    resident_bytes_ = static_cast<uint64_t>(static_cast<int64_t>(resident_bytes_) + delta);
+    RenderStats::instance().addTexture(GL_TEXTURE_2D, 0, delta);
+  }
+
+  /**
+   * @brief 纹理在屏幕上的边长为pixels时需要的mip层级
+   */
+  auto wantedLevel(const StreamedTexture& texture, float pixels) const -> uint32_t {
+    const float size = static_cast<float>(std::max(texture.mips[0].width, texture.mips[0].height));
+    if (pixels <= 0.0f) {
+      return texture.tail;
+    }
+    const float level = std::floor(std::log2(size / pixels) + options_.lod_bias);
+    return static_cast<uint32_t>(std::clamp(level, 0.0f, static_cast<float>(texture.tail)));
+  }
+
+  auto streamMips() -> void;
+
+  TextureStreamingOptions options_;
+  TextureStreamingStats stats_;
+  std::vector<StreamedTexture> textures_;
+  std::unordered_map<GLuint, size_t> index_;
+  uint64_t resident_bytes_ = 0;
+  uint32_t loading_ = 0;
+
+  // 后台解码的结果，在update中取出上传
+  std::mutex mutex_;
+  std::vector<DecodedTexture> decoded_;
+  JobCounter decoding_;
+};
+
+auto TextureStreamerImpl::streamMips() -> void {
+  // 堆中的项为(误差, 屏幕边长, 序号)；误差在入堆后变化的项已经过期，出堆时跳过
+  using Entry = std::tuple<int, float, size_t>;
+  // 误差越大、屏幕上越大的纹理越先上传
+  std::priority_queue<Entry> upgrades;
+  // 误差越小、屏幕上越小的纹理越先驱逐
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> victims;
+  for (size_t i = 0; i < textures_.size(); ++i) {
+    const StreamedTexture& texture = textures_[i];
+    if (!texture.ready) {
+      continue;
+    }
+    if (texture.error() > 0) {
+      upgrades.emplace(texture.error(), texture.pixels, i);
+    }
+    if (texture.resident < texture.tail) {
+      victims.emplace(texture.error(), texture.pixels, i);
+    }
+  }
+  auto is_current = [this](const Entry& entry) -> bool {
+    return textures_[std::get<2>(entry)].error() == std::get<0>(entry);
+  };
+  auto push_victim = [&](size_t index) -> void {
+    const StreamedTexture& texture = textures_[index];
+    if (texture.resident < texture.tail) {
+      victims.emplace(texture.error(), texture.pixels, index);
+    }
+  };
+
+  // 预算被调低时先驱逐到预算以内
+  while (resident_bytes_ > options_.budget_bytes && !victims.empty()) {
+    Entry entry = victims.top();
+    victims.pop();
+    if (!is_current(entry)) {
+      continue;
+    }
+    evict(textures_[std::get<2>(entry)]);
+    push_victim(std::get<2>(entry));
+  }
+
+  uint64_t uploaded = 0;
+  while (!upgrades.empty() && (uploaded == 0 || uploaded < options_.upload_bytes_per_frame)) {
+    Entry entry = upgrades.top();
+    upgrades.pop();
+    if (!is_current(entry)) {
+      continue;
+    }
+    StreamedTexture& texture = textures_[std::get<2>(entry)];
+    const int error = texture.error();
+    const uint64_t bytes = levelBytes(texture.mips[texture.resident - 1]);
+    std::vector<Entry> taken;
+    if (resident_bytes_ + bytes > options_.budget_bytes) {
+      // 只驱逐驱逐后仍比当前纹理清晰的层，保证不会来回交换
+      uint64_t freeable = 0;
+      while (resident_bytes_ + bytes > options_.budget_bytes + freeable && !victims.empty()) {
+        Entry victim = victims.top();
+        if (!is_current(victim)) {
+          victims.pop();
+          continue;
+        }
+        if (std::get<0>(victim) + 1 >= error) {
+          break;
+        }
+        victims.pop();
+        const StreamedTexture& candidate = textures_[std::get<2>(victim)];
+        freeable += levelBytes(candidate.mips[candidate.resident]);
+        taken.push_back(victim);
+      }
+      if (resident_bytes_ + bytes > options_.budget_bytes + freeable) {
+        // 腾不出空间，跳过这个纹理，后面层级更小的纹理可能放得下
+        for (const auto& victim : taken) {
+          victims.push(victim);
+        }
+        continue;
+      }
+    }
+    if (texture.mips[texture.resident - 1].rgba.empty()) {
+      // 放得下但CPU上没有这一层，重新解码后再上传；计入本帧的上传量，CPU上等待上传的数据不超过几帧的上传量
+      for (const auto& victim : taken) {
+        victims.push(victim);
+      }
+      if (!texture.reloading && !texture.path.empty()) {
+        reload(texture, std::get<2>(entry));
+        uploaded += bytes;
+      }
+      continue;
+    }
+    for (const auto& victim : taken) {
+      evict(textures_[std::get<2>(victim)]);
+      push_victim(std::get<2>(victim));
+    }
+    uploaded += upgrade(texture);
+    if (texture.error() > 0) {
+      upgrades.emplace(texture.error(), texture.pixels, std::get<2>(entry));
+    }
+    push_victim(std::get<2>(entry));
+  }
+}
+
+TextureStreamer::TextureStreamer(const TextureStreamingOptions& options)
+    : impl_(make_unique_impl<TextureStreamerImpl>(options)) {}
+
+// 在TextureStreamerImpl完整定义处析构，等待后台解码并删除纹理
+TextureStreamer::~TextureStreamer() = default;
+
+auto TextureStreamer::load(const std::string& texture_path, bool flip) -> GLuint {
+  if (!std::filesystem::exists(texture_path)) {
+    fmt::print("TextureStreamer: Texture file not found: {}\n", texture_path);
+    return 0;
+  }
+  GL_HWK_TRACE_SCOPE("TextureStreamer::load");
+  const size_t index = impl_->create();
+  impl_->loading_++;
+  impl_->textures_[index].path = texture_path;
+  impl_->textures_[index].flip = flip;
+  impl_->decode(index, texture_path, flip);
+  return impl_->textures_[index].id;
+}
+
+auto TextureStreamer::load(uint32_t width, uint32_t height, std::vector<uint8_t> rgba) -> GLuint {
+  if (width == 0 || height == 0 || rgba.size() != static_cast<size_t>(width) * height * 4) {
+    fmt::print("TextureStreamer: Invalid RGBA data: {}x{}, {} bytes\n", width, height, rgba.size());
+    return 0;
+  }
+  const size_t index = impl_->create();
+  impl_->loading_++;
+  TextureStreamerImpl* impl = impl_.get();
+  JobSystem::instance().schedule(
+      [impl, index, width, height, rgba = std::move(rgba)]() mutable {
+        GL_HWK_TRACE_SCOPE("TextureStreamer::buildMipChain");
+        impl->finish(index, buildMipChain(width, height, std::move(rgba)));
+      },
+      &impl_->decoding_);
+  return impl_->textures_[index].id;
+}
+
+auto TextureStreamer::request(GLuint texture, Camera& camera, const Aabb& bounds) -> void {
+  if (bounds.isEmpty()) {
+    return;
+  }
+  // 按包围球估计屏幕上的边长，摄像机在包围球内时按近裁剪面计算
+  const glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+  const float radius = glm::length(bounds.max - bounds.min) * 0.5f;
+  const float distance = glm::length(center - camera.getPosition()) - radius;
+  request(texture, 2.0f * radius * camera.getFocalLength() / std::max(distance, camera.getNearPlane()));
+}
+
+auto TextureStreamer::request(GLuint texture, float screen_pixels) -> void {
+  StreamedTexture* streamed = impl_->find(texture);
+  if (streamed == nullptr) {
+    fmt::print("TextureStreamer: Texture ID not found: {}\n", texture);
+    return;
+  }
+  streamed->pixels = streamed->requested ? std::max(streamed->pixels, screen_pixels) : screen_pixels;
+  streamed->requested = true;
+}
+
+auto TextureStreamer::update() -> void {
+  GL_HWK_TRACE_SCOPE("TextureStreamer::update");
+  auto& impl = *impl_;
+  impl.stats_.uploaded_bytes = 0;
+  impl.stats_.evicted_bytes = 0;
+
+  std::vector<DecodedTexture> decoded;
+  {
+    std::lock_guard<std::mutex> lock(impl.mutex_);
+    decoded.swap(impl.decoded_);
+  }
+  for (auto& result : decoded) {
+    StreamedTexture& texture = impl.textures_[result.index];
+    if (texture.ready) {
+      impl.restore(texture, result.mips);
+      continue;
+    }
+    impl.loading_--;
+    if (result.mips.empty()) {
+      // 解码失败，保留占位纹理
+      continue;
+    }
+    texture.mips = std::move(result.mips);
+    impl.allocate(texture);
+  }
+
+  for (auto& texture : impl.textures_) {
+    if (!texture.ready) {
+      continue;
+    }
+    // 本帧没有用到的纹理只需要常驻的几层
+    texture.wanted = texture.requested ? impl.wantedLevel(texture, texture.pixels) : texture.tail;
+    if (!texture.requested) {
+      texture.pixels = 0.0f;
+    }
+    if (texture.error() < 0) {
+      if (++texture.idle_frames >= impl.options_.evict_delay_frames) {
+        impl.evict(texture);
+      }
+    } else {
+      texture.idle_frames = 0;
+    }
+  }
+
+  impl.streamMips();
+
+  uint32_t pending = 0;
+  for (auto& texture : impl.textures_) {
+    if (texture.ready) {
+      impl.releaseCpuLevels(texture);
+      pending += texture.error() > 0 ? 1 : 0;
+    }
+    texture.requested = false;
+  }
+  impl.stats_.pending = pending;
+  impl.stats_.frames++;
+}
+
+auto TextureStreamer::setBudget(uint64_t budget_bytes) -> void { impl_->options_.budget_bytes = budget_bytes; }
+
+auto TextureStreamer::getResidentLevel(GLuint texture) -> int {
+  StreamedTexture* streamed = impl_->find(texture);
+  if (streamed == nullptr || !streamed->ready) {
+    return -1;
+  }
+  return static_cast<int>(streamed->resident);
+}
+
+auto TextureStreamer::getWantedLevel(GLuint texture) -> int {
+  StreamedTexture* streamed = impl_->find(texture);
+  if (streamed == nullptr || !streamed->ready) {
+    return -1;
+  }
+  return static_cast<int>(streamed->wanted);
+}
+
+auto TextureStreamer::getStats() -> TextureStreamingStats {
+  TextureStreamingStats stats = impl_->stats_;
+  stats.textures = static_cast<uint32_t>(impl_->textures_.size());
+  stats.loading = impl_->loading_;
+  stats.resident_bytes = impl_->resident_bytes_;
+  for (const auto& texture : impl_->textures_) {
+    for (const auto& mip : texture.mips) {
+      stats.cpu_bytes += mip.rgba.size();
+    }
+  }
+  stats.budget_bytes = impl_->options_.budget_bytes;
+  return stats;
+}
+
+}  // namespace gl_hwk
@@ -0,0 +1,157 @@
+#include "gl_homework/trace.hpp"
+
+// clang-format off
+// std
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+// third party
+#include <fmt/core.h>
+// clang-format on
+
+namespace gl_hwk {
+
+struct TraceEvent {
+  const char* name;
+  uint64_t begin_ns;
+  uint64_t end_ns;
+};
+
+// 单生产者单消费者环形缓冲区，生产者为所属线程，消费者为writeChromeTrace
+struct ThreadTraceBuffer {
+  static constexpr uint64_t kCapacity = 1 << 16;
+
+  explicit ThreadTraceBuffer(uint32_t tid) : tid(tid), events(kCapacity) {}
+
+  auto push(const TraceEvent& event) -> bool {
+    uint64_t h = head.load(std::memory_order_relaxed);
+    uint64_t t = tail.load(std::memory_order_acquire);
+    if (h - t >= kCapacity) {
+      return false;
+    }
+    events[h & (kCapacity - 1)] = event;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  template <typename Func>
+  auto drain(Func&& func) -> void {
+    uint64_t t = tail.load(std::memory_order_relaxed);
+    uint64_t h = head.load(std::memory_order_acquire);
+    for (; t != h; ++t) {
+      func(events[t & (kCapacity - 1)]);
+    }
+    tail.store(h, std::memory_order_release);
+  }
+
+  uint32_t tid;
+  // 由registry的锁保护
+  std::string name;
+  std::vector<TraceEvent> events;
+  std::atomic<uint64_t> head{0};
+  std::atomic<uint64_t> tail{0};
+};
+
+struct CollectedEvent {
+  uint32_t tid;
+  TraceEvent event;
+};
+
+class TracerImpl {
+ public:
+  TracerImpl() : start_ns_(Tracer::now()) {}
+
+  auto threadBuffer() -> ThreadTraceBuffer& {
+    thread_local std::shared_ptr<ThreadTraceBuffer> buffer;
+    if (!buffer) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      buffer = std::make_shared<ThreadTraceBuffer>(static_cast<uint32_t>(buffers_.size() + 1));
+      buffers_.push_back(buffer);
+    }
+    return *buffer;
+  }
+
+  std::atomic<bool> enabled_{false};
+  std::atomic<uint64_t> dropped_{0};
+  uint64_t start_ns_;
+  std::mutex mutex_;
+  // 线程退出后缓冲区仍由这里持有，直到被写出
+  std::vector<std::shared_ptr<ThreadTraceBuffer>> buffers_;
+  // 已取出但还未写出的事件
+  std::vector<CollectedEvent> collected_;
+};
+
+Tracer::Tracer() : impl_(make_unique_impl<TracerImpl>()) {}
+
+auto Tracer::instance() -> Tracer& {
+  static Tracer instance;
+  return instance;
+}
+
+auto Tracer::setEnabled(bool enable) -> void { impl_->enabled_.store(enable, std::memory_order_relaxed); }
+
+auto Tracer::isEnabled() -> bool { return impl_->enabled_.load(std::memory_order_relaxed); }
+
+auto Tracer::now() -> uint64_t {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+auto Tracer::record(const char* name, uint64_t begin_ns, uint64_t end_ns) -> void {
+  if (!impl_->threadBuffer().push({name, begin_ns, end_ns})) {
+    impl_->dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+auto Tracer::setThreadName(const std::string& name) -> void {
+  auto& buffer = impl_->threadBuffer();
+  std::lock_guard<std::mutex> lock(impl_->mutex_);
+  buffer.name = name;
+}
+
+auto Tracer::writeChromeTrace(const std::string& path) -> bool {
+  std::lock_guard<std::mutex> lock(impl_->mutex_);
+  for (auto& buffer : impl_->buffers_) {
+    buffer->drain([&](const TraceEvent& event) { impl_->collected_.push_back({buffer->tid, event}); });
+  }
+
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    fmt::print("Tracer: Failed to open file: {}\n", path);
+    return false;
+  }
+  file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  bool first = true;
+  for (const auto& buffer : impl_->buffers_) {
+    if (buffer->name.empty()) {
+      continue;
+    }
+    file << fmt::format("{}{{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": {}, \"args\": {{\"name\": "
+                        "\"{}\"}}}}",
+                        first ? "" : ",\n", buffer->tid, buffer->name);
+    first = false;
+  }
+  for (const auto& collected : impl_->collected_) {
+    const auto& event = collected.event;
+    // Chrome trace的时间单位为us
+    double ts_us = static_cast<double>(event.begin_ns - impl_->start_ns_) * 1e-3;
+    double dur_us = static_cast<double>(event.end_ns - event.begin_ns) * 1e-3;
+    file << fmt::format(
+        "{}{{\"name\": \"{}\", \"cat\": \"gl_hwk\", \"ph\": \"X\", \"pid\": 1, \"tid\": {}, \"ts\": {:.3f}, \"dur\": "
+        "{:.3f}}}",
+        first ? "" : ",\n", event.name, collected.tid, ts_us, dur_us);
+    first = false;
+  }
+  file << "\n]}\n";
+  // 已写出的事件不再保留，下次只写之后记录的事件；打开文件失败时保留到下次
+  impl_->collected_.clear();
+  return true;
+}
+
+auto Tracer::getDroppedEvents() -> uint64_t { return impl_->dropped_.load(std::memory_order_relaxed); }
+
+}  // namespace gl_hwk
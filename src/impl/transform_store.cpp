@@ -0,0 +1,357 @@
+#include "gl_homework/transform_store.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <cmath>
+#include <vector>
+// project
+#include "gl_homework/job_system.hpp"
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GL_HWK_SIMD_X86 1
+#define GL_HWK_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_M_X64)
+// MSVC没有按函数指定指令集的方式，只使用x64必定支持的SSE2
+#define GL_HWK_SIMD_X86 1
+#define GL_HWK_SIMD_NO_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace gl_hwk {
+
+struct TransformArrays {
+  const float* px;
+  const float* py;
+  const float* pz;
+  const float* qx;
+  const float* qy;
+  const float* qz;
+  const float* qw;
+  const float* sx;
+  const float* sy;
+  const float* sz;
+};
+
+/**
+ * @brief 四元数转旋转矩阵，r[c][r]为第c列第r行，与glm::mat3_cast一致
+ * model的第c列为R的第c列乘s[c]，法线矩阵R*S^-1的第c列为R的第c列除以s[c]
+ */
+static auto composeScalar(const TransformArrays& a, size_t begin, size_t end, InstanceData* out) -> void {
+  for (size_t i = begin; i < end; ++i) {
+    float x = a.qx[i], y = a.qy[i], z = a.qz[i], w = a.qw[i];
+    float r[3][3] = {{1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y)},
+                     {2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x)},
+                     {2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y)}};
+    float s[3] = {a.sx[i], a.sy[i], a.sz[i]};
+    auto& model = out[i].model;
+    auto& normal = out[i].normal;
+    for (int c = 0; c < 3; ++c) {
+      model[c] = glm::vec4(r[c][0] * s[c], r[c][1] * s[c], r[c][2] * s[c], 0.0f);
+      float inv = 1.0f / s[c];
+      normal[c] = glm::vec4(r[c][0] * inv, r[c][1] * inv, r[c][2] * inv, 0.0f);
+    }
+    model[3] = glm::vec4(a.px[i], a.py[i], a.pz[i], 1.0f);
+    normal[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+  }
+}
+
+#ifdef GL_HWK_SIMD_X86
+/**
+ * @brief 4个物体同一列的x/y/z/w转置为每个物体的一列后写入
+ */
+static inline auto storeColumn4(__m128 x, __m128 y, __m128 z, __m128 w, InstanceData* out, bool normal, int column)
+    -> void {
+  _MM_TRANSPOSE4_PS(x, y, z, w);
+  __m128 columns[4] = {x, y, z, w};
+  for (int k = 0; k < 4; ++k) {
+    auto& m = normal ? out[k].normal : out[k].model;
+    _mm_storeu_ps(&m[column][0], columns[k]);
+  }
+}
+
+static auto composeSse(const TransformArrays& a, size_t begin, size_t end, InstanceData* out) -> void {
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 two = _mm_set1_ps(2.0f);
+  const __m128 zero = _mm_setzero_ps();
+  size_t i = begin;
+  for (; i + 4 <= end; i += 4) {
+    __m128 x = _mm_loadu_ps(a.qx + i), y = _mm_loadu_ps(a.qy + i);
+    __m128 z = _mm_loadu_ps(a.qz + i), w = _mm_loadu_ps(a.qw + i);
+    __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+    __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+    __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+    __m128 r[3][3] = {
+        {_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), _mm_mul_ps(two, _mm_add_ps(xy, wz)),
+         _mm_mul_ps(two, _mm_sub_ps(xz, wy))},
+        {_mm_mul_ps(two, _mm_sub_ps(xy, wz)), _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))),
+         _mm_mul_ps(two, _mm_add_ps(yz, wx))},
+        {_mm_mul_ps(two, _mm_add_ps(xz, wy)), _mm_mul_ps(two, _mm_sub_ps(yz, wx)),
+         _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)))}};
+    __m128 s[3] = {_mm_loadu_ps(a.sx + i), _mm_loadu_ps(a.sy + i), _mm_loadu_ps(a.sz + i)};
+    for (int c = 0; c < 3; ++c) {
+      __m128 inv = _mm_div_ps(one, s[c]);
+      storeColumn4(_mm_mul_ps(r[c][0], s[c]), _mm_mul_ps(r[c][1], s[c]), _mm_mul_ps(r[c][2], s[c]), zero, out + i,
+                   false, c);
+      storeColumn4(_mm_mul_ps(r[c][0], inv), _mm_mul_ps(r[c][1], inv), _mm_mul_ps(r[c][2], inv), zero, out + i, true,
+                   c);
+    }
+    storeColumn4(_mm_loadu_ps(a.px + i), _mm_loadu_ps(a.py + i), _mm_loadu_ps(a.pz + i), one, out + i, false, 3);
+    storeColumn4(zero, zero, zero, one, out + i, true, 3);
+  }
+  composeScalar(a, i, end, out);
+}
+
+#ifndef GL_HWK_SIMD_NO_AVX2
+/**
+ * @brief 8个物体的一列拆成高低两半，分别转置写入
+ */
+GL_HWK_TARGET_AVX2 static inline auto storeColumn8(__m256 x, __m256 y, __m256 z, __m256 w, InstanceData* out,
+                                                   bool normal, int column) -> void {
+  __m128 lo[4] = {_mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z),
+                  _mm256_castps256_ps128(w)};
+  __m128 hi[4] = {_mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1),
+                  _mm256_extractf128_ps(w, 1)};
+  _MM_TRANSPOSE4_PS(lo[0], lo[1], lo[2], lo[3]);
+  _MM_TRANSPOSE4_PS(hi[0], hi[1], hi[2], hi[3]);
+  for (int k = 0; k < 4; ++k) {
+    auto& m0 = normal ? out[k].normal : out[k].model;
+    auto& m1 = normal ? out[k + 4].normal : out[k + 4].model;
+    _mm_storeu_ps(&m0[column][0], lo[k]);
+    _mm_storeu_ps(&m1[column][0], hi[k]);
+  }
+}
+
+GL_HWK_TARGET_AVX2 static auto composeAvx2(const TransformArrays& a, size_t begin, size_t end, InstanceData* out)
+    -> void {
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 two = _mm256_set1_ps(2.0f);
+  const __m256 zero = _mm256_setzero_ps();
+  size_t i = begin;
+  for (; i + 8 <= end; i += 8) {
+    __m256 x = _mm256_loadu_ps(a.qx + i), y = _mm256_loadu_ps(a.qy + i);
+    __m256 z = _mm256_loadu_ps(a.qz + i), w = _mm256_loadu_ps(a.qw + i);
+    __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+    __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+    __m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+    __m256 r[3][3] = {
+        {_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), _mm256_mul_ps(two, _mm256_add_ps(xy, wz)),
+         _mm256_mul_ps(two, _mm256_sub_ps(xz, wy))},
+        {_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))),
+         _mm256_mul_ps(two, _mm256_add_ps(yz, wx))},
+        {_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), _mm256_mul_ps(two, _mm256_sub_ps(yz, wx)),
+         _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy)))}};
+    __m256 s[3] = {_mm256_loadu_ps(a.sx + i), _mm256_loadu_ps(a.sy + i), _mm256_loadu_ps(a.sz + i)};
+    for (int c = 0; c < 3; ++c) {
+      __m256 inv = _mm256_div_ps(one, s[c]);
+      storeColumn8(_mm256_mul_ps(r[c][0], s[c]), _mm256_mul_ps(r[c][1], s[c]), _mm256_mul_ps(r[c][2], s[c]), zero,
+                   out + i, false, c);
+      storeColumn8(_mm256_mul_ps(r[c][0], inv), _mm256_mul_ps(r[c][1], inv), _mm256_mul_ps(r[c][2], inv), zero,
+                   out + i, true, c);
+    }
+    storeColumn8(_mm256_loadu_ps(a.px + i), _mm256_loadu_ps(a.py + i), _mm256_loadu_ps(a.pz + i), one, out + i, false,
+                 3);
+    storeColumn8(zero, zero, zero, one, out + i, true, 3);
+  }
+  composeScalar(a, i, end, out);
+}
+#endif
+#endif
+
+/**
+ * @brief CPU支持的最高指令集
+ */
+static auto supportedSimdLevel() -> SimdLevel {
+#if defined(GL_HWK_SIMD_X86) && !defined(GL_HWK_SIMD_NO_AVX2)
+  return __builtin_cpu_supports("avx2") ? SimdLevel::kAvx2 : SimdLevel::kSse;
+#elif defined(GL_HWK_SIMD_X86)
+  return SimdLevel::kSse;
+#else
+  return SimdLevel::kScalar;
+#endif
+}
+
+class TransformStoreImpl {
+ public:
+  // 每个任务处理的物体数
+  static constexpr size_t kGrain = 4096;
+
+  TransformStoreImpl() : level_(supportedSimdLevel()) {}
+
+  auto arrays() -> TransformArrays {
+    return {px_.data(), py_.data(), pz_.data(), qx_.data(), qy_.data(),
+            qz_.data(), qw_.data(), sx_.data(), sy_.data(), sz_.data()};
+  }
+
+  auto compose(InstanceData* out, size_t begin, size_t end) -> void { composeArrays(arrays(), out, begin, end); }
+
+  /**
+   * @brief 插值[begin, end)的变换到blended_，再用同样的SIMD路径计算矩阵
+   */
+  auto composeInterpolated(InstanceData* out, size_t begin, size_t end, float alpha) -> void {
+    size_t saved = std::min(end, previous_[0].size());
+    const std::vector<float>* current[10] = {&px_, &py_, &pz_, &qx_, &qy_, &qz_, &qw_, &sx_, &sy_, &sz_};
+    for (int c = 0; c < 10; ++c) {
+      const float* from = previous_[c].data();
+      const float* to = current[c]->data();
+      float* dst = blended_[c].data();
+      // 旋转在下面单独插值
+      bool rotation = c >= 3 && c <= 6;
+      for (size_t i = begin; i < saved && !rotation; ++i) {
+        dst[i] = from[i] + (to[i] - from[i]) * alpha;
+      }
+      for (size_t i = std::max(begin, saved); i < end; ++i) {
+        dst[i] = to[i];
+      }
+    }
+    // 两个四元数的夹角超过90度时，取反起点以沿较短的弧插值
+    for (size_t i = begin; i < saved; ++i) {
+      float dot = previous_[3][i] * qx_[i] + previous_[4][i] * qy_[i] + previous_[5][i] * qz_[i] +
+                  previous_[6][i] * qw_[i];
+      float sign = dot < 0.0f ? -1.0f : 1.0f;
+      float q[4];
+      float length = 0.0f;
+      for (int c = 0; c < 4; ++c) {
+        float from = previous_[3 + c][i] * sign;
+        q[c] = from + ((*current[3 + c])[i] - from) * alpha;
+        length += q[c] * q[c];
+      }
+      float inv = 1.0f / std::sqrt(std::max(length, 1e-12f));
+      for (int c = 0; c < 4; ++c) {
+        blended_[3 + c][i] = q[c] * inv;
+      }
+    }
+    TransformArrays a = {blended_[0].data(), blended_[1].data(), blended_[2].data(), blended_[3].data(),
+                         blended_[4].data(), blended_[5].data(), blended_[6].data(), blended_[7].data(),
+                         blended_[8].data(), blended_[9].data()};
+    composeArrays(a, out, begin, end);
+  }
+
+  auto composeArrays(const TransformArrays& a, InstanceData* out, size_t begin, size_t end) -> void {
+    switch (level_) {
+#ifdef GL_HWK_SIMD_X86
+#ifndef GL_HWK_SIMD_NO_AVX2
+      case SimdLevel::kAvx2:
+        composeAvx2(a, begin, end, out);
+        break;
+#endif
+      case SimdLevel::kSse:
+        composeSse(a, begin, end, out);
+        break;
+#endif
+      default:
+        composeScalar(a, begin, end, out);
+        break;
+    }
+  }
+
+  std::vector<float> px_, py_, pz_;
+  std::vector<float> qx_, qy_, qz_, qw_;
+  std::vector<float> sx_, sy_, sz_;
+  // saveState保存的变换和插值结果，顺序与TransformArrays相同
+  std::vector<float> previous_[10];
+  std::vector<float> blended_[10];
+  SimdLevel level_;
+};
+
+TransformStore::TransformStore() : impl_(make_unique_impl<TransformStoreImpl>()) {}
+
+// 在TransformStoreImpl完整定义处析构
+TransformStore::~TransformStore() = default;
+
+auto TransformStore::add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) -> uint32_t {
+  auto index = static_cast<uint32_t>(impl_->px_.size());
+  resize(index + 1);
+  setPosition(index, position);
+  setRotation(index, rotation);
+  setScale(index, scale);
+  return index;
+}
+
+auto TransformStore::resize(size_t size) -> void {
+  for (auto* v : {&impl_->px_, &impl_->py_, &impl_->pz_, &impl_->qx_, &impl_->qy_, &impl_->qz_}) {
+    v->resize(size, 0.0f);
+  }
+  // 新物体默认为单位变换
+  impl_->qw_.resize(size, 1.0f);
+  for (auto* v : {&impl_->sx_, &impl_->sy_, &impl_->sz_}) {
+    v->resize(size, 1.0f);
+  }
+}
+
+auto TransformStore::size() -> size_t { return impl_->px_.size(); }
+
+auto TransformStore::setPosition(uint32_t index, const glm::vec3& position) -> void {
+  impl_->px_[index] = position.x;
+  impl_->py_[index] = position.y;
+  impl_->pz_[index] = position.z;
+}
+
+auto TransformStore::setRotation(uint32_t index, const glm::quat& rotation) -> void {
+  glm::quat q = glm::normalize(rotation);
+  impl_->qx_[index] = q.x;
+  impl_->qy_[index] = q.y;
+  impl_->qz_[index] = q.z;
+  impl_->qw_[index] = q.w;
+}
+
+auto TransformStore::setScale(uint32_t index, const glm::vec3& scale) -> void {
+  impl_->sx_[index] = scale.x;
+  impl_->sy_[index] = scale.y;
+  impl_->sz_[index] = scale.z;
+}
+
+auto TransformStore::getPosition(uint32_t index) -> glm::vec3 {
+  return {impl_->px_[index], impl_->py_[index], impl_->pz_[index]};
+}
+
+auto TransformStore::getRotation(uint32_t index) -> glm::quat {
+  return glm::quat(impl_->qw_[index], impl_->qx_[index], impl_->qy_[index], impl_->qz_[index]);
+}
+
+auto TransformStore::getScale(uint32_t index) -> glm::vec3 {
+  return {impl_->sx_[index], impl_->sy_[index], impl_->sz_[index]};
+}
+
+auto TransformStore::compose(InstanceData* out, size_t begin, size_t end) -> void { impl_->compose(out, begin, end); }
+
+auto TransformStore::compose(InstanceBuffer& instances) -> void {
+  GL_HWK_TRACE_SCOPE("TransformStore::compose");
+  instances.resize(size());
+  InstanceData* out = instances.data();
+  auto* impl = impl_.get();
+  JobSystem::instance().parallelFor(size(), TransformStoreImpl::kGrain,
+                                    [impl, out](size_t begin, size_t end) { impl->compose(out, begin, end); });
+}
+
+auto TransformStore::saveState() -> void {
+  const std::vector<float>* current[10] = {&impl_->px_, &impl_->py_, &impl_->pz_, &impl_->qx_, &impl_->qy_,
+                                           &impl_->qz_, &impl_->qw_, &impl_->sx_, &impl_->sy_, &impl_->sz_};
+  for (int c = 0; c < 10; ++c) {
+    impl_->previous_[c] = *current[c];
+  }
+}
+
+auto TransformStore::compose(InstanceBuffer& instances, float alpha) -> void {
+  GL_HWK_TRACE_SCOPE("TransformStore::compose");
+  instances.resize(size());
+  for (auto& v : impl_->blended_) {
+    v.resize(size());
+  }
+  InstanceData* out = instances.data();
+  auto* impl = impl_.get();
+  JobSystem::instance().parallelFor(size(), TransformStoreImpl::kGrain, [impl, out, alpha](size_t begin, size_t end) {
+    impl->composeInterpolated(out, begin, end, alpha);
+  });
+}
+
+auto TransformStore::setSimdLevel(SimdLevel level) -> void {
+  impl_->level_ = std::min(level, supportedSimdLevel());
+}
+
+auto TransformStore::getSimdLevel() -> SimdLevel { return impl_->level_; }
+
+}  // namespace gl_hwk
@@ -0,0 +1,380 @@
+#include "gl_homework/transparency_renderer.hpp"
+
+// clang-format off
+// std
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <vector>
+// third party
+#include <fmt/core.h>
+// project
+#include "gl_homework/gpu_profiler.hpp"
+#include "gl_homework/render_stats.hpp"
+#include "gl_homework/trace.hpp"
+// clang-format on
+
+namespace gl_hwk {
+
+namespace {
+
+struct TransparentObject {
+  // 排序键，越远越小
+  uint32_t key;
+  uint32_t id;
+  Shader* shader;
+};
+
+/**
+ * @brief 把浮点数映射为保持大小顺序的无符号整数
+ */
+auto sortableKey(float value) -> uint32_t {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits ^ ((bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u);
+}
+
+/**
+ * @brief 按key升序的LSD基数排序，每次8位；所有元素某一字节相同时跳过该趟
+ */
+auto radixSort(std::vector<TransparentObject>& objects, std::vector<TransparentObject>& temp) -> void {
+  const size_t n = objects.size();
+  std::array<std::array<uint32_t, 256>, 4> histograms{};
+  for (const auto& object : objects) {
+    for (int pass = 0; pass < 4; ++pass) {
+      histograms[pass][(object.key >> (pass * 8)) & 0xFF]++;
+    }
+  }
+  temp.resize(n);
+  for (int pass = 0; pass < 4; ++pass) {
+    auto& histogram = histograms[pass];
+    if (histogram[(objects[0].key >> (pass * 8)) & 0xFF] == n) {
+      continue;
+    }
+    uint32_t offset = 0;
+    for (auto& count : histogram) {
+      uint32_t next = offset + count;
+      count = offset;
+      offset = next;
+    }
+    for (const auto& object : objects) {
+      temp[histogram[(object.key >> (pass * 8)) & 0xFF]++] = object;
+    }
+    objects.swap(temp);
+  }
+}
+
+}  // namespace
+
+class TransparencyRendererImpl {
+ public:
+  explicit TransparencyRendererImpl(const TransparencyOptions& options)
+      : options_(options), composite_shader_("shader/oit_composite.vert.GLSL", "shader/oit_composite.frag.GLSL") {
+    composite_shader_.start();
+    composite_shader_.setInt("accumTexture", 0);
+    composite_shader_.setInt("weightTexture", 1);
+  }
+
+  ~TransparencyRendererImpl() {
+    destroyTargets();
+    if (vao_ != 0) {
+      glDeleteVertexArrays(1, &vao_);
+    }
+  }
+
+  auto mode() const -> TransparencyMode { return fallback_ ? TransparencyMode::kSorted : options_.mode; }
+
+  auto destroyTargets() -> void {
+    if (fbo_ == 0) {
+      return;
+    }
+    glDeleteFramebuffers(1, &fbo_);
+    glDeleteTextures(2, textures_);
+    if (depth_rbo_ != 0) {
+      glDeleteRenderbuffers(1, &depth_rbo_);
+    }
+    RenderStats::instance().addTexture(GL_TEXTURE_2D, -2, -targetBytes());
+    fbo_ = 0;
+    depth_rbo_ = 0;
+  }
+
+  auto targetBytes() const -> int64_t { return static_cast<int64_t>(width_) * height_ * (8 + 2); }
+
+  /**
+   * @brief 与framebuffer的深度缓冲格式相同的格式，glBlitFramebuffer复制深度时要求格式一致；没有深度缓冲时返回0
+   */
+  static auto depthFormat(GLint framebuffer) -> GLenum {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    auto query = [&](GLenum attachment, GLenum pname) -> GLint {
+      GLint type = GL_NONE;
+      glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE,
+                                            &type);
+      GLint value = 0;
+      if (type != GL_NONE) {
+        glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, attachment, pname, &value);
+      }
+      return value;
+    };
+    GLenum depth = framebuffer == 0 ? GL_DEPTH : GL_DEPTH_ATTACHMENT;
+    GLint depth_bits = query(depth, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE);
+    if (depth_bits == 0) {
+      return 0;
+    }
+    GLint stencil_bits = query(framebuffer == 0 ? GL_STENCIL : GL_STENCIL_ATTACHMENT,
+                               GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE);
+    bool is_float = query(depth, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE) == GL_FLOAT;
+    if (is_float) {
+      return stencil_bits > 0 ? GL_DEPTH32F_STENCIL8 : GL_DEPTH_COMPONENT32F;
+    }
+    if (stencil_bits > 0) {
+      return GL_DEPTH24_STENCIL8;
+    }
+    return depth_bits == 16 ? GL_DEPTH_COMPONENT16 : depth_bits == 32 ? GL_DEPTH_COMPONENT32 : GL_DEPTH_COMPONENT24;
+  }
+
+  /**
+   * @brief 按需(重新)创建累积纹理、权重纹理和深度缓冲，帧缓冲不完整时返回false
+   */
+  auto ensureTargets(GLint framebuffer, uint32_t width, uint32_t height) -> bool {
+    if (fbo_ != 0 && width == width_ && height == height_ && framebuffer == framebuffer_) {
+      return true;
+    }
+    // 帧缓冲变化时才查询深度格式
+    GLenum depth_format = depthFormat(framebuffer);
+    framebuffer_ = framebuffer;
+    if (fbo_ != 0 && width == width_ && height == height_ && depth_format == depth_format_) {
+      return true;
+    }
+    destroyTargets();
+    width_ = width;
+    height_ = height;
+    depth_format_ = depth_format;
+
+    glGenFramebuffers(1, &fbo_);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glGenTextures(2, textures_);
+    const GLenum formats[2][2] = {{GL_RGBA16F, GL_RGBA}, {GL_R16F, GL_RED}};
+    for (int i = 0; i < 2; ++i) {
+      glBindTexture(GL_TEXTURE_2D, textures_[i]);
+      glTexImage2D(GL_TEXTURE_2D, 0, formats[i][0], width, height, 0, formats[i][1], GL_HALF_FLOAT, nullptr);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, textures_[i], 0);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    RenderStats::instance().addTexture(GL_TEXTURE_2D, 2, targetBytes());
+    if (depth_format != 0) {
+      bool stencil = depth_format == GL_DEPTH24_STENCIL8 || depth_format == GL_DEPTH32F_STENCIL8;
+      glGenRenderbuffers(1, &depth_rbo_);
+      glBindRenderbuffer(GL_RENDERBUFFER, depth_rbo_);
+      glRenderbufferStorage(GL_RENDERBUFFER, depth_format, width, height);
+      glFramebufferRenderbuffer(GL_FRAMEBUFFER, stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+                                GL_RENDERBUFFER, depth_rbo_);
+    }
+    const GLenum buffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, buffers);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      fmt::print("TransparencyRenderer: float render targets not supported, falling back to sorting\n");
+      destroyTargets();
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief 依次绘制物体，着色器变化时才重新启用；加权混合时打开着色器的oitPass
+   */
+  auto drawObjects(const TransparentDrawFunc& draw, bool weighted) -> void {
+    Shader* current = nullptr;
+    for (const auto& object : objects_) {
+      if (object.shader != current) {
+        current = object.shader;
+        current->start();
+        if (weighted) {
+          current->setInt("oitPass", 1);
+          if (std::find(weighted_shaders_.begin(), weighted_shaders_.end(), current) == weighted_shaders_.end()) {
+            weighted_shaders_.push_back(current);
+          }
+        }
+      }
+      draw(*current, object.id);
+    }
+    for (Shader* shader : weighted_shaders_) {
+      shader->start();
+      shader->setInt("oitPass", 0);
+    }
+    weighted_shaders_.clear();
+  }
+
+  auto renderWeighted(const TransparentDrawFunc& draw, GLint framebuffer, const GLint viewport[4]) -> bool {
+    uint32_t width = static_cast<uint32_t>(viewport[2]);
+    uint32_t height = static_cast<uint32_t>(viewport[3]);
+    if (!ensureTargets(framebuffer, width, height)) {
+      return false;
+    }
+    // 半透明物体需要被不透明物体遮挡，复制当前的深度缓冲
+    if (depth_rbo_ != 0) {
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+      glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo_);
+      glBlitFramebuffer(viewport[0], viewport[1], viewport[0] + viewport[2], viewport[1] + viewport[3], 0, 0, width,
+                        height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glViewport(0, 0, width, height);
+    const float accum_clear[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    const float weight_clear[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glClearBufferfv(GL_COLOR, 0, accum_clear);
+    glClearBufferfv(GL_COLOR, 1, weight_clear);
+    // 颜色和权重相加，alpha通道累乘透射率
+    glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+    drawObjects(draw, true);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_DEPTH_TEST);
+    composite_shader_.start();
+    composite_shader_.setIvec2("viewportOrigin", viewport[0], viewport[1]);
+    for (int i = 0; i < 2; ++i) {
+      glActiveTexture(GL_TEXTURE0 + i);
+      glBindTexture(GL_TEXTURE_2D, textures_[i]);
+    }
+    if (vao_ == 0) {
+      glGenVertexArrays(1, &vao_);
+    }
+    glBindVertexArray(vao_);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    RenderStats::instance().addDrawCall(GL_TRIANGLES, 3);
+    RenderStats::instance().addStateChange(12);
+    return true;
+  }
+
+  auto renderSorted(const TransparentDrawFunc& draw) -> void {
+    auto start = std::chrono::steady_clock::now();
+    if (objects_.size() > 1) {
+      radixSort(objects_, temp_);
+    }
+    stats_.sort_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    drawObjects(draw, false);
+    RenderStats::instance().addStateChange(2);
+  }
+
+  auto render(const TransparentDrawFunc& draw) -> void {
+    GL_HWK_TRACE_SCOPE("TransparencyRenderer::render");
+    stats_.frames++;
+    stats_.objects = static_cast<uint32_t>(objects_.size());
+    stats_.sort_ms = 0.0;
+    if (objects_.empty()) {
+      return;
+    }
+    GpuProfileScope scope("transparent");
+    // 保存调用者的状态
+    GLint framebuffer, read_framebuffer, viewport[4], program, vao, textures[2];
+    GLint blend_src_rgb, blend_dst_rgb, blend_src_alpha, blend_dst_alpha;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_framebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vao);
+    for (int i = 0; i < 2; ++i) {
+      glActiveTexture(GL_TEXTURE0 + i);
+      glGetIntegerv(GL_TEXTURE_BINDING_2D, &textures[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glGetIntegerv(GL_BLEND_SRC_RGB, &blend_src_rgb);
+    glGetIntegerv(GL_BLEND_DST_RGB, &blend_dst_rgb);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, &blend_src_alpha);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, &blend_dst_alpha);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean depth_mask;
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &depth_mask);
+
+    // 半透明物体之间不互相遮挡
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    if (mode() == TransparencyMode::kWeightedBlended && !renderWeighted(draw, framebuffer, viewport)) {
+      fallback_ = true;
+      glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+    if (mode() == TransparencyMode::kSorted) {
+      renderSorted(draw);
+    }
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glUseProgram(program);
+    glBindVertexArray(vao);
+    for (int i = 1; i >= 0; --i) {
+      glActiveTexture(GL_TEXTURE0 + i);
+      glBindTexture(GL_TEXTURE_2D, textures[i]);
+    }
+    glBlendFuncSeparate(blend_src_rgb, blend_dst_rgb, blend_src_alpha, blend_dst_alpha);
+    if (!blend) {
+      glDisable(GL_BLEND);
+    }
+    if (depth_test) {
+      glEnable(GL_DEPTH_TEST);
+    }
+    glDepthMask(depth_mask);
+  }
+
+  TransparencyOptions options_;
+  Shader composite_shader_;
+  glm::mat4 view_ = glm::mat4(1.0f);
+  std::vector<TransparentObject> objects_;
+  std::vector<TransparentObject> temp_;
+  std::vector<Shader*> weighted_shaders_;
+
+  GLuint fbo_ = 0;
+  // 0为累积颜色和透射率，1为权重
+  GLuint textures_[2] = {0, 0};
+  GLuint depth_rbo_ = 0;
+  GLenum depth_format_ = 0;
+  // 上次复制深度的帧缓冲
+  GLint framebuffer_ = -1;
+  GLuint vao_ = 0;
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  bool fallback_ = false;
+  TransparencyStats stats_;
+};
+
+TransparencyRenderer::TransparencyRenderer(const TransparencyOptions& options)
+    : impl_(make_unique_impl<TransparencyRendererImpl>(options)) {}
+
+// 在TransparencyRendererImpl完整定义处析构，释放帧缓冲
+TransparencyRenderer::~TransparencyRenderer() = default;
+
+auto TransparencyRenderer::setMode(TransparencyMode mode) -> void {
+  impl_->options_.mode = mode;
+  // 允许重新尝试创建浮点渲染目标
+  impl_->fallback_ = false;
+}
+
+auto TransparencyRenderer::getMode() -> TransparencyMode { return impl_->mode(); }
+
+auto TransparencyRenderer::begin(const glm::mat4& view) -> void {
+  impl_->view_ = view;
+  impl_->objects_.clear();
+}
+
+auto TransparencyRenderer::add(const glm::vec3& center, Shader& shader, uint32_t id) -> void {
+  const auto& view = impl_->view_;
+  // 只需要视图空间的z，越远-z越大
+  float depth = -(view[0][2] * center.x + view[1][2] * center.y + view[2][2] * center.z + view[3][2]);
+  impl_->objects_.push_back({~sortableKey(depth), id, &shader});
+}
+
+auto TransparencyRenderer::render(const TransparentDrawFunc& draw) -> void { impl_->render(draw); }
+
+auto TransparencyRenderer::getStats() -> TransparencyStats {
+  auto stats = impl_->stats_;
+  stats.fallback = impl_->fallback_;
+  return stats;
+}
+
+}  // namespace gl_hwk
@@ -6,16 +6,46 @@ add_requires("glew")
 add_requires("freeglut")
 add_requires("glm")
 add_requires("fmt")
-add_requires("opencv")
 
 add_cxxflags("-Wno-delete-incomplete")
+
+-- CPU trace事件，关闭后trace宏在编译期被移除
+option("trace")
+    set_default(true)
+    set_showmenu(true)
+    set_description("Enable CPU trace events")
+option_end()
+
+if not has_config("trace") then
+    add_defines("GL_HWK_DISABLE_TRACE")
+end
+
+-- 图片使用内置的JPEG/PNG解码器，开启后内置解码器不支持的格式交给OpenCV
+option("opencv")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Use OpenCV as fallback image decoder")
+option_end()
+
+if has_config("opencv") then
+    add_requires("opencv")
+end
 -- set_targetdir("build")
 
 target("gl_homework")
     set_kind("shared")
     add_files("src/impl/*.cpp")
     add_includedirs("include")
-    add_packages("glew", "freeglut", "glm", "fmt", "opencv")
+    add_packages("glew", "freeglut", "glm", "fmt")
+    if has_config("opencv") then
+        add_packages("opencv")
+        add_defines("GL_HWK_WITH_OPENCV")
+    end
+    -- 无窗口模式使用EGL surfaceless上下文
+    if is_plat("linux") then
+        add_syslinks("EGL")
+        add_defines("GL_HWK_WITH_EGL")
+    end
     set_installdir("install")
     after_install(function (target)
         -- copy include
@@ -37,3 +67,26 @@ target("example")
 
 
 
+-- 场景级benchmark，无窗口运行
+target("bench")
+    set_kind("binary")
+    add_files("bench/scene_bench.cpp")
+    add_deps("gl_homework")
+    add_includedirs("include")
+    add_packages("freeglut", "glew", "glm", "fmt")
+    after_build(function (target)
+        os.cp("shader/", target:targetdir())
+        os.cp("texture/", target:targetdir())
+    end)
+
+-- 库自身CPU热点的microbenchmark，GL函数替换为空实现，不需要OpenGL上下文
+target("micro_bench")
+    set_kind("binary")
+    add_files("bench/micro_bench.cpp", "bench/gl_stub.cpp")
+    add_deps("gl_homework")
+    add_includedirs("include")
+    add_packages("freeglut", "glew", "glm", "fmt")
+    after_build(function (target)
+        os.cp("shader/", target:targetdir())
+        os.cp("texture/", target:targetdir())
+    end)